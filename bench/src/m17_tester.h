@@ -0,0 +1,204 @@
+#pragma once
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#include <dsp/fec/viterbi.h>
+#include <golay24.h>
+#include <crc16.h>
+
+// Error correction stages of the M17 decoder, the headers come from the module which is built separately
+
+namespace m17_bench {
+    // Generators of the K=5 convolutional code, same as M17_CONV_POLY_1/2 of the decoder
+    const int CONV_POLY_1 = 0b11001;
+    const int CONV_POLY_2 = 0b10111;
+
+    // Encoded size of a link setup frame: 240 bits and 4 flush bits, two soft bits per bit
+    const int LSF_BITS = 244;
+    const int LSF_SOFT_BITS = LSF_BITS * 2;
+
+    // Results of the benchmarks are written here so that the work isn't optimized out
+    inline volatile uint32_t sink = 0;
+
+    // Encode bits with the convolutional code, flushing the encoder with the last 4 bits which must be zero
+    inline void convEncode(const uint8_t* bits, int count, int8_t* soft) {
+        int state = 0;
+        for (int i = 0; i < count; i++) {
+            int sr = (state << 1) | bits[i];
+            soft[2*i] = dsp::fec::viterbi_detail::parity(sr & CONV_POLY_1) ? 127 : -127;
+            soft[2*i + 1] = dsp::fec::viterbi_detail::parity(sr & CONV_POLY_2) ? 127 : -127;
+            state = sr & 0xF;
+        }
+    }
+
+    // Random LSF sized frame, noisy but with the sign of every soft bit right except for `flips` of them
+    inline void makeFrame(uint8_t* bits, int8_t* soft, int flips) {
+        for (int i = 0; i < LSF_BITS; i++) { bits[i] = (i < LSF_BITS - 4) ? (rand() & 1) : 0; }
+        convEncode(bits, LSF_BITS, soft);
+        for (int i = 0; i < LSF_SOFT_BITS; i++) {
+            int mag = 32 + (rand() % 96);
+            soft[i] = (soft[i] > 0) ? mag : -mag;
+        }
+        for (int i = 0; i < flips; i++) {
+            int id = rand() % LSF_SOFT_BITS;
+            soft[id] = -soft[id];
+        }
+    }
+
+    /**
+     * Decode noisy LSF frames with a few wrong bits, spaced out enough for the code to correct them.
+     * @param frames Number of frames to decode.
+     * @return Number of frames decoded wrong.
+     */
+    inline int testViterbi(int frames) {
+        dsp::fec::Viterbi<5> viterbi(CONV_POLY_1, CONV_POLY_2);
+        uint8_t bits[LSF_BITS];
+        uint8_t decoded[LSF_BITS];
+        int8_t soft[LSF_SOFT_BITS];
+        int failed = 0;
+        for (int f = 0; f < frames; f++) {
+            makeFrame(bits, soft, 0);
+            // One wrong bit every 40 soft bits is well within the free distance of 7 of the code
+            for (int i = rand() % 40; i < LSF_SOFT_BITS; i += 40) { soft[i] = -soft[i]; }
+            viterbi.decode(soft, LSF_SOFT_BITS, decoded);
+            failed += (memcmp(bits, decoded, LSF_BITS) != 0);
+        }
+        return failed;
+    }
+
+    /**
+     * Measure the throughput of the Viterbi decoder on LSF frames.
+     * @param durationMs Duration of the test in milliseconds.
+     * @return Number of frames decoded per second.
+     */
+    inline double benchmarkViterbi(int durationMs) {
+        dsp::fec::Viterbi<5> viterbi(CONV_POLY_1, CONV_POLY_2);
+        uint8_t bits[LSF_BITS];
+        uint8_t decoded[LSF_BITS];
+        int8_t soft[LSF_SOFT_BITS];
+        makeFrame(bits, soft, 4);
+
+        uint64_t frameCount = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto end = start + std::chrono::milliseconds(durationMs);
+        auto now = start;
+        while (now < end) {
+            for (int i = 0; i < 100; i++) { viterbi.decode(soft, LSF_SOFT_BITS, decoded); }
+            frameCount += 100;
+            now = std::chrono::high_resolution_clock::now();
+        }
+
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        return (double)frameCount / elapsed;
+    }
+
+    // Flip up to 3 random bits of the Golay codeword, the parity bit at bit 0 isn't covered by the correction
+    inline uint32_t golayErrors(int count) {
+        uint32_t errors = 0;
+        while (mobilinkd::Golay24::popcount(errors) < count) { errors |= 1 << (1 + (rand() % 23)); }
+        return errors;
+    }
+
+    /**
+     * Encode every 12bit word, corrupt it with up to 3 errors and decode it.
+     * @return Number of words decoded wrong or reported as uncorrectable.
+     */
+    inline int testGolay24() {
+        int failed = 0;
+        for (int errors = 0; errors <= 3; errors++) {
+            for (uint32_t data = 0; data < 4096; data++) {
+                uint32_t decoded;
+                uint32_t encoded = mobilinkd::Golay24::encode24(data) ^ golayErrors(errors);
+                bool ok = mobilinkd::Golay24::decode(encoded, decoded);
+                failed += (!ok || (decoded >> 12) != data);
+            }
+        }
+        return failed;
+    }
+
+    /**
+     * Measure the throughput of the Golay decoder on corrupted words.
+     * @param durationMs Duration of the test in milliseconds.
+     * @return Number of words decoded per second.
+     */
+    inline double benchmarkGolay24(int durationMs) {
+        uint32_t words[4096];
+        for (uint32_t i = 0; i < 4096; i++) { words[i] = mobilinkd::Golay24::encode24(i) ^ golayErrors(rand() % 4); }
+
+        uint64_t wordCount = 0;
+        uint32_t sum = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto end = start + std::chrono::milliseconds(durationMs);
+        auto now = start;
+        while (now < end) {
+            for (int i = 0; i < 4096; i++) {
+                uint32_t decoded;
+                mobilinkd::Golay24::decode(words[i], decoded);
+                sum += decoded;
+            }
+            wordCount += 4096;
+            now = std::chrono::high_resolution_clock::now();
+        }
+
+        sink = sum;
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        return (double)wordCount / elapsed;
+    }
+
+    /**
+     * Check the table driven CRC against the bit by bit one and the check value of the M17 CRC.
+     * @return Number of mismatches.
+     */
+    inline int testCRC16() {
+        int failed = 0;
+
+        // The M17 specification gives 0x772B for "123456789"
+        mobilinkd::CRC16<> crc;
+        crc.reset();
+        crc((const uint8_t*)"123456789", 9);
+        failed += (crc.get() != 0x772B);
+
+        // Bytes fed one at a time through the bitwise division
+        uint8_t data[256];
+        for (int i = 0; i < 256; i++) { data[i] = rand(); }
+        mobilinkd::CRC16<> ref;
+        ref.reset();
+        crc.reset();
+        for (int i = 0; i < 256; i++) {
+            ref.reg_ = ref.crc(data[i], ref.reg_);
+            crc(data[i]);
+            failed += (crc.reg_ != ref.reg_);
+        }
+        return failed;
+    }
+
+    /**
+     * Measure the throughput of the CRC on LSF sized buffers.
+     * @param durationMs Duration of the test in milliseconds.
+     * @return Number of bytes processed per second.
+     */
+    inline double benchmarkCRC16(int durationMs) {
+        uint8_t lsf[28];
+        for (int i = 0; i < 28; i++) { lsf[i] = rand(); }
+
+        uint64_t byteCount = 0;
+        uint16_t sum = 0;
+        mobilinkd::CRC16<> crc;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto end = start + std::chrono::milliseconds(durationMs);
+        auto now = start;
+        while (now < end) {
+            for (int i = 0; i < 1000; i++) {
+                crc.reset();
+                crc(lsf, 28);
+                sum += crc.get();
+            }
+            byteCount += 28 * 1000;
+            now = std::chrono::high_resolution_clock::now();
+        }
+
+        sink = sum;
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        return (double)byteCount / elapsed;
+    }
+}
@@ -0,0 +1,106 @@
+#include <utils/flog.h>
+#include <dsp/bench/convert_tester.h>
+#include <dsp/bench/one_pole_tester.h>
+#include <dsp/bench/nco_tester.h>
+#include <dsp/loop/costas.h>
+#include "m17_tester.h"
+
+// Benchmarks and self-tests of the DSP kernels, kept out of the sdrpp binary
+
+void benchmarkConvert() {
+    // Sample format conversion, with the block size typical of sources
+    const char* formatNames[] = { "U8", "S8", "S12 packed", "S16", "S24 BE", "S24 LE", "S32", "F32" };
+    for (int i = 0; i <= dsp::convert::SAMPLE_FORMAT_F32; i++) {
+        double rate = dsp::bench::benchmarkConvert((dsp::convert::SampleFormat)i, 500, 16384);
+        flog::info("Convert {0}: {1} MS/s", formatNames[i], (int)(rate / 1e6));
+    }
+}
+
+const char* ncoAccuracyNames[] = { "exact", "high", "low" };
+
+void benchmarkNCO() {
+    // Oscillator alone, then the loops driving it with a new phase every sample
+    for (int i = 0; i <= dsp::math::NCO::ACCURACY_LOW; i++) {
+        dsp::math::NCO::Accuracy accuracy = (dsp::math::NCO::Accuracy)i;
+        double nco = dsp::bench::benchmarkNCO(accuracy, 500, 16384);
+        double pll = dsp::bench::benchmarkLoop<dsp::loop::PLL>(accuracy, 500, 16384);
+        double costas = dsp::bench::benchmarkLoop<dsp::loop::Costas<2>>(accuracy, 500, 16384);
+        flog::info("NCO {0}: {1} MS/s, PLL {2} MS/s, Costas {3} MS/s", ncoAccuracyNames[i], (int)(nco / 1e6), (int)(pll / 1e6), (int)(costas / 1e6));
+    }
+}
+
+int testNCO() {
+    // Errors documented for each accuracy of the NCO, exact is only off by the float rounding of cosf/sinf
+    const double maxErrors[] = { 1e-6, 1e-5, 3.1e-3 };
+    int failed = 0;
+    for (int i = 0; i <= dsp::math::NCO::ACCURACY_LOW; i++) {
+        double err = dsp::bench::testNCO((dsp::math::NCO::Accuracy)i, 1000000);
+        flog::info("NCO {0}: error {1} ppm", ncoAccuracyNames[i], err * 1e6);
+        if (err > maxErrors[i]) {
+            flog::error("NCO {0}: error above {1}", ncoAccuracyNames[i], maxErrors[i]);
+            failed++;
+        }
+    }
+    return failed;
+}
+
+void benchmarkM17() {
+    // Error correction of the M17 decoder, per link setup frame for the Viterbi decoder
+    double viterbi = m17_bench::benchmarkViterbi(500);
+    double golay = m17_bench::benchmarkGolay24(500);
+    double crc = m17_bench::benchmarkCRC16(500);
+    flog::info("M17 Viterbi<5>: {0} LSF/s, Golay24: {1} Mwords/s, CRC16: {2} MB/s", (int)viterbi, (int)(golay / 1e6), (int)(crc / 1e6));
+}
+
+int testM17() {
+    int failed = 0;
+    int viterbi = m17_bench::testViterbi(10000);
+    if (viterbi) { flog::error("M17 Viterbi<5>: {0} of 10000 frames decoded wrong", viterbi); }
+    int golay = m17_bench::testGolay24();
+    if (golay) { flog::error("M17 Golay24: {0} words with up to 3 errors decoded wrong", golay); }
+    int crc = m17_bench::testCRC16();
+    if (crc) { flog::error("M17 CRC16: {0} mismatches", crc); }
+    failed += (viterbi != 0) + (golay != 0) + (crc != 0);
+    if (!failed) { flog::info("M17 Viterbi<5>, Golay24 and CRC16 decode correctly"); }
+    return failed;
+}
+
+bool checkOnePole(const char* name, double param, dsp::bench::OnePoleError err) {
+    // Errors in parts per million of the largest output
+    flog::info("{0} {1}: error {2} ppm (per-sample loop {3} ppm), difference {4} ppm", name, param, err.block * 1e6, err.perSample * 1e6, err.difference * 1e6);
+    if (err.pass()) { return true; }
+    flog::error("{0} {1}: less accurate than the per-sample loop it replaced", name, param);
+    return false;
+}
+
+int testOnePoles() {
+    // Block processed one-pole filters against the per-sample loops they replaced, at the rates they are used with
+    int failed = 0;
+    for (double samplerate : { 48000.0, 250000.0 }) {
+        failed += !checkOnePole("Mono deemphasis", samplerate, dsp::bench::testDeemphasis<float>(50e-6, samplerate, 1000000, 4096));
+        failed += !checkOnePole("Stereo deemphasis", samplerate, dsp::bench::testDeemphasis<dsp::stereo_t>(50e-6, samplerate, 1000000, 4096));
+    }
+    for (double rate : { 1e-6, 2e-5, 6.7e-3 }) {
+        failed += !checkOnePole("Float DC blocker", rate, dsp::bench::testDCBlocker<float>(rate, 1000000, 4096));
+        failed += !checkOnePole("Complex DC blocker", rate, dsp::bench::testDCBlocker<dsp::complex_t>(rate, 1000000, 4096));
+    }
+    for (double rate : { 500.0 / 24000.0, 500.0 / 48000.0 }) {
+        dsp::bench::OnePoleError err = dsp::bench::testNoiseBlanker(rate, 10.0, 1000000, 4096, 1e-4);
+        flog::info("Noise blanker {0}: {1} samples next to the level left out", rate, err.skipped);
+        failed += !checkOnePole("Noise blanker", rate, err);
+    }
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    benchmarkConvert();
+    benchmarkNCO();
+    benchmarkM17();
+
+    int failed = 0;
+    failed += testOnePoles();
+    failed += testNCO();
+    failed += testM17();
+
+    return failed ? -1 : 0;
+}
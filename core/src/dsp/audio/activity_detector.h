@@ -0,0 +1,108 @@
+#pragma once
+#include <stdexcept>
+#include "../math/abs_max.h"
+
+namespace dsp::audio {
+    /**
+     * Block based activity detector with hysteresis and hang time, meant to find transmissions in squelched audio.
+     * Activity starts when the peak of a block reaches the open level, and ends once the peak stayed below the
+     * close level for the hang time. The decision is made per block, the hang time is counted in samples.
+     */
+    class ActivityDetector {
+    public:
+        enum Event {
+            EVENT_NONE,
+            EVENT_START,
+            EVENT_END
+        };
+
+        ActivityDetector() {}
+
+        ActivityDetector(float openLevel, float closeLevel, int hangSamples) { init(openLevel, closeLevel, hangSamples); }
+
+        void init(float openLevel, float closeLevel, int hangSamples) {
+            setLevels(openLevel, closeLevel);
+            setHang(hangSamples);
+            reset();
+        }
+
+        /**
+         * Set the detection levels.
+         * @param openLevel Peak level starting activity.
+         * @param closeLevel Peak level under which activity ends, must not be greater than the open level.
+         */
+        void setLevels(float openLevel, float closeLevel) {
+            if (closeLevel > openLevel) { throw std::runtime_error("Close level must not be greater than the open level"); }
+            _openLevel = openLevel;
+            _closeLevel = closeLevel;
+        }
+
+        /**
+         * Set the time activity lasts after the level dropped.
+         * @param hangSamples Hang time in samples.
+         */
+        void setHang(int hangSamples) {
+            if (hangSamples < 0) { throw std::runtime_error("Hang time must not be negative"); }
+            _hangSamples = hangSamples;
+        }
+
+        void reset() {
+            active = false;
+            level = 0.0f;
+            silentSamples = 0;
+            peak = 0.0f;
+        }
+
+        /**
+         * Process a block of samples.
+         * @param data Samples, interleaved if there are multiple channels.
+         * @param count Number of float values.
+         * @param channels Number of interleaved channels, used to count the hang time in samples.
+         * @return EVENT_START if activity starts with this block, EVENT_END if it ended with this block.
+         */
+        Event process(const float* data, int count, int channels = 1) {
+            level = math::absMax(data, count);
+            if (!active) {
+                if (level < _openLevel) { return EVENT_NONE; }
+                active = true;
+                silentSamples = 0;
+                peak = level;
+                return EVENT_START;
+            }
+
+            if (level > peak) { peak = level; }
+            if (level >= _closeLevel) {
+                silentSamples = 0;
+                return EVENT_NONE;
+            }
+            silentSamples += count / channels;
+            if (silentSamples <= _hangSamples) { return EVENT_NONE; }
+            active = false;
+            return EVENT_END;
+        }
+
+        bool isActive() { return active; }
+
+        /**
+         * Get the peak level of the current activity, or the last one once it ended.
+         * @return Peak absolute value.
+         */
+        float getPeak() { return peak; }
+
+        /**
+         * Get the peak level of the last processed block.
+         * @return Peak absolute value.
+         */
+        float getLevel() { return level; }
+
+    private:
+        float _openLevel = 0.0f;
+        float _closeLevel = 0.0f;
+        int64_t _hangSamples = 0;
+
+        bool active = false;
+        int64_t silentSamples = 0;
+        float peak = 0.0f;
+        float level = 0.0f;
+    };
+}
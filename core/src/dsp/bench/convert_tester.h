@@ -0,0 +1,44 @@
+#pragma once
+#include <chrono>
+#include <stdlib.h>
+#include "../buffer/buffer.h"
+#include "../convert/sample_format.h"
+
+namespace dsp::bench {
+    /**
+     * Measure the throughput of the sample format conversion for a given format.
+     * @param format Sample format to convert from.
+     * @param durationMs Duration of the test in milliseconds.
+     * @param bufferSize Number of complex samples converted per call.
+     * @return Number of complex samples converted per second.
+     */
+    inline double benchmarkConvert(convert::SampleFormat format, int durationMs, int bufferSize) {
+        // Fill the input with random bytes, scale down floats to avoid NaNs and infinities
+        int inSize = bufferSize * convert::sampleFormatSize(format);
+        uint8_t* in = buffer::alloc<uint8_t>(inSize);
+        complex_t* out = buffer::alloc<complex_t>(bufferSize);
+        if (format == convert::SAMPLE_FORMAT_F32) {
+            float* fin = (float*)in;
+            for (int i = 0; i < bufferSize * 2; i++) { fin[i] = (2.0f * (float)rand() / (float)RAND_MAX) - 1.0f; }
+        }
+        else {
+            for (int i = 0; i < inSize; i++) { in[i] = rand(); }
+        }
+
+        // Convert until the duration has elapsed, the scale is halved so that floats aren't just copied
+        uint64_t sampCount = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto end = start + std::chrono::milliseconds(durationMs);
+        auto now = start;
+        while (now < end) {
+            convert::toComplex(format, in, out, bufferSize, convert::defaultScale(format) * 0.5f, convert::defaultOffset(format));
+            sampCount += bufferSize;
+            now = std::chrono::high_resolution_clock::now();
+        }
+
+        buffer::free(in);
+        buffer::free(out);
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        return (double)sampCount / elapsed;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+
+namespace dsp::bench {
+    /**
+     * Measures the share of real time a block spends processing its input, averaged over a window of signal time.
+     * A load of 1.0 means processing takes as long as the signal lasts, i.e. a full CPU core.
+     */
+    class LoadMeter {
+    public:
+        LoadMeter() {}
+
+        LoadMeter(double samplerate, double window = 1.0) { init(samplerate, window); }
+
+        void init(double samplerate, double window = 1.0) {
+            _samplerate = samplerate;
+            _window = window;
+            reset();
+        }
+
+        void setSamplerate(double samplerate) {
+            _samplerate = samplerate;
+            reset();
+        }
+
+        void reset() {
+            busy = 0.0;
+            samples = 0;
+            load = 0.0f;
+        }
+
+        // Call right before processing a block
+        inline void begin() {
+            start = std::chrono::steady_clock::now();
+        }
+
+        /**
+         * Call right after processing a block.
+         * @param count Number of input samples the block processed.
+         */
+        inline void end(int count) {
+            busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            samples += count;
+            double duration = (double)samples / _samplerate;
+            if (duration < _window) { return; }
+            load = busy / duration;
+            busy = 0.0;
+            samples = 0;
+        }
+
+        /**
+         * Get the load measured over the last window, can be called from any thread.
+         * @return Processing time divided by signal time.
+         */
+        float getLoad() { return load; }
+
+    private:
+        double _samplerate = 1.0;
+        double _window = 1.0;
+
+        std::chrono::steady_clock::time_point start;
+        double busy = 0.0;
+        int64_t samples = 0;
+        std::atomic<float> load = 0.0f;
+    };
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <chrono>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include "../buffer/buffer.h"
+#include "../math/nco.h"
+
+namespace dsp::bench {
+    /**
+     * Measure the largest error of the phasors of an NCO over the phase range used by the loops.
+     * The phases are swept over [-pi, pi] and compared to the phasor computed in double precision.
+     * @param accuracy Accuracy of the NCO.
+     * @param count Number of phases tried.
+     * @return Largest distance between the phasor and the exact one.
+     */
+    inline double testNCO(math::NCO::Accuracy accuracy, int count) {
+        math::NCO nco(accuracy);
+        double maxErr = 0.0;
+        for (int i = 0; i <= count; i++) {
+            float x = (float)(-DB_M_PI + (2.0 * DB_M_PI * (double)i / (double)count));
+            complex_t p = nco.phasor(x);
+            double err = hypot((double)p.re - cos((double)x), (double)p.im - sin((double)x));
+            maxErr = std::max<double>(maxErr, err);
+        }
+        return maxErr;
+    }
+
+    /**
+     * Measure the throughput of an NCO alone.
+     * @param accuracy Accuracy of the NCO.
+     * @param durationMs Duration of the test in milliseconds.
+     * @param bufferSize Number of phasors computed per iteration.
+     * @return Number of phasors computed per second.
+     */
+    inline double benchmarkNCO(math::NCO::Accuracy accuracy, int durationMs, int bufferSize) {
+        // Random phases like those of a loop, which doesn't step through the table in order
+        math::NCO nco(accuracy);
+        float* phases = buffer::alloc<float>(bufferSize);
+        complex_t* out = buffer::alloc<complex_t>(bufferSize);
+        for (int i = 0; i < bufferSize; i++) {
+            phases[i] = FL_M_PI * ((2.0f * (float)rand() / (float)RAND_MAX) - 1.0f);
+        }
+
+        uint64_t sampCount = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto end = start + std::chrono::milliseconds(durationMs);
+        auto now = start;
+        while (now < end) {
+            for (int i = 0; i < bufferSize; i++) { out[i] = nco.phasor(phases[i]); }
+            sampCount += bufferSize;
+            now = std::chrono::high_resolution_clock::now();
+        }
+
+        buffer::free(phases);
+        buffer::free(out);
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        return (double)sampCount / elapsed;
+    }
+
+    /**
+     * Measure the throughput of a phase locked loop using the NCO.
+     * The input is a noisy carrier with a frequency offset, so that the loop keeps correcting its phase.
+     * @param accuracy Accuracy of the NCO of the loop.
+     * @param durationMs Duration of the test in milliseconds.
+     * @param bufferSize Number of samples processed per call.
+     * @tparam LOOP loop::PLL or one of the loops derived from it.
+     * @return Number of samples processed per second.
+     */
+    template <class LOOP>
+    inline double benchmarkLoop(math::NCO::Accuracy accuracy, int durationMs, int bufferSize) {
+        complex_t* in = buffer::alloc<complex_t>(bufferSize);
+        complex_t* out = buffer::alloc<complex_t>(bufferSize);
+        for (int i = 0; i < bufferSize; i++) {
+            float phase = 0.01f * (float)i;
+            float noiseRe = 0.1f * ((2.0f * (float)rand() / (float)RAND_MAX) - 1.0f);
+            float noiseIm = 0.1f * ((2.0f * (float)rand() / (float)RAND_MAX) - 1.0f);
+            in[i] = { cosf(phase) + noiseRe, sinf(phase) + noiseIm };
+        }
+
+        LOOP loop;
+        loop.init(NULL, 0.01);
+        loop.setNCOAccuracy(accuracy);
+
+        uint64_t sampCount = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto end = start + std::chrono::milliseconds(durationMs);
+        auto now = start;
+        while (now < end) {
+            loop.process(bufferSize, in, out);
+            sampCount += bufferSize;
+            now = std::chrono::high_resolution_clock::now();
+        }
+
+        buffer::free(in);
+        buffer::free(out);
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        return (double)sampCount / elapsed;
+    }
+}
@@ -0,0 +1,260 @@
+#pragma once
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include <algorithm>
+#include "../buffer/buffer.h"
+#include "../filter/deephasis.h"
+#include "../correction/dc_blocker.h"
+#include "../noise_reduction/noise_blanker.h"
+
+// The one-pole blocks are checked against the per-sample loops they replaced, copied below in their original update
+// form. The two can't match bit for bit: the blocks compute y += a * (x - y) in a prefix scan while the old deemphasis
+// and noise blanker scaled the previous output by the rounded 1 - a. Both are measured against the exact recursion
+// computed in double precision, the blocks pass if their error is no larger than that of the old loops, give or take
+// a few float roundings. The difference between the two is then bounded by the sum of both errors.
+
+namespace dsp::bench {
+    namespace reference {
+        inline void deemphasis(const float* in, float* out, int count, float alpha, float& lastOut) {
+            out[0] = (alpha * in[0]) + ((1 - alpha) * lastOut);
+            for (int i = 1; i < count; i++) {
+                out[i] = (alpha * in[i]) + ((1 - alpha) * out[i - 1]);
+            }
+            lastOut = out[count - 1];
+        }
+
+        inline void deemphasis(const stereo_t* in, stereo_t* out, int count, float alpha, stereo_t& lastOut) {
+            out[0].l = (alpha * in[0].l) + ((1 - alpha) * lastOut.l);
+            out[0].r = (alpha * in[0].r) + ((1 - alpha) * lastOut.r);
+            for (int i = 1; i < count; i++) {
+                out[i].l = (alpha * in[i].l) + ((1 - alpha) * out[i - 1].l);
+                out[i].r = (alpha * in[i].r) + ((1 - alpha) * out[i - 1].r);
+            }
+            lastOut.l = out[count - 1].l;
+            lastOut.r = out[count - 1].r;
+        }
+
+        template <class T>
+        inline void dcBlocker(T* in, T* out, int count, float _rate, T& offset) {
+            for (int i = 0; i < count; i++) {
+                out[i] = in[i] - offset;
+                offset += out[i] * _rate;
+            }
+        }
+
+        inline void noiseBlanker(complex_t* in, complex_t* out, int count, float _rate, float _level, float& amp) {
+            float _invRate = 1.0f - _rate;
+            for (int i = 0; i < count; i++) {
+                // Get signal amplitude
+                float inAmp = in[i].amplitude();
+
+                // Update average amplitude
+                float gain = 1.0f;
+                if (inAmp != 0.0f) {
+                    amp = (amp * _invRate) + (inAmp * _rate);
+                    float excess = inAmp / amp;
+                    if (excess > _level) {
+                        gain = 1.0f / excess;
+                    }
+                }
+
+                // Scale output by gain
+                out[i] = in[i] * gain;
+            }
+        }
+    }
+
+    /**
+     * Error of a one-pole block and of the loop it replaced, relative to the largest exact output.
+     */
+    struct OnePoleError {
+        double block;
+        double perSample;
+        double difference;
+        int skipped;
+
+        // True if the block is no less accurate than the per-sample loop, allowing for a few float roundings
+        bool pass() { return block <= perSample + 4.0 * FLT_EPSILON; }
+    };
+
+    namespace detail {
+        // Noise with a different DC offset on each of the interleaved channels, the offset shows any bias of the DC gain
+        inline void onePoleInput(float* in, int count, int channels) {
+            for (int i = 0; i < count; i++) {
+                in[i] = (2.0f * (float)rand() / (float)RAND_MAX) - 1.0f + ((i % channels) ? -0.25f : 0.5f);
+            }
+        }
+
+        // Run a block in blocks of random size, so that both the carry between blocks and the scalar tail are covered
+        template <class T, class F>
+        inline void inBlocks(T* in, T* out, int count, int maxBlockSize, F process) {
+            for (int i = 0; i < count;) {
+                int len = std::min<int>(1 + (rand() % maxBlockSize), count - i);
+                process(len, &in[i], &out[i]);
+                i += len;
+            }
+        }
+
+        inline OnePoleError onePoleError(const float* block, const float* perSample, const double* exact, int count, const std::vector<bool>& skip = {}) {
+            double maxVal = 0.0;
+            double blockErr = 0.0;
+            double perSampleErr = 0.0;
+            double diff = 0.0;
+            int skipped = 0;
+            for (int i = 0; i < count; i++) {
+                if (!skip.empty() && skip[i]) {
+                    skipped++;
+                    continue;
+                }
+                maxVal = std::max<double>(maxVal, fabs(exact[i]));
+                blockErr = std::max<double>(blockErr, fabs(block[i] - exact[i]));
+                perSampleErr = std::max<double>(perSampleErr, fabs(perSample[i] - exact[i]));
+                diff = std::max<double>(diff, fabs((double)block[i] - (double)perSample[i]));
+            }
+            if (maxVal == 0.0) { maxVal = 1.0; }
+            return { blockErr / maxVal, perSampleErr / maxVal, diff / maxVal, skipped };
+        }
+    }
+
+    /**
+     * Compare the deemphasis block to the per-sample loop it replaced.
+     * @param tau Time constant in seconds.
+     * @param samplerate Samplerate in Hz.
+     * @param frames Number of samples.
+     * @param maxBlockSize Largest number of samples given to each call of the block.
+     * @tparam T float or stereo_t.
+     * @return Errors of both against the exact filter.
+     */
+    template <class T>
+    inline OnePoleError testDeemphasis(double tau, double samplerate, int frames, int maxBlockSize) {
+        const int channels = sizeof(T) / sizeof(float);
+        int count = frames * channels;
+        T* in = buffer::alloc<T>(frames);
+        T* out = buffer::alloc<T>(frames);
+        T* ref = buffer::alloc<T>(frames);
+        std::vector<double> exact(count);
+        detail::onePoleInput((float*)in, count, channels);
+
+        filter::Deemphasis<T> deemp;
+        deemp.init(NULL, tau, samplerate);
+        detail::inBlocks(in, out, frames, maxBlockSize, [&](int len, T* bin, T* bout) { deemp.process(len, bin, bout); });
+
+        // Same coefficient as the block
+        float dt = 1.0f / samplerate;
+        float alpha = dt / (tau + dt);
+        T lastOut = {};
+        reference::deemphasis(in, ref, frames, alpha, lastOut);
+
+        const float* x = (const float*)in;
+        double y[2] = {};
+        for (int i = 0; i < count; i++) {
+            int c = i % channels;
+            y[c] += (double)alpha * ((double)x[i] - y[c]);
+            exact[i] = y[c];
+        }
+
+        OnePoleError err = detail::onePoleError((float*)out, (float*)ref, exact.data(), count);
+        buffer::free(in);
+        buffer::free(out);
+        buffer::free(ref);
+        return err;
+    }
+
+    /**
+     * Compare the DC blocker block to the per-sample loop it replaced.
+     * @param rate Rate of the DC blocker, relative to the samplerate.
+     * @param frames Number of samples.
+     * @param maxBlockSize Largest number of samples given to each call of the block.
+     * @tparam T float, complex_t or stereo_t.
+     * @return Errors of both against the exact filter.
+     */
+    template <class T>
+    inline OnePoleError testDCBlocker(double rate, int frames, int maxBlockSize) {
+        const int channels = sizeof(T) / sizeof(float);
+        int count = frames * channels;
+        T* in = buffer::alloc<T>(frames);
+        T* out = buffer::alloc<T>(frames);
+        T* ref = buffer::alloc<T>(frames);
+        std::vector<double> exact(count);
+        detail::onePoleInput((float*)in, count, channels);
+
+        correction::DCBlocker<T> dcBlock;
+        dcBlock.init(NULL, rate);
+        detail::inBlocks(in, out, frames, maxBlockSize, [&](int len, T* bin, T* bout) { dcBlock.process(len, bin, bout); });
+
+        T offset = {};
+        reference::dcBlocker<T>(in, ref, frames, rate, offset);
+
+        const float* x = (const float*)in;
+        float frate = rate;
+        double off[2] = {};
+        for (int i = 0; i < count; i++) {
+            int c = i % channels;
+            exact[i] = (double)x[i] - off[c];
+            off[c] += exact[i] * (double)frate;
+        }
+
+        OnePoleError err = detail::onePoleError((float*)out, (float*)ref, exact.data(), count);
+        buffer::free(in);
+        buffer::free(out);
+        buffer::free(ref);
+        return err;
+    }
+
+    /**
+     * Compare the noise blanker block to the per-sample loop it replaced.
+     * The input is noise with impulses to blank and runs of null samples like those of a squelched signal.
+     * Samples whose excess is within `margin` of the level may be blanked by one and not the other, they are left out.
+     * @param rate Rate of the envelope follower, relative to the samplerate.
+     * @param level Excess over the envelope above which samples are blanked.
+     * @param frames Number of samples.
+     * @param maxBlockSize Largest number of samples given to each call of the block.
+     * @param margin Relative distance to the level below which samples are left out.
+     * @return Errors of both against the exact blanker.
+     */
+    inline OnePoleError testNoiseBlanker(double rate, double level, int frames, int maxBlockSize, double margin) {
+        complex_t* in = buffer::alloc<complex_t>(frames);
+        complex_t* out = buffer::alloc<complex_t>(frames);
+        complex_t* ref = buffer::alloc<complex_t>(frames);
+        std::vector<double> exact(frames * 2);
+        std::vector<bool> skip(frames * 2, false);
+        detail::onePoleInput((float*)in, frames * 2, 2);
+        for (int i = 0; i < frames; i++) {
+            if ((i % 100000) >= 90000) { in[i] = { 0.0f, 0.0f }; }
+            else if (!(rand() % 1000)) { in[i] = in[i] * 50.0f; }
+        }
+
+        noise_reduction::NoiseBlanker nb;
+        nb.init(NULL, rate, level);
+        detail::inBlocks(in, out, frames, maxBlockSize, [&](int len, complex_t* bin, complex_t* bout) { nb.process(len, bin, bout); });
+
+        float amp = 1.0f;
+        reference::noiseBlanker(in, ref, frames, rate, level, amp);
+
+        // Same rate and level as the block, which keeps them as floats
+        double frate = (float)rate;
+        double flevel = (float)level;
+        double env = 1.0;
+        for (int i = 0; i < frames; i++) {
+            double inAmp = hypot((double)in[i].re, (double)in[i].im);
+            double gain = 1.0;
+            if (inAmp != 0.0) {
+                env += frate * (inAmp - env);
+                double excess = inAmp / env;
+                if (excess > flevel) { gain = 1.0 / excess; }
+                if (fabs(excess - flevel) <= margin * flevel) { skip[i*2] = skip[i*2 + 1] = true; }
+            }
+            exact[i*2] = in[i].re * gain;
+            exact[i*2 + 1] = in[i].im * gain;
+        }
+
+        OnePoleError err = detail::onePoleError((float*)out, (float*)ref, exact.data(), frames * 2, skip);
+        err.skipped /= 2;
+        buffer::free(in);
+        buffer::free(out);
+        buffer::free(ref);
+        return err;
+    }
+}
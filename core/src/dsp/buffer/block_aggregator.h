@@ -0,0 +1,256 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <assert.h>
+#include <string.h>
+#include "../stream.h"
+#include "buffer.h"
+
+#define BLOCK_AGGREGATOR_DEFAULT_SLOTS  4
+#define BLOCK_AGGREGATOR_MAX_WRITE      (STREAM_BUFFER_SIZE / 2)
+#define BLOCK_AGGREGATOR_MIN_BLOCK      64
+
+namespace dsp::buffer {
+    /**
+     * Receive front-end for sources delivering samples in arbitrarily sized pieces (eg. network sources).
+     * Samples are written directly into a small ring of blocks which are sent to the output stream
+     * by a separate thread once they hold the configured duration, so that the receiving thread never
+     * waits on the DSP chain unless the whole ring is full.
+     */
+    template <class T>
+    class BlockAggregator {
+    public:
+        BlockAggregator() {}
+
+        BlockAggregator(stream<T>* out, int slots = BLOCK_AGGREGATOR_DEFAULT_SLOTS) { init(out, slots); }
+
+        ~BlockAggregator() {
+            if (!_init) { return; }
+            stop();
+            for (auto& b : blocks) { buffer::free(b); }
+            _init = false;
+        }
+
+        void init(stream<T>* out, int slots = BLOCK_AGGREGATOR_DEFAULT_SLOTS) {
+            _out = out;
+            blocks.resize(std::max<int>(slots, 2));
+            sizes.resize(blocks.size());
+            for (auto& b : blocks) { b = buffer::alloc<T>(STREAM_BUFFER_SIZE); }
+            _init = true;
+        }
+
+        /**
+         * Set the nominal samplerate of the source.
+         * @param samplerate Samplerate in samples per second.
+         */
+        void setSamplerate(double samplerate) {
+            assert(_init);
+            _samplerate = samplerate;
+            updateBlockSize();
+        }
+
+        /**
+         * Set the target duration of the blocks sent to the output stream.
+         * @param seconds Block duration in seconds.
+         */
+        void setBlockTime(double seconds) {
+            assert(_init);
+            _blockTime = seconds;
+            updateBlockSize();
+        }
+
+        void start() {
+            assert(_init);
+            std::lock_guard<std::mutex> lck(ctrlMtx);
+            if (running) { return; }
+            {
+                std::lock_guard<std::mutex> lck2(ringMtx);
+                widx = 0;
+                ridx = 0;
+                queued = 0;
+                filled = 0;
+                stopRing = false;
+            }
+            windowStart = now();
+            windowSamples = 0;
+            throughput = 0.0;
+            running = true;
+            workerThread = std::thread(&BlockAggregator::worker, this);
+        }
+
+        void stop() {
+            assert(_init);
+            std::lock_guard<std::mutex> lck(ctrlMtx);
+            if (!running) { return; }
+            {
+                std::lock_guard<std::mutex> lck2(ringMtx);
+                stopRing = true;
+            }
+            ringCnd.notify_all();
+            _out->stopWriter();
+            if (workerThread.joinable()) { workerThread.join(); }
+            _out->clearWriteStop();
+            running = false;
+        }
+
+        /**
+         * Get a pointer to write samples to. Waits if all blocks are waiting to be sent.
+         * @param count Maximum number of samples that will be written, at most BLOCK_AGGREGATOR_MAX_WRITE.
+         * @return Pointer to write the samples to, NULL if the aggregator was stopped.
+         */
+        T* reserve(int count) {
+            assert(_init);
+            assert(count <= BLOCK_AGGREGATOR_MAX_WRITE);
+            std::unique_lock<std::mutex> lck(ringMtx);
+
+            // Send the current block early if the samples wouldn't fit in it
+            if (filled + count > STREAM_BUFFER_SIZE) { push(); }
+
+            // Wait for the current block to be free
+            ringCnd.wait(lck, [this]() { return queued < (int)blocks.size() || stopRing; });
+            if (stopRing) { return NULL; }
+            return &blocks[widx][filled];
+        }
+
+        /**
+         * Mark samples written to the pointer returned by reserve() as valid.
+         * @param count Number of samples written.
+         */
+        void commit(int count) {
+            assert(_init);
+            {
+                std::lock_guard<std::mutex> lck(ringMtx);
+                filled += count;
+                if (filled >= blockSize) { push(); }
+            }
+
+            // Update throughput measurement about once a second
+            windowSamples += count;
+            int64_t t = now();
+            double elapsed = seconds(t - windowStart);
+            if (elapsed >= 1.0) {
+                throughput = (double)windowSamples / elapsed;
+                windowSamples = 0;
+                windowStart = t;
+            }
+        }
+
+        /**
+         * Get the measured input throughput.
+         * @return Throughput in samples per second, updated about once a second and falling towards zero if the input stalls.
+         */
+        double getThroughput() {
+            // If no commit closed the measurement window in time, the input stalled. Use the
+            // samples received since the window started, so that the throughput decays to zero.
+            double elapsed = seconds(now() - windowStart);
+            if (elapsed >= 2.0) { return (double)windowSamples / elapsed; }
+            return throughput;
+        }
+
+        /**
+         * Get the measured input throughput relative to the nominal samplerate.
+         * @return Ratio between the throughput and samplerate, 1.0 if the input keeps up.
+         */
+        double getThroughputRatio() {
+            return (_samplerate > 0.0) ? (getThroughput() / _samplerate) : 0.0;
+        }
+
+        /**
+         * Get the number of blocks waiting to be sent to the output stream.
+         * @return Number of queued blocks.
+         */
+        int getQueued() {
+            std::lock_guard<std::mutex> lck(ringMtx);
+            return queued;
+        }
+
+        /**
+         * Get the number of blocks in the ring.
+         * @return Number of blocks.
+         */
+        int getSlots() {
+            return blocks.size();
+        }
+
+    private:
+        static int64_t now() {
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+        }
+
+        static double seconds(int64_t ticks) {
+            return std::chrono::duration<double>(std::chrono::steady_clock::duration(ticks)).count();
+        }
+
+        void updateBlockSize() {
+            std::lock_guard<std::mutex> lck(ringMtx);
+            blockSize = std::clamp<int>(_samplerate * _blockTime, BLOCK_AGGREGATOR_MIN_BLOCK, STREAM_BUFFER_SIZE - BLOCK_AGGREGATOR_MAX_WRITE);
+        }
+
+        // Must be called with ringMtx locked
+        void push() {
+            if (!filled) { return; }
+            sizes[widx] = filled;
+            widx = (widx + 1) % blocks.size();
+            filled = 0;
+            queued++;
+            ringCnd.notify_all();
+        }
+
+        void worker() {
+            while (true) {
+                // Wait for a block
+                int idx, count;
+                {
+                    std::unique_lock<std::mutex> lck(ringMtx);
+                    ringCnd.wait(lck, [this]() { return queued > 0 || stopRing; });
+                    if (stopRing) { return; }
+                    idx = ridx;
+                    count = sizes[idx];
+                }
+
+                // Send it to the output stream
+                memcpy(_out->writeBuf, blocks[idx], count * sizeof(T));
+                if (!_out->swap(count)) { return; }
+
+                // Release it
+                {
+                    std::lock_guard<std::mutex> lck(ringMtx);
+                    ridx = (ridx + 1) % blocks.size();
+                    queued--;
+                }
+                ringCnd.notify_all();
+            }
+        }
+
+        bool _init = false;
+        stream<T>* _out;
+
+        std::vector<T*> blocks;
+        std::vector<int> sizes;
+        std::mutex ringMtx;
+        std::condition_variable ringCnd;
+        int widx = 0;
+        int ridx = 0;
+        int queued = 0;
+        int filled = 0;
+        bool stopRing = false;
+
+        double _samplerate = 1000000.0;
+        double _blockTime = 0.01;
+        int blockSize = 10000;
+
+        // Written by the receiving thread, read by the UI
+        std::atomic<int64_t> windowStart = 0;
+        std::atomic<uint64_t> windowSamples = 0;
+        std::atomic<double> throughput = 0.0;
+
+        std::mutex ctrlMtx;
+        bool running = false;
+        std::thread workerThread;
+    };
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <atomic>
+#include <algorithm>
+#include <string.h>
+#include <stdint.h>
+#include "buffer.h"
+
+namespace dsp::buffer {
+    /**
+     * Fixed size ring keeping the most recent samples written to it.
+     * One thread writes and one thread reads without any lock, the writer never waits and simply overwrites
+     * the oldest samples. Samples overwritten while being read are detected and reported as lost.
+     */
+    template <class T>
+    class HistoryRing {
+    public:
+        HistoryRing() {}
+
+        HistoryRing(size_t capacity) { init(capacity); }
+
+        ~HistoryRing() {
+            if (buf) { buffer::free(buf); }
+        }
+
+        /**
+         * Allocate the ring, must not be called while reading or writing.
+         * @param capacity Number of samples kept, 0 to free the memory.
+         * If the allocation fails, the capacity is left at 0.
+         */
+        void init(size_t capacity) {
+            if (buf) { buffer::free(buf); }
+            buf = capacity ? buffer::alloc<T>(capacity) : NULL;
+            _capacity = buf ? capacity : 0;
+            writePos.store(0);
+            reservePos.store(0);
+        }
+
+        /**
+         * Append samples, only the last samples are kept if there are more than the capacity.
+         * @param data Samples to write.
+         * @param count Number of samples.
+         */
+        void write(const T* data, int count) {
+            if (!_capacity || count <= 0) { return; }
+            uint64_t pos = writePos.load(std::memory_order_relaxed);
+            if ((size_t)count > _capacity) {
+                data += count - _capacity;
+                pos += count - _capacity;
+                count = _capacity;
+            }
+
+            // Announce the overwrite before touching the data so that readers can detect it
+            reservePos.store(pos + count, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            size_t start = pos % _capacity;
+            size_t first = std::min<size_t>(count, _capacity - start);
+            memcpy(&buf[start], data, first * sizeof(T));
+            memcpy(buf, &data[first], (count - first) * sizeof(T));
+            writePos.store(pos + count, std::memory_order_release);
+        }
+
+        /**
+         * Copy samples out of the ring.
+         * @param pos Position of the first sample to read, advanced past the samples read or lost.
+         * @param out Output buffer.
+         * @param maxCount Maximum number of samples to read.
+         * @param lost Set to the number of samples that were overwritten before they could be read.
+         * @return Number of samples read.
+         */
+        int read(uint64_t& pos, T* out, int maxCount, uint64_t& lost) {
+            lost = 0;
+            if (!_capacity) { return 0; }
+
+            // Skip samples that were already overwritten
+            uint64_t end = writePos.load(std::memory_order_acquire);
+            uint64_t oldest = oldestValid();
+            if (pos < oldest) {
+                lost = oldest - pos;
+                pos = oldest;
+            }
+            if (pos >= end) { return 0; }
+
+            // Copy the samples
+            int count = std::min<uint64_t>(maxCount, end - pos);
+            size_t start = pos % _capacity;
+            size_t first = std::min<size_t>(count, _capacity - start);
+            memcpy(out, &buf[start], first * sizeof(T));
+            memcpy(&out[first], buf, (count - first) * sizeof(T));
+
+            // Discard the samples the writer started overwriting during the copy
+            std::atomic_thread_fence(std::memory_order_acquire);
+            oldest = oldestValid();
+            if (oldest > pos) {
+                int skip = std::min<uint64_t>(count, oldest - pos);
+                memmove(out, &out[skip], (count - skip) * sizeof(T));
+                count -= skip;
+                lost += skip;
+                pos += skip;
+            }
+
+            pos += count;
+            return count;
+        }
+
+        /**
+         * Get the position following the last written sample.
+         * @return Total number of samples written since the ring was initialized.
+         */
+        uint64_t getWritePos() {
+            return writePos.load(std::memory_order_acquire);
+        }
+
+        /**
+         * Get the number of samples currently held by the ring.
+         * @return Number of samples, at most the capacity.
+         */
+        size_t getFill() {
+            return std::min<uint64_t>(getWritePos(), _capacity);
+        }
+
+        size_t getCapacity() {
+            return _capacity;
+        }
+
+        size_t getMemoryUsage() {
+            return _capacity * sizeof(T);
+        }
+
+    private:
+        uint64_t oldestValid() {
+            uint64_t reserved = reservePos.load(std::memory_order_relaxed);
+            return (reserved > _capacity) ? (reserved - _capacity) : 0;
+        }
+
+        T* buf = NULL;
+        size_t _capacity = 0;
+        std::atomic<uint64_t> writePos = 0;
+        std::atomic<uint64_t> reservePos = 0;
+    };
+}
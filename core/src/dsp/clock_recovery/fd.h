@@ -4,6 +4,7 @@
 #include "../taps/windowed_sinc.h"
 #include "../multirate/polyphase_bank.h"
 #include "../math/step.h"
+#include "../math/short_dot.h"
 
 namespace dsp::clock_recovery {
     class FD : public Processor<float, float> {
@@ -32,6 +33,7 @@ namespace dsp::clock_recovery {
             generateInterpTaps();
             buffer = buffer::alloc<float>(STREAM_BUFFER_SIZE + _interpTapCount);
             bufStart = &buffer[_interpTapCount - 1];
+            buffer::clear<float>(buffer, _interpTapCount - 1);
         
             base_type::init(in);
         }
@@ -80,6 +82,7 @@ namespace dsp::clock_recovery {
             generateInterpTaps();
             buffer = buffer::alloc<float>(STREAM_BUFFER_SIZE + _interpTapCount);
             bufStart = &buffer[_interpTapCount - 1];
+            buffer::clear<float>(buffer, _interpTapCount - 1);
             base_type::tempStart();
         }
 
@@ -101,32 +104,21 @@ namespace dsp::clock_recovery {
             int outCount = 0;
             while (offset < count) {
                 float error;
-                float outVal;
-                float dfdt;
 
-                // Calculate new output value
-                int phase = std::clamp<int>(floorf(pcl.phase * (float)_interpPhaseCount), 0, _interpPhaseCount - 1);
-                volk_32f_x2_dot_prod_32f(&outVal, &buffer[offset], interpBank.phases[phase], _interpTapCount);
+                // Truncation only differs from floorf() for negative values, which the clamp maps to zero anyway
+                int phase = std::clamp<int>((int)(pcl.phase * (float)_interpPhaseCount), 0, _interpPhaseCount - 1);
+
+                // Calculate the output value and its neighbours in one pass, the neighbours are clamped to the bank
+                int prevPhase = std::max<int>(phase - 1, 0);
+                int nextPhase = std::min<int>(phase + 1, _interpPhaseCount - 1);
+                const float* taps[3] = { interpBank.phases[prevPhase], interpBank.phases[phase], interpBank.phases[nextPhase] };
+                float vals[3];
+                math::dot3<float>(&buffer[offset], taps, vals, _interpTapCount);
+                float outVal = vals[1];
                 out[outCount++] = outVal;
 
                 // Calculate derivative of the signal
-                if (phase == 0) {
-                    float fT1;
-                    volk_32f_x2_dot_prod_32f(&fT1, &buffer[offset], interpBank.phases[phase+1], _interpTapCount);
-                    dfdt = fT1 - outVal;
-                }
-                else if (phase == _interpPhaseCount - 1) {
-                    float fT_1;
-                    volk_32f_x2_dot_prod_32f(&fT_1, &buffer[offset], interpBank.phases[phase-1], _interpTapCount);
-                    dfdt = outVal - fT_1;
-                }
-                else {
-                    float fT_1;
-                    float fT1;
-                    volk_32f_x2_dot_prod_32f(&fT_1, &buffer[offset], interpBank.phases[phase-1], _interpTapCount);
-                    volk_32f_x2_dot_prod_32f(&fT1, &buffer[offset], interpBank.phases[phase+1], _interpTapCount);
-                    dfdt = (fT1 - fT_1) * 0.5f;
-                }
+                float dfdt = (vals[2] - vals[0]) * ((nextPhase - prevPhase == 2) ? 0.5f : 1.0f);
                 
                 // Calculate error
                 error = dfdt * math::step(outVal);
@@ -137,9 +129,10 @@ namespace dsp::clock_recovery {
 
                 // Advance symbol offset and phase
                 pcl.advance(error);
-                float delta = floorf(pcl.phase);
+                int delta = (int)pcl.phase;
+                if (pcl.phase < (float)delta) { delta--; }
                 offset += delta;
-                pcl.phase -= delta;
+                pcl.phase -= (float)delta;
             }
             offset -= count;
 
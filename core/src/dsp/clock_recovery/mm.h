@@ -4,6 +4,7 @@
 #include "../taps/windowed_sinc.h"
 #include "../multirate/polyphase_bank.h"
 #include "../math/step.h"
+#include "../math/short_dot.h"
 
 namespace dsp::clock_recovery {
     template<class T>
@@ -33,6 +34,7 @@ namespace dsp::clock_recovery {
             generateInterpTaps();
             buffer = buffer::alloc<T>(STREAM_BUFFER_SIZE + _interpTapCount);
             bufStart = &buffer[_interpTapCount - 1];
+            buffer::clear<T>(buffer, _interpTapCount - 1);
         
             base_type::init(in);
         }
@@ -81,6 +83,7 @@ namespace dsp::clock_recovery {
             generateInterpTaps();
             buffer = buffer::alloc<T>(STREAM_BUFFER_SIZE + _interpTapCount);
             bufStart = &buffer[_interpTapCount - 1];
+            buffer::clear<T>(buffer, _interpTapCount - 1);
             base_type::tempStart();
         }
 
@@ -105,16 +108,11 @@ namespace dsp::clock_recovery {
             int outCount = 0;
             while (offset < count) {
                 float error;
-                T outVal;
 
                 // Calculate new output value
-                int phase = std::clamp<int>(floorf(pcl.phase * (float)_interpPhaseCount), 0, _interpPhaseCount - 1);
-                if constexpr (std::is_same_v<T, float>) {
-                    volk_32f_x2_dot_prod_32f(&outVal, &buffer[offset], interpBank.phases[phase], _interpTapCount);
-                }
-                if constexpr (std::is_same_v<T, complex_t>) {
-                    volk_32fc_32f_dot_prod_32fc((lv_32fc_t*)&outVal, (lv_32fc_t*)&buffer[offset], interpBank.phases[phase], _interpTapCount);
-                }
+                // Truncation only differs from floorf() for negative values, which the clamp maps to zero anyway
+                int phase = std::clamp<int>((int)(pcl.phase * (float)_interpPhaseCount), 0, _interpPhaseCount - 1);
+                T outVal = math::dot<T>(&buffer[offset], interpBank.phases[phase], _interpTapCount);
                 out[outCount++] = outVal;
 
                 // Calculate symbol phase error
@@ -143,9 +141,10 @@ namespace dsp::clock_recovery {
 
                 // Advance symbol offset and phase
                 pcl.advance(error);
-                float delta = floorf(pcl.phase);
+                int delta = (int)pcl.phase;
+                if (pcl.phase < (float)delta) { delta--; }
                 offset += delta;
-                pcl.phase -= delta;
+                pcl.phase -= (float)delta;
             }
             offset -= count;
 
@@ -1,6 +1,7 @@
 #pragma once
 #include "../processor.h"
 #include "pcm_type.h"
+#include "../convert/sample_format.h"
 
 namespace dsp::compression {
     class SampleStreamDecompressor : public Processor<uint8_t, complex_t> {
@@ -21,12 +22,12 @@ namespace dsp::compression {
             }
             else if (sampleType == PCMType::PCM_TYPE_I16) {
                 int outCount = (count - 8) / (sizeof(int16_t) * 2);
-                volk_16i_s32f_convert_32f((float*)out, (int16_t*)dataBuf, 32768.0f / scaler, outCount * 2);
+                convert::s16ToComplex((const int16_t*)dataBuf, out, outCount, scaler / 32768.0f);
                 return outCount;
             }
             else if (sampleType == PCMType::PCM_TYPE_I8) {
                 int outCount = (count - 8) / (sizeof(int8_t) * 2);
-                volk_8i_s32f_convert_32f((float*)out, (int8_t*)dataBuf, 128.0f / scaler, outCount * 2);
+                convert::s8ToComplex((const int8_t*)dataBuf, out, outCount, scaler / 128.0f);
                 return outCount;
             }
             
@@ -0,0 +1,624 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "../types.h"
+#include "../simd.h"
+
+// Conversion of the raw sample formats used by SDR hardware and network protocols to complex_t.
+// All functions compute out = (in - offset) * scale on both I and Q and take the number of complex samples.
+// The fastest kernel available on the running CPU is selected at runtime.
+
+namespace dsp::convert {
+    enum SampleFormat {
+        SAMPLE_FORMAT_U8,           // 8bit unsigned
+        SAMPLE_FORMAT_S8,           // 8bit signed
+        SAMPLE_FORMAT_S12_PACKED,   // Two 12bit signed values in three bytes (I = b0 | b1[3:0] << 8, Q = b1[7:4] | b2 << 4)
+        SAMPLE_FORMAT_S16,          // 16bit signed, native endianness
+        SAMPLE_FORMAT_S24_BE,       // 24bit signed, big endian
+        SAMPLE_FORMAT_S24_LE,       // 24bit signed, little endian
+        SAMPLE_FORMAT_S32,          // 32bit signed, native endianness
+        SAMPLE_FORMAT_F32           // 32bit float, native endianness
+    };
+
+    /**
+     * Get the size of a complex sample.
+     * @param format Sample format.
+     * @return Size of a complex (I+Q) sample in bytes.
+     */
+    inline int sampleFormatSize(SampleFormat format) {
+        switch (format) {
+        case SAMPLE_FORMAT_U8:          return 2;
+        case SAMPLE_FORMAT_S8:          return 2;
+        case SAMPLE_FORMAT_S12_PACKED:  return 3;
+        case SAMPLE_FORMAT_S16:         return 4;
+        case SAMPLE_FORMAT_S24_BE:      return 6;
+        case SAMPLE_FORMAT_S24_LE:      return 6;
+        case SAMPLE_FORMAT_S32:         return 8;
+        case SAMPLE_FORMAT_F32:         return 8;
+        default:                        return 0;
+        }
+    }
+
+    /**
+     * Get the scale mapping the full range of a sample format to [-1.0, 1.0].
+     * @param format Sample format.
+     * @return Default scale.
+     */
+    inline float defaultScale(SampleFormat format) {
+        switch (format) {
+        case SAMPLE_FORMAT_U8:          return 1.0f / 128.0f;
+        case SAMPLE_FORMAT_S8:          return 1.0f / 128.0f;
+        case SAMPLE_FORMAT_S12_PACKED:  return 1.0f / 2048.0f;
+        case SAMPLE_FORMAT_S16:         return 1.0f / 32768.0f;
+        case SAMPLE_FORMAT_S24_BE:      return 1.0f / 8388608.0f;
+        case SAMPLE_FORMAT_S24_LE:      return 1.0f / 8388608.0f;
+        case SAMPLE_FORMAT_S32:         return 1.0f / 2147483648.0f;
+        default:                        return 1.0f;
+        }
+    }
+
+    /**
+     * Get the offset centering a sample format around zero.
+     * @param format Sample format.
+     * @return Default offset.
+     */
+    inline float defaultOffset(SampleFormat format) {
+        return (format == SAMPLE_FORMAT_U8) ? 128.0f : 0.0f;
+    }
+
+    namespace generic {
+        // Input values are converted as out = in * mul + add
+
+        inline void u8(const uint8_t* in, float* out, int count, float mul, float add) {
+            // Use a lookup table when it's worth building it
+            if (count >= 1024) {
+                float lut[256];
+                for (int i = 0; i < 256; i++) { lut[i] = (float)i * mul + add; }
+                for (int i = 0; i < count; i++) { out[i] = lut[in[i]]; }
+                return;
+            }
+            for (int i = 0; i < count; i++) { out[i] = (float)in[i] * mul + add; }
+        }
+
+        inline void s8(const int8_t* in, float* out, int count, float mul, float add) {
+            if (count >= 1024) {
+                float lut[256];
+                for (int i = 0; i < 256; i++) { lut[i] = (float)(int8_t)i * mul + add; }
+                for (int i = 0; i < count; i++) { out[i] = lut[(uint8_t)in[i]]; }
+                return;
+            }
+            for (int i = 0; i < count; i++) { out[i] = (float)in[i] * mul + add; }
+        }
+
+        inline void s12Packed(const uint8_t* in, float* out, int count, float mul, float add) {
+            for (int i = 0; i < count; i++) {
+                const uint8_t* s = &in[i*3];
+                int16_t vi = (int16_t)(((uint16_t)s[0] << 4) | ((uint16_t)s[1] << 12));
+                int16_t vq = (int16_t)(((uint16_t)s[1] | ((uint16_t)s[2] << 8)) & 0xFFF0);
+                out[i*2] = (float)(vi >> 4) * mul + add;
+                out[i*2 + 1] = (float)(vq >> 4) * mul + add;
+            }
+        }
+
+        inline void s16(const int16_t* in, float* out, int count, float mul, float add) {
+            for (int i = 0; i < count; i++) { out[i] = (float)in[i] * mul + add; }
+        }
+
+        inline void s24(const uint8_t* in, float* out, int count, float mul, float add, bool bigEndian, int stride, bool swapIQ) {
+            // Samples are placed in the top 24 bits of an int32 to get the sign, mul must include the 1/256 factor
+            int io = swapIQ ? 1 : 0;
+            for (int i = 0; i < count; i++) {
+                const uint8_t* s = &in[i*stride];
+                int32_t v[2];
+                for (int c = 0; c < 2; c++) {
+                    const uint8_t* b = &s[c*3];
+                    if (bigEndian) {
+                        v[c] = (int32_t)(((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8));
+                    }
+                    else {
+                        v[c] = (int32_t)(((uint32_t)b[2] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[0] << 8));
+                    }
+                }
+                out[i*2] = (float)v[io] * mul + add;
+                out[i*2 + 1] = (float)v[io ^ 1] * mul + add;
+            }
+        }
+
+        inline void s32(const int32_t* in, float* out, int count, float mul, float add) {
+            for (int i = 0; i < count; i++) { out[i] = (float)in[i] * mul + add; }
+        }
+
+        inline void f32(const float* in, float* out, int count, float mul, float add) {
+            for (int i = 0; i < count; i++) { out[i] = in[i] * mul + add; }
+        }
+    }
+
+#if defined(DSP_SIMD_X86)
+    namespace sse {
+        inline __m128 cvtmad(__m128i v, __m128 mul, __m128 add) {
+            return _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(v), mul), add);
+        }
+
+        // SSE2 is always available on the platforms where DSP_SIMD_X86 is defined
+        inline int u8(const uint8_t* in, float* out, int count, float mul, float add) {
+            const __m128 vmul = _mm_set1_ps(mul);
+            const __m128 vadd = _mm_set1_ps(add);
+            const __m128i zero = _mm_setzero_si128();
+            int i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m128i raw = _mm_loadu_si128((const __m128i*)&in[i]);
+                __m128i lo = _mm_unpacklo_epi8(raw, zero);
+                __m128i hi = _mm_unpackhi_epi8(raw, zero);
+                _mm_storeu_ps(&out[i], cvtmad(_mm_unpacklo_epi16(lo, zero), vmul, vadd));
+                _mm_storeu_ps(&out[i + 4], cvtmad(_mm_unpackhi_epi16(lo, zero), vmul, vadd));
+                _mm_storeu_ps(&out[i + 8], cvtmad(_mm_unpacklo_epi16(hi, zero), vmul, vadd));
+                _mm_storeu_ps(&out[i + 12], cvtmad(_mm_unpackhi_epi16(hi, zero), vmul, vadd));
+            }
+            return i;
+        }
+
+        inline int s8(const int8_t* in, float* out, int count, float mul, float add) {
+            const __m128 vmul = _mm_set1_ps(mul);
+            const __m128 vadd = _mm_set1_ps(add);
+            int i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m128i raw = _mm_loadu_si128((const __m128i*)&in[i]);
+                __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(raw, raw), 8);
+                __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(raw, raw), 8);
+                _mm_storeu_ps(&out[i], cvtmad(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16), vmul, vadd));
+                _mm_storeu_ps(&out[i + 4], cvtmad(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16), vmul, vadd));
+                _mm_storeu_ps(&out[i + 8], cvtmad(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16), vmul, vadd));
+                _mm_storeu_ps(&out[i + 12], cvtmad(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16), vmul, vadd));
+            }
+            return i;
+        }
+
+        inline int s16(const int16_t* in, float* out, int count, float mul, float add) {
+            const __m128 vmul = _mm_set1_ps(mul);
+            const __m128 vadd = _mm_set1_ps(add);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m128i raw = _mm_loadu_si128((const __m128i*)&in[i]);
+                _mm_storeu_ps(&out[i], cvtmad(_mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16), vmul, vadd));
+                _mm_storeu_ps(&out[i + 4], cvtmad(_mm_srai_epi32(_mm_unpackhi_epi16(raw, raw), 16), vmul, vadd));
+            }
+            return i;
+        }
+
+        inline int s32(const int32_t* in, float* out, int count, float mul, float add) {
+            const __m128 vmul = _mm_set1_ps(mul);
+            const __m128 vadd = _mm_set1_ps(add);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_ps(&out[i], cvtmad(_mm_loadu_si128((const __m128i*)&in[i]), vmul, vadd));
+            }
+            return i;
+        }
+
+        inline int f32(const float* in, float* out, int count, float mul, float add) {
+            const __m128 vmul = _mm_set1_ps(mul);
+            const __m128 vadd = _mm_set1_ps(add);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_ps(&out[i], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&in[i]), vmul), vadd));
+            }
+            return i;
+        }
+
+        // The following kernels need SSSE3 for the byte shuffle and return the number of complex samples converted
+
+        DSP_TARGET("ssse3")
+        inline int s12Packed(const uint8_t* in, float* out, int count, float mul, float add) {
+            // Place each 12bit value in the top of a 16bit lane, even values need to be shifted up by 4
+            const __m128i shuf = _mm_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+            const __m128i shift = _mm_setr_epi16(16, 1, 16, 1, 16, 1, 16, 1);
+            const __m128i mask = _mm_set1_epi16((short)0xFFF0);
+            const __m128 vmul = _mm_set1_ps(mul * (1.0f / 16.0f));
+            const __m128 vadd = _mm_set1_ps(add);
+            int i = 0;
+            for (; i + 6 <= count; i += 4) {
+                __m128i raw = _mm_loadu_si128((const __m128i*)&in[i*3]);
+                __m128i w = _mm_and_si128(_mm_mullo_epi16(_mm_shuffle_epi8(raw, shuf), shift), mask);
+                _mm_storeu_ps(&out[i*2], cvtmad(_mm_srai_epi32(_mm_unpacklo_epi16(w, w), 16), vmul, vadd));
+                _mm_storeu_ps(&out[i*2 + 4], cvtmad(_mm_srai_epi32(_mm_unpackhi_epi16(w, w), 16), vmul, vadd));
+            }
+            return i;
+        }
+
+        DSP_TARGET("ssse3")
+        inline int s24(const uint8_t* in, float* out, int count, float mul, float add, bool bigEndian, int stride, bool swapIQ) {
+            // Two complex samples are converted per load, so they must fit in 16 bytes
+            if (stride < 6 || stride > 8) { return 0; }
+
+            // Build the shuffle moving the 24bit values to the top of each lane
+            alignas(16) int8_t idx[16];
+            for (int lane = 0; lane < 4; lane++) {
+                int base = (lane >> 1) * stride + (((lane & 1) ^ (swapIQ ? 1 : 0)) * 3);
+                idx[lane*4] = -1;
+                for (int b = 0; b < 3; b++) {
+                    idx[lane*4 + 1 + b] = bigEndian ? (base + 2 - b) : (base + b);
+                }
+            }
+            const __m128i shuf = _mm_load_si128((const __m128i*)idx);
+            const __m128 vmul = _mm_set1_ps(mul);
+            const __m128 vadd = _mm_set1_ps(add);
+            int i = 0;
+            for (; (count - i) * stride >= 16; i += 2) {
+                __m128i raw = _mm_loadu_si128((const __m128i*)&in[i*stride]);
+                _mm_storeu_ps(&out[i*2], cvtmad(_mm_shuffle_epi8(raw, shuf), vmul, vadd));
+            }
+            return i;
+        }
+    }
+
+    namespace avx2 {
+        DSP_TARGET("avx2,fma")
+        inline int u8(const uint8_t* in, float* out, int count, float mul, float add) {
+            const __m256 vmul = _mm256_set1_ps(mul);
+            const __m256 vadd = _mm256_set1_ps(add);
+            int i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m128i raw = _mm_loadu_si128((const __m128i*)&in[i]);
+                __m256 a = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(raw));
+                __m256 b = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(raw, 8)));
+                _mm256_storeu_ps(&out[i], _mm256_fmadd_ps(a, vmul, vadd));
+                _mm256_storeu_ps(&out[i + 8], _mm256_fmadd_ps(b, vmul, vadd));
+            }
+            return i;
+        }
+
+        DSP_TARGET("avx2,fma")
+        inline int s8(const int8_t* in, float* out, int count, float mul, float add) {
+            const __m256 vmul = _mm256_set1_ps(mul);
+            const __m256 vadd = _mm256_set1_ps(add);
+            int i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m128i raw = _mm_loadu_si128((const __m128i*)&in[i]);
+                __m256 a = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(raw));
+                __m256 b = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(raw, 8)));
+                _mm256_storeu_ps(&out[i], _mm256_fmadd_ps(a, vmul, vadd));
+                _mm256_storeu_ps(&out[i + 8], _mm256_fmadd_ps(b, vmul, vadd));
+            }
+            return i;
+        }
+
+        DSP_TARGET("avx2,fma")
+        inline int s16(const int16_t* in, float* out, int count, float mul, float add) {
+            const __m256 vmul = _mm256_set1_ps(mul);
+            const __m256 vadd = _mm256_set1_ps(add);
+            int i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m256i raw = _mm256_loadu_si256((const __m256i*)&in[i]);
+                __m256 a = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(raw)));
+                __m256 b = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(raw, 1)));
+                _mm256_storeu_ps(&out[i], _mm256_fmadd_ps(a, vmul, vadd));
+                _mm256_storeu_ps(&out[i + 8], _mm256_fmadd_ps(b, vmul, vadd));
+            }
+            return i;
+        }
+
+        DSP_TARGET("avx2,fma")
+        inline int s32(const int32_t* in, float* out, int count, float mul, float add) {
+            const __m256 vmul = _mm256_set1_ps(mul);
+            const __m256 vadd = _mm256_set1_ps(add);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 v = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)&in[i]));
+                _mm256_storeu_ps(&out[i], _mm256_fmadd_ps(v, vmul, vadd));
+            }
+            return i;
+        }
+
+        DSP_TARGET("avx2,fma")
+        inline int f32(const float* in, float* out, int count, float mul, float add) {
+            const __m256 vmul = _mm256_set1_ps(mul);
+            const __m256 vadd = _mm256_set1_ps(add);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_ps(&out[i], _mm256_fmadd_ps(_mm256_loadu_ps(&in[i]), vmul, vadd));
+            }
+            return i;
+        }
+    }
+#endif
+
+#if defined(DSP_SIMD_NEON)
+    namespace neon {
+        inline float32x4_t cvtmad(int32x4_t v, float32x4_t mul, float32x4_t add) {
+            return vmlaq_f32(add, vcvtq_f32_s32(v), mul);
+        }
+
+        inline int u8(const uint8_t* in, float* out, int count, float mul, float add) {
+            const float32x4_t vmul = vdupq_n_f32(mul);
+            const float32x4_t vadd = vdupq_n_f32(add);
+            int i = 0;
+            for (; i + 16 <= count; i += 16) {
+                uint8x16_t raw = vld1q_u8(&in[i]);
+                int16x8_t lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(raw)));
+                int16x8_t hi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(raw)));
+                vst1q_f32(&out[i], cvtmad(vmovl_s16(vget_low_s16(lo)), vmul, vadd));
+                vst1q_f32(&out[i + 4], cvtmad(vmovl_s16(vget_high_s16(lo)), vmul, vadd));
+                vst1q_f32(&out[i + 8], cvtmad(vmovl_s16(vget_low_s16(hi)), vmul, vadd));
+                vst1q_f32(&out[i + 12], cvtmad(vmovl_s16(vget_high_s16(hi)), vmul, vadd));
+            }
+            return i;
+        }
+
+        inline int s8(const int8_t* in, float* out, int count, float mul, float add) {
+            const float32x4_t vmul = vdupq_n_f32(mul);
+            const float32x4_t vadd = vdupq_n_f32(add);
+            int i = 0;
+            for (; i + 16 <= count; i += 16) {
+                int8x16_t raw = vld1q_s8(&in[i]);
+                int16x8_t lo = vmovl_s8(vget_low_s8(raw));
+                int16x8_t hi = vmovl_s8(vget_high_s8(raw));
+                vst1q_f32(&out[i], cvtmad(vmovl_s16(vget_low_s16(lo)), vmul, vadd));
+                vst1q_f32(&out[i + 4], cvtmad(vmovl_s16(vget_high_s16(lo)), vmul, vadd));
+                vst1q_f32(&out[i + 8], cvtmad(vmovl_s16(vget_low_s16(hi)), vmul, vadd));
+                vst1q_f32(&out[i + 12], cvtmad(vmovl_s16(vget_high_s16(hi)), vmul, vadd));
+            }
+            return i;
+        }
+
+        inline int s16(const int16_t* in, float* out, int count, float mul, float add) {
+            const float32x4_t vmul = vdupq_n_f32(mul);
+            const float32x4_t vadd = vdupq_n_f32(add);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                int16x8_t raw = vld1q_s16(&in[i]);
+                vst1q_f32(&out[i], cvtmad(vmovl_s16(vget_low_s16(raw)), vmul, vadd));
+                vst1q_f32(&out[i + 4], cvtmad(vmovl_s16(vget_high_s16(raw)), vmul, vadd));
+            }
+            return i;
+        }
+
+        inline int s32(const int32_t* in, float* out, int count, float mul, float add) {
+            const float32x4_t vmul = vdupq_n_f32(mul);
+            const float32x4_t vadd = vdupq_n_f32(add);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                vst1q_f32(&out[i], cvtmad(vld1q_s32(&in[i]), vmul, vadd));
+            }
+            return i;
+        }
+
+        inline int f32(const float* in, float* out, int count, float mul, float add) {
+            const float32x4_t vmul = vdupq_n_f32(mul);
+            const float32x4_t vadd = vdupq_n_f32(add);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                vst1q_f32(&out[i], vmlaq_f32(vadd, vld1q_f32(&in[i]), vmul));
+            }
+            return i;
+        }
+
+        inline int s12Packed(const uint8_t* in, float* out, int count, float mul, float add) {
+            const uint8_t idx[16] = { 0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11 };
+            const int16_t sh[8] = { 4, 0, 4, 0, 4, 0, 4, 0 };
+            const uint8x16_t shuf = vld1q_u8(idx);
+            const int16x8_t shift = vld1q_s16(sh);
+            const int16x8_t mask = vdupq_n_s16((int16_t)0xFFF0);
+            const float32x4_t vmul = vdupq_n_f32(mul * (1.0f / 16.0f));
+            const float32x4_t vadd = vdupq_n_f32(add);
+            int i = 0;
+            for (; i + 6 <= count; i += 4) {
+                uint8x16_t raw = vld1q_u8(&in[i*3]);
+                int16x8_t w = vandq_s16(vshlq_s16(vreinterpretq_s16_u8(vqtbl1q_u8(raw, shuf)), shift), mask);
+                vst1q_f32(&out[i*2], cvtmad(vmovl_s16(vget_low_s16(w)), vmul, vadd));
+                vst1q_f32(&out[i*2 + 4], cvtmad(vmovl_s16(vget_high_s16(w)), vmul, vadd));
+            }
+            return i;
+        }
+
+        inline int s24(const uint8_t* in, float* out, int count, float mul, float add, bool bigEndian, int stride, bool swapIQ) {
+            if (stride < 6 || stride > 8) { return 0; }
+
+            // Out of range indices give zero
+            uint8_t idx[16];
+            for (int lane = 0; lane < 4; lane++) {
+                int base = (lane >> 1) * stride + (((lane & 1) ^ (swapIQ ? 1 : 0)) * 3);
+                idx[lane*4] = 0xFF;
+                for (int b = 0; b < 3; b++) {
+                    idx[lane*4 + 1 + b] = bigEndian ? (base + 2 - b) : (base + b);
+                }
+            }
+            const uint8x16_t shuf = vld1q_u8(idx);
+            const float32x4_t vmul = vdupq_n_f32(mul);
+            const float32x4_t vadd = vdupq_n_f32(add);
+            int i = 0;
+            for (; (count - i) * stride >= 16; i += 2) {
+                uint8x16_t raw = vld1q_u8(&in[i*stride]);
+                vst1q_f32(&out[i*2], cvtmad(vreinterpretq_s32_u8(vqtbl1q_u8(raw, shuf)), vmul, vadd));
+            }
+            return i;
+        }
+    }
+#endif
+
+    /**
+     * Convert unsigned 8bit IQ samples.
+     * @param in Input samples.
+     * @param out Output samples.
+     * @param count Number of complex samples.
+     * @param scale Scale applied after removing the offset.
+     * @param offset Value subtracted from each sample.
+     */
+    inline void u8ToComplex(const uint8_t* in, complex_t* out, int count, float scale = 1.0f / 128.0f, float offset = 128.0f) {
+        float* fout = (float*)out;
+        int n = count * 2;
+        float add = -offset * scale;
+        int done = 0;
+#if defined(DSP_SIMD_X86)
+        done = simd::hasAVX2() ? avx2::u8(in, fout, n, scale, add) : sse::u8(in, fout, n, scale, add);
+#elif defined(DSP_SIMD_NEON)
+        done = neon::u8(in, fout, n, scale, add);
+#endif
+        generic::u8(&in[done], &fout[done], n - done, scale, add);
+    }
+
+    /**
+     * Convert signed 8bit IQ samples.
+     * @param in Input samples.
+     * @param out Output samples.
+     * @param count Number of complex samples.
+     * @param scale Scale applied after removing the offset.
+     * @param offset Value subtracted from each sample.
+     */
+    inline void s8ToComplex(const int8_t* in, complex_t* out, int count, float scale = 1.0f / 128.0f, float offset = 0.0f) {
+        float* fout = (float*)out;
+        int n = count * 2;
+        float add = -offset * scale;
+        int done = 0;
+#if defined(DSP_SIMD_X86)
+        done = simd::hasAVX2() ? avx2::s8(in, fout, n, scale, add) : sse::s8(in, fout, n, scale, add);
+#elif defined(DSP_SIMD_NEON)
+        done = neon::s8(in, fout, n, scale, add);
+#endif
+        generic::s8(&in[done], &fout[done], n - done, scale, add);
+    }
+
+    /**
+     * Convert packed signed 12bit IQ samples (3 bytes per complex sample).
+     * @param in Input samples.
+     * @param out Output samples.
+     * @param count Number of complex samples.
+     * @param scale Scale applied after removing the offset.
+     * @param offset Value subtracted from each sample.
+     */
+    inline void s12PackedToComplex(const uint8_t* in, complex_t* out, int count, float scale = 1.0f / 2048.0f, float offset = 0.0f) {
+        float* fout = (float*)out;
+        float add = -offset * scale;
+        int done = 0;
+#if defined(DSP_SIMD_X86)
+        if (simd::hasSSSE3()) { done = sse::s12Packed(in, fout, count, scale, add); }
+#elif defined(DSP_SIMD_NEON)
+        done = neon::s12Packed(in, fout, count, scale, add);
+#endif
+        generic::s12Packed(&in[done*3], &fout[done*2], count - done, scale, add);
+    }
+
+    /**
+     * Convert signed 16bit IQ samples.
+     * @param in Input samples.
+     * @param out Output samples.
+     * @param count Number of complex samples.
+     * @param scale Scale applied after removing the offset.
+     * @param offset Value subtracted from each sample.
+     */
+    inline void s16ToComplex(const int16_t* in, complex_t* out, int count, float scale = 1.0f / 32768.0f, float offset = 0.0f) {
+        float* fout = (float*)out;
+        int n = count * 2;
+        float add = -offset * scale;
+        int done = 0;
+#if defined(DSP_SIMD_X86)
+        done = simd::hasAVX2() ? avx2::s16(in, fout, n, scale, add) : sse::s16(in, fout, n, scale, add);
+#elif defined(DSP_SIMD_NEON)
+        done = neon::s16(in, fout, n, scale, add);
+#endif
+        generic::s16(&in[done], &fout[done], n - done, scale, add);
+    }
+
+    /**
+     * Convert signed 24bit IQ samples.
+     * @param in Input samples.
+     * @param out Output samples.
+     * @param count Number of complex samples.
+     * @param bigEndian True if the samples are big endian, false if little endian.
+     * @param scale Scale applied after removing the offset.
+     * @param offset Value subtracted from each sample.
+     * @param stride Distance between two complex samples in bytes, more than 6 if the samples are interleaved with other data.
+     * @param swapIQ True if Q comes before I in the input.
+     */
+    inline void s24ToComplex(const uint8_t* in, complex_t* out, int count, bool bigEndian, float scale = 1.0f / 8388608.0f, float offset = 0.0f, int stride = 6, bool swapIQ = false) {
+        float* fout = (float*)out;
+        float mul = scale * (1.0f / 256.0f);
+        float add = -offset * scale;
+        int done = 0;
+#if defined(DSP_SIMD_X86)
+        if (simd::hasSSSE3()) { done = sse::s24(in, fout, count, mul, add, bigEndian, stride, swapIQ); }
+#elif defined(DSP_SIMD_NEON)
+        done = neon::s24(in, fout, count, mul, add, bigEndian, stride, swapIQ);
+#endif
+        generic::s24(&in[done*stride], &fout[done*2], count - done, mul, add, bigEndian, stride, swapIQ);
+    }
+
+    /**
+     * Convert signed 32bit IQ samples.
+     * @param in Input samples.
+     * @param out Output samples.
+     * @param count Number of complex samples.
+     * @param scale Scale applied after removing the offset.
+     * @param offset Value subtracted from each sample.
+     */
+    inline void s32ToComplex(const int32_t* in, complex_t* out, int count, float scale = 1.0f / 2147483648.0f, float offset = 0.0f) {
+        float* fout = (float*)out;
+        int n = count * 2;
+        float add = -offset * scale;
+        int done = 0;
+#if defined(DSP_SIMD_X86)
+        done = simd::hasAVX2() ? avx2::s32(in, fout, n, scale, add) : sse::s32(in, fout, n, scale, add);
+#elif defined(DSP_SIMD_NEON)
+        done = neon::s32(in, fout, n, scale, add);
+#endif
+        generic::s32(&in[done], &fout[done], n - done, scale, add);
+    }
+
+    /**
+     * Convert float IQ samples.
+     * @param in Input samples.
+     * @param out Output samples.
+     * @param count Number of complex samples.
+     * @param scale Scale applied after removing the offset.
+     * @param offset Value subtracted from each sample.
+     */
+    inline void f32ToComplex(const float* in, complex_t* out, int count, float scale = 1.0f, float offset = 0.0f) {
+        float* fout = (float*)out;
+        int n = count * 2;
+        if (scale == 1.0f && offset == 0.0f) {
+            if ((const void*)in != (void*)out) { memcpy(out, in, n * sizeof(float)); }
+            return;
+        }
+        float add = -offset * scale;
+        int done = 0;
+#if defined(DSP_SIMD_X86)
+        done = simd::hasAVX2() ? avx2::f32(in, fout, n, scale, add) : sse::f32(in, fout, n, scale, add);
+#elif defined(DSP_SIMD_NEON)
+        done = neon::f32(in, fout, n, scale, add);
+#endif
+        generic::f32(&in[done], &fout[done], n - done, scale, add);
+    }
+
+    /**
+     * Convert IQ samples of any supported format.
+     * @param format Format of the input samples.
+     * @param in Input samples.
+     * @param out Output samples.
+     * @param count Number of complex samples.
+     * @param scale Scale applied after removing the offset.
+     * @param offset Value subtracted from each sample.
+     */
+    inline void toComplex(SampleFormat format, const void* in, complex_t* out, int count, float scale, float offset) {
+        switch (format) {
+        case SAMPLE_FORMAT_U8:          u8ToComplex((const uint8_t*)in, out, count, scale, offset); break;
+        case SAMPLE_FORMAT_S8:          s8ToComplex((const int8_t*)in, out, count, scale, offset); break;
+        case SAMPLE_FORMAT_S12_PACKED:  s12PackedToComplex((const uint8_t*)in, out, count, scale, offset); break;
+        case SAMPLE_FORMAT_S16:         s16ToComplex((const int16_t*)in, out, count, scale, offset); break;
+        case SAMPLE_FORMAT_S24_BE:      s24ToComplex((const uint8_t*)in, out, count, true, scale, offset); break;
+        case SAMPLE_FORMAT_S24_LE:      s24ToComplex((const uint8_t*)in, out, count, false, scale, offset); break;
+        case SAMPLE_FORMAT_S32:         s32ToComplex((const int32_t*)in, out, count, scale, offset); break;
+        case SAMPLE_FORMAT_F32:         f32ToComplex((const float*)in, out, count, scale, offset); break;
+        default:                        break;
+        }
+    }
+
+    /**
+     * Convert IQ samples of any supported format using the default scale and offset.
+     * @param format Format of the input samples.
+     * @param in Input samples.
+     * @param out Output samples.
+     * @param count Number of complex samples.
+     */
+    inline void toComplex(SampleFormat format, const void* in, complex_t* out, int count) {
+        toComplex(format, in, out, count, defaultScale(format), defaultOffset(format));
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "../processor.h"
+#include "../math/one_pole.h"
 
 namespace dsp::correction {
     template<class T>
@@ -52,9 +53,12 @@ namespace dsp::correction {
 
         // TODO: Add back the const
         int process(int count, T* in, T* out) {
-            for (int i = 0; i < count; i++) {
-                out[i] = in[i] - offset;
-                offset += out[i] * _rate;
+            // The offset follows the input through a one-pole low pass and the output is what is left of the input
+            if constexpr (std::is_same_v<T, float>) {
+                math::onePole<1, true>(in, out, count, _rate, &offset);
+            }
+            if constexpr (std::is_same_v<T, complex_t> || std::is_same_v<T, stereo_t>) {
+                math::onePole<2, true>((float*)in, (float*)out, count, _rate, (float*)&offset);
             }
             return count;
         }
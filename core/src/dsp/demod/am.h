@@ -80,6 +80,13 @@ namespace dsp::demod {
             audioAgc.setDecay(decay);
         }
 
+        void setAGCLookAhead(int samples) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            carrierAgc.setLookAhead(samples);
+            audioAgc.setLookAhead(samples);
+        }
+
         void setDCBlockRate(double rate) {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
@@ -136,9 +143,23 @@ namespace dsp::demod {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
 
-            process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+            // Skip the demodulation of silence. The AGCs keep their gain instead of ramping up on nothing,
+            // the DC blocker and low-pass restart from rest once the signal is back.
+            bool silent = base_type::_in->readSilent;
+            if (silent) {
+                dcBlock.reset();
+                {
+                    std::lock_guard<std::mutex> lck(lpfMtx);
+                    lpf.reset();
+                }
+                buffer::clear<T>(base_type::out.writeBuf, count);
+            }
+            else {
+                process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+            }
 
             base_type::_in->flush();
+            base_type::out.writeSilent = silent;
             if (!base_type::out.swap(count)) { return -1; }
             return count;
         }
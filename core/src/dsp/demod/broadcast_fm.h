@@ -3,6 +3,7 @@
 #include "../taps/low_pass.h"
 #include "../taps/band_pass.h"
 #include "../filter/fir.h"
+#include "../filter/decimating_fir.h"
 #include "../loop/pll.h"
 #include "../convert/l_r_to_stereo.h"
 #include "../convert/real_to_complex.h"
@@ -12,7 +13,15 @@
 #include "../math/multiply.h"
 #include "../math/add.h"
 #include "../math/subtract.h"
+#include "../math/phasor.h"
+#include "../math/hz_to_rads.h"
 #include "../multirate/rational_resampler.h"
+#include "../bench/load_meter.h"
+#include <algorithm>
+
+// Decimations of the economy mode: the MPX is processed at half the IF samplerate and the audio is output at a quarter of it
+#define BROADCAST_FM_ECO_MPX_DECIM      2
+#define BROADCAST_FM_ECO_AUDIO_DECIM    2
 
 namespace dsp::demod {
     class BroadcastFM : public Processor<complex_t, stereo_t> {
@@ -20,7 +29,7 @@ namespace dsp::demod {
     public:
         BroadcastFM() {}
 
-        BroadcastFM(stream<complex_t>* in, double deviation, double samplerate, bool stereo = true, bool lowPass = true, bool rdsOut = false) { init(in, deviation, samplerate, stereo, lowPass); }
+        BroadcastFM(stream<complex_t>* in, double deviation, double samplerate, bool stereo = true, bool lowPass = true, bool rdsOut = false, bool economy = false) { init(in, deviation, samplerate, stereo, lowPass, rdsOut, economy); }
 
         ~BroadcastFM() {
             if (!base_type::_block_init) { return; }
@@ -30,35 +39,48 @@ namespace dsp::demod {
             buffer::free(r);
             taps::free(pilotFirTaps);
             taps::free(audioFirTaps);
+            taps::free(mpxDecimTaps);
+            taps::free(ecoAudioTaps);
         }
 
-        virtual void init(stream<complex_t>* in, double deviation, double samplerate, bool stereo = true, bool lowPass = true, bool rdsOut = false) {
+        virtual void init(stream<complex_t>* in, double deviation, double samplerate, bool stereo = true, bool lowPass = true, bool rdsOut = false, bool economy = false) {
             _deviation = deviation;
             _samplerate = samplerate;
             _stereo = stereo;
             _lowPass = lowPass;
             _rdsOut = rdsOut;
+            _economy = economy;
+            double mpxSamplerate = getMPXSamplerate();
             
             demod.init(NULL, _deviation, _samplerate);
-            pilotFirTaps = taps::bandPass<complex_t>(18750.0, 19250.0, 3000.0, _samplerate, true);
+            mpxDecimTaps = genMPXDecimTaps();
+            mpxDecim.init(NULL, mpxDecimTaps, BROADCAST_FM_ECO_MPX_DECIM);
+            pilotFirTaps = genPilotTaps(mpxSamplerate);
             pilotFir.init(NULL, pilotFirTaps);
             rtoc.init(NULL);
-            pilotPLL.init(NULL, 25000.0 / _samplerate, 0.0, math::hzToRads(19000.0, _samplerate), math::hzToRads(18750.0, _samplerate), math::hzToRads(19250.0, _samplerate));
-            lprDelay.init(NULL, ((pilotFirTaps.size - 1) / 2) + 1);
-            lmrDelay.init(NULL, ((pilotFirTaps.size - 1) / 2) + 1);
+            pilotPLL.init(NULL, 25000.0 / mpxSamplerate, 0.0, math::hzToRads(19000.0, mpxSamplerate), math::hzToRads(18750.0, mpxSamplerate), math::hzToRads(19250.0, mpxSamplerate));
+            lprDelay.init(NULL, (pilotFirTaps.size - 1) / 2);
+            lmrDelay.init(NULL, (pilotFirTaps.size - 1) / 2);
             audioFirTaps = taps::lowPass(15000.0, 4000.0, _samplerate);
             alFir.init(NULL, audioFirTaps);
             arFir.init(NULL, audioFirTaps);
-            rdsResamp.init(NULL, samplerate, 5000.0);
+            ecoAudioTaps = taps::lowPass(15000.0, 4000.0, mpxSamplerate);
+            monoDecim.init(NULL, ecoAudioTaps, BROADCAST_FM_ECO_AUDIO_DECIM);
+            stereoDecim.init(NULL, ecoAudioTaps, BROADCAST_FM_ECO_AUDIO_DECIM);
+            rdsResamp.init(NULL, mpxSamplerate, 5000.0);
+            loadMeter.init(_samplerate);
 
             lmr = buffer::alloc<float>(STREAM_BUFFER_SIZE);
             l = buffer::alloc<float>(STREAM_BUFFER_SIZE);
             r = buffer::alloc<float>(STREAM_BUFFER_SIZE);
 
+            mpxDecim.out.free();
             lprDelay.out.free();
             lmrDelay.out.free();
             arFir.out.free();
             alFir.out.free();
+            monoDecim.out.free();
+            stereoDecim.out.free();
             rdsResamp.out.free();
 
             base_type::init(in);
@@ -78,21 +100,12 @@ namespace dsp::demod {
             _samplerate = samplerate;
 
             demod.setDeviation(_deviation, _samplerate);
-            taps::free(pilotFirTaps);
-            pilotFirTaps = taps::bandPass<complex_t>(18750.0, 19250.0, 3000.0, samplerate, true);
-            pilotFir.setTaps(pilotFirTaps);
-            
-            pilotPLL.setFrequencyLimits(math::hzToRads(18750.0, _samplerate), math::hzToRads(19250.0, _samplerate));
-            pilotPLL.setInitialFreq(math::hzToRads(19000.0, _samplerate));
-            lprDelay.setDelay(((pilotFirTaps.size - 1) / 2) + 1);
-            lmrDelay.setDelay(((pilotFirTaps.size - 1) / 2) + 1);
-
             taps::free(audioFirTaps);
             audioFirTaps = taps::lowPass(15000.0, 4000.0, _samplerate);
             alFir.setTaps(audioFirTaps);
             arFir.setTaps(audioFirTaps);
-
-            rdsResamp.setInSamplerate(samplerate);
+            loadMeter.setSamplerate(_samplerate);
+            updateMPXSamplerate();
 
             reset();
             base_type::tempStart();
@@ -121,37 +134,86 @@ namespace dsp::demod {
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             base_type::tempStop();
             _rdsOut = rdsOut;
+
+            // The MPX decimation filter has to keep the RDS subcarrier when it is used
+            taps::free(mpxDecimTaps);
+            mpxDecimTaps = genMPXDecimTaps();
+            mpxDecim.setTaps(mpxDecimTaps);
+
             reset();
             base_type::tempStart();
         }
 
+        /**
+         * Enable the economy mode. The MPX is decimated before the stereo and RDS processing and the audio
+         * is always low-passed and output at a lower samplerate, see getOutSamplerate(). The stereo and RDS subcarriers
+         * are only kept intact for IF samplerates of at least 240KHz.
+         * @param economy True to enable the economy mode.
+         */
+        void setEconomy(bool economy) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            _economy = economy;
+            updateMPXSamplerate();
+            reset();
+            base_type::tempStart();
+        }
+
+        /**
+         * Get the samplerate of the audio output.
+         * @return Samplerate in Hz.
+         */
+        double getOutSamplerate() {
+            return _economy ? (_samplerate / (BROADCAST_FM_ECO_MPX_DECIM * BROADCAST_FM_ECO_AUDIO_DECIM)) : _samplerate;
+        }
+
+        /**
+         * Get the processing load of the demodulator.
+         * @return Processing time divided by signal time, 1.0 being a full CPU core.
+         */
+        float getLoad() {
+            return loadMeter.getLoad();
+        }
+
         void reset() {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             base_type::tempStop();
             demod.reset();
+            mpxDecim.reset();
             pilotFir.reset();
             pilotPLL.reset();
             lprDelay.reset();
             lmrDelay.reset();
             alFir.reset();
             arFir.reset();
+            monoDecim.reset();
+            stereoDecim.reset();
+            loadMeter.reset();
             base_type::tempStart();
         }
 
         inline int process(int count, complex_t* in, stereo_t* out, int& rdsOutCount, float* rdsout = NULL) {
             // Demodulate
-            demod.process(count, in, demod.out.writeBuf);
+            float* mpx = demod.out.writeBuf;
+            demod.process(count, in, mpx);
+
+            // In economy mode, everything after the demodulator runs at a lower samplerate
+            if (_economy) {
+                count = mpxDecim.process(count, mpx, mpx);
+            }
+
             if (_stereo) {
                 // Convert to complex
-                rtoc.process(count, demod.out.writeBuf, rtoc.out.writeBuf);
+                rtoc.process(count, mpx, rtoc.out.writeBuf);
 
                 // Filter out pilot and run through PLL
                 pilotFir.process(count, rtoc.out.writeBuf, pilotFir.out.writeBuf);
                 pilotPLL.process(count, pilotFir.out.writeBuf, pilotPLL.out.writeBuf);
 
                 // Delay
-                lprDelay.process(count, demod.out.writeBuf, demod.out.writeBuf);
+                lprDelay.process(count, mpx, mpx);
                 lmrDelay.process(count, rtoc.out.writeBuf, rtoc.out.writeBuf);
                 
                 // conjugate PLL output to down convert twice the L-R signal
@@ -175,10 +237,14 @@ namespace dsp::demod {
                 volk_32f_s32f_multiply_32f(lmr, lmr, 2.0f, count);
 
                 // Do L = (L+R) + (L-R), R = (L+R) - (L-R)
-                math::Add<float>::process(count, demod.out.writeBuf, lmr, l);
-                math::Subtract<float>::process(count, demod.out.writeBuf, lmr, r);
+                math::Add<float>::process(count, mpx, lmr, l);
+                math::Subtract<float>::process(count, mpx, lmr, r);
 
-                // Filter if needed
+                // Filter if needed, the economy mode always filters since it decimates at the same time
+                if (_economy) {
+                    convert::LRToStereo::process(count, l, r, out);
+                    return stereoDecim.process(count, out, out);
+                }
                 if (_lowPass) {
                     alFir.process(count, l, l);
                     arFir.process(count, r, r);
@@ -191,14 +257,14 @@ namespace dsp::demod {
                 // Process RDS if needed. Note: find a way to not have to copy half the code from the stereo demod
                 if (_rdsOut) {
                     // Convert to complex
-                    rtoc.process(count, demod.out.writeBuf, rtoc.out.writeBuf);
+                    rtoc.process(count, mpx, rtoc.out.writeBuf);
 
                     // Filter out pilot and run through PLL
                     pilotFir.process(count, rtoc.out.writeBuf, pilotFir.out.writeBuf);
                     pilotPLL.process(count, pilotFir.out.writeBuf, pilotPLL.out.writeBuf);
 
                     // Delay
-                    lprDelay.process(count, demod.out.writeBuf, demod.out.writeBuf);
+                    lprDelay.process(count, mpx, mpx);
                     lmrDelay.process(count, rtoc.out.writeBuf, rtoc.out.writeBuf);
                     
                     // conjugate PLL output to down convert twice the L-R signal
@@ -214,12 +280,15 @@ namespace dsp::demod {
                 }
 
                 // Filter if needed
-                if (_lowPass) {
-                    alFir.process(count, demod.out.writeBuf, demod.out.writeBuf);
+                if (_economy) {
+                    count = monoDecim.process(count, mpx, mpx);
+                }
+                else if (_lowPass) {
+                    alFir.process(count, mpx, mpx);
                 }
 
                 // Interleave raw MPX to stereo
-                convert::LRToStereo::process(count, demod.out.writeBuf, demod.out.writeBuf, out);
+                convert::LRToStereo::process(count, mpx, mpx, out);
             }
 
             return count;
@@ -230,10 +299,12 @@ namespace dsp::demod {
             if (count < 0) { return -1; }
 
             int rdsOutCount = 0;
-            process(count, base_type::_in->readBuf, base_type::out.writeBuf, rdsOutCount, rdsOut.writeBuf);
+            loadMeter.begin();
+            int outCount = process(count, base_type::_in->readBuf, base_type::out.writeBuf, rdsOutCount, rdsOut.writeBuf);
+            loadMeter.end(count);
 
             base_type::_in->flush();
-            if (!base_type::out.swap(count)) { return -1; }
+            if (outCount && !base_type::out.swap(outCount)) { return -1; }
             if (rdsOutCount && _rdsOut) {
                 if (!rdsOut.swap(rdsOutCount)) { return -1; }
             }
@@ -243,13 +314,72 @@ namespace dsp::demod {
         stream<float> rdsOut;
 
     protected:
+        double getMPXSamplerate() {
+            return _economy ? (_samplerate / BROADCAST_FM_ECO_MPX_DECIM) : _samplerate;
+        }
+
+        tap<float> genMPXDecimTaps() {
+            // Keep everything up to the top of the L-R subcarrier, or of the RDS subcarrier if needed, and
+            // let the rest fold back above it. Below about four times that samplerate there is no room left, the
+            // transition is then kept to a minimum and the top of the MPX aliases.
+            double halfRate = _samplerate / (2.0 * BROADCAST_FM_ECO_MPX_DECIM);
+            double passband = _rdsOut ? 60000.0 : 53000.0;
+            return taps::lowPass(halfRate, std::max<double>(2.0 * (halfRate - passband), 4000.0), _samplerate);
+        }
+
+        tap<complex_t> genPilotTaps(double samplerate) {
+            tap<complex_t> pilotTaps = taps::bandPass<complex_t>(18750.0, 19250.0, 3000.0, samplerate, true);
+
+            // The band-pass shifts the phase of the pilot on top of its group delay by an amount that depends on the samplerate.
+            // Rotate the taps so that the pilot comes out pi/4 ahead, which puts twice its phase in line with the stereo subcarrier.
+            double omega = math::hzToRads(19000.0, samplerate);
+            complex_t resp = { 0.0f, 0.0f };
+            for (int i = 0; i < pilotTaps.size; i++) {
+                resp = resp + pilotTaps.taps[i] * math::phasor(omega * i);
+            }
+            double excess = resp.phase() - (omega * ((pilotTaps.size - 1) / 2));
+            complex_t rot = math::phasor((FL_M_PI / 4.0) - excess);
+            for (int i = 0; i < pilotTaps.size; i++) {
+                pilotTaps.taps[i] = pilotTaps.taps[i] * rot;
+            }
+            return pilotTaps;
+        }
+
+        void updateMPXSamplerate() {
+            double mpxSamplerate = getMPXSamplerate();
+
+            taps::free(mpxDecimTaps);
+            mpxDecimTaps = genMPXDecimTaps();
+            mpxDecim.setTaps(mpxDecimTaps);
+
+            taps::free(pilotFirTaps);
+            pilotFirTaps = genPilotTaps(mpxSamplerate);
+            pilotFir.setTaps(pilotFirTaps);
+            
+            pilotPLL.setBandwidth(25000.0 / mpxSamplerate);
+            pilotPLL.setFrequencyLimits(math::hzToRads(18750.0, mpxSamplerate), math::hzToRads(19250.0, mpxSamplerate));
+            pilotPLL.setInitialFreq(math::hzToRads(19000.0, mpxSamplerate));
+            lprDelay.setDelay((pilotFirTaps.size - 1) / 2);
+            lmrDelay.setDelay((pilotFirTaps.size - 1) / 2);
+
+            taps::free(ecoAudioTaps);
+            ecoAudioTaps = taps::lowPass(15000.0, 4000.0, mpxSamplerate);
+            monoDecim.setTaps(ecoAudioTaps);
+            stereoDecim.setTaps(ecoAudioTaps);
+
+            rdsResamp.setInSamplerate(mpxSamplerate);
+        }
+
         double _deviation;
         double _samplerate;
         bool _stereo;
         bool _lowPass;
         bool _rdsOut;
+        bool _economy;
 
         Quadrature demod;
+        tap<float> mpxDecimTaps;
+        filter::DecimatingFIR<float, float> mpxDecim;
         tap<complex_t> pilotFirTaps;
         filter::FIR<complex_t, complex_t> pilotFir;
         convert::RealToComplex rtoc;
@@ -259,7 +389,11 @@ namespace dsp::demod {
         tap<float> audioFirTaps;
         filter::FIR<float, float> arFir;
         filter::FIR<float, float> alFir;
+        tap<float> ecoAudioTaps;
+        filter::DecimatingFIR<float, float> monoDecim;
+        filter::DecimatingFIR<stereo_t, float> stereoDecim;
         multirate::RationalResampler<float> rdsResamp;
+        bench::LoadMeter loadMeter;
 
         float* lmr;
         float* l;
@@ -0,0 +1,357 @@
+#pragma once
+#include "../sink.h"
+#include "../multirate/decim/plans.h"
+#include "../taps/low_pass.h"
+#include "../taps/from_array.h"
+#include "../math/phase_diff.h"
+#include "../math/one_pole.h"
+#include "../math/hz_to_rads.h"
+#include "../convert/mono_to_stereo.h"
+#include <stdexcept>
+
+// Demodulates a group of narrow band channels out of the same wideband stream in a single block.
+// Every channel is shifted to baseband and goes through the same decimation filters, whose taps are shared.
+// Only the state of each channel (oscillator, filter history, demodulator) is stored per channel, in arrays
+// indexed by channel. Since all channels see the same number of samples, the decimation phases are shared too.
+
+namespace dsp::demod {
+    class ChannelGroup : public Sink<complex_t> {
+        using base_type = Sink<complex_t>;
+    public:
+        enum Mode {
+            NFM,
+            AM
+        };
+
+        ChannelGroup() {}
+
+        ChannelGroup(stream<complex_t>* in, Mode mode, double samplerate, double channelSamplerate, double bandwidth) { init(in, mode, samplerate, channelSamplerate, bandwidth); }
+
+        ~ChannelGroup() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            for (auto& out : outputs) { delete out; }
+            freeStages();
+            buffer::free(workA);
+            buffer::free(workB);
+            buffer::free(amp);
+            buffer::free(audio);
+        }
+
+        /**
+         * @param in Wideband input stream.
+         * @param mode Demodulation applied to all channels.
+         * @param samplerate Samplerate of the input stream.
+         * @param channelSamplerate Samplerate of the audio output of each channel, the input samplerate must be a power of two multiple of it.
+         * @param bandwidth Bandwidth of each channel in Hz.
+         */
+        void init(stream<complex_t>* in, Mode mode, double samplerate, double channelSamplerate, double bandwidth) {
+            _mode = mode;
+            _samplerate = samplerate;
+            _channelSamplerate = channelSamplerate;
+            _bandwidth = bandwidth;
+
+            workA = buffer::alloc<complex_t>(STREAM_BUFFER_SIZE + MAX_HISTORY);
+            workB = buffer::alloc<complex_t>(STREAM_BUFFER_SIZE + MAX_HISTORY);
+            amp = buffer::alloc<float>(STREAM_BUFFER_SIZE);
+            audio = buffer::alloc<float>(STREAM_BUFFER_SIZE);
+
+            reconfigure();
+
+            base_type::init(in);
+        }
+
+        void setMode(Mode mode) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            _mode = mode;
+            resetDemods();
+            base_type::tempStart();
+        }
+
+        void setSamplerates(double samplerate, double channelSamplerate) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            _samplerate = samplerate;
+            _channelSamplerate = channelSamplerate;
+            reconfigure();
+            for (int i = 0; i < phaseDeltas.size(); i++) { phaseDeltas[i] = phasorDelta(offsets[i]); }
+            base_type::tempStart();
+        }
+
+        void setBandwidth(double bandwidth) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            _bandwidth = bandwidth;
+            reconfigure();
+            base_type::tempStart();
+        }
+
+        /**
+         * Add a channel to the group.
+         * @param offset Frequency of the channel relative to the center of the input stream in Hz.
+         * @param squelchLevel Level in dB under which the channel outputs silence.
+         * @return Index of the new channel.
+         */
+        int addChannel(double offset, float squelchLevel = -INFINITY) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            offsets.push_back(offset);
+            phases.push_back(lv_cmake(1.0f, 0.0f));
+            phaseDeltas.push_back(phasorDelta(offset));
+            squelchLevels.push_back(squelchLevel);
+            levels.push_back(-INFINITY);
+            lastSamples.push_back({ 1.0f, 0.0f });
+            carriers.push_back(0.0f);
+            for (auto& st : stages) { st.history.resize(st.history.size() + st.taps.size - 1, { 0.0f, 0.0f }); }
+            stream<stereo_t>* out = new stream<stereo_t>;
+            outputs.push_back(out);
+            base_type::registerOutput(out);
+            base_type::tempStart();
+            return outputs.size() - 1;
+        }
+
+        /**
+         * Remove a channel, the indices of the following channels are shifted down by one.
+         * @param id Index of the channel.
+         */
+        void removeChannel(int id) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            if (id < 0 || id >= outputs.size()) {
+                throw std::runtime_error("[ChannelGroup] Tried to remove a channel that doesn't exist");
+            }
+            base_type::tempStop();
+            offsets.erase(offsets.begin() + id);
+            phases.erase(phases.begin() + id);
+            phaseDeltas.erase(phaseDeltas.begin() + id);
+            squelchLevels.erase(squelchLevels.begin() + id);
+            levels.erase(levels.begin() + id);
+            lastSamples.erase(lastSamples.begin() + id);
+            carriers.erase(carriers.begin() + id);
+            for (auto& st : stages) {
+                int hl = st.taps.size - 1;
+                st.history.erase(st.history.begin() + (id * hl), st.history.begin() + ((id + 1) * hl));
+            }
+            base_type::unregisterOutput(outputs[id]);
+            delete outputs[id];
+            outputs.erase(outputs.begin() + id);
+            base_type::tempStart();
+        }
+
+        void setOffset(int id, double offset) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            // The worker reads the phase delta without locking, it must not see half of the new value
+            base_type::tempStop();
+            offsets[id] = offset;
+            phaseDeltas[id] = phasorDelta(offset);
+            base_type::tempStart();
+        }
+
+        void setSquelchLevel(int id, float level) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            squelchLevels[id] = level;
+        }
+
+        /**
+         * Get the level of a channel, measured the same way as by the squelch.
+         * @param id Index of the channel.
+         * @return Level of the last block in dB.
+         */
+        float getLevel(int id) { return levels[id]; }
+
+        int getChannelCount() { return outputs.size(); }
+
+        stream<stereo_t>* getOutput(int id) { return outputs[id]; }
+
+        void reset() {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            for (auto& p : phases) { p = lv_cmake(1.0f, 0.0f); }
+            for (auto& st : stages) {
+                std::fill(st.history.begin(), st.history.end(), complex_t{ 0.0f, 0.0f });
+                st.offset = 0;
+            }
+            resetDemods();
+            base_type::tempStart();
+        }
+
+        int process(int count, const complex_t* in) {
+            int outCount = 0;
+            for (int c = 0; c < outputs.size(); c++) {
+                // Shift the channel to baseband and decimate it down to the channel samplerate
+                complex_t* x = &workA[MAX_HISTORY];
+                complex_t* y = &workB[MAX_HISTORY];
+                volk_32fc_s32fc_x2_rotator_32fc((lv_32fc_t*)x, (lv_32fc_t*)in, phaseDeltas[c], &phases[c], count);
+                int n = count;
+                for (auto& st : stages) {
+                    n = decimate(st, c, x, n, y);
+                    std::swap(x, y);
+                }
+                outCount = n;
+                if (!n) { continue; }
+
+                // Squelch
+                float sum;
+                volk_32fc_magnitude_32f(amp, (lv_32fc_t*)x, n);
+                volk_32f_accumulator_s32f(&sum, amp, n);
+                levels[c] = 10.0f * log10f(sum / (float)n);
+                stream<stereo_t>* out = outputs[c];
+                if (levels[c] < squelchLevels[c]) {
+                    lastSamples[c] = { 1.0f, 0.0f };
+                    buffer::clear(out->writeBuf, n);
+                    out->writeSilent = true;
+                    continue;
+                }
+
+                // Demodulate
+                if (_mode == Mode::NFM) {
+                    math::phaseDiff(x, audio, n, lastSamples[c], invDeviation);
+                }
+                else {
+                    // Normalize by the carrier level, which acts as a carrier AGC
+                    if (carriers[c] == 0.0f) { carriers[c] = amp[0]; }
+                    math::onePole<1>(amp, audio, n, carrierRate, &carriers[c]);
+                    for (int i = 0; i < n; i++) {
+                        audio[i] = (amp[i] / std::max<float>(audio[i], 1e-10f)) - 1.0f;
+                    }
+                }
+                convert::MonoToStereo::process(n, audio, out->writeBuf);
+            }
+
+            // The decimation phases are common to all channels
+            for (auto& st : stages) { st.offset = st.nextOffset; }
+
+            return outCount;
+        }
+
+        int run() {
+            int count = base_type::_in->read();
+            if (count < 0) { return -1; }
+
+            int outCount = process(count, base_type::_in->readBuf);
+
+            base_type::_in->flush();
+            if (!outCount) { return count; }
+            for (auto& out : outputs) {
+                if (!out->swap(outCount)) { return -1; }
+            }
+            return count;
+        }
+
+    protected:
+        struct Stage {
+            tap<float> taps;
+            int decimation;
+            int offset;
+            int nextOffset;
+            std::vector<complex_t> history;
+        };
+
+        // Largest filter history of any stage, the work buffers keep that much room in front of the data
+        static const int MAX_HISTORY = 8192;
+
+        int decimate(Stage& st, int channel, complex_t* in, int count, complex_t* out) {
+            // Put the history of the channel right before its samples
+            int hl = st.taps.size - 1;
+            complex_t* hist = &st.history[channel * hl];
+            complex_t* start = in - hl;
+            memcpy(start, hist, hl * sizeof(complex_t));
+
+            int outCount = 0;
+            int offset = st.offset;
+            for (; offset < count; offset += st.decimation) {
+                volk_32fc_32f_dot_prod_32fc((lv_32fc_t*)&out[outCount++], (lv_32fc_t*)&start[offset], st.taps.taps, st.taps.size);
+            }
+            st.nextOffset = offset - count;
+
+            memcpy(hist, &start[count], hl * sizeof(complex_t));
+            return outCount;
+        }
+
+        void reconfigure() {
+            // The input samplerate has to be a power of two multiple of the channel samplerate
+            double ratio = _samplerate / _channelSamplerate;
+            int iratio = round(ratio);
+            if (fabs(ratio - iratio) > 1e-6 || iratio < 1 || (iratio & (iratio - 1)) || iratio > (1 << multirate::decim::plans_len)) {
+                throw std::runtime_error("[ChannelGroup] The input samplerate must be a power of two multiple of the channel samplerate");
+            }
+            freeStages();
+
+            // Decimate with the same filters as the power decimator, then filter the channel at its samplerate
+            if (iratio > 1) {
+                multirate::decim::plan plan = multirate::decim::plans[(int)log2(iratio) - 1];
+                for (int i = 0; i < plan.stageCount; i++) {
+                    addStage(taps::fromArray<float>(plan.stages[i].tapcount, plan.stages[i].taps), plan.stages[i].decimation);
+                }
+            }
+            // The channel can't be wider than its samplerate
+            double bw = std::min<double>(_bandwidth, _channelSamplerate * 0.9);
+            addStage(taps::lowPass(bw / 2.0, bw * 0.1, _channelSamplerate), 1);
+
+            invDeviation = 1.0f / math::hzToRads(bw / 2.0, _channelSamplerate);
+            carrierRate = 10.0 / _channelSamplerate;
+        }
+
+        void addStage(tap<float> taps, int decimation) {
+            if (taps.size - 1 > MAX_HISTORY) {
+                taps::free(taps);
+                throw std::runtime_error("[ChannelGroup] Channel filter is too long, the bandwidth is too narrow for the channel samplerate");
+            }
+            Stage st;
+            st.taps = taps;
+            st.decimation = decimation;
+            st.offset = 0;
+            st.nextOffset = 0;
+            st.history.resize(outputs.size() * (taps.size - 1), { 0.0f, 0.0f });
+            stages.push_back(st);
+        }
+
+        void freeStages() {
+            for (auto& st : stages) { taps::free(st.taps); }
+            stages.clear();
+        }
+
+        void resetDemods() {
+            for (auto& l : lastSamples) { l = { 1.0f, 0.0f }; }
+            for (auto& c : carriers) { c = 0.0f; }
+        }
+
+        lv_32fc_t phasorDelta(double offset) {
+            double omega = -math::hzToRads(offset, _samplerate);
+            return lv_cmake(cos(omega), sin(omega));
+        }
+
+        Mode _mode;
+        double _samplerate;
+        double _channelSamplerate;
+        double _bandwidth;
+        float invDeviation;
+        float carrierRate;
+
+        std::vector<Stage> stages;
+
+        // Per channel state
+        std::vector<double> offsets;
+        std::vector<lv_32fc_t> phases;
+        std::vector<lv_32fc_t> phaseDeltas;
+        std::vector<float> squelchLevels;
+        std::vector<float> levels;
+        std::vector<complex_t> lastSamples;
+        std::vector<float> carriers;
+        std::vector<stream<stereo_t>*> outputs;
+
+        // Work buffers shared by all channels
+        complex_t* workA;
+        complex_t* workB;
+        float* amp;
+        float* audio;
+    };
+}
@@ -106,9 +106,22 @@ namespace dsp::demod {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
 
-            process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+            // Skip the demodulation of silence, the discriminator and filter restart from rest once the signal is back
+            bool silent = base_type::_in->readSilent;
+            if (silent) {
+                demod.reset();
+                {
+                    std::lock_guard<std::mutex> lck(filterMtx);
+                    fir.reset();
+                }
+                buffer::clear<T>(base_type::out.writeBuf, count);
+            }
+            else {
+                process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+            }
 
             base_type::_in->flush();
+            base_type::out.writeSilent = silent;
             if (!base_type::out.swap(count)) { return -1; }
             return count;
         }
@@ -1,8 +1,7 @@
 #pragma once
 #include "../processor.h"
-#include "../math/fast_atan2.h"
 #include "../math/hz_to_rads.h"
-#include "../math/normalize_phase.h"
+#include "../math/phase_diff.h"
 
 namespace dsp::demod {
     class Quadrature : public Processor<complex_t, float> {
@@ -36,19 +35,25 @@ namespace dsp::demod {
             _invDeviation = 1.0 / math::hzToRads(deviation, samplerate);
         }
 
+        /**
+         * Set the accuracy of the phase computation.
+         * @param accuracy PHASE_ACCURACY_EXACT for atan2f, or one of the vectorized approximations.
+         */
+        void setAccuracy(math::PhaseAccuracy accuracy) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            _accuracy = accuracy;
+        }
+
         inline int process(int count, complex_t* in, float* out) {
-            for (int i = 0; i < count; i++) {
-                float cphase = in[i].phase();
-                out[i] = math::normalizePhase(cphase - phase) * _invDeviation;
-                phase = cphase;
-            }
+            math::phaseDiff(in, out, count, last, _invDeviation, _accuracy);
             return count;
         }
 
         void reset() {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
-            phase = 0.0f;
+            last = { 1.0f, 0.0f };
         }
 
         int run() {
@@ -64,6 +69,7 @@ namespace dsp::demod {
 
     protected:
         float _invDeviation;
-        float phase = 0.0f;
+        math::PhaseAccuracy _accuracy = math::PHASE_ACCURACY_HIGH;
+        complex_t last = { 1.0f, 0.0f };
     };
 }
\ No newline at end of file
@@ -0,0 +1,289 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include "../simd.h"
+
+// Soft decision Viterbi decoder for rate 1/2 convolutional codes.
+// States are updated one butterfly per pair of states, the fastest kernel available on the running CPU is selected at runtime.
+
+namespace dsp::fec {
+    namespace viterbi_detail {
+        inline int parity(int x) {
+            x ^= x >> 16;
+            x ^= x >> 8;
+            x ^= x >> 4;
+            x ^= x >> 2;
+            x ^= x >> 1;
+            return x & 1;
+        }
+
+        // Kernels advance the path metrics of `steps` pairs of soft bits and return the decisions of each step, one bit per new state.
+        // Butterfly i takes old states i and i + B to new states 2i and 2i + 1. The branch metric of old state i with
+        // input 0 is 254 +/- s0 +/- s1 depending on the masks, the three other branches use it or its complement (508 - bm).
+        // Metrics are kept relative to state 0 to stay in range.
+        namespace generic {
+            inline void steps(const int8_t* soft, int steps, int16_t*& metrics, int16_t*& next, const int16_t* m0, const int16_t* m1, uint64_t* dec, int B) {
+                for (int t = 0; t < steps; t++) {
+                    int s0 = soft[2*t];
+                    int s1 = soft[2*t + 1];
+                    int base = metrics[0];
+                    uint64_t d = 0;
+                    for (int i = 0; i < B; i++) {
+                        int bm = 254 + ((s0 ^ m0[i]) - m0[i]) + ((s1 ^ m1[i]) - m1[i]);
+                        int cbm = 508 - bm;
+                        int lo = metrics[i] - base;
+                        int hi = metrics[i + B] - base;
+                        int a0 = lo + bm, b0 = hi + cbm;
+                        int a1 = lo + cbm, b1 = hi + bm;
+                        next[2*i] = (a0 > b0) ? b0 : a0;
+                        next[2*i + 1] = (a1 > b1) ? b1 : a1;
+                        d |= (uint64_t)(a0 > b0) << (2*i);
+                        d |= (uint64_t)(a1 > b1) << (2*i + 1);
+                    }
+                    dec[t] = d;
+                    std::swap(metrics, next);
+                }
+            }
+        }
+
+#if defined(DSP_SIMD_X86)
+        namespace sse {
+            // Requires B to be a multiple of 8
+            inline void steps(const int8_t* soft, int steps, int16_t*& metrics, int16_t*& next, const int16_t* m0, const int16_t* m1, uint64_t* dec, int B) {
+                const __m128i c254 = _mm_set1_epi16(254);
+                const __m128i c508 = _mm_set1_epi16(508);
+                for (int t = 0; t < steps; t++) {
+                    __m128i s0 = _mm_set1_epi16(soft[2*t]);
+                    __m128i s1 = _mm_set1_epi16(soft[2*t + 1]);
+                    __m128i base = _mm_set1_epi16(metrics[0]);
+                    uint64_t d = 0;
+                    for (int i = 0; i < B; i += 8) {
+                        __m128i mm0 = _mm_loadu_si128((const __m128i*)&m0[i]);
+                        __m128i mm1 = _mm_loadu_si128((const __m128i*)&m1[i]);
+                        __m128i bm = _mm_add_epi16(c254, _mm_add_epi16(_mm_sub_epi16(_mm_xor_si128(s0, mm0), mm0), _mm_sub_epi16(_mm_xor_si128(s1, mm1), mm1)));
+                        __m128i cbm = _mm_sub_epi16(c508, bm);
+                        __m128i lo = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)&metrics[i]), base);
+                        __m128i hi = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)&metrics[i + B]), base);
+                        __m128i a0 = _mm_add_epi16(lo, bm), b0 = _mm_add_epi16(hi, cbm);
+                        __m128i a1 = _mm_add_epi16(lo, cbm), b1 = _mm_add_epi16(hi, bm);
+                        __m128i even = _mm_min_epi16(a0, b0);
+                        __m128i odd = _mm_min_epi16(a1, b1);
+                        __m128i de = _mm_cmpgt_epi16(a0, b0);
+                        __m128i dodd = _mm_cmpgt_epi16(a1, b1);
+                        _mm_storeu_si128((__m128i*)&next[2*i], _mm_unpacklo_epi16(even, odd));
+                        _mm_storeu_si128((__m128i*)&next[2*i + 8], _mm_unpackhi_epi16(even, odd));
+                        int mask = _mm_movemask_epi8(_mm_packs_epi16(_mm_unpacklo_epi16(de, dodd), _mm_unpackhi_epi16(de, dodd)));
+                        d |= (uint64_t)(uint16_t)mask << (2*i);
+                    }
+                    dec[t] = d;
+                    std::swap(metrics, next);
+                }
+            }
+        }
+
+        namespace avx2 {
+            // Requires B to be a multiple of 16
+            DSP_TARGET("avx2")
+            inline void steps(const int8_t* soft, int steps, int16_t*& metrics, int16_t*& next, const int16_t* m0, const int16_t* m1, uint64_t* dec, int B) {
+                const __m256i c254 = _mm256_set1_epi16(254);
+                const __m256i c508 = _mm256_set1_epi16(508);
+                for (int t = 0; t < steps; t++) {
+                    __m256i s0 = _mm256_set1_epi16(soft[2*t]);
+                    __m256i s1 = _mm256_set1_epi16(soft[2*t + 1]);
+                    __m256i base = _mm256_set1_epi16(metrics[0]);
+                    uint64_t d = 0;
+                    for (int i = 0; i < B; i += 16) {
+                        __m256i mm0 = _mm256_loadu_si256((const __m256i*)&m0[i]);
+                        __m256i mm1 = _mm256_loadu_si256((const __m256i*)&m1[i]);
+                        __m256i bm = _mm256_add_epi16(c254, _mm256_add_epi16(_mm256_sub_epi16(_mm256_xor_si256(s0, mm0), mm0), _mm256_sub_epi16(_mm256_xor_si256(s1, mm1), mm1)));
+                        __m256i cbm = _mm256_sub_epi16(c508, bm);
+                        __m256i lo = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)&metrics[i]), base);
+                        __m256i hi = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)&metrics[i + B]), base);
+                        __m256i a0 = _mm256_add_epi16(lo, bm), b0 = _mm256_add_epi16(hi, cbm);
+                        __m256i a1 = _mm256_add_epi16(lo, cbm), b1 = _mm256_add_epi16(hi, bm);
+
+                        // Unpacking works within 128bit lanes, reorder the 64bit halves first so the interleaved states come out in order
+                        __m256i even = _mm256_permute4x64_epi64(_mm256_min_epi16(a0, b0), 0xD8);
+                        __m256i odd = _mm256_permute4x64_epi64(_mm256_min_epi16(a1, b1), 0xD8);
+                        __m256i de = _mm256_permute4x64_epi64(_mm256_cmpgt_epi16(a0, b0), 0xD8);
+                        __m256i dodd = _mm256_permute4x64_epi64(_mm256_cmpgt_epi16(a1, b1), 0xD8);
+                        _mm256_storeu_si256((__m256i*)&next[2*i], _mm256_unpacklo_epi16(even, odd));
+                        _mm256_storeu_si256((__m256i*)&next[2*i + 16], _mm256_unpackhi_epi16(even, odd));
+                        __m256i packed = _mm256_packs_epi16(_mm256_unpacklo_epi16(de, dodd), _mm256_unpackhi_epi16(de, dodd));
+                        uint32_t mask = _mm256_movemask_epi8(_mm256_permute4x64_epi64(packed, 0xD8));
+                        d |= (uint64_t)mask << (2*i);
+                    }
+                    dec[t] = d;
+                    std::swap(metrics, next);
+                }
+            }
+        }
+#endif
+    }
+
+    template<int K>
+    class Viterbi {
+        static_assert(K >= 3 && K <= 7, "Constraint length must be between 3 and 7");
+    public:
+        static constexpr int STATES = 1 << (K - 1);
+
+        Viterbi() {}
+
+        /**
+         * Create a decoder.
+         * @param poly0 Generator of the first output bit, bit n is the input delayed by n bits (eg. 0x4F for the CCSDS 171 octal generator).
+         * @param poly1 Generator of the second output bit.
+         * @param depth Traceback depth used when decoding a continuous stream.
+         */
+        Viterbi(int poly0, int poly1, int depth = 16 * K) { init(poly0, poly1, depth); }
+
+        void init(int poly0, int poly1, int depth = 16 * K) {
+            // The butterfly structure requires the first and last taps of both generators
+            int ends = 1 | (1 << (K - 1));
+            if ((poly0 & ends) != ends || (poly1 & ends) != ends) {
+                throw std::runtime_error("[Viterbi] Generators must use the first and last taps");
+            }
+            _poly0 = poly0;
+            _poly1 = poly1;
+            _depth = depth;
+            for (int i = 0; i < B; i++) {
+                m0[i] = viterbi_detail::parity((i << 1) & poly0) ? -1 : 0;
+                m1[i] = viterbi_detail::parity((i << 1) & poly1) ? -1 : 0;
+            }
+            reset();
+        }
+
+        /**
+         * Reset the decoder.
+         * @param state State of the encoder, -1 if unknown.
+         */
+        void reset(int state = -1) {
+            metrics = metricBuf[0];
+            next = metricBuf[1];
+            for (int i = 0; i < STATES; i++) {
+                metrics[i] = (state < 0 || i == state) ? 0 : 4096;
+            }
+            decisions.clear();
+            hard.clear();
+            encState = (state < 0) ? 0 : state;
+        }
+
+        /**
+         * Decode a continuous stream. Bits are output once they are older than the traceback depth.
+         * @param soft Soft bits, two per encoded bit, from -127 (0) to 127 (1). 0 marks an erased (punctured) bit.
+         * @param count Number of soft bits, must be even.
+         * @param out Decoded bits, one per byte. Must have room for count / 2 + the traceback depth bits.
+         * @return Number of decoded bits.
+         */
+        int process(const int8_t* soft, int count, uint8_t* out) {
+            advance(soft, count / 2);
+
+            // Only trace back once enough bits are pending to amortize the traceback over the depth
+            int ready = (int)decisions.size() - _depth;
+            if (ready < _depth) { return 0; }
+            traceback(bestState(), ready, out);
+            return ready;
+        }
+
+        /**
+         * Decode a terminated block.
+         * @param soft Soft bits, two per encoded bit, from -127 (0) to 127 (1). 0 marks an erased (punctured) bit.
+         * @param count Number of soft bits, must be even.
+         * @param out Decoded bits, one per byte, including the tail bits.
+         * @param startState State of the encoder before the block.
+         * @param endState State of the encoder after the block, -1 if unknown.
+         * @return Number of decoded bits.
+         */
+        int decode(const int8_t* soft, int count, uint8_t* out, int startState = 0, int endState = 0) {
+            reset(startState);
+            advance(soft, count / 2);
+            int bits = decisions.size();
+            traceback((endState < 0) ? bestState() : endState, bits, out);
+            return bits;
+        }
+
+        /**
+         * Get the channel bit error rate, estimated by encoding the decoded bits again.
+         * @return Fraction of hard decisions that differ from the re-encoded bits in the last decoded bits.
+         */
+        float getBER() { return ber; }
+
+    private:
+        static constexpr int B = STATES / 2;
+
+        void advance(const int8_t* soft, int steps) {
+            size_t start = decisions.size();
+            decisions.resize(start + steps);
+            hard.resize(start + steps);
+            for (int i = 0; i < steps; i++) {
+                // Erased bits are stored as matching to not count them as errors
+                uint8_t h = 0;
+                if (soft[2*i]) { h |= (soft[2*i] > 0) ? 1 : 0; } else { h |= 4; }
+                if (soft[2*i + 1]) { h |= (soft[2*i + 1] > 0) ? 2 : 0; } else { h |= 8; }
+                hard[start + i] = h;
+            }
+#if defined(DSP_SIMD_X86)
+            if (B >= 16 && simd::hasAVX2()) {
+                viterbi_detail::avx2::steps(soft, steps, metrics, next, m0, m1, &decisions[start], B);
+            }
+            else if (B >= 8) {
+                viterbi_detail::sse::steps(soft, steps, metrics, next, m0, m1, &decisions[start], B);
+            }
+            else {
+                viterbi_detail::generic::steps(soft, steps, metrics, next, m0, m1, &decisions[start], B);
+            }
+#else
+            viterbi_detail::generic::steps(soft, steps, metrics, next, m0, m1, &decisions[start], B);
+#endif
+        }
+
+        int bestState() {
+            int best = 0;
+            for (int i = 1; i < STATES; i++) {
+                if (metrics[i] < metrics[best]) { best = i; }
+            }
+            return best;
+        }
+
+        // Output the oldest `count` pending bits, tracing back from `state` at the newest step
+        void traceback(int state, int count, uint8_t* out) {
+            for (int t = (int)decisions.size() - 1; t >= 0; t--) {
+                int d = (decisions[t] >> state) & 1;
+                if (t < count) { out[t] = state & 1; }
+                state = (state >> 1) | (d << (K - 2));
+            }
+
+            // Estimate the channel errors from the re-encoded bits
+            int errors = 0;
+            int total = 0;
+            for (int t = 0; t < count; t++) {
+                int sr = (encState << 1) | out[t];
+                int h = hard[t];
+                if (!(h & 4)) { errors += viterbi_detail::parity(sr & _poly0) != (h & 1); total++; }
+                if (!(h & 8)) { errors += viterbi_detail::parity(sr & _poly1) != ((h >> 1) & 1); total++; }
+                encState = sr & (STATES - 1);
+            }
+            if (total) { ber = (float)errors / (float)total; }
+
+            decisions.erase(decisions.begin(), decisions.begin() + count);
+            hard.erase(hard.begin(), hard.begin() + count);
+        }
+
+        int _poly0;
+        int _poly1;
+        int _depth;
+        alignas(32) int16_t m0[B];
+        alignas(32) int16_t m1[B];
+        alignas(32) int16_t metricBuf[2][STATES];
+        int16_t* metrics = metricBuf[0];
+        int16_t* next = metricBuf[1];
+        std::vector<uint64_t> decisions;
+        std::vector<uint8_t> hard;
+        int encState = 0;
+        std::atomic<float> ber = 0.0f;
+    };
+}
@@ -67,6 +67,25 @@ namespace dsp::filter {
             return outCount;
         }
 
+        /**
+         * Account for a block of silence without doing the convolution. The history is cleared so that the
+         * filter restarts cleanly once the signal is back.
+         * @param count Number of input samples.
+         * @param out Output buffer, filled with zeros.
+         * @return Number of output samples.
+         */
+        inline int silence(int count, D* out) {
+            int outCount = 0;
+            if (offset < count) {
+                outCount = ((count - offset) + _decimation - 1) / _decimation;
+                offset += outCount * _decimation;
+            }
+            offset -= count;
+            buffer::clear<D>(base_type::buffer, base_type::_taps.size - 1);
+            buffer::clear<D>(out, outCount);
+            return outCount;
+        }
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
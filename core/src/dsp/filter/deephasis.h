@@ -1,5 +1,6 @@
 #pragma once
 #include "../processor.h"
+#include "../math/one_pole.h"
 
 
 namespace dsp::filter {
@@ -57,21 +58,10 @@ namespace dsp::filter {
 
         inline int process(int count, const T* in, T* out) {
             if constexpr (std::is_same_v<T, float>) {
-                out[0] = (alpha * in[0]) + ((1 - alpha) * lastOut);
-                for (int i = 1; i < count; i++) {
-                    out[i] = (alpha * in[i]) + ((1 - alpha) * out[i - 1]);
-                }
-                lastOut = out[count - 1];
+                math::onePole<1>(in, out, count, alpha, &lastOut);
             }
             if constexpr (std::is_same_v<T, stereo_t>) {
-                out[0].l = (alpha * in[0].l) + ((1 - alpha) * lastOut.l);
-                out[0].r = (alpha * in[0].r) + ((1 - alpha) * lastOut.r);
-                for (int i = 1; i < count; i++) {
-                    out[i].l = (alpha * in[i].l) + ((1 - alpha) * out[i - 1].l);
-                    out[i].r = (alpha * in[i].r) + ((1 - alpha) * out[i - 1].r);
-                }
-                lastOut.l = out[count - 1].l;
-                lastOut.r = out[count - 1].r;
+                math::onePole<2>((const float*)in, (float*)out, count, alpha, (float*)&lastOut);
             }
             return count;
         }
@@ -81,8 +71,19 @@ namespace dsp::filter {
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
-            process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+
+            // Silence stays silent, the filter restarts from rest once the signal is back
+            bool silent = base_type::_in->readSilent;
+            if (silent) {
+                lastOut = {};
+                buffer::clear<T>(base_type::out.writeBuf, count);
+            }
+            else {
+                process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+            }
+
             base_type::_in->flush();
+            base_type::out.writeSilent = silent;
             if (!base_type::out.swap(count)) { return -1; }
             return count;
         }
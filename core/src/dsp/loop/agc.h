@@ -1,5 +1,7 @@
 #pragma once
 #include "../processor.h"
+#include <stdexcept>
+#include <volk/volk.h>
 
 namespace dsp::loop {
     template <class T>
@@ -10,6 +12,15 @@ namespace dsp::loop {
 
         AGC(stream<T>* in, double setPoint, double attack, double decay, double maxGain, double maxOutputAmp, double initGain = 1.0) { init(in, setPoint, attack, decay, maxGain, maxOutputAmp, initGain); }
 
+        ~AGC() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            buffer::free(ampBuf);
+            buffer::free(peakBuf);
+            buffer::free(gainBuf);
+            buffer::free(dequeBuf);
+        }
+
         void init(stream<T>* in, double setPoint, double attack, double decay, double maxGain, double maxOutputAmp, double initGain = 1.0) {
             _setPoint = setPoint;
             _attack = attack;
@@ -20,6 +31,12 @@ namespace dsp::loop {
             _maxOutputAmp = maxOutputAmp;
             _initGain = initGain;
             amp = _setPoint / _initGain;
+
+            ampBuf = buffer::alloc<float>(STREAM_BUFFER_SIZE);
+            peakBuf = buffer::alloc<float>(STREAM_BUFFER_SIZE);
+            gainBuf = buffer::alloc<float>(STREAM_BUFFER_SIZE);
+            dequeBuf = buffer::alloc<int>(STREAM_BUFFER_SIZE);
+
             base_type::init(in);
         }
 
@@ -61,6 +78,17 @@ namespace dsp::loop {
             _initGain = initGain;
         }
 
+        /**
+         * Set how far ahead the AGC looks when clipping is detected.
+         * @param samples Look-ahead window in samples, 0 to look up to the end of the block.
+         */
+        void setLookAhead(int samples) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            if (samples < 0) { throw std::runtime_error("Look-ahead must not be negative"); }
+            _lookAhead = samples;
+        }
+
         void reset() {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
@@ -68,17 +96,20 @@ namespace dsp::loop {
         }
 
         inline int process(int count, T* in, T* out) {
-            for (int i = 0; i < count; i++) {
-                // Get signal amplitude
-                float inAmp, gain;
-                if constexpr (std::is_same_v<T, complex_t>) {
-                    inAmp = in[i].amplitude();
-                }
-                if constexpr (std::is_same_v<T, float>) {
-                    inAmp = fabsf(in[i]);
-                }
+            // Get signal amplitude
+            if constexpr (std::is_same_v<T, complex_t>) {
+                volk_32fc_magnitude_32f(ampBuf, (lv_32fc_t*)in, count);
+            }
+            if constexpr (std::is_same_v<T, float>) {
+                for (int i = 0; i < count; i++) { ampBuf[i] = fabsf(in[i]); }
+            }
 
+            // The look-ahead peaks are only computed once clipping happens
+            int peaksFrom = count;
+            for (int i = 0; i < count; i++) {
                 // Update average amplitude
+                float inAmp = ampBuf[i];
+                float gain;
                 if (inAmp != 0.0f) {
                     amp = (inAmp > amp) ? ((amp * _invAttack) + (inAmp * _attack)) : ((amp * _invDecay) + (inAmp * _decay));
                     gain = std::min<float>(_setPoint / amp, _maxGain);
@@ -89,22 +120,23 @@ namespace dsp::loop {
 
                 // If clipping is detected look ahead and correct
                 if (inAmp*gain > _maxOutputAmp) {
-                    float maxAmp = 0;
-                    for (int j = i; j < count; j++) {
-                        if constexpr (std::is_same_v<T, complex_t>) {
-                            inAmp = in[j].amplitude();
-                        }
-                        if constexpr (std::is_same_v<T, float>) {
-                            inAmp = fabsf(in[j]);
-                        }
-                        if (inAmp > maxAmp) { maxAmp = inAmp; }
+                    if (i < peaksFrom) {
+                        computePeaks(i, count);
+                        peaksFrom = i;
                     }
-                    amp = maxAmp;
+                    amp = peakBuf[i];
                     gain = std::min<float>(_setPoint / amp, _maxGain);
                 }
-                
-                // Scale output by gain
-                out[i] = in[i] * gain;
+
+                gainBuf[i] = gain;
+            }
+
+            // Scale output by gain
+            if constexpr (std::is_same_v<T, complex_t>) {
+                volk_32fc_32f_multiply_32fc((lv_32fc_t*)out, (lv_32fc_t*)in, gainBuf, count);
+            }
+            if constexpr (std::is_same_v<T, float>) {
+                volk_32f_x2_multiply_32f(out, in, gainBuf, count);
             }
             return count;
         }
@@ -121,6 +153,28 @@ namespace dsp::loop {
         }
 
     protected:
+        // Fill peakBuf[from, count) with the largest amplitude between each sample and the end of its look-ahead window
+        void computePeaks(int from, int count) {
+            if (!_lookAhead) {
+                float peak = 0.0f;
+                for (int i = count - 1; i >= from; i--) {
+                    if (ampBuf[i] > peak) { peak = ampBuf[i]; }
+                    peakBuf[i] = peak;
+                }
+                return;
+            }
+
+            // Sliding window maximum, the deque holds indices of decreasing amplitude with the window's peak at its head
+            int head = 0;
+            int tail = 0;
+            for (int i = count - 1; i >= from; i--) {
+                while (tail > head && ampBuf[dequeBuf[tail - 1]] <= ampBuf[i]) { tail--; }
+                dequeBuf[tail++] = i;
+                if (dequeBuf[head] >= i + _lookAhead) { head++; }
+                peakBuf[i] = ampBuf[dequeBuf[head]];
+            }
+        }
+
         float _setPoint;
         float _attack;
         float _invAttack;
@@ -129,8 +183,14 @@ namespace dsp::loop {
         float _maxGain;
         float _maxOutputAmp;
         float _initGain;
+        int _lookAhead = 0;
 
         float amp = 1.0;
 
+        float* ampBuf;
+        float* peakBuf;
+        float* gainBuf;
+        int* dequeBuf;
+
     };
 }
\ No newline at end of file
@@ -13,7 +13,7 @@ namespace dsp::loop {
 
         inline int process(int count, complex_t* in, complex_t* out) {
             for (int i = 0; i < count; i++) {
-                out[i] = in[i] * math::phasor(-pcl.phase);
+                out[i] = in[i] * nco.phasor(-pcl.phase);
                 pcl.advance(math::normalizePhase(in[i].phase() - pcl.phase));
             }
             return count;
@@ -16,7 +16,7 @@ namespace dsp::loop {
 
         inline int process(int count, complex_t* in, complex_t* out) {
             for (int i = 0; i < count; i++) {
-                out[i] = in[i] * math::phasor(-pcl.phase);
+                out[i] = in[i] * nco.phasor(-pcl.phase);
                 pcl.advance(errorFunction(out[i]));
             }
             return count;
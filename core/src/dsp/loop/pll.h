@@ -1,7 +1,7 @@
 #pragma once
 #include "../processor.h"
 #include "../math/normalize_phase.h"
-#include "../math/phasor.h"
+#include "../math/nco.h"
 #include "phase_control_loop.h"
 
 namespace dsp::loop {
@@ -52,6 +52,18 @@ namespace dsp::loop {
             pcl.setFreqLimits(minFreq, maxFreq);
         }
 
+        /**
+         * Set the accuracy of the oscillator generating the loop phasor.
+         * @param accuracy Accuracy, the table based modes are much faster than the exact one.
+         */
+        void setNCOAccuracy(math::NCO::Accuracy accuracy) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            nco.setAccuracy(accuracy);
+            base_type::tempStart();
+        }
+
         void reset() {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
@@ -63,7 +75,7 @@ namespace dsp::loop {
 
         virtual inline int process(int count, complex_t* in, complex_t* out) {
             for (int i = 0; i < count; i++) {
-                out[i] = math::phasor(pcl.phase);
+                out[i] = nco.phasor(pcl.phase);
                 pcl.advance(math::normalizePhase(in[i].phase() - pcl.phase));
             }
             return count;
@@ -82,6 +94,7 @@ namespace dsp::loop {
 
     protected:
         PhaseControlLoop<float> pcl;
+        math::NCO nco;
         float _initPhase;
         float _initFreq;
         complex_t lastVCO = { 1.0f, 0.0f };
@@ -0,0 +1,94 @@
+#pragma once
+#include <math.h>
+#include "../simd.h"
+
+// Peak absolute value of a block of samples, used for level and silence detection.
+// The fastest kernel available on the running CPU is selected at runtime.
+
+namespace dsp::math {
+    namespace generic {
+        // Continues from the peak of the samples processed by a SIMD kernel
+        inline float absMax(const float* in, int count, float peak) {
+            for (int i = 0; i < count; i++) {
+                float val = fabsf(in[i]);
+                if (val > peak) { peak = val; }
+            }
+            return peak;
+        }
+    }
+
+#if defined(DSP_SIMD_X86)
+    // SIMD kernels return the number of samples processed and their peak through the reference
+    namespace sse {
+        inline int absMax(const float* in, int count, float& peak) {
+            // Clearing the sign bit gives the absolute value, independent accumulators hide the latency of maxps
+            const __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+            __m128 m0 = _mm_setzero_ps();
+            __m128 m1 = _mm_setzero_ps();
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                m0 = _mm_max_ps(m0, _mm_and_ps(_mm_loadu_ps(&in[i]), mask));
+                m1 = _mm_max_ps(m1, _mm_and_ps(_mm_loadu_ps(&in[i + 4]), mask));
+            }
+            m0 = _mm_max_ps(m0, m1);
+            m0 = _mm_max_ps(m0, _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(1, 0, 3, 2)));
+            m0 = _mm_max_ps(m0, _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(2, 3, 0, 1)));
+            peak = _mm_cvtss_f32(m0);
+            return i;
+        }
+    }
+
+    namespace avx2 {
+        DSP_TARGET("avx2,fma")
+        inline int absMax(const float* in, int count, float& peak) {
+            const __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+            __m256 m0 = _mm256_setzero_ps();
+            __m256 m1 = _mm256_setzero_ps();
+            int i = 0;
+            for (; i + 16 <= count; i += 16) {
+                m0 = _mm256_max_ps(m0, _mm256_and_ps(_mm256_loadu_ps(&in[i]), mask));
+                m1 = _mm256_max_ps(m1, _mm256_and_ps(_mm256_loadu_ps(&in[i + 8]), mask));
+            }
+            m0 = _mm256_max_ps(m0, m1);
+            __m128 m = _mm_max_ps(_mm256_castps256_ps128(m0), _mm256_extractf128_ps(m0, 1));
+            m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+            m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+            peak = _mm_cvtss_f32(m);
+            return i;
+        }
+    }
+#endif
+
+#if defined(DSP_SIMD_NEON)
+    namespace neon {
+        inline int absMax(const float* in, int count, float& peak) {
+            float32x4_t m0 = vdupq_n_f32(0.0f);
+            float32x4_t m1 = vdupq_n_f32(0.0f);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                m0 = vmaxq_f32(m0, vabsq_f32(vld1q_f32(&in[i])));
+                m1 = vmaxq_f32(m1, vabsq_f32(vld1q_f32(&in[i + 4])));
+            }
+            peak = vmaxvq_f32(vmaxq_f32(m0, m1));
+            return i;
+        }
+    }
+#endif
+
+    /**
+     * Get the largest absolute value of a block of samples.
+     * @param in Input samples, interleaved channels are handled like any other sample.
+     * @param count Number of float values.
+     * @return Peak absolute value, 0 if count is 0.
+     */
+    inline float absMax(const float* in, int count) {
+        float peak = 0.0f;
+        int done = 0;
+#if defined(DSP_SIMD_X86)
+        done = simd::hasAVX2() ? avx2::absMax(in, count, peak) : sse::absMax(in, count, peak);
+#elif defined(DSP_SIMD_NEON)
+        done = neon::absMax(in, count, peak);
+#endif
+        return generic::absMax(&in[done], count - done, peak);
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <math.h>
+#include "../types.h"
+#include "constants.h"
+
+namespace dsp::math {
+    /**
+     * Numerically controlled oscillator, computes the phasor of an arbitrary phase from a shared lookup table
+     * instead of calling cosf/sinf for every sample.
+     */
+    class NCO {
+    public:
+        enum Accuracy {
+            // Uses libm, exact to the float precision
+            ACCURACY_EXACT,
+            // Linear interpolation between table entries, error below 1e-5
+            ACCURACY_HIGH,
+            // Nearest table entry, error below 3.1e-3 (-50dB)
+            ACCURACY_LOW
+        };
+
+        NCO(Accuracy accuracy = ACCURACY_HIGH) {
+            setAccuracy(accuracy);
+        }
+
+        void setAccuracy(Accuracy accuracy) {
+            _accuracy = accuracy;
+            lut = getTable();
+        }
+
+        Accuracy getAccuracy() { return _accuracy; }
+
+        /**
+         * Compute the phasor of a phase.
+         * @param x Phase in radians, any value is valid but precision is best close to [-pi, pi].
+         * @return Complex number of magnitude 1 and argument x.
+         */
+        inline complex_t phasor(float x) const {
+            if (_accuracy == ACCURACY_HIGH) {
+                float t = x * (float)(TABLE_SIZE / (2.0 * DB_M_PI));
+                int i = (int)t;
+                if (t < (float)i) { i--; }
+                const Entry& e = lut[i & TABLE_MASK];
+                float frac = t - (float)i;
+                return { e.value.re + frac * e.delta.re, e.value.im + frac * e.delta.im };
+            }
+            else if (_accuracy == ACCURACY_LOW) {
+                return lut[(int)lrintf(x * (float)(TABLE_SIZE / (2.0 * DB_M_PI))) & TABLE_MASK].value;
+            }
+            return { cosf(x), sinf(x) };
+        }
+
+    private:
+        struct Entry {
+            complex_t value;
+            complex_t delta;
+        };
+
+        static constexpr int TABLE_SIZE = 1024;
+        static constexpr int TABLE_MASK = TABLE_SIZE - 1;
+
+        // The table is generated once and shared by all oscillators
+        static const Entry* getTable() {
+            static const Table table;
+            return table.entries;
+        }
+
+        struct Table {
+            Table() {
+                for (int i = 0; i < TABLE_SIZE; i++) {
+                    double a = 2.0 * DB_M_PI * (double)i / (double)TABLE_SIZE;
+                    double b = 2.0 * DB_M_PI * (double)(i + 1) / (double)TABLE_SIZE;
+                    entries[i].value = { (float)cos(a), (float)sin(a) };
+                    entries[i].delta = { (float)(cos(b) - cos(a)), (float)(sin(b) - sin(a)) };
+                }
+            }
+            Entry entries[TABLE_SIZE];
+        };
+
+        Accuracy _accuracy;
+        const Entry* lut;
+    };
+}
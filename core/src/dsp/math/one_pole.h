@@ -0,0 +1,209 @@
+#pragma once
+#include "../simd.h"
+
+// One-pole recursion y[n] = y[n-1] + a * (x[n] - y[n-1]) over one or two interleaved channels, the core of
+// deemphasis filters, DC blockers and envelope followers. The SIMD kernels break the dependency between
+// samples by computing a prefix scan of eight values at a time and only carrying the last output between
+// iterations. The previous output is always added back as is and never scaled by 1 - a, whose rounding
+// would bias the DC gain of filters with a very small coefficient.
+
+namespace dsp::math {
+    namespace generic {
+        template <int CHANNELS, bool RESIDUAL>
+        inline void onePole(const float* in, float* out, int frames, float a, float* state) {
+            for (int i = 0; i < frames; i++) {
+                for (int c = 0; c < CHANNELS; c++) {
+                    float x = in[i*CHANNELS + c];
+                    float y = state[c] + (a * (x - state[c]));
+                    out[i*CHANNELS + c] = RESIDUAL ? (x - state[c]) : y;
+                    state[c] = y;
+                }
+            }
+        }
+    }
+
+    namespace detail {
+        // Weight of the previous output in the response of each frame of an iteration, a * (1 + b + ... + b^k)
+        // with b = 1 - a, repeated for each channel of the frame
+        template <int CHANNELS>
+        inline void onePoleCarryWeights(float a, float* weights) {
+            float b = 1.0f - a;
+            float sum = 0.0f;
+            float pow = 1.0f;
+            for (int f = 0; f < 8 / CHANNELS; f++) {
+                sum += pow;
+                pow *= b;
+                for (int c = 0; c < CHANNELS; c++) { weights[f*CHANNELS + c] = a * sum; }
+            }
+        }
+    }
+
+#if defined(DSP_SIMD_X86)
+    // SIMD kernels return the number of frames processed and leave the last output in the state
+    namespace sse {
+        // Move the values of a register by whole frames towards the end, shifting in zeros
+        template <int CHANNELS, int FRAMES>
+        inline __m128 shiftFrames(__m128 v) {
+            return _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), FRAMES * CHANNELS * 4));
+        }
+
+        // Broadcast the last frame of a register to all frames
+        template <int CHANNELS>
+        inline __m128 lastFrame(__m128 v) {
+            return (CHANNELS == 1) ? _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)) : _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+
+        // Last frame of prev followed by all but the last frame of v
+        template <int CHANNELS>
+        inline __m128 previousFrames(__m128 prev, __m128 v) {
+            if (CHANNELS == 1) { return _mm_move_ss(shiftFrames<1, 1>(v), lastFrame<1>(prev)); }
+            return _mm_shuffle_ps(prev, v, _MM_SHUFFLE(1, 0, 3, 2));
+        }
+
+        // Response of the filter to the inputs of a register alone
+        template <int CHANNELS>
+        inline __m128 scan(__m128 x, __m128 av, __m128 bv, __m128 b2v) {
+            __m128 t = _mm_mul_ps(x, av);
+            t = _mm_add_ps(t, _mm_mul_ps(shiftFrames<CHANNELS, 1>(t), bv));
+            if (CHANNELS == 1) { t = _mm_add_ps(t, _mm_mul_ps(shiftFrames<1, 2>(t), b2v)); }
+            return t;
+        }
+
+        template <int CHANNELS, bool RESIDUAL>
+        inline int onePole(const float* in, float* out, int frames, float a, float* state) {
+            static_assert(CHANNELS == 1 || CHANNELS == 2, "Only one or two channels are supported");
+            const int step = 8 / CHANNELS;
+            const float b = 1.0f - a;
+            const float b2 = b * b;
+            const __m128 av = _mm_set1_ps(a);
+            const __m128 bv = _mm_set1_ps(b);
+            const __m128 b2v = _mm_set1_ps(b2);
+            const __m128 crossGain = (CHANNELS == 1) ? _mm_setr_ps(b, b2, b2 * b, b2 * b2) : _mm_setr_ps(b, b, b2, b2);
+            alignas(16) float weights[8];
+            detail::onePoleCarryWeights<CHANNELS>(a, weights);
+            const __m128 carryWeightA = _mm_load_ps(&weights[0]);
+            const __m128 carryWeightB = _mm_load_ps(&weights[4]);
+            __m128 carry = (CHANNELS == 1) ? _mm_set1_ps(state[0]) : _mm_setr_ps(state[0], state[1], state[0], state[1]);
+
+            int i = 0;
+            for (; i + step <= frames; i += step) {
+                __m128 xA = _mm_loadu_ps(&in[i*CHANNELS]);
+                __m128 xB = _mm_loadu_ps(&in[i*CHANNELS + 4]);
+
+                // Response to the inputs of this iteration, the second register also gets the decay of the first
+                __m128 tA = scan<CHANNELS>(xA, av, bv, b2v);
+                __m128 tB = scan<CHANNELS>(xB, av, bv, b2v);
+                tB = _mm_add_ps(tB, _mm_mul_ps(lastFrame<CHANNELS>(tA), crossGain));
+
+                // Response to the previous output, the only dependency between iterations
+                __m128 yA = _mm_add_ps(carry, _mm_sub_ps(tA, _mm_mul_ps(carry, carryWeightA)));
+                __m128 yB = _mm_add_ps(carry, _mm_sub_ps(tB, _mm_mul_ps(carry, carryWeightB)));
+
+                if (RESIDUAL) {
+                    _mm_storeu_ps(&out[i*CHANNELS], _mm_sub_ps(xA, previousFrames<CHANNELS>(carry, yA)));
+                    _mm_storeu_ps(&out[i*CHANNELS + 4], _mm_sub_ps(xB, previousFrames<CHANNELS>(yA, yB)));
+                }
+                else {
+                    _mm_storeu_ps(&out[i*CHANNELS], yA);
+                    _mm_storeu_ps(&out[i*CHANNELS + 4], yB);
+                }
+                carry = lastFrame<CHANNELS>(yB);
+            }
+
+            alignas(16) float c[4];
+            _mm_store_ps(c, carry);
+            for (int ch = 0; ch < CHANNELS; ch++) { state[ch] = c[ch]; }
+            return i;
+        }
+    }
+#endif
+
+#if defined(DSP_SIMD_NEON)
+    namespace neon {
+        template <int CHANNELS>
+        inline float32x4_t lastFrame(float32x4_t v) {
+            return (CHANNELS == 1) ? vdupq_laneq_f32(v, 3) : vcombine_f32(vget_high_f32(v), vget_high_f32(v));
+        }
+
+        template <int CHANNELS>
+        inline float32x4_t previousFrames(float32x4_t prev, float32x4_t v) {
+            return vextq_f32(prev, v, 4 - CHANNELS);
+        }
+
+        template <int CHANNELS>
+        inline float32x4_t scan(float32x4_t x, float a, float b, float b2) {
+            const float32x4_t zero = vdupq_n_f32(0.0f);
+            float32x4_t t = vmulq_n_f32(x, a);
+            t = vmlaq_n_f32(t, vextq_f32(zero, t, 4 - CHANNELS), b);
+            if (CHANNELS == 1) { t = vmlaq_n_f32(t, vextq_f32(zero, t, 2), b2); }
+            return t;
+        }
+
+        template <int CHANNELS, bool RESIDUAL>
+        inline int onePole(const float* in, float* out, int frames, float a, float* state) {
+            static_assert(CHANNELS == 1 || CHANNELS == 2, "Only one or two channels are supported");
+            const int step = 8 / CHANNELS;
+            const float b = 1.0f - a;
+            const float b2 = b * b;
+            const float monoCross[4] = { b, b2, b2 * b, b2 * b2 };
+            const float stereoCross[4] = { b, b, b2, b2 };
+            const float32x4_t crossGain = vld1q_f32((CHANNELS == 1) ? monoCross : stereoCross);
+            float weights[8];
+            detail::onePoleCarryWeights<CHANNELS>(a, weights);
+            const float32x4_t carryWeightA = vld1q_f32(&weights[0]);
+            const float32x4_t carryWeightB = vld1q_f32(&weights[4]);
+            const float init[4] = { state[0], state[CHANNELS - 1], state[0], state[CHANNELS - 1] };
+            float32x4_t carry = vld1q_f32(init);
+
+            int i = 0;
+            for (; i + step <= frames; i += step) {
+                float32x4_t xA = vld1q_f32(&in[i*CHANNELS]);
+                float32x4_t xB = vld1q_f32(&in[i*CHANNELS + 4]);
+
+                float32x4_t tA = scan<CHANNELS>(xA, a, b, b2);
+                float32x4_t tB = scan<CHANNELS>(xB, a, b, b2);
+                tB = vmlaq_f32(tB, lastFrame<CHANNELS>(tA), crossGain);
+
+                float32x4_t yA = vaddq_f32(carry, vmlsq_f32(tA, carry, carryWeightA));
+                float32x4_t yB = vaddq_f32(carry, vmlsq_f32(tB, carry, carryWeightB));
+
+                if (RESIDUAL) {
+                    vst1q_f32(&out[i*CHANNELS], vsubq_f32(xA, previousFrames<CHANNELS>(carry, yA)));
+                    vst1q_f32(&out[i*CHANNELS + 4], vsubq_f32(xB, previousFrames<CHANNELS>(yA, yB)));
+                }
+                else {
+                    vst1q_f32(&out[i*CHANNELS], yA);
+                    vst1q_f32(&out[i*CHANNELS + 4], yB);
+                }
+                carry = lastFrame<CHANNELS>(yB);
+            }
+
+            float c[4];
+            vst1q_f32(c, carry);
+            for (int ch = 0; ch < CHANNELS; ch++) { state[ch] = c[ch]; }
+            return i;
+        }
+    }
+#endif
+
+    /**
+     * Run a one-pole recursion y[n] = y[n-1] + a * (x[n] - y[n-1]) on each channel.
+     * @param in Input samples, channels interleaved.
+     * @param out Output samples, can be the same buffer as the input.
+     * @param frames Number of samples per channel.
+     * @param a Filter coefficient, between 0 and 1.
+     * @param state Previous output of each channel, updated to the last output of the block.
+     * @tparam CHANNELS Number of interleaved channels, 1 or 2.
+     * @tparam RESIDUAL Output x[n] - y[n-1] instead of y[n], which is what a DC blocker outputs.
+     */
+    template <int CHANNELS, bool RESIDUAL = false>
+    inline void onePole(const float* in, float* out, int frames, float a, float* state) {
+        int done = 0;
+#if defined(DSP_SIMD_X86)
+        done = sse::onePole<CHANNELS, RESIDUAL>(in, out, frames, a, state);
+#elif defined(DSP_SIMD_NEON)
+        done = neon::onePole<CHANNELS, RESIDUAL>(in, out, frames, a, state);
+#endif
+        generic::onePole<CHANNELS, RESIDUAL>(&in[done*CHANNELS], &out[done*CHANNELS], frames - done, a, state);
+    }
+}
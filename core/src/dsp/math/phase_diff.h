@@ -0,0 +1,244 @@
+#pragma once
+#include <math.h>
+#include <algorithm>
+#include "../types.h"
+#include "../simd.h"
+
+// Phase difference between consecutive complex samples, the core of FM discriminators.
+// The difference is computed as the angle of in[i] * conj(in[i-1]), which is already in [-pi, pi],
+// using either atan2f or a polynomial approximation that is vectorized with a kernel selected at runtime.
+
+#define PHASE_DIFF_MIN_MAG  1e-30f
+
+namespace dsp::math {
+    enum PhaseAccuracy {
+        PHASE_ACCURACY_EXACT,   // atan2f, scalar
+        PHASE_ACCURACY_HIGH,    // Polynomial with a maximum error below 1e-5 rad
+        PHASE_ACCURACY_FAST     // Polynomial with a maximum error of about 5e-3 rad
+    };
+
+    namespace detail {
+        // Minimax coefficients of atan(a) / a as a polynomial of a^2, for a in [0, 1]
+        constexpr float ATAN_HIGH[6] = { 0.99997726f, -0.33262347f, 0.19354346f, -0.11643287f, 0.05265332f, -0.01172120f };
+        constexpr float ATAN_FAST[2] = { 0.97239411f, -0.19194795f };
+    }
+
+    namespace generic {
+        template <bool FAST>
+        inline float atan2Poly(float y, float x) {
+            float ax = fabsf(x);
+            float ay = fabsf(y);
+            float mx = std::max<float>(std::max<float>(ax, ay), PHASE_DIFF_MIN_MAG);
+            float a = std::min<float>(ax, ay) / mx;
+            float s = a * a;
+            float r;
+            if (FAST) {
+                r = a * (detail::ATAN_FAST[0] + s * detail::ATAN_FAST[1]);
+            }
+            else {
+                r = detail::ATAN_HIGH[5];
+                for (int i = 4; i >= 0; i--) { r = r * s + detail::ATAN_HIGH[i]; }
+                r *= a;
+            }
+            if (ay > ax) { r = (FL_M_PI / 2.0f) - r; }
+            if (x < 0.0f) { r = FL_M_PI - r; }
+            return copysignf(r, y);
+        }
+
+        inline float phaseDiff(complex_t cur, complex_t prev, PhaseAccuracy accuracy) {
+            float re = cur.re * prev.re + cur.im * prev.im;
+            float im = cur.im * prev.re - cur.re * prev.im;
+            switch (accuracy) {
+            case PHASE_ACCURACY_FAST:   return atan2Poly<true>(im, re);
+            case PHASE_ACCURACY_HIGH:   return atan2Poly<false>(im, re);
+            default:                    return atan2f(im, re);
+            }
+        }
+
+        // The sample before in[0] must be readable
+        inline void phaseDiff(const complex_t* in, float* out, int count, float scale, PhaseAccuracy accuracy) {
+            for (int i = 0; i < count; i++) {
+                out[i] = phaseDiff(in[i], in[i - 1], accuracy) * scale;
+            }
+        }
+    }
+
+    // SIMD kernels read the sample before in[0] and return the number of samples processed
+#if defined(DSP_SIMD_X86)
+    namespace sse {
+        inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+
+        template <bool FAST>
+        inline __m128 atan2Poly(__m128 y, __m128 x) {
+            const __m128 sign = _mm_set1_ps(-0.0f);
+            __m128 ax = _mm_andnot_ps(sign, x);
+            __m128 ay = _mm_andnot_ps(sign, y);
+            __m128 mx = _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(PHASE_DIFF_MIN_MAG));
+            __m128 a = _mm_div_ps(_mm_min_ps(ax, ay), mx);
+            __m128 s = _mm_mul_ps(a, a);
+            __m128 r;
+            if (FAST) {
+                r = _mm_add_ps(_mm_set1_ps(detail::ATAN_FAST[0]), _mm_mul_ps(s, _mm_set1_ps(detail::ATAN_FAST[1])));
+            }
+            else {
+                r = _mm_set1_ps(detail::ATAN_HIGH[5]);
+                for (int i = 4; i >= 0; i--) { r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(detail::ATAN_HIGH[i])); }
+            }
+            r = _mm_mul_ps(r, a);
+            r = select(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(FL_M_PI / 2.0f), r), r);
+            r = select(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(FL_M_PI), r), r);
+            return _mm_or_ps(r, _mm_and_ps(sign, y));
+        }
+
+        template <bool FAST>
+        inline int phaseDiff(const complex_t* in, float* out, int count, float scale) {
+            const float* fin = (const float*)in;
+            const __m128 vscale = _mm_set1_ps(scale);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                // Deinterleave the current and previous samples
+                __m128 c0 = _mm_loadu_ps(&fin[i*2]);
+                __m128 c1 = _mm_loadu_ps(&fin[i*2 + 4]);
+                __m128 p0 = _mm_loadu_ps(&fin[i*2 - 2]);
+                __m128 p1 = _mm_loadu_ps(&fin[i*2 + 2]);
+                __m128 cre = _mm_shuffle_ps(c0, c1, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 cim = _mm_shuffle_ps(c0, c1, _MM_SHUFFLE(3, 1, 3, 1));
+                __m128 pre = _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 pim = _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(3, 1, 3, 1));
+
+                // cur * conj(prev)
+                __m128 re = _mm_add_ps(_mm_mul_ps(cre, pre), _mm_mul_ps(cim, pim));
+                __m128 im = _mm_sub_ps(_mm_mul_ps(cim, pre), _mm_mul_ps(cre, pim));
+                _mm_storeu_ps(&out[i], _mm_mul_ps(atan2Poly<FAST>(im, re), vscale));
+            }
+            return i;
+        }
+    }
+
+    namespace avx2 {
+        template <bool FAST>
+        DSP_TARGET("avx2,fma")
+        inline __m256 atan2Poly(__m256 y, __m256 x) {
+            const __m256 sign = _mm256_set1_ps(-0.0f);
+            __m256 ax = _mm256_andnot_ps(sign, x);
+            __m256 ay = _mm256_andnot_ps(sign, y);
+            __m256 mx = _mm256_max_ps(_mm256_max_ps(ax, ay), _mm256_set1_ps(PHASE_DIFF_MIN_MAG));
+            __m256 a = _mm256_div_ps(_mm256_min_ps(ax, ay), mx);
+            __m256 s = _mm256_mul_ps(a, a);
+            __m256 r;
+            if (FAST) {
+                r = _mm256_fmadd_ps(s, _mm256_set1_ps(detail::ATAN_FAST[1]), _mm256_set1_ps(detail::ATAN_FAST[0]));
+            }
+            else {
+                r = _mm256_set1_ps(detail::ATAN_HIGH[5]);
+                for (int i = 4; i >= 0; i--) { r = _mm256_fmadd_ps(r, s, _mm256_set1_ps(detail::ATAN_HIGH[i])); }
+            }
+            r = _mm256_mul_ps(r, a);
+            r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(FL_M_PI / 2.0f), r), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+            r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(FL_M_PI), r), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+            return _mm256_or_ps(r, _mm256_and_ps(sign, y));
+        }
+
+        template <bool FAST>
+        DSP_TARGET("avx2,fma")
+        inline int phaseDiff(const complex_t* in, float* out, int count, float scale) {
+            const float* fin = (const float*)in;
+            const __m256 vscale = _mm256_set1_ps(scale);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                // Shuffles work within 128bit lanes, the permute puts the samples back in order
+                __m256 c0 = _mm256_loadu_ps(&fin[i*2]);
+                __m256 c1 = _mm256_loadu_ps(&fin[i*2 + 8]);
+                __m256 p0 = _mm256_loadu_ps(&fin[i*2 - 2]);
+                __m256 p1 = _mm256_loadu_ps(&fin[i*2 + 6]);
+                __m256 cre = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(c0, c1, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+                __m256 cim = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(c0, c1, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+                __m256 pre = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+                __m256 pim = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+
+                // cur * conj(prev)
+                __m256 re = _mm256_fmadd_ps(cre, pre, _mm256_mul_ps(cim, pim));
+                __m256 im = _mm256_fmsub_ps(cim, pre, _mm256_mul_ps(cre, pim));
+                _mm256_storeu_ps(&out[i], _mm256_mul_ps(atan2Poly<FAST>(im, re), vscale));
+            }
+            return i;
+        }
+    }
+#endif
+
+#if defined(DSP_SIMD_NEON)
+    namespace neon {
+        template <bool FAST>
+        inline float32x4_t atan2Poly(float32x4_t y, float32x4_t x) {
+            float32x4_t ax = vabsq_f32(x);
+            float32x4_t ay = vabsq_f32(y);
+            float32x4_t mx = vmaxq_f32(vmaxq_f32(ax, ay), vdupq_n_f32(PHASE_DIFF_MIN_MAG));
+            float32x4_t a = vdivq_f32(vminq_f32(ax, ay), mx);
+            float32x4_t s = vmulq_f32(a, a);
+            float32x4_t r;
+            if (FAST) {
+                r = vfmaq_f32(vdupq_n_f32(detail::ATAN_FAST[0]), s, vdupq_n_f32(detail::ATAN_FAST[1]));
+            }
+            else {
+                r = vdupq_n_f32(detail::ATAN_HIGH[5]);
+                for (int i = 4; i >= 0; i--) { r = vfmaq_f32(vdupq_n_f32(detail::ATAN_HIGH[i]), r, s); }
+            }
+            r = vmulq_f32(r, a);
+            r = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(FL_M_PI / 2.0f), r), r);
+            r = vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.0f)), vsubq_f32(vdupq_n_f32(FL_M_PI), r), r);
+            uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(y), vdupq_n_u32(0x80000000));
+            return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(r), sign));
+        }
+
+        template <bool FAST>
+        inline int phaseDiff(const complex_t* in, float* out, int count, float scale) {
+            const float* fin = (const float*)in;
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                float32x4x2_t c = vld2q_f32(&fin[i*2]);
+                float32x4x2_t p = vld2q_f32(&fin[i*2 - 2]);
+
+                // cur * conj(prev)
+                float32x4_t re = vmlaq_f32(vmulq_f32(c.val[0], p.val[0]), c.val[1], p.val[1]);
+                float32x4_t im = vmlsq_f32(vmulq_f32(c.val[1], p.val[0]), c.val[0], p.val[1]);
+                vst1q_f32(&out[i], vmulq_n_f32(atan2Poly<FAST>(im, re), scale));
+            }
+            return i;
+        }
+    }
+#endif
+
+    /**
+     * Compute the phase difference between consecutive samples.
+     * @param in Input samples.
+     * @param out Phase differences in radians multiplied by the scale.
+     * @param count Number of samples.
+     * @param last Sample preceding the block, updated to the last sample of the block.
+     * @param scale Factor applied to the output.
+     * @param accuracy Accuracy of the angle computation.
+     */
+    inline void phaseDiff(const complex_t* in, float* out, int count, complex_t& last, float scale, PhaseAccuracy accuracy = PHASE_ACCURACY_HIGH) {
+        if (count <= 0) { return; }
+
+        // The first sample uses the state, the following ones can read their predecessor from the input
+        out[0] = generic::phaseDiff(in[0], last, accuracy) * scale;
+        int done = 1;
+        if (accuracy != PHASE_ACCURACY_EXACT) {
+            bool fast = (accuracy == PHASE_ACCURACY_FAST);
+#if defined(DSP_SIMD_X86)
+            if (simd::hasAVX2()) {
+                done += fast ? avx2::phaseDiff<true>(&in[1], &out[1], count - 1, scale) : avx2::phaseDiff<false>(&in[1], &out[1], count - 1, scale);
+            }
+            else {
+                done += fast ? sse::phaseDiff<true>(&in[1], &out[1], count - 1, scale) : sse::phaseDiff<false>(&in[1], &out[1], count - 1, scale);
+            }
+#elif defined(DSP_SIMD_NEON)
+            done += fast ? neon::phaseDiff<true>(&in[1], &out[1], count - 1, scale) : neon::phaseDiff<false>(&in[1], &out[1], count - 1, scale);
+#endif
+        }
+        generic::phaseDiff(&in[done], &out[done], count - done, scale, accuracy);
+        last = in[count - 1];
+    }
+}
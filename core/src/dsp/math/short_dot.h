@@ -0,0 +1,115 @@
+#pragma once
+#include <volk/volk.h>
+#include <type_traits>
+#include "../types.h"
+
+namespace dsp::math {
+    /**
+     * Dot product of a short, fixed length filter. Meant for interpolators where the call overhead
+     * of a generic dot product would dominate.
+     * @tparam T Sample type, float or complex_t.
+     * @tparam N Number of taps, must be a multiple of 4.
+     * @param in Input samples.
+     * @param taps Filter taps.
+     * @return Filter output.
+     */
+    template<class T, int N>
+    inline T shortDot(const T* in, const float* taps) {
+        static_assert(N % 4 == 0, "Tap count must be a multiple of 4");
+        // Independent partial sums so the compiler can keep them in one vector register
+        float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        if constexpr (std::is_same_v<T, float>) {
+            for (int i = 0; i < N; i += 4) {
+                for (int j = 0; j < 4; j++) { acc[j] += in[i + j] * taps[i + j]; }
+            }
+            return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        }
+        else {
+            const float* fin = (const float*)in;
+            for (int i = 0; i < N; i += 2) {
+                for (int j = 0; j < 4; j++) { acc[j] += fin[2*i + j] * taps[i + (j >> 1)]; }
+            }
+            return { acc[0] + acc[2], acc[1] + acc[3] };
+        }
+    }
+
+    /**
+     * Compute three neighbouring interpolants in a single pass over the input.
+     * @tparam T Sample type, float or complex_t.
+     * @tparam N Number of taps, must be a multiple of 4.
+     * @param in Input samples.
+     * @param taps Taps of the three filters.
+     * @param out Output of the three filters.
+     */
+    template<class T, int N>
+    inline void shortDot3(const T* in, const float* const taps[3], T out[3]) {
+        static_assert(N % 4 == 0, "Tap count must be a multiple of 4");
+        float acc[3][4] = {};
+        if constexpr (std::is_same_v<T, float>) {
+            for (int i = 0; i < N; i += 4) {
+                for (int j = 0; j < 4; j++) {
+                    float x = in[i + j];
+                    acc[0][j] += x * taps[0][i + j];
+                    acc[1][j] += x * taps[1][i + j];
+                    acc[2][j] += x * taps[2][i + j];
+                }
+            }
+            for (int k = 0; k < 3; k++) { out[k] = (acc[k][0] + acc[k][1]) + (acc[k][2] + acc[k][3]); }
+        }
+        else {
+            const float* fin = (const float*)in;
+            for (int i = 0; i < N; i += 2) {
+                for (int j = 0; j < 4; j++) {
+                    float x = fin[2*i + j];
+                    acc[0][j] += x * taps[0][i + (j >> 1)];
+                    acc[1][j] += x * taps[1][i + (j >> 1)];
+                    acc[2][j] += x * taps[2][i + (j >> 1)];
+                }
+            }
+            for (int k = 0; k < 3; k++) { out[k] = { acc[k][0] + acc[k][2], acc[k][1] + acc[k][3] }; }
+        }
+    }
+
+    /**
+     * Dot product using the specialized kernel for 4, 8 or 16 taps and volk for any other length.
+     * @param in Input samples.
+     * @param taps Filter taps.
+     * @param count Number of taps.
+     * @return Filter output.
+     */
+    template<class T>
+    inline T dot(const T* in, const float* taps, int count) {
+        switch (count) {
+            case 4:     return shortDot<T, 4>(in, taps);
+            case 8:     return shortDot<T, 8>(in, taps);
+            case 16:    return shortDot<T, 16>(in, taps);
+            default:    break;
+        }
+        T out;
+        if constexpr (std::is_same_v<T, float>) {
+            volk_32f_x2_dot_prod_32f(&out, in, taps, count);
+        }
+        else {
+            volk_32fc_32f_dot_prod_32fc((lv_32fc_t*)&out, (const lv_32fc_t*)in, taps, count);
+        }
+        return out;
+    }
+
+    /**
+     * Three dot products of the same input, in one pass for 4, 8 or 16 taps.
+     * @param in Input samples.
+     * @param taps Taps of the three filters.
+     * @param out Output of the three filters.
+     * @param count Number of taps.
+     */
+    template<class T>
+    inline void dot3(const T* in, const float* const taps[3], T out[3], int count) {
+        switch (count) {
+            case 4:     shortDot3<T, 4>(in, taps, out); return;
+            case 8:     shortDot3<T, 8>(in, taps, out); return;
+            case 16:    shortDot3<T, 16>(in, taps, out); return;
+            default:    break;
+        }
+        for (int k = 0; k < 3; k++) { out[k] = dot<T>(in, taps[k], count); }
+    }
+}
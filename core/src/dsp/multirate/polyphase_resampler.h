@@ -98,6 +98,27 @@ namespace dsp::multirate {
             return outCount;
         }
 
+        /**
+         * Account for a block of silence without doing the convolution. The phase advances exactly as if the
+         * block had been processed and the history is cleared.
+         * @param count Number of input samples.
+         * @param out Output buffer, filled with zeros.
+         * @return Number of output samples.
+         */
+        inline int silence(int count, T* out) {
+            int outCount = 0;
+            while (offset < count) {
+                outCount++;
+                phase += _decim;
+                offset += phase / _interp;
+                phase = phase % _interp;
+            }
+            offset -= count;
+            buffer::clear<T>(buffer, phases.tapsPerPhase - 1);
+            buffer::clear<T>(out, outCount);
+            return outCount;
+        }
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -66,6 +66,23 @@ namespace dsp::multirate {
             return count;
         }
 
+        /**
+         * Account for a block of silence without filtering, see filter::DecimatingFIR::silence().
+         * @param count Number of input samples.
+         * @param out Output buffer, filled with zeros.
+         * @return Number of output samples.
+         */
+        inline int silence(int count, T* out) {
+            if (_ratio == 1) {
+                buffer::clear<T>(out, count);
+                return count;
+            }
+            for (int i = 0; i < stageCount; i++) {
+                count = decimFirs[i]->silence(count, out);
+            }
+            return count;
+        }
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
@@ -95,15 +95,39 @@ namespace dsp::multirate {
             return count;
         }
 
+        /**
+         * Account for a block of silence without filtering, the output has the same length as if it had been processed.
+         * @param count Number of input samples.
+         * @param out Output buffer, filled with zeros.
+         * @return Number of output samples.
+         */
+        inline int silence(int count, T* out) {
+            switch(mode) {
+                case Mode::BOTH:
+                    count = decim.silence(count, out);
+                    return resamp.silence(count, out);
+                case Mode::DECIM_ONLY:
+                    return decim.silence(count, out);
+                case Mode::RESAMP_ONLY:
+                    return resamp.silence(count, out);
+                case Mode::NONE:
+                    buffer::clear<T>(out, count);
+                    return count;
+            }
+            return count;
+        }
+
         int run() {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
 
-            int outCount = process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+            bool silent = base_type::_in->readSilent;
+            int outCount = silent ? silence(count, base_type::out.writeBuf) : process(count, base_type::_in->readBuf, base_type::out.writeBuf);
 
             // Swap if some data was generated
             base_type::_in->flush();
             if (outCount) {
+                base_type::out.writeSilent = silent;
                 if (!base_type::out.swap(outCount)) { return -1; }
             }
             return outCount;
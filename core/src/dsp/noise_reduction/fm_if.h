@@ -80,10 +80,19 @@ namespace dsp::noise_reduction {
             int count = base_type::_in->read();
             if (count < 0) { return -1; }
 
-            process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+            // Don't run the FFTs on silence, restart with a clear buffer once the signal is back
+            bool silent = base_type::_in->readSilent;
+            if (silent) {
+                buffer::clear(buffer, _bins - 1);
+                buffer::clear(base_type::out.writeBuf, count);
+            }
+            else {
+                process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+            }
 
             // Swap if some data was generated
             base_type::_in->flush();
+            base_type::out.writeSilent = silent;
             if (!base_type::out.swap(count)) { return -1; }
             return count;
         }
@@ -1,5 +1,7 @@
 #pragma once
 #include "../processor.h"
+#include "../math/one_pole.h"
+#include <volk/volk.h>
 
 namespace dsp::noise_reduction {
     class NoiseBlanker : public Processor<complex_t, complex_t> {
@@ -9,10 +11,20 @@ namespace dsp::noise_reduction {
 
         NoiseBlanker(stream<complex_t>* in, double rate, double level) { init(in, rate, level); }
 
+        ~NoiseBlanker() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            buffer::free(ampBuf);
+            buffer::free(envBuf);
+        }
+
         void init(stream<complex_t>* in, double rate, double level) {
             _rate = rate;
-            _invRate = 1.0f - _rate;
             _level = level;
+
+            ampBuf = buffer::alloc<float>(STREAM_BUFFER_SIZE);
+            envBuf = buffer::alloc<float>(STREAM_BUFFER_SIZE);
+
             base_type::init(in);
         }
 
@@ -20,7 +32,6 @@ namespace dsp::noise_reduction {
             assert(base_type::_block_init);
             std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
             _rate = rate;
-            _invRate = 1.0f - _rate;
         }
 
         void setLevel(double level) {
@@ -36,23 +47,37 @@ namespace dsp::noise_reduction {
         }
 
         inline int process(int count, complex_t* in, complex_t* out) {
-            for (int i = 0; i < count; i++) {
-                // Get signal amplitude
-                float inAmp = in[i].amplitude();
-
-                // Update average amplitude
-                float gain = 1.0f;
-                if (inAmp != 0.0f) {
-                    amp = (amp * _invRate) + (inAmp * _rate);
-                    float excess = inAmp / amp;
-                    if (excess > _level) {
-                        gain = 1.0f / excess;
+            // Get signal amplitude
+            volk_32fc_magnitude_32f(ampBuf, (lv_32fc_t*)in, count);
+
+            // Update average amplitude, it is held during null samples which only show up in bulk when squelched
+            int nulls = 0;
+            for (int i = 0; i < count; i++) { nulls += (ampBuf[i] == 0.0f); }
+            if (!nulls) {
+                math::onePole<1>(ampBuf, envBuf, count, _rate, &amp);
+            }
+            else {
+                int i = 0;
+                while (i < count) {
+                    int start = i;
+                    if (ampBuf[i] != 0.0f) {
+                        while (i < count && ampBuf[i] != 0.0f) { i++; }
+                        math::onePole<1>(&ampBuf[start], &envBuf[start], i - start, _rate, &amp);
+                    }
+                    else {
+                        while (i < count && ampBuf[i] == 0.0f) { envBuf[i++] = amp; }
                     }
                 }
-                
-                // Scale output by gain
-                out[i] = in[i] * gain;
             }
+
+            // Compute the gain, null samples have an excess of zero and are left untouched
+            for (int i = 0; i < count; i++) {
+                float excess = ampBuf[i] / envBuf[i];
+                envBuf[i] = (excess > _level) ? (1.0f / excess) : 1.0f;
+            }
+
+            // Scale output by gain
+            volk_32fc_32f_multiply_32fc((lv_32fc_t*)out, (lv_32fc_t*)in, envBuf, count);
             return count;
         }
 
@@ -69,10 +94,12 @@ namespace dsp::noise_reduction {
 
     protected:
         float _rate;
-        float _invRate;
         float _level;
 
         float amp = 1.0;
 
+        float* ampBuf;
+        float* envBuf;
+
     };
 }
\ No newline at end of file
@@ -36,7 +36,8 @@ namespace dsp::noise_reduction {
             volk_32f_accumulator_s32f(&sum, normBuffer, count);
             sum /= (float)count;
 
-            if (10.0f * log10f(sum) >= _level) {
+            open = (10.0f * log10f(sum) >= _level);
+            if (open) {
                 memcpy(out, in, count * sizeof(complex_t));
             }
             else {
@@ -53,6 +54,9 @@ namespace dsp::noise_reduction {
             if (count < 0) { return -1; }
             process(count, base_type::_in->readBuf, base_type::out.writeBuf);
             base_type::_in->flush();
+
+            // Let the following blocks know they can skip the block
+            base_type::out.writeSilent = !open;
             if (!base_type::out.swap(count)) { return -1; }
             return count;
         }
@@ -60,6 +64,7 @@ namespace dsp::noise_reduction {
     private:
         float* normBuffer;
         float _level = -50.0f;
+        bool open = true;
                 
     };
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+// Helpers to write SIMD kernels that are selected at runtime depending on the CPU
+// DSP_SIMD_X86:    SSE2 can be used directly, SSSE3/AVX2 kernels must be marked with DSP_TARGET and dispatched
+// DSP_SIMD_NEON:   NEON can be used directly (always available on aarch64)
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#include <immintrin.h>
+#define DSP_SIMD_X86
+#define DSP_TARGET(feat) __attribute__((target(feat)))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#define DSP_SIMD_X86
+#define DSP_TARGET(feat)
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define DSP_SIMD_NEON
+#define DSP_TARGET(feat)
+#else
+#define DSP_TARGET(feat)
+#endif
+
+namespace dsp::simd {
+#if defined(DSP_SIMD_X86) && defined(_MSC_VER)
+    namespace detail {
+        inline bool osSavesYMM() {
+            int regs[4];
+            __cpuid(regs, 1);
+            if (!(regs[2] & (1 << 27))) { return false; }
+            return (_xgetbv(0) & 0x6) == 0x6;
+        }
+    }
+#endif
+
+    /**
+     * Check if the CPU supports SSSE3 instructions.
+     * @return True if SSSE3 kernels can be used.
+     */
+    inline bool hasSSSE3() {
+#if defined(DSP_SIMD_X86) && defined(_MSC_VER)
+        static const bool supported = [] {
+            int regs[4];
+            __cpuid(regs, 1);
+            return (regs[2] & (1 << 9)) != 0;
+        }();
+        return supported;
+#elif defined(DSP_SIMD_X86)
+        static const bool supported = __builtin_cpu_supports("ssse3");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Check if the CPU (and OS) supports AVX2 and FMA instructions.
+     * @return True if AVX2 kernels can be used.
+     */
+    inline bool hasAVX2() {
+#if defined(DSP_SIMD_X86) && defined(_MSC_VER)
+        static const bool supported = [] {
+            if (!detail::osSavesYMM()) { return false; }
+            int regs[4];
+            __cpuid(regs, 1);
+            bool fma = (regs[2] & (1 << 12)) != 0;
+            __cpuidex(regs, 7, 0);
+            return fma && (regs[1] & (1 << 5)) != 0;
+        }();
+        return supported;
+#elif defined(DSP_SIMD_X86)
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Check if the CPU supports NEON instructions.
+     * @return True if NEON kernels can be used.
+     */
+    constexpr bool hasNEON() {
+#if defined(DSP_SIMD_NEON)
+        return true;
+#else
+        return false;
+#endif
+    }
+}
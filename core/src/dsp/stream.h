@@ -53,6 +53,8 @@ namespace dsp {
                 T* temp = writeBuf;
                 writeBuf = readBuf;
                 readBuf = temp;
+                readSilent = writeSilent;
+                writeSilent = false;
                 canSwap = false;
             }
 
@@ -124,6 +126,11 @@ namespace dsp {
         T* writeBuf;
         T* readBuf;
 
+        // Set by the writer before swapping to mark a block that only contains silence. The samples are still zeros so
+        // readers can ignore the flag, but those that care can skip their processing. Cleared after each swap.
+        bool writeSilent = false;
+        bool readSilent = false;
+
     private:
         std::mutex swapMtx;
         std::condition_variable swapCV;
@@ -376,6 +376,93 @@ namespace SmGui {
         return size;
     }
 
+    bool DrawList::itemEquals(DrawListElem& a, DrawListElem& b) {
+        if (a.type != b.type) { return false; }
+        if (a.type == DRAW_LIST_ELEM_TYPE_DRAW_STEP) { return a.step == b.step && a.forceSync == b.forceSync; }
+        else if (a.type == DRAW_LIST_ELEM_TYPE_BOOL) { return a.b == b.b; }
+        else if (a.type == DRAW_LIST_ELEM_TYPE_INT) { return a.i == b.i; }
+        else if (a.type == DRAW_LIST_ELEM_TYPE_FLOAT) { return a.f == b.f; }
+        else if (a.type == DRAW_LIST_ELEM_TYPE_STRING) { return a.str == b.str; }
+        return false;
+    }
+
+    int DrawList::loadDiff(void* data, int len) {
+        uint8_t* buf = (uint8_t*)data;
+        int i = 0;
+
+        // Resize to the new element count
+        if (len < 4) { return -1; }
+        uint32_t count = *(uint32_t*)&buf[i];
+        i += 4;
+        len -= 4;
+        if (count > SMGUI_MAX_DIFF_ELEMENTS) { return -1; }
+        elements.resize(count);
+
+        // Replace each run of changed elements
+        while (len > 0) {
+            if (len < 6) { return -1; }
+            uint32_t first = *(uint32_t*)&buf[i];
+            uint16_t n = *(uint16_t*)&buf[i + 4];
+            i += 6;
+            len -= 6;
+            if (n > count || first > count - n) { return -1; }
+
+            for (int j = 0; j < n; j++) {
+                if (len < 1) { return -1; }
+                int consumed = loadItem(elements[first + j], &buf[i], len);
+                if (consumed < 0) { return -1; }
+                i += consumed;
+                len -= consumed;
+            }
+        }
+
+        // Validate the result
+        if (!validate()) {
+            flog::error("Drawlist validation failed after applying diff");
+            return -1;
+        }
+
+        return i;
+    }
+
+    int DrawList::storeDiff(DrawList& prev, void* data, int len) {
+        uint8_t* buf = (uint8_t*)data;
+        int i = 0;
+        int count = elements.size();
+        int prevCount = prev.elements.size();
+
+        // Save the new element count
+        if (len < 4) { return -1; }
+        *(uint32_t*)&buf[i] = count;
+        i += 4;
+        len -= 4;
+
+        // Save runs of elements that differ from the previous list as [first index, count, elements...]
+        for (int e = 0; e < count;) {
+            if (e < prevCount && itemEquals(elements[e], prev.elements[e])) {
+                e++;
+                continue;
+            }
+            int first = e;
+            while (e < count && e - first < 0xFFFF && !(e < prevCount && itemEquals(elements[e], prev.elements[e]))) { e++; }
+
+            if (len < 6) { return -1; }
+            *(uint32_t*)&buf[i] = first;
+            *(uint16_t*)&buf[i + 4] = e - first;
+            i += 6;
+            len -= 6;
+
+            for (int j = first; j < e; j++) {
+                int size = storeItem(elements[j], &buf[i], len);
+                if (size < 0) { return -1; }
+                i += size;
+                len -= size;
+            }
+        }
+
+        return i;
+    }
+
     bool DrawList::checkTypes(int firstId, int n, ...) {
         va_list args;
         va_start(args, n);
@@ -5,6 +5,9 @@
 #include <vector>
 #include <map>
 
+// Upper limit of the element count announced by a diff, far above what any menu produces
+#define SMGUI_MAX_DIFF_ELEMENTS 0x10000
+
 namespace SmGui {
     enum DrawStep {
         // Format calls
@@ -93,6 +96,9 @@ namespace SmGui {
         int store(void* data, int len);
         static int getItemSize(DrawListElem& elem);
         int getSize();
+        static bool itemEquals(DrawListElem& a, DrawListElem& b);
+        int loadDiff(void* data, int len);
+        int storeDiff(DrawList& prev, void* data, int len);
         bool checkTypes(int firstId, int n, ...);
         bool validate();
 
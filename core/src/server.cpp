@@ -35,6 +35,7 @@ namespace server {
     uint8_t* bb_pkt_data = NULL;
 
     SmGui::DrawListElem dummyElem;
+    SmGui::DrawList lastUI;
 
     ZSTD_CCtx* cctx;
 
@@ -195,6 +196,10 @@ namespace server {
 
         sendSampleRate(sampleRate);
 
+        // Forget the UI sent to the previous client and tell this one that it can ask for diffs
+        lastUI.elements.clear();
+        sendCommand(COMMAND_UI_DIFF_SUPPORTED, 0);
+
         // TODO: Wait otherwise someone else could connect
 
         listener->acceptAsync(_clientHandler, NULL);
@@ -248,12 +253,15 @@ namespace server {
 
     void commandHandler(Command cmd, uint8_t* data, int len) {
         if (cmd == COMMAND_GET_UI) {
-            sendUI(COMMAND_GET_UI, "", dummyElem);
+            // Without flags, a full UI is sent (used by clients to resync)
+            bool diff = (len >= 1) && (data[0] & UI_FLAG_DIFF);
+            sendUI(COMMAND_GET_UI, "", dummyElem, diff);
         }
         else if (cmd == COMMAND_UI_ACTION && len >= 3) {
             // Check if sending back data is needed
             int i = 0;
-            bool sendback = data[i++];
+            uint8_t flags = data[i++];
+            bool sendback = flags & UI_FLAG_SENDBACK;
             len--;
             
             // Load id
@@ -271,9 +279,12 @@ namespace server {
             i += count;
             len -= count;
 
+            // The client already shows the new value, take it into account for the next diff
+            applyClientChange(diffId.str, diffValue);
+
             // Render and send back
             if (sendback) {
-                sendUI(COMMAND_UI_ACTION, diffId.str, diffValue);
+                sendUI(COMMAND_UI_ACTION, diffId.str, diffValue, flags & UI_FLAG_DIFF);
             }
             else {
                 renderUI(NULL, diffId.str, diffValue);
@@ -319,6 +330,23 @@ namespace server {
         sigpath::sourceManager.showSelectedMenu();
     }
 
+    void applyClientChange(std::string& diffId, SmGui::DrawListElem& diffValue) {
+        auto& elems = lastUI.elements;
+        for (int i = 1; i + 1 < elems.size(); i++) {
+            if (elems[i].type != SmGui::DRAW_LIST_ELEM_TYPE_STRING || elems[i].str != diffId) { continue; }
+            if (elems[i - 1].type != SmGui::DRAW_LIST_ELEM_TYPE_DRAW_STEP) { continue; }
+
+            // Only widgets editing their value in the client's draw list are concerned
+            SmGui::DrawStep step = elems[i - 1].step;
+            if (step != SmGui::DRAW_STEP_COMBO && step != SmGui::DRAW_STEP_SLIDER_INT && step != SmGui::DRAW_STEP_SLIDER_FLOAT_WITH_STEPS &&
+                step != SmGui::DRAW_STEP_INPUT_INT && step != SmGui::DRAW_STEP_CHECKBOX && step != SmGui::DRAW_STEP_SLIDER_FLOAT &&
+                step != SmGui::DRAW_STEP_INPUT_TEXT) { return; }
+
+            if (elems[i + 1].type == diffValue.type) { elems[i + 1] = diffValue; }
+            return;
+        }
+    }
+
     void renderUI(SmGui::DrawList* dl, std::string diffId, SmGui::DrawListElem diffValue) {
         // If we're recording and there's an action, render once with the action and record without
 
@@ -339,14 +367,31 @@ namespace server {
         }
     }
 
-    void sendUI(Command originCmd, std::string diffId, SmGui::DrawListElem diffValue) {
+    void sendUI(Command originCmd, std::string diffId, SmGui::DrawListElem diffValue, bool allowDiff) {
         // Render UI
         SmGui::DrawList dl;
         renderUI(&dl, diffId, diffValue);
 
-        // Create response
+        // Create response, only sending the elements that changed since the last UI if the client allows it
         int size = dl.getSize();
-        dl.store(s_cmd_data, size);
+        if (!allowDiff) {
+            dl.store(s_cmd_data, size);
+        }
+        else {
+            int diffSize = lastUI.elements.empty() ? -1 : dl.storeDiff(lastUI, &s_cmd_data[1], size);
+            if (diffSize >= 0) {
+                s_cmd_data[0] = UI_FORMAT_DIFF;
+                size = diffSize;
+            }
+            else {
+                s_cmd_data[0] = UI_FORMAT_FULL;
+                dl.store(&s_cmd_data[1], size);
+            }
+            size++;
+        }
+
+        // Remember what the client now has
+        lastUI.elements = std::move(dl.elements);
 
         // Send to network
         sendCommandAck(originCmd, size);
@@ -15,8 +15,9 @@ namespace server {
     void drawMenu();
 
     void commandHandler(Command cmd, uint8_t* data, int len);
+    void applyClientChange(std::string& diffId, SmGui::DrawListElem& diffValue);
     void renderUI(SmGui::DrawList* dl, std::string diffId, SmGui::DrawListElem diffValue);
-    void sendUI(Command originCmd, std::string diffId, SmGui::DrawListElem diffValue);
+    void sendUI(Command originCmd, std::string diffId, SmGui::DrawListElem diffValue, bool allowDiff = false);
     void sendError(Error err);
     void sendSampleRate(double sampleRate);
     void setInputSampleRate(double samplerate);
@@ -30,7 +30,20 @@ namespace server {
 
         // Server to client
         COMMAND_SET_SAMPLERATE = 0x80,
-        COMMAND_DISCONNECT
+        COMMAND_DISCONNECT,
+        COMMAND_UI_DIFF_SUPPORTED
+    };
+
+    // Flags sent with COMMAND_GET_UI (optional) and COMMAND_UI_ACTION
+    enum UIFlags {
+        UI_FLAG_SENDBACK    = (1 << 0),
+        UI_FLAG_DIFF        = (1 << 1)
+    };
+
+    // First byte of the UI sent back when UI_FLAG_DIFF was requested
+    enum UIFormat {
+        UI_FORMAT_FULL,
+        UI_FORMAT_DIFF
     };
 
     enum Error {
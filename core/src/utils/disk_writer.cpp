@@ -0,0 +1,397 @@
+#include "disk_writer.h"
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <stdexcept>
+#include <utils/flog.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <malloc.h>
+#define DISK_OPEN_FLAGS     (_O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY)
+#define DISK_OPEN_MODE      (_S_IREAD | _S_IWRITE)
+#define disk_open           _open
+#define disk_close          _close
+#else
+#include <unistd.h>
+#define DISK_OPEN_FLAGS     (O_WRONLY | O_CREAT | O_TRUNC)
+#define DISK_OPEN_MODE      0644
+#define disk_open           ::open
+#define disk_close          ::close
+#endif
+
+namespace diskio {
+    static uint8_t* alignedAlloc(size_t size) {
+#ifdef _WIN32
+        return (uint8_t*)_aligned_malloc(size, DISK_WRITER_ALIGNMENT);
+#else
+        void* ptr = NULL;
+        if (posix_memalign(&ptr, DISK_WRITER_ALIGNMENT, size)) { return NULL; }
+        return (uint8_t*)ptr;
+#endif
+    }
+
+    static void alignedFree(uint8_t* ptr) {
+#ifdef _WIN32
+        _aligned_free(ptr);
+#else
+        free(ptr);
+#endif
+    }
+
+    Writer::Writer() {}
+
+    Writer::~Writer() { close(); }
+
+    bool Writer::open(std::string path) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (opened) { close(); }
+
+        // Open file, falling back to regular I/O if the filesystem doesn't support direct I/O
+        bool direct = false;
+#ifdef __linux__
+        if (directIO) {
+            fd = disk_open(path.c_str(), DISK_OPEN_FLAGS | O_DIRECT, DISK_OPEN_MODE);
+            if (fd >= 0) { direct = true; }
+            else { flog::warn("Could not open '{0}' with direct I/O, falling back to regular I/O", path); }
+        }
+#endif
+        if (!direct) { fd = disk_open(path.c_str(), DISK_OPEN_FLAGS, DISK_OPEN_MODE); }
+        if (fd < 0) { return false; }
+
+        // Unaligned writes (headers and the end of the file) can't use direct I/O and need a second descriptor
+        patchFd = fd;
+        if (direct) {
+            patchFd = disk_open(path.c_str(), O_WRONLY, DISK_OPEN_MODE);
+            if (patchFd < 0) {
+                disk_close(fd);
+                fd = -1;
+                return false;
+            }
+        }
+        _direct = direct;
+
+        // Allocate buffers
+        for (int i = 0; i < bufferCount; i++) {
+            uint8_t* buf = alignedAlloc(bufferSize);
+            if (!buf) { break; }
+            buffers.push_back(buf);
+        }
+        if (buffers.size() < 2) {
+            for (auto& buf : buffers) { alignedFree(buf); }
+            buffers.clear();
+            if (patchFd != fd) { disk_close(patchFd); }
+            disk_close(fd);
+            fd = -1;
+            patchFd = -1;
+            return false;
+        }
+        freeBuffers = buffers;
+
+        // Reset state
+        session++;
+        current = freeBuffers.back();
+        freeBuffers.pop_back();
+        currentLen = 0;
+        currentOffset = 0;
+        preallocated = 0;
+        writeError = false;
+        droppedBytes = 0;
+        throughput = 0.0;
+        windowBytes = 0;
+        windowStart = std::chrono::steady_clock::now();
+
+        // Start writer thread
+        stopWorker = false;
+        workerThread = std::thread(&Writer::worker, this);
+
+        opened = true;
+        return true;
+    }
+
+    bool Writer::isOpen() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        return opened;
+    }
+
+    void Writer::close() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!opened) { return; }
+
+        // Let the writer thread finish the queued jobs
+        {
+            std::lock_guard<std::mutex> lck2(queueMtx);
+            stopWorker = true;
+        }
+        queueCnd.notify_all();
+        if (workerThread.joinable()) { workerThread.join(); }
+
+        // Write the last partial buffer, only its aligned part can go through the direct I/O descriptor
+        if (current && currentLen && !writeError) {
+            size_t aligned = _direct ? (currentLen & ~((size_t)DISK_WRITER_ALIGNMENT - 1)) : currentLen;
+            bool ok = true;
+            if (aligned) { ok &= writeFull(fd, current, aligned, currentOffset); }
+            if (currentLen > aligned) { ok &= writeFull(patchFd, &current[aligned], currentLen - aligned, currentOffset + aligned); }
+            if (!ok) { flog::error("Failed to write the end of the file"); }
+        }
+
+        // Release the space reserved past the end of the data
+        trimPreallocation(currentOffset + currentLen);
+
+        // Close file
+        if (patchFd != fd) { disk_close(patchFd); }
+        disk_close(fd);
+        fd = -1;
+        patchFd = -1;
+
+        // Free buffers
+        for (auto& buf : buffers) { alignedFree(buf); }
+        buffers.clear();
+        freeBuffers.clear();
+        jobs.clear();
+        current = NULL;
+
+        opened = false;
+    }
+
+    void Writer::setBuffers(size_t size, int count) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (opened) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        bufferSize = std::max<size_t>((size + DISK_WRITER_ALIGNMENT - 1) & ~((size_t)DISK_WRITER_ALIGNMENT - 1), DISK_WRITER_ALIGNMENT);
+        bufferCount = std::max<int>(count, 2);
+    }
+
+    void Writer::setOverflowPolicy(OverflowPolicy policy) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        overflowPolicy = policy;
+    }
+
+    void Writer::setDirectIO(bool enabled) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (opened) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        directIO = enabled;
+    }
+
+    void Writer::setPreallocation(uint64_t step) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (opened) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        preallocStep = step;
+    }
+
+    bool Writer::write(const uint8_t* data, size_t len) {
+        std::unique_lock<std::recursive_mutex> lck(mtx);
+        if (!opened) { return false; }
+
+        // When dropping, only accept the write if enough buffers are free to hold all of it
+        size_t room = current ? (bufferSize - currentLen) : 0;
+        if (overflowPolicy == OVERFLOW_DROP && len > room) {
+            size_t needed = (len - room + bufferSize - 1) / bufferSize;
+            std::lock_guard<std::mutex> lck2(queueMtx);
+            if (freeBuffers.size() < needed) {
+                droppedBytes += len;
+                return false;
+            }
+        }
+
+        while (len) {
+            // Get a new buffer if needed, waiting for one to be written if none are free
+            if (!current && !takeBuffer(lck)) { return false; }
+
+            // Copy as much as possible to the current buffer and queue it once full
+            size_t count = std::min<size_t>(len, bufferSize - currentLen);
+            memcpy(&current[currentLen], data, count);
+            currentLen += count;
+            data += count;
+            len -= count;
+            if (currentLen == bufferSize) { queueCurrent(); }
+        }
+
+        return true;
+    }
+
+    void Writer::writeAt(const uint8_t* data, size_t len, uint64_t offset) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!opened) { return; }
+        uint64_t end = offset + len;
+        if (end > currentOffset + currentLen) {
+            flog::error("Attempted to write past the end of the file");
+            return;
+        }
+
+        // Data still in the current buffer is modified in place
+        if (end > currentOffset) {
+            uint64_t start = std::max<uint64_t>(offset, currentOffset);
+            memcpy(&current[start - currentOffset], &data[start - offset], end - start);
+            end = start;
+        }
+
+        // Data already queued is overwritten by the writer thread after it was written
+        if (end > offset) {
+            Job job;
+            job.patch = true;
+            job.offset = offset;
+            job.patchData.assign(data, data + (end - offset));
+            {
+                std::lock_guard<std::mutex> lck2(queueMtx);
+                jobs.push_back(std::move(job));
+            }
+            queueCnd.notify_all();
+        }
+    }
+
+    uint64_t Writer::tell() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        return currentOffset + currentLen;
+    }
+
+    uint64_t Writer::tellQueued() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        return currentOffset;
+    }
+
+    float Writer::getQueueFill() {
+        std::lock_guard<std::mutex> lck(queueMtx);
+        if (buffers.empty()) { return 0.0f; }
+        return 1.0f - ((float)freeBuffers.size() / (float)buffers.size());
+    }
+
+    double Writer::getThroughput() {
+        return throughput;
+    }
+
+    uint64_t Writer::getDroppedBytes() {
+        return droppedBytes;
+    }
+
+    bool Writer::takeBuffer(std::unique_lock<std::recursive_mutex>& lck) {
+        uint64_t sess = session;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lck2(queueMtx);
+                if (!freeBuffers.empty()) {
+                    current = freeBuffers.back();
+                    freeBuffers.pop_back();
+                    return true;
+                }
+            }
+
+            // Wait without holding the control mutex so that the UI can still query the writer
+            lck.unlock();
+            {
+                std::unique_lock<std::mutex> lck2(queueMtx);
+                queueCnd.wait(lck2, [this]() { return !freeBuffers.empty() || stopWorker; });
+            }
+            lck.lock();
+
+            // Give up if the file was closed in the meantime
+            if (!opened || session != sess) { return false; }
+        }
+    }
+
+    void Writer::queueCurrent() {
+        Job job;
+        job.buf = current;
+        job.len = currentLen;
+        job.offset = currentOffset;
+        {
+            std::lock_guard<std::mutex> lck(queueMtx);
+            jobs.push_back(std::move(job));
+        }
+        queueCnd.notify_all();
+        currentOffset += currentLen;
+        currentLen = 0;
+        current = NULL;
+    }
+
+    bool Writer::writeFull(int _fd, const uint8_t* data, size_t len, uint64_t offset) {
+#ifdef _WIN32
+        if (_lseeki64(_fd, offset, SEEK_SET) < 0) { return false; }
+#endif
+        while (len) {
+#ifdef _WIN32
+            int ret = _write(_fd, data, (unsigned int)std::min<size_t>(len, 1 << 30));
+#else
+            ssize_t ret = pwrite(_fd, data, len, offset);
+#endif
+            if (ret <= 0) { return false; }
+            data += ret;
+            len -= ret;
+            offset += ret;
+        }
+        return true;
+    }
+
+    void Writer::preallocate(uint64_t end) {
+#ifdef __linux__
+        if (!preallocStep || end <= preallocated) { return; }
+        uint64_t newEnd = ((end + preallocStep - 1) / preallocStep) * preallocStep;
+        if (fallocate(fd, FALLOC_FL_KEEP_SIZE, preallocated, newEnd - preallocated)) {
+            flog::warn("Could not preallocate disk space, disabling preallocation");
+            preallocStep = 0;
+            return;
+        }
+        preallocated = newEnd;
+#endif
+    }
+
+    void Writer::trimPreallocation(uint64_t end) {
+#ifdef __linux__
+        // Truncating to the current size frees the blocks reserved with FALLOC_FL_KEEP_SIZE, punching a hole past the end doesn't
+        if (preallocated <= end) { return; }
+        if (ftruncate(fd, end)) {
+            flog::warn("Could not release the disk space preallocated past the end of the file");
+        }
+        preallocated = 0;
+#endif
+    }
+
+    void Writer::worker() {
+        while (true) {
+            // Get the next job, exit only once all jobs are done
+            Job job;
+            {
+                std::unique_lock<std::mutex> lck(queueMtx);
+                queueCnd.wait(lck, [this]() { return !jobs.empty() || stopWorker; });
+                if (jobs.empty()) { return; }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            // Overwrite already written data
+            if (job.patch) {
+                if (!writeError && !writeFull(patchFd, job.patchData.data(), job.patchData.size(), job.offset)) {
+                    flog::error("Failed to write to file");
+                    writeError = true;
+                }
+                continue;
+            }
+
+            // Write buffer, data is dropped after an error to avoid blocking the DSP
+            preallocate(job.offset + job.len);
+            if (!writeError && !writeFull(fd, job.buf, job.len, job.offset)) {
+                flog::error("Failed to write to file, further data will be dropped");
+                writeError = true;
+            }
+            if (writeError) { droppedBytes += job.len; }
+
+            // Update throughput measurement about once a second
+            windowBytes += job.len;
+            auto now = std::chrono::steady_clock::now();
+            double elapsed = std::chrono::duration<double>(now - windowStart).count();
+            if (elapsed >= 1.0) {
+                throughput = (double)windowBytes / elapsed;
+                windowBytes = 0;
+                windowStart = now;
+            }
+
+            // Release buffer
+            {
+                std::lock_guard<std::mutex> lck(queueMtx);
+                freeBuffers.push_back(job.buf);
+            }
+            queueCnd.notify_all();
+        }
+    }
+}
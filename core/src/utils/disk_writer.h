@@ -0,0 +1,169 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <stdint.h>
+
+#define DISK_WRITER_DEFAULT_BUFFER_SIZE     (4 * 1024 * 1024)
+#define DISK_WRITER_DEFAULT_BUFFER_COUNT    16
+#define DISK_WRITER_ALIGNMENT               4096
+
+namespace diskio {
+    enum OverflowPolicy {
+        OVERFLOW_BLOCK,
+        OVERFLOW_DROP
+    };
+
+    /**
+     * File writer performing the actual disk writes on its own thread.
+     * Data is appended to large aligned buffers which are queued to the writer thread once full.
+     * Writes to data that was already written (eg. headers) are queued and done in order.
+     */
+    class Writer {
+    public:
+        Writer();
+        ~Writer();
+
+        /**
+         * Open a file for writing, truncating it if it exists.
+         * @param path Path of the file.
+         * @return True on success, false otherwise.
+         */
+        bool open(std::string path);
+        bool isOpen();
+
+        /**
+         * Write all queued data and close the file.
+         */
+        void close();
+
+        /**
+         * Set the size and number of buffers used to queue data. Cannot be changed while open.
+         * @param size Size of each buffer in bytes, rounded up to a multiple of DISK_WRITER_ALIGNMENT.
+         * @param count Number of buffers.
+         */
+        void setBuffers(size_t size, int count);
+
+        /**
+         * Set what happens when a write doesn't fit in the free buffers.
+         * @param policy OVERFLOW_BLOCK to wait for the disk, OVERFLOW_DROP to discard the write.
+         */
+        void setOverflowPolicy(OverflowPolicy policy);
+
+        /**
+         * Bypass the OS cache (O_DIRECT), only supported on Linux. Cannot be changed while open.
+         * @param enabled True to enable direct I/O.
+         */
+        void setDirectIO(bool enabled);
+
+        /**
+         * Reserve disk space ahead of the data (fallocate), only supported on Linux. Cannot be changed while open.
+         * @param step Number of bytes to reserve at a time, 0 to disable.
+         */
+        void setPreallocation(uint64_t step);
+
+        /**
+         * Append data to the file.
+         * @param data Data to write.
+         * @param len Number of bytes to write.
+         * @return True if the data was queued, false if it was dropped or the file isn't open.
+         */
+        bool write(const uint8_t* data, size_t len);
+
+        /**
+         * Overwrite data that was already written.
+         * @param data Data to write.
+         * @param len Number of bytes to write.
+         * @param offset Offset in the file, offset + len must not exceed the current size.
+         */
+        void writeAt(const uint8_t* data, size_t len, uint64_t offset);
+
+        /**
+         * Get the size of the file, including queued data.
+         * @return Size of the file in bytes.
+         */
+        uint64_t tell();
+
+        /**
+         * Get the size of the file excluding the data that is still being buffered.
+         * @return Size in bytes of the data that the writer thread will have written once the queued jobs are done.
+         */
+        uint64_t tellQueued();
+
+        /**
+         * Get the fraction of the buffers waiting to be written.
+         * @return Fill level between 0 and 1.
+         */
+        float getQueueFill();
+
+        /**
+         * Get the measured disk write speed.
+         * @return Write speed in bytes per second, updated about once a second.
+         */
+        double getThroughput();
+
+        /**
+         * Get the number of bytes dropped because of an overflow or write error since the file was opened.
+         * @return Number of dropped bytes.
+         */
+        uint64_t getDroppedBytes();
+
+    private:
+        struct Job {
+            uint8_t* buf = NULL;
+            size_t len = 0;
+            bool patch = false;
+            uint64_t offset = 0;
+            std::vector<uint8_t> patchData;
+        };
+
+        bool takeBuffer(std::unique_lock<std::recursive_mutex>& lck);
+        void queueCurrent();
+        bool writeFull(int _fd, const uint8_t* data, size_t len, uint64_t offset);
+        void preallocate(uint64_t end);
+        void trimPreallocation(uint64_t end);
+        void worker();
+
+        // Settings
+        size_t bufferSize = DISK_WRITER_DEFAULT_BUFFER_SIZE;
+        int bufferCount = DISK_WRITER_DEFAULT_BUFFER_COUNT;
+        OverflowPolicy overflowPolicy = OVERFLOW_BLOCK;
+        bool directIO = false;
+        uint64_t preallocStep = 0;
+
+        // File state
+        std::recursive_mutex mtx;
+        bool opened = false;
+        uint64_t session = 0;
+        bool _direct = false;
+        int fd = -1;
+        int patchFd = -1;
+        uint64_t preallocated = 0;
+        bool writeError = false;
+
+        // Buffers, only accessed by the writer thread once queued
+        std::vector<uint8_t*> buffers;
+        std::vector<uint8_t*> freeBuffers;
+        std::deque<Job> jobs;
+        std::mutex queueMtx;
+        std::condition_variable queueCnd;
+        bool stopWorker = false;
+        std::thread workerThread;
+
+        // Current buffer
+        uint8_t* current = NULL;
+        size_t currentLen = 0;
+        uint64_t currentOffset = 0;
+
+        // Metrics, updated by the writer thread and read from the UI
+        std::atomic<uint64_t> droppedBytes = 0;
+        std::atomic<double> throughput = 0.0;
+        uint64_t windowBytes = 0;
+        std::chrono::steady_clock::time_point windowStart;
+    };
+}
@@ -0,0 +1,562 @@
+#include "flac.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+
+#define FLAC_STREAMINFO_OFFSET      8
+#define FLAC_STREAMINFO_SIZE        34
+#define FLAC_MAX_FIXED_ORDER        4
+#define FLAC_MAX_PARTITION_ORDER    8
+#define FLAC_MAX_RICE_PARAM         14
+#define FLAC_RICE_ESCAPE            15
+
+namespace flac {
+    namespace {
+        enum SubframeType {
+            SUBFRAME_CONSTANT   = 0x00,
+            SUBFRAME_VERBATIM   = 0x01,
+            SUBFRAME_FIXED      = 0x08
+        };
+
+        enum ChannelAssignment {
+            CHAN_LEFT_SIDE  = 8,
+            CHAN_RIGHT_SIDE = 9,
+            CHAN_MID_SIDE   = 10
+        };
+
+        class BitWriter {
+        public:
+            BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+            void write(uint32_t val, int bits) {
+                if (!bits) { return; }
+                acc = (acc << bits) | (val & mask(bits));
+                count += bits;
+                while (count >= 8) {
+                    count -= 8;
+                    out.push_back(acc >> count);
+                }
+                acc &= mask(count);
+            }
+
+            void writeSigned(int32_t val, int bits) {
+                write((uint32_t)val, bits);
+            }
+
+            void writeZeros(uint32_t bits) {
+                for (; bits >= 32; bits -= 32) { write(0, 32); }
+                write(0, bits);
+            }
+
+            void align() {
+                if (count) { write(0, 8 - count); }
+            }
+
+            static uint32_t mask(int bits) {
+                return (bits >= 32) ? 0xFFFFFFFF : ((1u << bits) - 1);
+            }
+
+        private:
+            std::vector<uint8_t>& out;
+            uint64_t acc = 0;
+            int count = 0;
+        };
+
+        struct CRCTables {
+            CRCTables() {
+                for (int i = 0; i < 256; i++) {
+                    uint8_t c8 = i;
+                    uint16_t c16 = i << 8;
+                    for (int j = 0; j < 8; j++) {
+                        c8 = (c8 & 0x80) ? ((c8 << 1) ^ 0x07) : (c8 << 1);
+                        c16 = (c16 & 0x8000) ? ((c16 << 1) ^ 0x8005) : (c16 << 1);
+                    }
+                    crc8[i] = c8;
+                    crc16[i] = c16;
+                }
+            }
+            uint8_t crc8[256];
+            uint16_t crc16[256];
+        };
+        const CRCTables CRC;
+
+        uint8_t crc8(const uint8_t* data, size_t len) {
+            uint8_t crc = 0;
+            for (size_t i = 0; i < len; i++) { crc = CRC.crc8[crc ^ data[i]]; }
+            return crc;
+        }
+
+        uint16_t crc16(const uint8_t* data, size_t len) {
+            uint16_t crc = 0;
+            for (size_t i = 0; i < len; i++) { crc = (crc << 8) ^ CRC.crc16[(crc >> 8) ^ data[i]]; }
+            return crc;
+        }
+
+        int64_t fixedResidual(const int32_t* x, int i, int order) {
+            switch (order) {
+            case 0: return x[i];
+            case 1: return (int64_t)x[i] - x[i-1];
+            case 2: return (int64_t)x[i] - 2 * (int64_t)x[i-1] + x[i-2];
+            case 3: return (int64_t)x[i] - 3 * (int64_t)x[i-1] + 3 * (int64_t)x[i-2] - x[i-3];
+            default: return (int64_t)x[i] - 4 * (int64_t)x[i-1] + 6 * (int64_t)x[i-2] - 4 * (int64_t)x[i-3] + x[i-4];
+            }
+        }
+
+        // Pick the fixed predictor with the smallest sum of absolute residuals
+        int bestFixedOrder(const int32_t* x, int n, uint64_t& err) {
+            uint64_t sums[FLAC_MAX_FIXED_ORDER + 1] = { 0 };
+            for (int i = FLAC_MAX_FIXED_ORDER; i < n; i++) {
+                for (int o = 0; o <= FLAC_MAX_FIXED_ORDER; o++) {
+                    int64_t r = fixedResidual(x, i, o);
+                    sums[o] += (r < 0) ? -r : r;
+                }
+            }
+            int best = 0;
+            for (int o = 1; o <= FLAC_MAX_FIXED_ORDER; o++) {
+                if (sums[o] < sums[best]) { best = o; }
+            }
+            err = sums[best];
+            return best;
+        }
+
+        struct Partition {
+            int param;
+            int escapeBits;
+        };
+
+        // Find the cheapest Rice parameter for one partition, or the raw width if escaping is cheaper
+        uint64_t planPartition(const uint32_t* u, int count, Partition& part) {
+            uint64_t sum = 0;
+            uint32_t maxU = 0;
+            for (int i = 0; i < count; i++) {
+                sum += u[i];
+                maxU = std::max<uint32_t>(maxU, u[i]);
+            }
+            int k0 = 0;
+            if (count && sum > (uint64_t)count) {
+                uint64_t mean = sum / count;
+                while (k0 < FLAC_MAX_RICE_PARAM && (mean >> (k0 + 1))) { k0++; }
+            }
+
+            uint64_t best = UINT64_MAX;
+            for (int k = std::max<int>(k0 - 1, 0); k <= std::min<int>(k0 + 1, FLAC_MAX_RICE_PARAM); k++) {
+                uint64_t bits = (uint64_t)count * (k + 1);
+                for (int i = 0; i < count; i++) { bits += u[i] >> k; }
+                if (bits < best) {
+                    best = bits;
+                    part.param = k;
+                    part.escapeBits = -1;
+                }
+            }
+
+            int width = 0;
+            while (width < 32 && (maxU >> width)) { width++; }
+            uint64_t escape = 5 + (uint64_t)count * width;
+            if (escape < best) {
+                best = escape;
+                part.param = FLAC_RICE_ESCAPE;
+                part.escapeBits = width;
+            }
+            return 4 + best;
+        }
+
+        void writeSubframe(BitWriter& bw, const int32_t* x, int n, int bps) {
+            // Constant subframe
+            bool constant = true;
+            for (int i = 1; i < n && constant; i++) { constant = (x[i] == x[0]); }
+            if (constant) {
+                bw.write(SUBFRAME_CONSTANT << 1, 8);
+                bw.writeSigned(x[0], bps);
+                return;
+            }
+
+            // Compute the residual of the best fixed predictor
+            uint64_t err;
+            int order = (n > FLAC_MAX_FIXED_ORDER) ? bestFixedOrder(x, n, err) : 0;
+            std::vector<int32_t> res(n - order);
+            std::vector<uint32_t> u(n - order);
+            for (int i = order; i < n; i++) {
+                int32_t r = fixedResidual(x, i, order);
+                res[i - order] = r;
+                u[i - order] = ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+            }
+
+            // Find the best partitioning of the residual
+            uint64_t bestBits = UINT64_MAX;
+            int bestPartOrder = 0;
+            std::vector<Partition> bestParts;
+            std::vector<Partition> parts;
+            for (int p = 0; p <= FLAC_MAX_PARTITION_ORDER; p++) {
+                if ((n % (1 << p)) || (n >> p) <= order) { break; }
+                int partSize = n >> p;
+                parts.resize(1 << p);
+                uint64_t bits = 0;
+                int offset = 0;
+                for (int i = 0; i < (1 << p); i++) {
+                    int count = i ? partSize : (partSize - order);
+                    bits += planPartition(&u[offset], count, parts[i]);
+                    offset += count;
+                }
+                if (bits < bestBits) {
+                    bestBits = bits;
+                    bestPartOrder = p;
+                    bestParts = parts;
+                }
+            }
+
+            // Fall back to verbatim if the prediction doesn't help
+            uint64_t fixedBits = 8 + (uint64_t)order * bps + 6 + bestBits;
+            if (fixedBits >= 8 + (uint64_t)n * bps) {
+                bw.write(SUBFRAME_VERBATIM << 1, 8);
+                for (int i = 0; i < n; i++) { bw.writeSigned(x[i], bps); }
+                return;
+            }
+
+            // Fixed subframe
+            bw.write((SUBFRAME_FIXED | order) << 1, 8);
+            for (int i = 0; i < order; i++) { bw.writeSigned(x[i], bps); }
+            bw.write(0, 2);
+            bw.write(bestPartOrder, 4);
+            int partSize = n >> bestPartOrder;
+            int offset = 0;
+            for (int i = 0; i < (int)bestParts.size(); i++) {
+                const Partition& part = bestParts[i];
+                int count = i ? partSize : (partSize - order);
+                bw.write(part.param, 4);
+                if (part.param == FLAC_RICE_ESCAPE) {
+                    bw.write(part.escapeBits, 5);
+                    for (int j = offset; j < offset + count; j++) { bw.writeSigned(res[j], part.escapeBits); }
+                }
+                else {
+                    int k = part.param;
+                    for (int j = offset; j < offset + count; j++) {
+                        bw.writeZeros(u[j] >> k);
+                        bw.write((1u << k) | (u[j] & BitWriter::mask(k)), k + 1);
+                    }
+                }
+                offset += count;
+            }
+        }
+
+        void writeUTF8(BitWriter& bw, uint64_t val) {
+            if (val < 0x80) {
+                bw.write(val, 8);
+                return;
+            }
+            int bytes = 2;
+            while (bytes < 7 && val >= (1ull << (5 * bytes + 1))) { bytes++; }
+            bw.write((0xFF00 >> bytes) | (val >> (6 * (bytes - 1))), 8);
+            for (int i = bytes - 2; i >= 0; i--) {
+                bw.write(0x80 | ((val >> (6 * i)) & 0x3F), 8);
+            }
+        }
+
+        int samplerateCode(uint64_t samplerate) {
+            switch (samplerate) {
+            case 88200:  return 1;
+            case 176400: return 2;
+            case 192000: return 3;
+            case 8000:   return 4;
+            case 16000:  return 5;
+            case 22050:  return 6;
+            case 24000:  return 7;
+            case 32000:  return 8;
+            case 44100:  return 9;
+            case 48000:  return 10;
+            case 96000:  return 11;
+            default:     break;
+            }
+            if (samplerate % 1000 == 0 && samplerate / 1000 <= 255) { return 12; }
+            if (samplerate <= 65535) { return 13; }
+            if (samplerate % 10 == 0 && samplerate / 10 <= 65535) { return 14; }
+            return 0;
+        }
+
+        int sampleSizeCode(int bps) {
+            switch (bps) {
+            case 8:  return 1;
+            case 16: return 4;
+            default: return 6;
+            }
+        }
+    }
+
+    Writer::Writer(int channels, uint64_t samplerate, wav::SampleType type) {
+        // Validate channels and samplerate
+        if (channels < 1 || channels > FLAC_MAX_CHANNELS) { throw std::runtime_error("Channel count must be between 1 and 8"); }
+        if (!samplerate) { throw std::runtime_error("Samplerate must be non-zero"); }
+
+        _channels = channels;
+        _samplerate = samplerate;
+        _type = type;
+    }
+
+    Writer::~Writer() { close(); }
+
+    bool Writer::open(std::string path) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Close previous file
+        if (file.isOpen()) { close(); }
+
+        // The stream info can't describe higher samplerates
+        if (_samplerate > FLAC_MAX_SAMPLERATE) { return false; }
+
+        // Reset work values
+        bps = (_type == wav::SAMP_TYPE_UINT8) ? 8 : ((_type == wav::SAMP_TYPE_INT16) ? 16 : 24);
+        for (int i = 0; i < _channels; i++) { block[i].resize(FLAC_BLOCK_SIZE); }
+        blockFill = 0;
+        frameNumber = 0;
+        samplesWritten = 0;
+        samplesDropped = 0;
+        minFrameSize = 0;
+        maxFrameSize = 0;
+        encodedBytes = 0;
+        encodeTime = 0.0;
+        openTime = std::chrono::steady_clock::now();
+
+        // Open file
+        if (!file.open(path)) { return false; }
+
+        // Write the stream info, it's updated once the stream is complete
+        file.write((const uint8_t*)"fLaC", 4);
+        writeStreamInfo(false);
+
+        // Vorbis comment with the description, always the last metadata block
+        std::vector<uint8_t> comment;
+        auto appendString = [&](std::string str) {
+            uint32_t len = str.size();
+            comment.insert(comment.end(), (uint8_t*)&len, (uint8_t*)&len + 4);
+            comment.insert(comment.end(), str.begin(), str.end());
+        };
+        appendString("SDR++");
+        uint32_t commentCount = _description.empty() ? 0 : 1;
+        comment.insert(comment.end(), (uint8_t*)&commentCount, (uint8_t*)&commentCount + 4);
+        if (!_description.empty()) { appendString("DESCRIPTION=" + _description); }
+        uint8_t hdr[4] = { 0x84, (uint8_t)(comment.size() >> 16), (uint8_t)(comment.size() >> 8), (uint8_t)comment.size() };
+        file.write(hdr, 4);
+        file.write(comment.data(), comment.size());
+
+        return true;
+    }
+
+    bool Writer::isOpen() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        return file.isOpen();
+    }
+
+    void Writer::close() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do nothing if the file is not open
+        if (!file.isOpen()) { return; }
+
+        // Encode the remaining samples and write the final stream info
+        encodeBlock();
+        writeStreamInfo(true);
+        file.close();
+    }
+
+    void Writer::setChannels(int channels) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+
+        // Validate channel count
+        if (channels < 1 || channels > FLAC_MAX_CHANNELS) { throw std::runtime_error("Channel count must be between 1 and 8"); }
+        _channels = channels;
+    }
+
+    void Writer::setSamplerate(uint64_t samplerate) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+
+        // Validate samplerate
+        if (!samplerate) { throw std::runtime_error("Samplerate must be non-zero"); }
+        _samplerate = samplerate;
+    }
+
+    void Writer::setSampleType(wav::SampleType type) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        _type = type;
+    }
+
+    void Writer::setDescription(std::string description) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        _description = description;
+    }
+
+    void Writer::setBuffers(size_t size, int count) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        file.setBuffers(size, count);
+    }
+
+    void Writer::setOverflowPolicy(diskio::OverflowPolicy policy) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        file.setOverflowPolicy(policy);
+    }
+
+    void Writer::setDirectIO(bool enabled) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        file.setDirectIO(enabled);
+    }
+
+    void Writer::setPreallocation(uint64_t step) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        file.setPreallocation(step);
+    }
+
+    float Writer::getQueueFill() {
+        return file.getQueueFill();
+    }
+
+    double Writer::getThroughput() {
+        return file.getThroughput();
+    }
+
+    double Writer::getCompressionRatio() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!encodedBytes) { return 1.0; }
+        return (double)(samplesWritten * _channels * (bps / 8)) / (double)encodedBytes;
+    }
+
+    double Writer::getEncoderLoad() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - openTime).count();
+        return (elapsed > 0.0) ? (encodeTime / elapsed) : 0.0;
+    }
+
+    void Writer::write(float* samples, int count) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!file.isOpen()) { return; }
+        auto start = std::chrono::steady_clock::now();
+
+        // Deinterleave into the block, encoding it every time it's full
+        float scale = (float)((1 << (bps - 1)) - 1);
+        float minVal = -scale - 1.0f;
+        for (int i = 0; i < count; i++) {
+            for (int c = 0; c < _channels; c++) {
+                block[c][blockFill] = lrintf(std::clamp<float>(samples[i * _channels + c] * scale, minVal, scale));
+            }
+            if (++blockFill == FLAC_BLOCK_SIZE) { encodeBlock(); }
+        }
+
+        encodeTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void Writer::encodeBlock() {
+        if (!blockFill) { return; }
+        int n = blockFill;
+        blockFill = 0;
+
+        // Pick the stereo decorrelation with the lowest estimated cost
+        int assignment = _channels - 1;
+        std::vector<int32_t> mid, side;
+        if (_channels == 2) {
+            mid.resize(n);
+            side.resize(n);
+            for (int i = 0; i < n; i++) {
+                mid[i] = ((int64_t)block[0][i] + block[1][i]) >> 1;
+                side[i] = block[0][i] - block[1][i];
+            }
+            uint64_t errL = 0, errR = 0, errM = 0, errS = 0;
+            if (n > FLAC_MAX_FIXED_ORDER) {
+                bestFixedOrder(block[0].data(), n, errL);
+                bestFixedOrder(block[1].data(), n, errR);
+                bestFixedOrder(mid.data(), n, errM);
+                bestFixedOrder(side.data(), n, errS);
+            }
+            uint64_t costs[4] = { errL + errR, errL + errS, errR + errS, errM + errS };
+            int best = std::min_element(costs, costs + 4) - costs;
+            const int assignments[4] = { 1, CHAN_LEFT_SIDE, CHAN_RIGHT_SIDE, CHAN_MID_SIDE };
+            assignment = assignments[best];
+        }
+
+        // Frame header
+        frame.clear();
+        BitWriter bw(frame);
+        int srCode = samplerateCode(_samplerate);
+        int bsCode = (n == FLAC_BLOCK_SIZE) ? 12 : 7;
+        bw.write(0xFFF8, 16);
+        bw.write(bsCode, 4);
+        bw.write(srCode, 4);
+        bw.write(assignment, 4);
+        bw.write(sampleSizeCode(bps), 3);
+        bw.write(0, 1);
+        writeUTF8(bw, frameNumber);
+        if (bsCode == 7) { bw.write(n - 1, 16); }
+        if (srCode == 12) { bw.write(_samplerate / 1000, 8); }
+        else if (srCode == 13) { bw.write(_samplerate, 16); }
+        else if (srCode == 14) { bw.write(_samplerate / 10, 16); }
+        bw.write(crc8(frame.data(), frame.size()), 8);
+
+        // Subframes, the side channel needs one more bit
+        switch (assignment) {
+        case CHAN_LEFT_SIDE:
+            writeSubframe(bw, block[0].data(), n, bps);
+            writeSubframe(bw, side.data(), n, bps + 1);
+            break;
+        case CHAN_RIGHT_SIDE:
+            writeSubframe(bw, side.data(), n, bps + 1);
+            writeSubframe(bw, block[1].data(), n, bps);
+            break;
+        case CHAN_MID_SIDE:
+            writeSubframe(bw, mid.data(), n, bps);
+            writeSubframe(bw, side.data(), n, bps + 1);
+            break;
+        default:
+            for (int c = 0; c < _channels; c++) { writeSubframe(bw, block[c].data(), n, bps); }
+            break;
+        }
+
+        // Footer
+        bw.align();
+        uint16_t crc = crc16(frame.data(), frame.size());
+        frame.push_back(crc >> 8);
+        frame.push_back(crc & 0xFF);
+        frameNumber++;
+
+        // Frames are dropped whole so that the stream stays decodable
+        if (!file.write(frame.data(), frame.size())) {
+            samplesDropped += n;
+            return;
+        }
+        samplesWritten += n;
+        encodedBytes += frame.size();
+        uint32_t size = frame.size();
+        minFrameSize = minFrameSize ? std::min<uint32_t>(minFrameSize, size) : size;
+        maxFrameSize = std::max<uint32_t>(maxFrameSize, size);
+    }
+
+    void Writer::writeStreamInfo(bool last) {
+        std::vector<uint8_t> info;
+        BitWriter bw(info);
+        bw.write(0x00, 8);
+        bw.write(FLAC_STREAMINFO_SIZE, 24);
+        bw.write(FLAC_BLOCK_SIZE, 16);
+        bw.write(FLAC_BLOCK_SIZE, 16);
+        bw.write(minFrameSize, 24);
+        bw.write(maxFrameSize, 24);
+        bw.write(_samplerate, 20);
+        bw.write(_channels - 1, 3);
+        bw.write(bps - 1, 5);
+        bw.write((uint64_t)samplesWritten >> 32, 4);
+        bw.write(samplesWritten & 0xFFFFFFFF, 32);
+        for (int i = 0; i < 4; i++) { bw.write(0, 32); } // MD5 left unset, allowed by the format
+
+        if (last) {
+            file.writeAt(info.data(), info.size(), FLAC_STREAMINFO_OFFSET - 4);
+        }
+        else {
+            file.write(info.data(), info.size());
+        }
+    }
+}
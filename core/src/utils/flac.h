@@ -0,0 +1,94 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <stdint.h>
+#include "disk_writer.h"
+#include "wav.h"
+
+#define FLAC_BLOCK_SIZE         4096
+#define FLAC_MAX_CHANNELS       8
+#define FLAC_MAX_SAMPLERATE     1048575
+
+namespace flac {
+    /**
+     * Lossless FLAC encoder writing through a diskio::Writer.
+     * Each block uses the best fixed predictor (order 0 to 4) with partitioned Rice coding of the residual,
+     * stereo blocks additionally pick the best of left/right, left/side, right/side and mid/side.
+     * Samples are converted to 8, 16 or 24 bits depending on the sample type, 32bit types are stored as 24 bits.
+     */
+    class Writer {
+    public:
+        Writer(int channels = 2, uint64_t samplerate = 48000, wav::SampleType type = wav::SAMP_TYPE_INT16);
+        ~Writer();
+
+        /**
+         * Create a FLAC file.
+         * @param path Path of the file.
+         * @return True on success, false otherwise.
+         */
+        bool open(std::string path);
+        bool isOpen();
+
+        /**
+         * Encode the last partial block, update the stream info and close the file.
+         */
+        void close();
+
+        void setChannels(int channels);
+        void setSamplerate(uint64_t samplerate);
+        void setSampleType(wav::SampleType type);
+        void setDescription(std::string description);
+        void setBuffers(size_t size, int count);
+        void setOverflowPolicy(diskio::OverflowPolicy policy);
+        void setDirectIO(bool enabled);
+        void setPreallocation(uint64_t step);
+
+        size_t getSamplesWritten() { return samplesWritten; }
+        uint64_t getSamplesDropped() { return samplesDropped; }
+        float getQueueFill();
+        double getThroughput();
+
+        /**
+         * Get the ratio between the size of the samples as PCM and the size of the encoded frames.
+         * @return Compression ratio, 1.0 if nothing was encoded yet.
+         */
+        double getCompressionRatio();
+
+        /**
+         * Get the time spent encoding relative to the time the file has been open.
+         * @return Load as a fraction of one CPU core.
+         */
+        double getEncoderLoad();
+
+        void write(float* samples, int count);
+
+    private:
+        void encodeBlock();
+        void writeStreamInfo(bool last);
+
+        std::recursive_mutex mtx;
+        diskio::Writer file;
+
+        int _channels;
+        uint64_t _samplerate;
+        wav::SampleType _type;
+        std::string _description;
+        int bps = 16;
+
+        // Block being filled, one buffer per channel
+        std::vector<int32_t> block[FLAC_MAX_CHANNELS];
+        int blockFill = 0;
+        uint64_t frameNumber = 0;
+        std::vector<uint8_t> frame;
+
+        size_t samplesWritten = 0;
+        uint64_t samplesDropped = 0;
+        uint32_t minFrameSize = 0;
+        uint32_t maxFrameSize = 0;
+        uint64_t encodedBytes = 0;
+        double encodeTime = 0.0;
+        std::chrono::steady_clock::time_point openTime;
+    };
+}
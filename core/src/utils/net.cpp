@@ -2,6 +2,7 @@
 #include <string.h>
 #include <codecvt>
 #include <stdexcept>
+#include <algorithm>
 
 #ifdef _WIN32
 #define WOULD_BLOCK (WSAGetLastError() == WSAEWOULDBLOCK)
@@ -9,6 +10,8 @@
 #define WOULD_BLOCK (errno == EWOULDBLOCK)
 #endif
 
+#define NET_RECVMULTI_MAX_BATCH 64
+
 namespace net {
     bool _init = false;
     
@@ -198,6 +201,49 @@ namespace net {
         return read;
     }
 
+    int Socket::recvmulti(uint8_t* data, size_t stride, int* lens, int count, int timeout) {
+        if (count <= 0) { return 0; }
+
+        // Wait for and receive the first datagram
+        int err = recv(data, stride, false, timeout);
+        if (err <= 0) { return err; }
+        lens[0] = err;
+        int received = 1;
+
+#ifdef __linux__
+        // Receive everything already queued with a single system call
+        mmsghdr msgs[NET_RECVMULTI_MAX_BATCH];
+        iovec iovs[NET_RECVMULTI_MAX_BATCH];
+        int batch = std::min<int>(count - 1, NET_RECVMULTI_MAX_BATCH);
+        for (int i = 0; i < batch; i++) {
+            iovs[i].iov_base = &data[(i + 1) * stride];
+            iovs[i].iov_len = stride;
+            memset(&msgs[i].msg_hdr, 0, sizeof(msghdr));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = (batch > 0) ? ::recvmmsg(sock, msgs, batch, MSG_DONTWAIT, NULL) : 0;
+        for (int i = 0; i < n; i++) {
+            lens[received++] = msgs[i].msg_len;
+        }
+#else
+        // Drain the queued datagrams one at a time without blocking
+        fd_set set;
+        FD_ZERO(&set);
+        while (received < count) {
+            FD_SET(sock, &set);
+            timeval tv;
+            tv.tv_sec = 0;
+            tv.tv_usec = 0;
+            if (select(sock+1, &set, NULL, NULL, &tv) <= 0) { break; }
+            err = ::recvfrom(sock, (char*)&data[received * stride], stride, 0, NULL, NULL);
+            if (err <= 0) { break; }
+            lens[received++] = err;
+        }
+#endif
+        return received;
+    }
+
     // === Listener functions ===
 
     Listener::Listener(SockHandle_t sock) {
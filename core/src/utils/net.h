@@ -169,6 +169,18 @@ namespace net {
          */
         int recvline(std::string& str, int maxLen = 0, int timeout = NO_TIMEOUT, Address* dest = NULL);
 
+        /**
+         * Receive multiple datagrams from socket. Waits for the first datagram then returns all the ones already queued (up to count).
+         * Uses recvmmsg() where available to receive the whole batch with a single system call.
+         * @param data Buffer to read the datagrams into. Datagram n is stored at offset n*stride.
+         * @param stride Maximum size of a single datagram in bytes.
+         * @param lens Array of at least count elements receiving the length of each datagram.
+         * @param count Maximum number of datagrams to read.
+         * @param timeout Timeout in milliseconds for the first datagram. Use NO_TIMEOUT or NONBLOCKING here if needed.
+         * @return Number of datagrams read. 0 means timed out or closed. -1 means would block or error.
+         */
+        int recvmulti(uint8_t* data, size_t stride, int* lens, int count, int timeout = NO_TIMEOUT);
+
     private:
         Address* raddr = NULL;
         SockHandle_t sock;
@@ -1,5 +1,7 @@
 #include "http.h"
 #include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
 
 namespace net::http {
     std::string MessageHeader::serialize() {
@@ -303,4 +305,93 @@ namespace net::http {
         }
         return 0;
     }
+
+    StreamReader::StreamReader(std::shared_ptr<Socket> sock, size_t bufferSize) {
+        this->sock = sock;
+        buffer.resize(bufferSize);
+    }
+
+    int StreamReader::recvResponseHeader(ResponseHeader& resp, int timeout) {
+        // Non-blocking mode not alloowed
+        if (!timeout) { return -1; }
+
+        // Read lines until the empty line ending the header
+        std::string data;
+        while (true) {
+            std::string_view line;
+            if (recvLine(line, timeout)) { return -1; }
+            if (line.empty()) { break; }
+            data += line;
+            data += "\n";
+        }
+
+        // Deserialize
+        resp.deserialize(data);
+        return 0;
+    }
+
+    int StreamReader::recvChunk(uint8_t** data, int timeout) {
+        // Parse the chunk size, extensions after it are ignored
+        std::string_view line;
+        if (recvLine(line, timeout)) { return -1; }
+        char* end;
+        std::string lenStr(line.substr(0, 16));
+        size_t len = strtoull(lenStr.c_str(), &end, 16);
+        if (end == lenStr.c_str() || len > INT32_MAX) { return -1; }
+
+        // Last chunk, skip the (empty) trailer
+        if (!len) {
+            if (recvLine(line, timeout)) { return -1; }
+            *data = NULL;
+            return 0;
+        }
+
+        // Wait for the data and its terminating CRLF to be in the buffer
+        if (fill(len + 2, timeout)) { return -1; }
+        if (buffer[rpos + len] != '\r' || buffer[rpos + len + 1] != '\n') { return -1; }
+        *data = &buffer[rpos];
+        rpos += len + 2;
+        return len;
+    }
+
+    int StreamReader::recvLine(std::string_view& line, int timeout) {
+        size_t searched = 0;
+        while (true) {
+            // Search for the end of line in the data not searched yet
+            uint8_t* nl = (uint8_t*)memchr(buffer.data() + rpos + searched, '\n', wpos - rpos - searched);
+            if (nl) {
+                size_t len = nl - (buffer.data() + rpos);
+                line = std::string_view((char*)&buffer[rpos], (len && buffer[rpos + len - 1] == '\r') ? len - 1 : len);
+                rpos += len + 1;
+                return 0;
+            }
+            searched = wpos - rpos;
+
+            // Receive more data
+            if (searched >= HTTP_MAX_LINE_LENGTH) { return -1; }
+            if (fill(searched + 1, timeout)) { return -1; }
+        }
+    }
+
+    int StreamReader::fill(size_t count, int timeout) {
+        if (wpos - rpos >= count) { return 0; }
+
+        // Move the pending data to the start of the buffer if the rest can't fit after it
+        if (rpos + count > buffer.size()) {
+            memmove(buffer.data(), &buffer[rpos], wpos - rpos);
+            wpos -= rpos;
+            rpos = 0;
+        }
+
+        // Grow the buffer if it's too small
+        if (count > buffer.size()) { buffer.resize(count); }
+
+        // Receive as much as possible until there's enough data
+        while (wpos - rpos < count) {
+            int ret = sock->recv(buffer.data() + wpos, buffer.size() - wpos, false, timeout);
+            if (ret <= 0) { return -1; }
+            wpos += ret;
+        }
+        return 0;
+    }
 }
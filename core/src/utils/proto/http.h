@@ -1,8 +1,13 @@
 #pragma once
 #include <map>
 #include <string>
+#include <string_view>
+#include <vector>
 #include "../net.h"
 
+#define HTTP_STREAM_READER_BUFFER_SIZE  (1024 * 1024)
+#define HTTP_MAX_LINE_LENGTH            (64 * 1024)
+
 namespace net::http {
     enum Method {
         METHOD_OPTIONS,
@@ -272,5 +277,54 @@ namespace net::http {
 
     };
 
+    /**
+     * Buffered HTTP/1.1 stream reader. Data is received from the socket in large blocks
+     * and lines and chunks are parsed directly in the buffer without being copied.
+     */
+    class StreamReader {
+    public:
+        StreamReader() {}
+
+        /**
+         * Create a reader for a socket.
+         * @param sock Socket to read from.
+         * @param bufferSize Initial size of the receive buffer, it is grown if a chunk doesn't fit.
+         */
+        StreamReader(std::shared_ptr<Socket> sock, size_t bufferSize = HTTP_STREAM_READER_BUFFER_SIZE);
+
+        /**
+         * Receive a response header.
+         * @param resp Response header to deserialize into.
+         * @param timeout Timeout in milliseconds.
+         * @return 0 on success, -1 on error or timeout.
+         */
+        int recvResponseHeader(ResponseHeader& resp, int timeout = -1);
+
+        /**
+         * Receive a complete chunk of a chunked transfer.
+         * @param data Set to point to the chunk data inside the receive buffer. Only valid until the next call.
+         * @param timeout Timeout in milliseconds.
+         * @return Length of the chunk data, 0 if this was the last chunk, -1 on error or timeout.
+         */
+        int recvChunk(uint8_t** data, int timeout = -1);
+
+        /**
+         * Receive a line.
+         * @param line Set to the line without its terminating CRLF. Only valid until the next call.
+         * @param timeout Timeout in milliseconds.
+         * @return 0 on success, -1 on error, timeout or if the line is too long.
+         */
+        int recvLine(std::string_view& line, int timeout = -1);
+
+    private:
+        int fill(size_t count, int timeout);
+
+        std::shared_ptr<Socket> sock;
+        std::vector<uint8_t> buffer;
+        size_t rpos = 0;
+        size_t wpos = 0;
+
+    };
+
     
 }
\ No newline at end of file
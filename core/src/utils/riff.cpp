@@ -1,18 +1,40 @@
 #include "riff.h"
 #include <string.h>
 #include <stdexcept>
+#include <algorithm>
+#include <utils/flog.h>
 
 namespace riff {
     const char* RIFF_SIGNATURE      = "RIFF";
+    const char* RF64_SIGNATURE      = "RF64";
     const char* LIST_SIGNATURE      = "LIST";
+    const char* JUNK_SIGNATURE      = "JUNK";
+    const char* DS64_SIGNATURE      = "ds64";
+    const char* DATA_SIGNATURE      = "data";
     const size_t RIFF_LABEL_SIZE    = 4;
-
-    bool Writer::open(std::string path, const char form[4]) {
+    const uint64_t MAX_CHUNK_SIZE   = 0xFFFFFFFF;
+
+#pragma pack(push, 1)
+    struct RF64Header {
+        ChunkHeader riff;
+        char form[4];
+        ChunkHeader ds64;
+        DS64Chunk body;
+    };
+#pragma pack(pop)
+
+    bool Writer::open(std::string path, const char form[4], bool rf64) {
         std::lock_guard<std::recursive_mutex> lck(mtx);
 
         // Open file
-        file = std::ofstream(path, std::ios::out | std::ios::binary);
-        if (!file.is_open()) { return false; }
+        if (!file.open(path)) { return false; }
+
+        // Reset state
+        _rf64 = rf64;
+        large = false;
+        sizeWarned = false;
+        dataSize = 0;
+        sampleCount = 0;
 
         // Begin RIFF chunk
         beginRIFF(form);
@@ -22,7 +44,7 @@ namespace riff {
 
     bool Writer::isOpen() {
         std::lock_guard<std::recursive_mutex> lck(mtx);
-        return file.is_open();
+        return file.isOpen();
     }
 
     void Writer::close() {
@@ -51,7 +73,7 @@ namespace riff {
         if (chunks.empty()) {
             throw std::runtime_error("No chunk to end");
         }
-        if (memcmp(chunks.top().hdr.id, LIST_SIGNATURE, RIFF_LABEL_SIZE)) {
+        if (memcmp(chunks.back().hdr.id, LIST_SIGNATURE, RIFF_LABEL_SIZE)) {
             throw std::runtime_error("Top chunk not LIST chunk");
         }
 
@@ -63,13 +85,14 @@ namespace riff {
 
         // Create and write header
         ChunkDesc desc;
-        desc.pos = file.tellp();
+        desc.pos = file.tell();
+        desc.size = 0;
         memcpy(desc.hdr.id, id, sizeof(desc.hdr.id));
         desc.hdr.size = 0;
-        file.write((char*)&desc.hdr, sizeof(ChunkHeader));
+        file.write((uint8_t*)&desc.hdr, sizeof(ChunkHeader));
 
         // Save descriptor
-        chunks.push(desc);
+        chunks.push_back(desc);
     }
 
     void Writer::endChunk() {
@@ -80,31 +103,61 @@ namespace riff {
         }
 
         // Get descriptor
-        ChunkDesc desc = chunks.top();
-        chunks.pop();
+        ChunkDesc desc = chunks.back();
+        chunks.pop_back();
+
+        // The RIFF chunk has its own header
+        if (chunks.empty()) {
+            writeHeader(desc.size);
+            return;
+        }
 
         // Write size
-        auto pos = file.tellp();
-        auto npos = desc.pos;
-        npos += 4;
-        file.seekp(npos);
-        file.write((char*)&desc.hdr.size, sizeof(desc.hdr.size));
-        file.seekp(pos);
-
-        // If parent chunk, increment its size
-        if (!chunks.empty()) {
-            chunks.top().hdr.size += desc.hdr.size;
+        writeChunkSize(desc, desc.size);
+
+        // Chunks must be word aligned, pad with a zero byte if needed
+        uint64_t padding = 0;
+        if (desc.size & 1) {
+            uint8_t zero = 0;
+            if (file.write(&zero, 1)) { padding = 1; }
         }
+
+        // Increment the size of the parent chunk
+        chunks.back().size += sizeof(ChunkHeader) + desc.size + padding;
     }
 
-    void Writer::write(const uint8_t* data, size_t len) {
+    bool Writer::write(const uint8_t* data, size_t len) {
         std::lock_guard<std::recursive_mutex> lck(mtx);
 
         if (chunks.empty()) {
             throw std::runtime_error("No chunk to write into");
         }
-        file.write((char*)data, len);
-        chunks.top().hdr.size += len;
+
+        // Only count the data if it wasn't dropped
+        if (!file.write(data, len)) { return false; }
+        chunks.back().size += len;
+        return true;
+    }
+
+    void Writer::updateSizes() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+
+        if (chunks.empty()) { return; }
+
+        // All open chunks extend to the end of the file, only count what the writer thread will write before this update
+        uint64_t end = file.tellQueued();
+        for (int i = chunks.size() - 1; i > 0; i--) {
+            const ChunkDesc& desc = chunks[i];
+            uint64_t start = desc.pos + sizeof(ChunkHeader);
+            writeChunkSize(desc, (end > start) ? (end - start) : 0);
+        }
+        uint64_t start = chunks[0].pos + sizeof(ChunkHeader);
+        writeHeader((end > start) ? (end - start) : 0);
+    }
+
+    void Writer::setSampleCount(uint64_t count) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        sampleCount = count;
     }
 
     void Writer::beginRIFF(const char form[4]) {
@@ -115,8 +168,17 @@ namespace riff {
         }
 
         // Create chunk with RIFF ID and write form
+        memcpy(_form, form, RIFF_LABEL_SIZE);
         beginChunk(RIFF_SIGNATURE);
         write((uint8_t*)form, RIFF_LABEL_SIZE);
+
+        // Reserve space for the ds64 chunk, it stays a JUNK chunk until the file exceeds 4GB
+        if (_rf64) {
+            DS64Chunk ds64 = { 0, 0, 0, 0 };
+            beginChunk(JUNK_SIGNATURE);
+            write((uint8_t*)&ds64, sizeof(DS64Chunk));
+            endChunk();
+        }
     }
 
     void Writer::endRIFF() {
@@ -125,10 +187,50 @@ namespace riff {
         if (chunks.empty()) {
             throw std::runtime_error("No chunk to end");
         }
-        if (memcmp(chunks.top().hdr.id, RIFF_SIGNATURE, RIFF_LABEL_SIZE)) {
+        if (memcmp(chunks.back().hdr.id, RIFF_SIGNATURE, RIFF_LABEL_SIZE)) {
             throw std::runtime_error("Top chunk not RIFF chunk");
         }
 
         endChunk();
     }
-}
\ No newline at end of file
+
+    void Writer::writeChunkSize(const ChunkDesc& desc, uint64_t size) {
+        bool isData = !memcmp(desc.hdr.id, DATA_SIGNATURE, RIFF_LABEL_SIZE);
+        if (isData) { dataSize = size; }
+
+        // Sizes that don't fit are saturated, RF64 files store the real data size in the ds64 chunk
+        if (size > MAX_CHUNK_SIZE && !(_rf64 && isData) && !sizeWarned) {
+            flog::warn("RIFF chunk '{0}' exceeds 4GB, the file will be truncated when read", std::string(desc.hdr.id, RIFF_LABEL_SIZE));
+            sizeWarned = true;
+        }
+        uint32_t size32 = std::min<uint64_t>(size, MAX_CHUNK_SIZE);
+        file.writeAt((uint8_t*)&size32, sizeof(uint32_t), desc.pos + 4);
+    }
+
+    void Writer::writeHeader(uint64_t riffSize) {
+        // Plain RIFF files only have a size to update
+        if (!_rf64) {
+            if (riffSize > MAX_CHUNK_SIZE && !sizeWarned) {
+                flog::warn("RIFF file exceeds 4GB, the file will be truncated when read");
+                sizeWarned = true;
+            }
+            uint32_t size32 = std::min<uint64_t>(riffSize, MAX_CHUNK_SIZE);
+            file.writeAt((uint8_t*)&size32, sizeof(uint32_t), 4);
+            return;
+        }
+
+        // Switch to RF64 once the file is too large, the whole header is written at once so that it's always consistent
+        if (riffSize > MAX_CHUNK_SIZE || dataSize > MAX_CHUNK_SIZE) { large = true; }
+        RF64Header hdr;
+        memcpy(hdr.riff.id, large ? RF64_SIGNATURE : RIFF_SIGNATURE, RIFF_LABEL_SIZE);
+        hdr.riff.size = large ? MAX_CHUNK_SIZE : riffSize;
+        memcpy(hdr.form, _form, RIFF_LABEL_SIZE);
+        memcpy(hdr.ds64.id, large ? DS64_SIGNATURE : JUNK_SIGNATURE, RIFF_LABEL_SIZE);
+        hdr.ds64.size = sizeof(DS64Chunk);
+        hdr.body.riffSize = riffSize;
+        hdr.body.dataSize = dataSize;
+        hdr.body.sampleCount = sampleCount;
+        hdr.body.tableLength = 0;
+        file.writeAt((uint8_t*)&hdr, sizeof(RF64Header), 0);
+    }
+}
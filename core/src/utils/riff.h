@@ -2,8 +2,9 @@
 #include <mutex>
 #include <fstream>
 #include <string>
-#include <stack>
+#include <vector>
 #include <stdint.h>
+#include "disk_writer.h"
 
 namespace riff {
 #pragma pack(push, 1)
@@ -11,16 +12,31 @@ namespace riff {
         char id[4];
         uint32_t size;
     };
+
+    struct DS64Chunk {
+        uint64_t riffSize;
+        uint64_t dataSize;
+        uint64_t sampleCount;
+        uint32_t tableLength;
+    };
 #pragma pack(pop)
 
     struct ChunkDesc {
         ChunkHeader hdr;
-        std::streampos pos;
+        uint64_t pos;
+        uint64_t size;
     };
 
     class Writer {
     public:
-        bool open(std::string path, const char form[4]);
+        /**
+         * Create a new RIFF file.
+         * @param path Path of the file.
+         * @param form Form type of the RIFF chunk.
+         * @param rf64 Reserve space for a ds64 chunk so that the file can be turned into an RF64 file if it exceeds 4GB.
+         * @return True on success, false otherwise.
+         */
+        bool open(std::string path, const char form[4], bool rf64 = false);
         bool isOpen();
         void close();
 
@@ -30,14 +46,37 @@ namespace riff {
         void beginChunk(const char id[4]);
         void endChunk();
 
-        void write(const uint8_t* data, size_t len);
+        bool write(const uint8_t* data, size_t len);
+
+        /**
+         * Write the current size of all open chunks to the file, so that it stays readable if it isn't closed properly.
+         * Only data that was handed to the disk writer thread is accounted for.
+         */
+        void updateSizes();
+
+        /**
+         * Set the sample count stored in the ds64 chunk of RF64 files.
+         * @param count Number of samples.
+         */
+        void setSampleCount(uint64_t count);
+
+        diskio::Writer& getFile() { return file; }
 
     private:
         void beginRIFF(const char form[4]);
         void endRIFF();
+        void writeChunkSize(const ChunkDesc& desc, uint64_t size);
+        void writeHeader(uint64_t riffSize);
 
         std::recursive_mutex mtx;
-        std::ofstream file;
-        std::stack<ChunkDesc> chunks;
+        diskio::Writer file;
+        std::vector<ChunkDesc> chunks;
+
+        char _form[4];
+        bool _rf64 = false;
+        bool large = false;
+        bool sizeWarned = false;
+        uint64_t dataSize = 0;
+        uint64_t sampleCount = 0;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,484 @@
+#include "sigmf.h"
+#include <json.hpp>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+#include <time.h>
+#include <stdio.h>
+#include <math.h>
+#include <volk/volk.h>
+#include <dsp/buffer/buffer.h>
+#include <dsp/stream.h>
+#include <utils/flog.h>
+#include <version.h>
+
+using nlohmann::json;
+
+namespace sigmf {
+    const char* SIGMF_VERSION       = "1.0.0";
+    const char* DATA_EXTENSION      = ".sigmf-data";
+    const char* META_EXTENSION      = ".sigmf-meta";
+    const double META_SAVE_INTERVAL = 1.0;
+
+    bool Metadata::load(std::string path) {
+        try {
+            std::ifstream file(path);
+            json j = json::parse(file);
+
+            // Global fields
+            json& global = j["global"];
+            datatype = global["core:datatype"];
+            samplerate = global.value("core:sample_rate", 0.0);
+            channels = global.value("core:num_channels", 1);
+            description = global.value("core:description", "");
+            recorder = global.value("core:recorder", "");
+
+            // Captures
+            captures.clear();
+            if (j.contains("captures")) {
+                for (auto& c : j["captures"]) {
+                    Capture cap;
+                    cap.sampleStart = c.value("core:sample_start", (uint64_t)0);
+                    cap.frequency = c.value("core:frequency", 0.0);
+                    cap.datetime = c.value("core:datetime", "");
+                    captures.push_back(cap);
+                }
+            }
+
+            // Annotations
+            annotations.clear();
+            if (j.contains("annotations")) {
+                for (auto& a : j["annotations"]) {
+                    Annotation ann;
+                    ann.sampleStart = a.value("core:sample_start", (uint64_t)0);
+                    ann.sampleCount = a.value("core:sample_count", (uint64_t)0);
+                    ann.freqLower = a.value("core:freq_lower_edge", 0.0);
+                    ann.freqUpper = a.value("core:freq_upper_edge", 0.0);
+                    ann.label = a.value("core:label", "");
+                    annotations.push_back(ann);
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            flog::error("Could not load SigMF metadata '{0}': {1}", path, e.what());
+            return false;
+        }
+
+        // The specification requires sorted segments, but don't rely on it for the binary searches
+        std::stable_sort(captures.begin(), captures.end(), [](const Capture& a, const Capture& b) { return a.sampleStart < b.sampleStart; });
+        std::stable_sort(annotations.begin(), annotations.end(), [](const Annotation& a, const Annotation& b) { return a.sampleStart < b.sampleStart; });
+        updateTimes();
+        return true;
+    }
+
+    bool Metadata::save(std::string path) {
+        json j;
+        j["global"]["core:datatype"] = datatype;
+        j["global"]["core:sample_rate"] = samplerate;
+        j["global"]["core:version"] = SIGMF_VERSION;
+        j["global"]["core:num_channels"] = channels;
+        if (!description.empty()) { j["global"]["core:description"] = description; }
+        if (!recorder.empty()) { j["global"]["core:recorder"] = recorder; }
+
+        j["captures"] = json::array();
+        for (auto& cap : captures) {
+            json c;
+            c["core:sample_start"] = cap.sampleStart;
+            c["core:frequency"] = cap.frequency;
+            if (!cap.datetime.empty()) { c["core:datetime"] = cap.datetime; }
+            j["captures"].push_back(c);
+        }
+
+        j["annotations"] = json::array();
+        for (auto& ann : annotations) {
+            json a;
+            a["core:sample_start"] = ann.sampleStart;
+            a["core:sample_count"] = ann.sampleCount;
+            a["core:freq_lower_edge"] = ann.freqLower;
+            a["core:freq_upper_edge"] = ann.freqUpper;
+            if (!ann.label.empty()) { a["core:label"] = ann.label; }
+            j["annotations"].push_back(a);
+        }
+
+        // Write to a temporary file and rename it over the old one
+        std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream file(tmpPath);
+            if (!file.is_open()) { return false; }
+            file << j.dump(4);
+            if (!file.good()) { return false; }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, path, ec);
+        return !ec;
+    }
+
+    int Metadata::captureAt(uint64_t sample) {
+        if (captures.empty()) { return -1; }
+        auto it = std::upper_bound(captures.begin(), captures.end(), sample, [](uint64_t s, const Capture& c) { return s < c.sampleStart; });
+        if (it == captures.begin()) { return 0; }
+        return (it - captures.begin()) - 1;
+    }
+
+    bool Metadata::sampleAtTime(double time, uint64_t& sample) {
+        if (captures.empty() || captures[0].time < 0.0 || samplerate <= 0.0) { return false; }
+
+        // Find the last capture starting before the time
+        auto it = std::upper_bound(captures.begin(), captures.end(), time, [](double t, const Capture& c) { return t < c.time; });
+        if (it == captures.begin()) { return false; }
+        int id = (it - captures.begin()) - 1;
+
+        // Offset into the segment, clamped to the start of the next one
+        uint64_t offset = (time - captures[id].time) * samplerate;
+        sample = captures[id].sampleStart + offset;
+        if (id + 1 < (int)captures.size()) { sample = std::min<uint64_t>(sample, captures[id + 1].sampleStart); }
+        return true;
+    }
+
+    bool Metadata::timeAtSample(uint64_t sample, double& time) {
+        if (samplerate <= 0.0) { return false; }
+        int id = captureAt(sample);
+        if (id < 0 || captures[id].time < 0.0) { return false; }
+        time = captures[id].time + (double)(sample - std::min<uint64_t>(sample, captures[id].sampleStart)) / samplerate;
+        return true;
+    }
+
+    void Metadata::updateTimes() {
+        for (int i = 0; i < captures.size(); i++) {
+            Capture& cap = captures[i];
+            if (parseTime(cap.datetime, cap.time)) { continue; }
+            cap.time = -1.0;
+            if (i > 0 && captures[i - 1].time >= 0.0 && samplerate > 0.0) {
+                cap.time = captures[i - 1].time + (double)(cap.sampleStart - captures[i - 1].sampleStart) / samplerate;
+            }
+        }
+    }
+
+    std::string Metadata::formatTime(double time) {
+        time_t secs = floor(time);
+        int ms = std::clamp<int>((time - (double)secs) * 1000.0, 0, 999);
+        tm* utc = gmtime(&secs);
+        char buf[64];
+        sprintf(buf, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", utc->tm_year + 1900, utc->tm_mon + 1, utc->tm_mday, utc->tm_hour, utc->tm_min, utc->tm_sec, ms);
+        return buf;
+    }
+
+    bool Metadata::parseTime(std::string str, double& time) {
+        tm utc = {};
+        double sec = 0.0;
+        if (sscanf(str.c_str(), "%d-%d-%dT%d:%d:%lf", &utc.tm_year, &utc.tm_mon, &utc.tm_mday, &utc.tm_hour, &utc.tm_min, &sec) != 6) { return false; }
+        utc.tm_year -= 1900;
+        utc.tm_mon -= 1;
+        utc.tm_sec = 0;
+#ifdef _WIN32
+        time_t base = _mkgmtime(&utc);
+#else
+        time_t base = timegm(&utc);
+#endif
+        if (base == (time_t)-1) { return false; }
+        time = (double)base + sec;
+        return true;
+    }
+
+    Writer::Writer(int channels, uint64_t samplerate, bool complex, wav::SampleType type) {
+        // Validate channels and samplerate
+        if (channels < 1) { throw std::runtime_error("Channel count must be greater or equal to 1"); }
+        if (!samplerate) { throw std::runtime_error("Samplerate must be non-zero"); }
+
+        // Initialize variables
+        _channels = channels;
+        _samplerate = samplerate;
+        _complex = complex;
+        _type = type;
+    }
+
+    Writer::~Writer() { close(); }
+
+    bool Writer::open(std::string path) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Close previous recording
+        if (file.isOpen()) { close(); }
+
+        // Reset work values
+        samplesWritten = 0;
+        samplesSinceSave = 0;
+        annotating = false;
+
+        // Fill global metadata, complex samples are counted as a single value
+        static const char* const TYPE_NAMES[] = { "u8", "i16_le", "i32_le", "f32_le" };
+        int values = _complex ? 2 : 1;
+        meta = Metadata();
+        meta.datatype = std::string(_complex ? "c" : "r") + TYPE_NAMES[_type];
+        meta.samplerate = _samplerate;
+        meta.channels = _complex ? 1 : _channels;
+        meta.description = _description;
+        meta.recorder = std::string("SDR++ v") + VERSION_STR;
+        bytesPerSamp = (_type == wav::SAMP_TYPE_UINT8 ? 1 : (_type == wav::SAMP_TYPE_INT16 ? 2 : 4)) * values * meta.channels;
+
+        // Open data file
+        metaPath = path + META_EXTENSION;
+        if (!file.open(path + DATA_EXTENSION)) { return false; }
+
+        // Allocate buffers once the file is open, so that nothing is left allocated if it can't be
+        int bufSize = STREAM_BUFFER_SIZE * values * meta.channels;
+        switch (_type) {
+        case wav::SAMP_TYPE_UINT8:
+            bufU8 = dsp::buffer::alloc<uint8_t>(bufSize);
+            break;
+        case wav::SAMP_TYPE_INT16:
+            bufI16 = dsp::buffer::alloc<int16_t>(bufSize);
+            break;
+        case wav::SAMP_TYPE_INT32:
+            bufI32 = dsp::buffer::alloc<int32_t>(bufSize);
+            break;
+        case wav::SAMP_TYPE_FLOAT32:
+            break;
+        default:
+            file.close();
+            return false;
+        }
+
+        // Write the initial metadata
+        saveMeta();
+
+        saveRequested = false;
+        stopMeta = false;
+        metaThread = std::thread(&Writer::metaWorker, this, metaPath);
+
+        return true;
+    }
+
+    bool Writer::isOpen() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        return file.isOpen();
+    }
+
+    void Writer::close() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do nothing if the file is not open
+        if (!file.isOpen()) { return; }
+
+        // Stop the periodic saves, the final metadata is saved here
+        {
+            std::lock_guard<std::mutex> lck2(metaMtx);
+            stopMeta = true;
+        }
+        metaCnd.notify_all();
+        if (metaThread.joinable()) { metaThread.join(); }
+
+        // Finish the metadata and close the data file
+        if (annotating) { endAnnotation(); }
+        file.close();
+        saveMeta();
+
+        // Free buffers
+        if (bufU8) {
+            dsp::buffer::free(bufU8);
+            bufU8 = NULL;
+        }
+        if (bufI16) {
+            dsp::buffer::free(bufI16);
+            bufI16 = NULL;
+        }
+        if (bufI32) {
+            dsp::buffer::free(bufI32);
+            bufI32 = NULL;
+        }
+    }
+
+    void Writer::setChannels(int channels) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+
+        // Validate channel count
+        if (channels < 1) { throw std::runtime_error("Channel count must be greater or equal to 1"); }
+        _channels = channels;
+    }
+
+    void Writer::setSamplerate(uint64_t samplerate) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+
+        // Validate samplerate
+        if (!samplerate) { throw std::runtime_error("Samplerate must be non-zero"); }
+        _samplerate = samplerate;
+    }
+
+    void Writer::setComplex(bool complex) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        _complex = complex;
+    }
+
+    void Writer::setSampleType(wav::SampleType type) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        _type = type;
+    }
+
+    void Writer::setDescription(std::string description) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        _description = description;
+        meta.description = description;
+        metaDirty = true;
+    }
+
+    void Writer::setBuffers(size_t size, int count) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        file.setBuffers(size, count);
+    }
+
+    void Writer::setOverflowPolicy(diskio::OverflowPolicy policy) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        file.setOverflowPolicy(policy);
+    }
+
+    void Writer::setDirectIO(bool enabled) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        file.setDirectIO(enabled);
+    }
+
+    void Writer::setPreallocation(uint64_t step) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        file.setPreallocation(step);
+    }
+
+    void Writer::addCapture(double frequency, double age) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!file.isOpen()) { return; }
+
+        // A segment that didn't get any samples is replaced
+        Capture cap;
+        cap.sampleStart = samplesWritten;
+        cap.frequency = frequency;
+        cap.time = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count() - age;
+        cap.datetime = Metadata::formatTime(cap.time);
+        if (!meta.captures.empty() && meta.captures.back().sampleStart == cap.sampleStart) {
+            meta.captures.back() = cap;
+        }
+        else {
+            meta.captures.push_back(cap);
+        }
+        metaDirty = true;
+    }
+
+    void Writer::beginAnnotation(std::string label, double freqLower, double freqUpper) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!file.isOpen()) { return; }
+        if (annotating) { endAnnotation(); }
+        Annotation ann;
+        ann.sampleStart = samplesWritten;
+        ann.sampleCount = 0;
+        ann.freqLower = freqLower;
+        ann.freqUpper = freqUpper;
+        ann.label = label;
+        meta.annotations.push_back(ann);
+        annotating = true;
+    }
+
+    void Writer::endAnnotation() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!annotating) { return; }
+        Annotation& ann = meta.annotations.back();
+        ann.sampleCount = samplesWritten - ann.sampleStart;
+        if (!ann.sampleCount) { meta.annotations.pop_back(); }
+        annotating = false;
+        metaDirty = true;
+    }
+
+    uint64_t Writer::getSamplesDropped() {
+        if (!bytesPerSamp) { return 0; }
+        return file.getDroppedBytes() / bytesPerSamp;
+    }
+
+    float Writer::getQueueFill() {
+        return file.getQueueFill();
+    }
+
+    double Writer::getThroughput() {
+        return file.getThroughput();
+    }
+
+    void Writer::write(float* samples, int count) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!file.isOpen()) { return; }
+
+        // Convert to the selected sample type
+        int tcount = count * (_complex ? 2 : _channels);
+        int tbytes = count * bytesPerSamp;
+        bool written = false;
+        switch (_type) {
+        case wav::SAMP_TYPE_UINT8:
+            for (int i = 0; i < tcount; i++) {
+                bufU8[i] = (samples[i] * 127.0f) + 128.0f;
+            }
+            written = file.write(bufU8, tbytes);
+            break;
+        case wav::SAMP_TYPE_INT16:
+            volk_32f_s32f_convert_16i(bufI16, samples, 32767.0f, tcount);
+            written = file.write((uint8_t*)bufI16, tbytes);
+            break;
+        case wav::SAMP_TYPE_INT32:
+            volk_32f_s32f_convert_32i(bufI32, samples, 2147483647.0f, tcount);
+            written = file.write((uint8_t*)bufI32, tbytes);
+            break;
+        case wav::SAMP_TYPE_FLOAT32:
+            written = file.write((uint8_t*)samples, tbytes);
+            break;
+        default:
+            break;
+        }
+
+        // Sample indices in the metadata must match the data file, so dropped samples aren't counted
+        if (written) { samplesWritten += count; }
+
+        // Save the metadata at most once per interval when it changed
+        samplesSinceSave += count;
+        if (metaDirty && samplesSinceSave >= _samplerate * META_SAVE_INTERVAL) {
+            requestSave();
+            samplesSinceSave = 0;
+        }
+    }
+
+    void Writer::requestSave() {
+        // Only a copy is made here, serializing and writing it is left to the metadata thread
+        {
+            std::lock_guard<std::mutex> lck(metaMtx);
+            pendingMeta = meta;
+            saveRequested = true;
+        }
+        metaCnd.notify_all();
+        metaDirty = false;
+    }
+
+    void Writer::metaWorker(std::string path) {
+        while (true) {
+            Metadata m;
+            {
+                std::unique_lock<std::mutex> lck(metaMtx);
+                metaCnd.wait(lck, [this]() { return saveRequested || stopMeta; });
+                if (stopMeta) { return; }
+                m = std::move(pendingMeta);
+                saveRequested = false;
+            }
+            if (!m.save(path)) { flog::error("Failed to save SigMF metadata to '{0}'", path); }
+        }
+    }
+
+    void Writer::saveMeta() {
+        if (!meta.save(metaPath)) { flog::error("Failed to save SigMF metadata to '{0}'", metaPath); }
+        metaDirty = false;
+    }
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <stdint.h>
+#include "disk_writer.h"
+#include "wav.h"
+
+namespace sigmf {
+    struct Capture {
+        uint64_t sampleStart;
+        double frequency;
+        std::string datetime;
+        double time = -1.0;
+    };
+
+    struct Annotation {
+        uint64_t sampleStart;
+        uint64_t sampleCount;
+        double freqLower;
+        double freqUpper;
+        std::string label;
+    };
+
+    /**
+     * Contents of a SigMF metadata file (.sigmf-meta).
+     * Captures and annotations are kept sorted by sample index so that lookups never need to scan the recording.
+     */
+    class Metadata {
+    public:
+        /**
+         * Load a metadata file.
+         * @param path Path of the .sigmf-meta file.
+         * @return True on success, false otherwise.
+         */
+        bool load(std::string path);
+
+        /**
+         * Save the metadata, the file is replaced atomically so that it's never left half written.
+         * @param path Path of the .sigmf-meta file.
+         * @return True on success, false otherwise.
+         */
+        bool save(std::string path);
+
+        /**
+         * Find the capture segment containing a sample.
+         * @param sample Sample index.
+         * @return Index of the capture segment, -1 if there are none.
+         */
+        int captureAt(uint64_t sample);
+
+        /**
+         * Find the sample recorded at a given time using the capture timestamps.
+         * @param time UTC time in seconds since the epoch.
+         * @param sample Sample index, only set on success.
+         * @return True if the time is covered by a capture segment with a timestamp.
+         */
+        bool sampleAtTime(double time, uint64_t& sample);
+
+        /**
+         * Get the time at which a sample was recorded.
+         * @param sample Sample index.
+         * @param time UTC time in seconds since the epoch, only set on success.
+         * @return True if the sample is in a capture segment with a timestamp.
+         */
+        bool timeAtSample(uint64_t sample, double& time);
+
+        /**
+         * Compute the time of each capture segment from its timestamp, segments without one continue the previous segment.
+         */
+        void updateTimes();
+
+        static std::string formatTime(double time);
+        static bool parseTime(std::string str, double& time);
+
+        std::string datatype;
+        double samplerate = 0.0;
+        int channels = 1;
+        std::string description;
+        std::string recorder;
+        std::vector<Capture> captures;
+        std::vector<Annotation> annotations;
+    };
+
+    /**
+     * Writer for SigMF recordings, samples go to the .sigmf-data file through a diskio::Writer
+     * and the metadata is saved to the .sigmf-meta file when it changes and when the recording is closed.
+     */
+    class Writer {
+    public:
+        Writer(int channels = 2, uint64_t samplerate = 48000, bool complex = true, wav::SampleType type = wav::SAMP_TYPE_INT16);
+        ~Writer();
+
+        /**
+         * Create a recording.
+         * @param path Path of the recording without extension.
+         * @return True on success, false otherwise.
+         */
+        bool open(std::string path);
+        bool isOpen();
+        void close();
+
+        void setChannels(int channels);
+        void setSamplerate(uint64_t samplerate);
+        void setComplex(bool complex);
+        void setSampleType(wav::SampleType type);
+        void setDescription(std::string description);
+        void setBuffers(size_t size, int count);
+        void setOverflowPolicy(diskio::OverflowPolicy policy);
+        void setDirectIO(bool enabled);
+        void setPreallocation(uint64_t step);
+
+        /**
+         * Start a new capture segment at the current sample, timestamped with the current time.
+         * @param frequency Center frequency of the segment in Hz.
+         * @param age Time in seconds elapsed since the first sample of the segment was received.
+         */
+        void addCapture(double frequency, double age = 0.0);
+
+        /**
+         * Start an annotation at the current sample.
+         * @param label Label of the annotation.
+         * @param freqLower Lower edge of the annotated signal in Hz.
+         * @param freqUpper Upper edge of the annotated signal in Hz.
+         */
+        void beginAnnotation(std::string label, double freqLower, double freqUpper);
+
+        /**
+         * End the current annotation at the current sample.
+         */
+        void endAnnotation();
+
+        size_t getSamplesWritten() { return samplesWritten; }
+        uint64_t getSamplesDropped();
+        float getQueueFill();
+        double getThroughput();
+
+        void write(float* samples, int count);
+
+    private:
+        void saveMeta();
+        void requestSave();
+        void metaWorker(std::string path);
+
+        std::recursive_mutex mtx;
+        diskio::Writer file;
+        Metadata meta;
+        std::string metaPath;
+        bool metaDirty = false;
+        bool annotating = false;
+
+        int _channels;
+        uint64_t _samplerate;
+        bool _complex;
+        wav::SampleType _type;
+        std::string _description;
+        size_t bytesPerSamp = 0;
+
+        uint8_t* bufU8 = NULL;
+        int16_t* bufI16 = NULL;
+        int32_t* bufI32 = NULL;
+        size_t samplesWritten = 0;
+        uint64_t samplesSinceSave = 0;
+
+        // Periodic metadata saves are done by their own thread to keep file I/O out of write()
+        std::thread metaThread;
+        std::mutex metaMtx;
+        std::condition_variable metaCnd;
+        Metadata pendingMeta;
+        bool saveRequested = false;
+        bool stopMeta = false;
+    };
+}
@@ -4,13 +4,21 @@
 #include <dsp/buffer/buffer.h>
 #include <dsp/stream.h>
 #include <map>
+#include <algorithm>
+#include <string.h>
 
 namespace wav {
     const char* WAVE_FILE_TYPE          = "WAVE";
     const char* FORMAT_MARKER           = "fmt ";
     const char* DATA_MARKER             = "data";
+    const char* CUE_MARKER              = "cue ";
+    const char* ADTL_LIST_TYPE          = "adtl";
+    const char* LABEL_MARKER            = "labl";
+    const char* LABELLED_TEXT_MARKER    = "ltxt";
+    const char* REGION_PURPOSE          = "rgn ";
     const uint32_t FORMAT_HEADER_LEN    = 16;
     const uint16_t SAMPLE_TYPE_PCM      = 1;
+    const double HEADER_UPDATE_INTERVAL = 1.0;
 
     std::map<SampleType, int> SAMP_BITS = {
         { SAMP_TYPE_UINT8, 8 },
@@ -40,6 +48,8 @@ namespace wav {
 
         // Reset work values
         samplesWritten = 0;
+        samplesSinceUpdate = 0;
+        markers.clear();
 
         // Fill header
         bytesPerSamp = (SAMP_BITS[_type] / 8) * _channels;
@@ -69,7 +79,7 @@ namespace wav {
         }
 
         // Open file
-        if (!rw.open(path, WAVE_FILE_TYPE)) { return false; }
+        if (!rw.open(path, WAVE_FILE_TYPE, _format == FORMAT_RF64)) { return false; }
 
         // Write format chunk
         rw.beginChunk(FORMAT_MARKER);
@@ -98,8 +108,12 @@ namespace wav {
         if (!rw.isOpen()) { return; }
 
         // Finish data chunk
+        rw.setSampleCount(samplesWritten);
         rw.endChunk();
 
+        // Markers follow the data chunk
+        writeMarkers();
+
         // Close the file
         rw.close();
 
@@ -152,6 +166,98 @@ namespace wav {
         _type = type;
     }
 
+    void Writer::setBuffers(size_t size, int count) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (rw.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        rw.getFile().setBuffers(size, count);
+    }
+
+    void Writer::setOverflowPolicy(diskio::OverflowPolicy policy) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        rw.getFile().setOverflowPolicy(policy);
+    }
+
+    void Writer::setDirectIO(bool enabled) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (rw.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        rw.getFile().setDirectIO(enabled);
+    }
+
+    void Writer::setPreallocation(uint64_t step) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (rw.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        rw.getFile().setPreallocation(step);
+    }
+
+    uint64_t Writer::getSamplesDropped() {
+        if (!bytesPerSamp) { return 0; }
+        return rw.getFile().getDroppedBytes() / bytesPerSamp;
+    }
+
+    float Writer::getQueueFill() {
+        return rw.getFile().getQueueFill();
+    }
+
+    double Writer::getThroughput() {
+        return rw.getFile().getThroughput();
+    }
+
+    void Writer::addMarker(uint64_t sample, uint64_t length, std::string label) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!rw.isOpen()) { return; }
+
+        // Cue points can only address the first 4G samples
+        if (sample > UINT32_MAX) { return; }
+        markers.push_back({ sample, std::min<uint64_t>(length, UINT32_MAX), label });
+    }
+
+    void Writer::writeMarkers() {
+        if (markers.empty()) { return; }
+
+        // Cue points giving the position of each marker
+        uint32_t count = markers.size();
+        rw.beginChunk(CUE_MARKER);
+        rw.write((uint8_t*)&count, sizeof(uint32_t));
+        for (int i = 0; i < markers.size(); i++) {
+            CuePoint cp;
+            cp.id = i + 1;
+            cp.position = markers[i].sample;
+            memcpy(cp.chunk, DATA_MARKER, 4);
+            cp.chunkStart = 0;
+            cp.blockStart = 0;
+            cp.sampleOffset = markers[i].sample;
+            rw.write((uint8_t*)&cp, sizeof(CuePoint));
+        }
+        rw.endChunk();
+
+        // Label and length of each marker
+        rw.beginList(ADTL_LIST_TYPE);
+        for (int i = 0; i < markers.size(); i++) {
+            uint32_t id = i + 1;
+            rw.beginChunk(LABEL_MARKER);
+            rw.write((uint8_t*)&id, sizeof(uint32_t));
+            rw.write((uint8_t*)markers[i].label.c_str(), markers[i].label.size() + 1);
+            rw.endChunk();
+
+            LabelledText lt;
+            lt.id = id;
+            lt.sampleLength = markers[i].length;
+            memcpy(lt.purpose, REGION_PURPOSE, 4);
+            lt.country = 0;
+            lt.language = 0;
+            lt.dialect = 0;
+            lt.codePage = 0;
+            rw.beginChunk(LABELLED_TEXT_MARKER);
+            rw.write((uint8_t*)&lt, sizeof(LabelledText));
+            rw.endChunk();
+        }
+        rw.endList();
+        markers.clear();
+    }
+
     void Writer::write(float* samples, int count) {
         std::lock_guard<std::recursive_mutex> lck(mtx);
         if (!rw.isOpen()) { return; }
@@ -159,30 +265,39 @@ namespace wav {
         // Select different writer function depending on the chose depth
         int tcount = count * _channels;
         int tbytes = count * bytesPerSamp;
+        bool written = false;
         switch (_type) {
         case SAMP_TYPE_UINT8:
             // Volk doesn't support unsigned ints yet :/
             for (int i = 0; i < tcount; i++) {
                 bufU8[i] = (samples[i] * 127.0f) + 128.0f;
             }
-            rw.write(bufU8, tbytes);
+            written = rw.write(bufU8, tbytes);
             break;
         case SAMP_TYPE_INT16:
             volk_32f_s32f_convert_16i(bufI16, samples, 32767.0f, tcount);
-            rw.write((uint8_t*)bufI16, tbytes);
+            written = rw.write((uint8_t*)bufI16, tbytes);
             break;
         case SAMP_TYPE_INT32:
             volk_32f_s32f_convert_32i(bufI32, samples, 2147483647.0f, tcount);
-            rw.write((uint8_t*)bufI32, tbytes);
+            written = rw.write((uint8_t*)bufI32, tbytes);
             break;
         case SAMP_TYPE_FLOAT32:
-            rw.write((uint8_t*)samples, tbytes);
+            written = rw.write((uint8_t*)samples, tbytes);
             break;
         default:
             break;
         }
 
-        // Increment sample counter
-        samplesWritten += count;
+        // Increment sample counter if the samples weren't dropped
+        if (written) { samplesWritten += count; }
+
+        // Periodically update the header so that the file stays readable if the recording is interrupted
+        samplesSinceUpdate += count;
+        if (samplesSinceUpdate >= _samplerate * HEADER_UPDATE_INTERVAL) {
+            rw.setSampleCount(samplesWritten);
+            rw.updateSizes();
+            samplesSinceUpdate = 0;
+        }
     }
 }
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <mutex>
 #include <functional>
+#include <vector>
 #include "riff.h"
 
 namespace wav {    
@@ -16,6 +17,25 @@ namespace wav {
         uint16_t bytesPerSample;
         uint16_t bitDepth;
     };
+
+    struct CuePoint {
+        uint32_t id;
+        uint32_t position;
+        char chunk[4];
+        uint32_t chunkStart;
+        uint32_t blockStart;
+        uint32_t sampleOffset;
+    };
+
+    struct LabelledText {
+        uint32_t id;
+        uint32_t sampleLength;
+        char purpose[4];
+        uint16_t country;
+        uint16_t language;
+        uint16_t dialect;
+        uint16_t codePage;
+    };
     #pragma pack(pop)
 
     enum Format {
@@ -49,12 +69,35 @@ namespace wav {
         void setSamplerate(uint64_t samplerate);
         void setFormat(Format format);
         void setSampleType(SampleType type);
+        void setBuffers(size_t size, int count);
+        void setOverflowPolicy(diskio::OverflowPolicy policy);
+        void setDirectIO(bool enabled);
+        void setPreallocation(uint64_t step);
 
         size_t getSamplesWritten() { return samplesWritten; }
+        uint64_t getSamplesDropped();
+        float getQueueFill();
+        double getThroughput();
+
+        /**
+         * Add a marker, written as a cue point with a labelled region when the file is closed.
+         * @param sample Index of the first sample of the region.
+         * @param length Length of the region in samples.
+         * @param label Label of the region.
+         */
+        void addMarker(uint64_t sample, uint64_t length, std::string label);
 
         void write(float* samples, int count);
 
     private:
+        struct Marker {
+            uint64_t sample;
+            uint64_t length;
+            std::string label;
+        };
+
+        void writeMarkers();
+
         std::recursive_mutex mtx;
         FormatHeader hdr;
         riff::Writer rw;
@@ -63,11 +106,13 @@ namespace wav {
         uint64_t _samplerate;
         Format _format;
         SampleType _type;
-        size_t bytesPerSamp;
+        size_t bytesPerSamp = 0;
 
         uint8_t* bufU8 = NULL;
         int16_t* bufI16 = NULL;
         int32_t* bufI32 = NULL;
         size_t samplesWritten = 0;
+        uint64_t samplesSinceUpdate = 0;
+        std::vector<Marker> markers;
     };
 }
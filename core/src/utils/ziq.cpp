@@ -0,0 +1,568 @@
+#include "ziq.h"
+#include <volk/volk.h>
+#include <zstd.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <utils/flog.h>
+
+namespace ziq {
+    const char FILE_MAGIC[4]        = { 'Z', 'I', 'Q', 'F' };
+    const char CHUNK_MAGIC[4]       = { 'Z', 'C', 'H', 'K' };
+    const char INDEX_MAGIC[4]       = { 'Z', 'I', 'D', 'X' };
+    const uint16_t VERSION          = 1;
+
+    namespace {
+        int typeSize(wav::SampleType type) {
+            switch (type) {
+            case wav::SAMP_TYPE_UINT8:  return 1;
+            case wav::SAMP_TYPE_INT16:  return 2;
+            default:                    return 4;
+            }
+        }
+
+        // Differences between consecutive samples of the same channel, integer types wrap around
+        template <class T>
+        void deltaEncode(uint8_t* data, int count, int channels) {
+            T* d = (T*)data;
+            for (int i = count - 1; i > 0; i--) {
+                for (int c = 0; c < channels; c++) { d[i * channels + c] -= d[(i - 1) * channels + c]; }
+            }
+        }
+
+        template <class T>
+        void deltaDecode(uint8_t* data, int count, int channels) {
+            T* d = (T*)data;
+            for (int i = 1; i < count; i++) {
+                for (int c = 0; c < channels; c++) { d[i * channels + c] += d[(i - 1) * channels + c]; }
+            }
+        }
+
+        void delta(uint8_t* data, int count, int channels, int size, bool encode) {
+            switch (size) {
+            case 1: encode ? deltaEncode<uint8_t>(data, count, channels) : deltaDecode<uint8_t>(data, count, channels); break;
+            case 2: encode ? deltaEncode<uint16_t>(data, count, channels) : deltaDecode<uint16_t>(data, count, channels); break;
+            default: encode ? deltaEncode<uint32_t>(data, count, channels) : deltaDecode<uint32_t>(data, count, channels); break;
+            }
+        }
+
+        // Group the n-th byte of every value together, the high bytes of slowly changing values compress very well
+        void shuffle(const uint8_t* in, uint8_t* out, size_t values, int size) {
+            for (int b = 0; b < size; b++) {
+                uint8_t* plane = &out[b * values];
+                for (size_t i = 0; i < values; i++) { plane[i] = in[i * size + b]; }
+            }
+        }
+
+        void unshuffle(const uint8_t* in, uint8_t* out, size_t values, int size) {
+            for (int b = 0; b < size; b++) {
+                const uint8_t* plane = &in[b * values];
+                for (size_t i = 0; i < values; i++) { out[i * size + b] = plane[i]; }
+            }
+        }
+    }
+
+    Writer::Writer(int channels, uint64_t samplerate, bool complex, wav::SampleType type) {
+        // Validate channels and samplerate
+        if (channels < 1) { throw std::runtime_error("Channel count must be greater or equal to 1"); }
+        if (!samplerate) { throw std::runtime_error("Samplerate must be non-zero"); }
+
+        _channels = channels;
+        _samplerate = samplerate;
+        _complex = complex;
+        _type = type;
+    }
+
+    Writer::~Writer() { close(); }
+
+    bool Writer::open(std::string path) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Close previous file
+        if (file.isOpen()) { close(); }
+
+        // Reset work values
+        bytesPerSamp = typeSize(_type) * _channels;
+        samplesWritten = 0;
+        samplesDropped = 0;
+        rawBytes = 0;
+        compressedBytes = 0;
+        encodeTime = 0.0;
+        nextSeq = 0;
+        nextWriteSeq = 0;
+        stopWorkers = false;
+        flushing = false;
+        index.clear();
+        openTime = std::chrono::steady_clock::now();
+
+        // Open file and write a header marking it as unfinished
+        if (!file.open(path)) { return false; }
+        FileHeader hdr;
+        memcpy(hdr.magic, FILE_MAGIC, 4);
+        hdr.version = VERSION;
+        hdr.sampleType = _type;
+        hdr.channels = _channels;
+        hdr.flags = (_complex ? FLAG_COMPLEX : 0) | ((_type != wav::SAMP_TYPE_FLOAT32) ? FLAG_DELTA : 0);
+        hdr.chunkSize = chunkSize;
+        hdr.samplerate = _samplerate;
+        hdr.sampleCount = 0;
+        hdr.indexOffset = 0;
+        file.write((uint8_t*)&hdr, sizeof(FileHeader));
+
+        // Allocate enough chunks for every thread to have one in progress and one waiting
+        int threads = _threads ? _threads : std::max<int>(std::thread::hardware_concurrency() / 2, 1);
+        threads = std::clamp<int>(threads, 1, ZIQ_MAX_THREADS);
+        slots.clear();
+        slots.resize(threads * 2 + 2);
+        freeSlots.clear();
+        for (auto& slot : slots) {
+            slot.raw.resize(chunkSize * bytesPerSamp);
+            slot.compressed.resize(sizeof(ChunkHeader) + ZSTD_compressBound(chunkSize * bytesPerSamp));
+            freeSlots.push_back(&slot);
+        }
+        current = NULL;
+
+        // Start the compression threads
+        for (int i = 0; i < threads; i++) {
+            workers.push_back(std::thread(&Writer::worker, this));
+        }
+
+        return true;
+    }
+
+    bool Writer::isOpen() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        return file.isOpen();
+    }
+
+    void Writer::close() {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do nothing if the file is not open
+        if (!file.isOpen()) { return; }
+
+        // Compress the last partial chunk and wait for all chunks to be written
+        if (current && current->count) { submit(); }
+        {
+            std::unique_lock<std::mutex> plck(poolMtx);
+            if (current) {
+                freeSlots.push_back(current);
+                current = NULL;
+            }
+            poolCnd.wait(plck, [=]() { return freeSlots.size() == slots.size(); });
+            stopWorkers = true;
+            poolCnd.notify_all();
+        }
+        for (auto& w : workers) { w.join(); }
+        workers.clear();
+
+        // Write the index and complete the header
+        uint64_t indexOffset = file.tell();
+        IndexHeader ihdr;
+        memcpy(ihdr.magic, INDEX_MAGIC, 4);
+        ihdr.count = index.size();
+        std::vector<uint8_t> indexData((uint8_t*)&ihdr, (uint8_t*)&ihdr + sizeof(IndexHeader));
+        indexData.insert(indexData.end(), (uint8_t*)index.data(), (uint8_t*)(index.data() + index.size()));
+        if (!file.write(indexData.data(), indexData.size())) { indexOffset = 0; }
+
+        FileHeader hdr;
+        memcpy(hdr.magic, FILE_MAGIC, 4);
+        hdr.version = VERSION;
+        hdr.sampleType = _type;
+        hdr.channels = _channels;
+        hdr.flags = (_complex ? FLAG_COMPLEX : 0) | ((_type != wav::SAMP_TYPE_FLOAT32) ? FLAG_DELTA : 0);
+        hdr.chunkSize = chunkSize;
+        hdr.samplerate = _samplerate;
+        hdr.sampleCount = samplesWritten;
+        hdr.indexOffset = indexOffset;
+        file.writeAt((uint8_t*)&hdr, sizeof(FileHeader), 0);
+        file.close();
+
+        slots.clear();
+        freeSlots.clear();
+    }
+
+    void Writer::setChannels(int channels) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+
+        // Validate channel count
+        if (channels < 1) { throw std::runtime_error("Channel count must be greater or equal to 1"); }
+        _channels = channels;
+    }
+
+    void Writer::setSamplerate(uint64_t samplerate) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+
+        // Validate samplerate
+        if (!samplerate) { throw std::runtime_error("Samplerate must be non-zero"); }
+        _samplerate = samplerate;
+    }
+
+    void Writer::setComplex(bool complex) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        _complex = complex;
+    }
+
+    void Writer::setSampleType(wav::SampleType type) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        _type = type;
+    }
+
+    void Writer::setBuffers(size_t size, int count) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        file.setBuffers(size, count);
+    }
+
+    void Writer::setOverflowPolicy(diskio::OverflowPolicy policy) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        overflowPolicy = policy;
+        file.setOverflowPolicy(policy);
+    }
+
+    void Writer::setDirectIO(bool enabled) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        file.setDirectIO(enabled);
+    }
+
+    void Writer::setPreallocation(uint64_t step) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        file.setPreallocation(step);
+    }
+
+    void Writer::setThreads(int threads) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        // Do not allow settings to change while open
+        if (file.isOpen()) { throw std::runtime_error("Cannot change parameters while file is open"); }
+        _threads = threads;
+    }
+
+    void Writer::setLevel(int level) {
+        _level = std::clamp<int>(level, ZSTD_minCLevel(), ZSTD_maxCLevel());
+    }
+
+    uint64_t Writer::getSamplesDropped() {
+        std::lock_guard<std::mutex> lck(poolMtx);
+        return samplesDropped;
+    }
+
+    float Writer::getQueueFill() {
+        // Either the compression or the disk can be the bottleneck
+        std::lock_guard<std::mutex> lck(poolMtx);
+        float poolFill = slots.empty() ? 0.0f : 1.0f - ((float)freeSlots.size() / (float)slots.size());
+        return std::max<float>(poolFill, file.getQueueFill());
+    }
+
+    double Writer::getThroughput() {
+        return file.getThroughput();
+    }
+
+    double Writer::getCompressionRatio() {
+        std::lock_guard<std::mutex> lck(poolMtx);
+        if (!compressedBytes) { return 1.0; }
+        return (double)rawBytes / (double)compressedBytes;
+    }
+
+    double Writer::getEncoderLoad() {
+        std::lock_guard<std::mutex> lck(poolMtx);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - openTime).count();
+        return (elapsed > 0.0) ? (encodeTime / elapsed) : 0.0;
+    }
+
+    void Writer::write(float* samples, int count) {
+        std::lock_guard<std::recursive_mutex> lck(mtx);
+        if (!file.isOpen()) { return; }
+
+        while (count > 0) {
+            // Get a chunk to fill, if none are free the samples are either dropped or we wait
+            if (!current && !acquireSlot()) {
+                std::lock_guard<std::mutex> plck(poolMtx);
+                samplesDropped += count;
+                return;
+            }
+
+            // Convert as many samples as fit in the chunk
+            int n = std::min<int>(count, chunkSize - current->count);
+            int tcount = n * _channels;
+            uint8_t* dst = &current->raw[current->count * bytesPerSamp];
+            switch (_type) {
+            case wav::SAMP_TYPE_UINT8:
+                for (int i = 0; i < tcount; i++) { dst[i] = (samples[i] * 127.0f) + 128.0f; }
+                break;
+            case wav::SAMP_TYPE_INT16:
+                volk_32f_s32f_convert_16i((int16_t*)dst, samples, 32767.0f, tcount);
+                break;
+            case wav::SAMP_TYPE_INT32:
+                volk_32f_s32f_convert_32i((int32_t*)dst, samples, 2147483647.0f, tcount);
+                break;
+            default:
+                memcpy(dst, samples, tcount * sizeof(float));
+                break;
+            }
+            current->count += n;
+            samples += tcount;
+            count -= n;
+
+            if (current->count == (int)chunkSize) { submit(); }
+        }
+    }
+
+    bool Writer::acquireSlot() {
+        std::unique_lock<std::mutex> lck(poolMtx);
+        if (freeSlots.empty()) {
+            if (overflowPolicy == diskio::OVERFLOW_DROP) { return false; }
+            poolCnd.wait(lck, [=]() { return !freeSlots.empty(); });
+        }
+        current = freeSlots.back();
+        freeSlots.pop_back();
+        current->count = 0;
+        return true;
+    }
+
+    void Writer::submit() {
+        std::lock_guard<std::mutex> lck(poolMtx);
+        current->seq = nextSeq++;
+        pending.push_back(current);
+        current = NULL;
+        poolCnd.notify_all();
+    }
+
+    void Writer::worker() {
+        ZSTD_CCtx* cctx = ZSTD_createCCtx();
+        std::vector<uint8_t> filtered;
+        while (true) {
+            // Wait for a chunk to compress
+            Slot* slot;
+            {
+                std::unique_lock<std::mutex> lck(poolMtx);
+                poolCnd.wait(lck, [=]() { return !pending.empty() || stopWorkers; });
+                if (pending.empty()) { break; }
+                slot = pending.front();
+                pending.pop_front();
+            }
+            auto start = std::chrono::steady_clock::now();
+
+            // Filter then compress after the space reserved for the chunk header
+            int size = typeSize(_type);
+            size_t len = slot->count * bytesPerSamp;
+            filtered.resize(len);
+            if (_type != wav::SAMP_TYPE_FLOAT32) { delta(slot->raw.data(), slot->count, _channels, size, true); }
+            shuffle(slot->raw.data(), filtered.data(), len / size, size);
+            size_t clen = ZSTD_compressCCtx(cctx, &slot->compressed[sizeof(ChunkHeader)], slot->compressed.size() - sizeof(ChunkHeader), filtered.data(), len, _level);
+
+            // Chunks that fail to compress are counted as dropped when flushed
+            ChunkHeader* chdr = (ChunkHeader*)slot->compressed.data();
+            memcpy(chdr->magic, CHUNK_MAGIC, 4);
+            chdr->compressedSize = ZSTD_isError(clen) ? 0 : clen;
+            chdr->sampleCount = slot->count;
+            chdr->reserved = 0;
+
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            {
+                std::lock_guard<std::mutex> lck(poolMtx);
+                completed[slot->seq] = slot;
+                encodeTime += elapsed;
+            }
+            flushCompleted();
+        }
+        ZSTD_freeCCtx(cctx);
+    }
+
+    void Writer::flushCompleted() {
+        // Only one thread writes at a time so that chunks stay in order
+        std::unique_lock<std::mutex> lck(poolMtx);
+        if (flushing) { return; }
+        flushing = true;
+        while (true) {
+            auto it = completed.find(nextWriteSeq);
+            if (it == completed.end()) { break; }
+            Slot* slot = it->second;
+            completed.erase(it);
+            nextWriteSeq++;
+            lck.unlock();
+
+            // Chunk positions are only known once written, since previous chunks could have been dropped
+            ChunkHeader* chdr = (ChunkHeader*)slot->compressed.data();
+            chdr->firstSample = samplesWritten;
+            uint64_t offset = file.tell();
+            bool written = chdr->compressedSize && file.write(slot->compressed.data(), sizeof(ChunkHeader) + chdr->compressedSize);
+
+            lck.lock();
+            if (written) {
+                index.push_back({ offset, samplesWritten });
+                samplesWritten += slot->count;
+                rawBytes += slot->count * bytesPerSamp;
+                compressedBytes += sizeof(ChunkHeader) + chdr->compressedSize;
+            }
+            else {
+                samplesDropped += slot->count;
+            }
+            freeSlots.push_back(slot);
+            poolCnd.notify_all();
+        }
+        flushing = false;
+    }
+
+    Reader::Reader(std::string path) {
+        file.open(path, std::ios::in | std::ios::binary);
+        if (!file.is_open()) { throw std::runtime_error("Could not open file"); }
+        file.seekg(0, std::ios::end);
+        fileSize = file.tellg();
+        file.seekg(0);
+
+        // Validate the header
+        if (fileSize < sizeof(FileHeader)) { throw std::runtime_error("File is too small"); }
+        file.read((char*)&hdr, sizeof(FileHeader));
+        if (memcmp(hdr.magic, FILE_MAGIC, 4)) { throw std::runtime_error("Not a ZIQ file"); }
+        if (hdr.version != VERSION) { throw std::runtime_error("Unsupported ZIQ version"); }
+        if (hdr.sampleType > wav::SAMP_TYPE_FLOAT32) { throw std::runtime_error("Unsupported sample type"); }
+        if (!hdr.channels) { throw std::runtime_error("Invalid channel count"); }
+        if (!hdr.samplerate) { throw std::runtime_error("Sample rate may not be zero"); }
+        if (!hdr.chunkSize || hdr.chunkSize > ZIQ_MAX_CHUNK_SIZE) { throw std::runtime_error("Invalid chunk size"); }
+        bytesPerSamp = typeSize((wav::SampleType)hdr.sampleType) * hdr.channels;
+
+        // Use the index if the file was closed properly and it is consistent, otherwise find the chunks
+        if (!readIndex()) { scanChunks(); }
+    }
+
+    void Reader::seek(uint64_t sample) {
+        position = std::min<uint64_t>(sample, sampleCount);
+    }
+
+    int Reader::read(float* out, int count) {
+        int done = 0;
+        while (done < count && position < sampleCount) {
+            // Find and load the chunk containing the position
+            auto it = std::upper_bound(index.begin(), index.end(), position, [](uint64_t pos, const IndexEntry& e) { return pos < e.firstSample; });
+            int id = std::distance(index.begin(), it) - 1;
+            if (!loadChunk(id)) { return -1; }
+
+            // Copy as many samples as possible from it
+            uint64_t offset = position - index[id].firstSample;
+            uint64_t available = samples.size() / hdr.channels - offset;
+            if (!available) { break; }
+            int n = std::min<uint64_t>(count - done, available);
+            memcpy(&out[done * hdr.channels], &samples[offset * hdr.channels], n * hdr.channels * sizeof(float));
+            done += n;
+            position += n;
+        }
+        return done;
+    }
+
+    bool Reader::readIndex() {
+        if (!hdr.indexOffset || hdr.indexOffset + sizeof(IndexHeader) > fileSize) { return false; }
+        IndexHeader ihdr;
+        file.seekg(hdr.indexOffset);
+        file.read((char*)&ihdr, sizeof(IndexHeader));
+        if (memcmp(ihdr.magic, INDEX_MAGIC, 4)) { return false; }
+        if (hdr.indexOffset + sizeof(IndexHeader) + (uint64_t)ihdr.count * sizeof(IndexEntry) > fileSize) { return false; }
+        index.resize(ihdr.count);
+        file.read((char*)index.data(), ihdr.count * sizeof(IndexEntry));
+        if (!file.good()) { return false; }
+        sampleCount = hdr.sampleCount;
+
+        // The entries must point to chunk headers inside the file, in order and covering the samples from the first one
+        if (index.empty()) { return !sampleCount; }
+        if (index[0].firstSample) { return false; }
+        for (size_t i = 0; i < index.size(); i++) {
+            if (index[i].offset < sizeof(FileHeader) || index[i].offset + sizeof(ChunkHeader) > fileSize) { return false; }
+            if (i && (index[i].offset <= index[i - 1].offset || index[i].firstSample <= index[i - 1].firstSample)) { return false; }
+        }
+        return index.back().firstSample < sampleCount;
+    }
+
+    void Reader::scanChunks() {
+        index.clear();
+        file.clear();
+        sampleCount = 0;
+        uint64_t offset = sizeof(FileHeader);
+        while (offset + sizeof(ChunkHeader) <= fileSize) {
+            ChunkHeader chdr;
+            file.seekg(offset);
+            file.read((char*)&chdr, sizeof(ChunkHeader));
+            if (!file.good() || memcmp(chdr.magic, CHUNK_MAGIC, 4)) { break; }
+
+            // The last chunk may have been cut short
+            uint64_t end = offset + sizeof(ChunkHeader) + chdr.compressedSize;
+            if (end > fileSize || !chdr.sampleCount || chdr.sampleCount > hdr.chunkSize) { break; }
+
+            index.push_back({ offset, sampleCount });
+            sampleCount += chdr.sampleCount;
+            offset = end;
+        }
+        file.clear();
+    }
+
+    bool Reader::loadChunk(int id) {
+        if (id == loadedChunk) { return true; }
+        loadedChunk = -1;
+        samples.clear();
+
+        // Read the header, it must hold the number of samples the index expects
+        ChunkHeader chdr;
+        file.clear();
+        file.seekg(index[id].offset);
+        file.read((char*)&chdr, sizeof(ChunkHeader));
+        if (!file.good() || memcmp(chdr.magic, CHUNK_MAGIC, 4)) {
+            flog::error("Invalid ZIQ chunk at offset {0}", index[id].offset);
+            return false;
+        }
+        uint64_t expected = ((id + 1 < (int)index.size()) ? index[id + 1].firstSample : sampleCount) - index[id].firstSample;
+        if (chdr.sampleCount != expected || chdr.sampleCount > hdr.chunkSize || index[id].offset + sizeof(ChunkHeader) + chdr.compressedSize > fileSize) {
+            flog::error("Inconsistent ZIQ chunk at offset {0}", index[id].offset);
+            return false;
+        }
+
+        // Read the compressed data
+        compressed.resize(chdr.compressedSize);
+        file.read((char*)compressed.data(), chdr.compressedSize);
+        if (!file.good()) {
+            flog::error("Could not read ZIQ chunk at offset {0}", index[id].offset);
+            return false;
+        }
+
+        // Decompress and undo the filters
+        size_t len = (size_t)chdr.sampleCount * bytesPerSamp;
+        std::vector<uint8_t> filtered(len);
+        if (ZSTD_decompress(filtered.data(), len, compressed.data(), compressed.size()) != len) {
+            flog::error("Could not decompress ZIQ chunk at offset {0}", index[id].offset);
+            return false;
+        }
+        int size = typeSize((wav::SampleType)hdr.sampleType);
+        raw.resize(len);
+        unshuffle(filtered.data(), raw.data(), len / size, size);
+        if (hdr.flags & FLAG_DELTA) { delta(raw.data(), chdr.sampleCount, hdr.channels, size, false); }
+
+        // Convert to float
+        size_t values = (size_t)chdr.sampleCount * hdr.channels;
+        samples.resize(values);
+        switch (hdr.sampleType) {
+        case wav::SAMP_TYPE_UINT8:
+            for (size_t i = 0; i < values; i++) { samples[i] = ((float)raw[i] - 128.0f) / 127.0f; }
+            break;
+        case wav::SAMP_TYPE_INT16:
+            for (size_t i = 0; i < values; i++) { samples[i] = (float)((int16_t*)raw.data())[i] / 32767.0f; }
+            break;
+        case wav::SAMP_TYPE_INT32:
+            for (size_t i = 0; i < values; i++) { samples[i] = (float)((int32_t*)raw.data())[i] / 2147483647.0f; }
+            break;
+        default:
+            memcpy(samples.data(), raw.data(), values * sizeof(float));
+            break;
+        }
+        loadedChunk = id;
+        return true;
+    }
+}
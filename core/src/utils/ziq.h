@@ -0,0 +1,229 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <stdint.h>
+#include "disk_writer.h"
+#include "wav.h"
+
+#define ZIQ_DEFAULT_CHUNK_SIZE      (256 * 1024)
+#define ZIQ_DEFAULT_LEVEL           1
+#define ZIQ_MAX_THREADS             16
+#define ZIQ_MAX_CHUNK_SIZE          (16 * 1024 * 1024)
+
+/**
+ * Chunked, seekable compressed sample container (.ziq).
+ * The file starts with a FileHeader, followed by independently compressed chunks each preceded by a ChunkHeader,
+ * and ends with an index of the chunks. Samples are stored as the chosen sample type, integer types are delta coded
+ * per channel, then the bytes of each sample are split into planes before compressing with zstd.
+ * The header is only completed on close, readers recover unclosed files by walking the chunk headers.
+ */
+namespace ziq {
+    #pragma pack(push, 1)
+    struct FileHeader {
+        char magic[4];
+        uint16_t version;
+        uint8_t sampleType;
+        uint8_t channels;
+        uint32_t flags;
+        uint32_t chunkSize;
+        uint64_t samplerate;
+        uint64_t sampleCount;
+        uint64_t indexOffset;
+    };
+
+    struct ChunkHeader {
+        char magic[4];
+        uint32_t compressedSize;
+        uint32_t sampleCount;
+        uint32_t reserved;
+        uint64_t firstSample;
+    };
+
+    struct IndexHeader {
+        char magic[4];
+        uint32_t count;
+    };
+
+    struct IndexEntry {
+        uint64_t offset;
+        uint64_t firstSample;
+    };
+    #pragma pack(pop)
+
+    enum Flags {
+        FLAG_COMPLEX    = (1 << 0),
+        FLAG_DELTA      = (1 << 1)
+    };
+
+    /**
+     * Writer compressing chunks on a pool of worker threads, write() never waits for compression.
+     * Compressed chunks are written to disk in order through a diskio::Writer.
+     */
+    class Writer {
+    public:
+        Writer(int channels = 2, uint64_t samplerate = 48000, bool complex = true, wav::SampleType type = wav::SAMP_TYPE_INT16);
+        ~Writer();
+
+        /**
+         * Create a file.
+         * @param path Path of the file.
+         * @return True on success, false otherwise.
+         */
+        bool open(std::string path);
+        bool isOpen();
+
+        /**
+         * Compress the remaining samples, write the index and close the file.
+         */
+        void close();
+
+        void setChannels(int channels);
+        void setSamplerate(uint64_t samplerate);
+        void setComplex(bool complex);
+        void setSampleType(wav::SampleType type);
+        void setBuffers(size_t size, int count);
+        void setOverflowPolicy(diskio::OverflowPolicy policy);
+        void setDirectIO(bool enabled);
+        void setPreallocation(uint64_t step);
+
+        /**
+         * Set the number of compression threads. Cannot be changed while open.
+         * @param threads Number of threads, 0 to use half of the available cores.
+         */
+        void setThreads(int threads);
+
+        /**
+         * Set the zstd compression level.
+         * @param level Compression level, higher is smaller but slower.
+         */
+        void setLevel(int level);
+
+        size_t getSamplesWritten() { return samplesWritten; }
+        uint64_t getSamplesDropped();
+        float getQueueFill();
+        double getThroughput();
+
+        /**
+         * Get the ratio between the size of the samples and the size of the compressed chunks.
+         * @return Compression ratio, 1.0 if nothing was compressed yet.
+         */
+        double getCompressionRatio();
+
+        /**
+         * Get the total time spent compressing relative to the time the file has been open.
+         * @return Load as a fraction of one CPU core, can exceed 1 with multiple threads.
+         */
+        double getEncoderLoad();
+
+        void write(float* samples, int count);
+
+    private:
+        struct Slot {
+            std::vector<uint8_t> raw;
+            std::vector<uint8_t> compressed;
+            int count = 0;
+            uint64_t seq = 0;
+        };
+
+        bool acquireSlot();
+        void submit();
+        void worker();
+        void flushCompleted();
+
+        std::recursive_mutex mtx;
+        diskio::Writer file;
+
+        int _channels;
+        uint64_t _samplerate;
+        bool _complex;
+        wav::SampleType _type;
+        int _threads = 0;
+        std::atomic<int> _level = ZIQ_DEFAULT_LEVEL;
+        diskio::OverflowPolicy overflowPolicy = diskio::OVERFLOW_BLOCK;
+        size_t bytesPerSamp = 0;
+        uint32_t chunkSize = ZIQ_DEFAULT_CHUNK_SIZE;
+
+        // Chunk pool
+        std::vector<Slot> slots;
+        std::vector<Slot*> freeSlots;
+        std::deque<Slot*> pending;
+        std::map<uint64_t, Slot*> completed;
+        std::mutex poolMtx;
+        std::condition_variable poolCnd;
+        std::vector<std::thread> workers;
+        bool stopWorkers = false;
+        bool flushing = false;
+        uint64_t nextSeq = 0;
+        uint64_t nextWriteSeq = 0;
+        Slot* current = NULL;
+
+        // Index of the chunks written to the file
+        std::vector<IndexEntry> index;
+
+        size_t samplesWritten = 0;
+        uint64_t samplesDropped = 0;
+        uint64_t rawBytes = 0;
+        uint64_t compressedBytes = 0;
+        double encodeTime = 0.0;
+        std::chrono::steady_clock::time_point openTime;
+    };
+
+    /**
+     * Reader for .ziq files, seeking only decompresses the chunk containing the target sample.
+     */
+    class Reader {
+    public:
+        /**
+         * Open a file. Throws on error.
+         * @param path Path of the file.
+         */
+        Reader(std::string path);
+
+        int getChannels() { return hdr.channels; }
+        bool isComplex() { return hdr.flags & FLAG_COMPLEX; }
+        wav::SampleType getSampleType() { return (wav::SampleType)hdr.sampleType; }
+        uint64_t getSampleRate() { return hdr.samplerate; }
+        uint64_t getSampleCount() { return sampleCount; }
+        uint64_t getPosition() { return position; }
+
+        /**
+         * Move the read position.
+         * @param sample Index of the next sample to read, clamped to the number of samples.
+         */
+        void seek(uint64_t sample);
+
+        /**
+         * Read samples at the read position and advance it.
+         * @param out Interleaved output samples, channel count floats per sample.
+         * @param count Maximum number of samples to read.
+         * @return Number of samples read, 0 at the end of the file, -1 if a chunk is corrupt.
+         */
+        int read(float* out, int count);
+
+    private:
+        bool readIndex();
+        void scanChunks();
+        bool loadChunk(int id);
+
+        std::ifstream file;
+        uint64_t fileSize = 0;
+        FileHeader hdr;
+        std::vector<IndexEntry> index;
+        uint64_t sampleCount = 0;
+        uint64_t position = 0;
+        size_t bytesPerSamp = 0;
+
+        int loadedChunk = -1;
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> raw;
+        std::vector<float> samples;
+    };
+}
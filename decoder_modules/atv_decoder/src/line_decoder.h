@@ -0,0 +1,325 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <dsp/simd.h>
+#include <gui/widgets/image.h>
+
+// Line oriented decoder of a demodulated PAL signal. The samples are split into sync pulses and lines,
+// each line is then resampled to the image width and converted to pixels in one go.
+
+namespace atv {
+    namespace generic {
+        // Index of the first sample at or after `start` that is below the level (or not below it when `below` is false)
+        inline int findLevel(const float* in, int start, int count, float level, bool below) {
+            for (int i = start; i < count; i++) {
+                if ((in[i] < level) == below) { return i; }
+            }
+            return count;
+        }
+
+        inline void toPixels(const float* in, uint32_t* out, int count, float offset, float scale) {
+            for (int i = 0; i < count; i++) {
+                uint32_t val = (uint32_t)std::clamp<float>((in[i] - offset) * scale, 0.0f, 255.0f);
+                out[i] = (val * 0x010101) | 0xFF000000;
+            }
+        }
+    }
+
+#if defined(DSP_SIMD_X86)
+    // SIMD kernels return the number of samples they handled, the generic kernels do the rest
+    namespace sse {
+        inline int findLevel(const float* in, int start, int count, float level, bool below, int& found) {
+            const __m128 lvl = _mm_set1_ps(level);
+            const int none = below ? 0 : 0xF;
+            int i = start;
+            for (; i + 4 <= count; i += 4) {
+                int mask = _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(&in[i]), lvl));
+                if (mask != none) {
+                    found = generic::findLevel(in, i, i + 4, level, below);
+                    return i;
+                }
+            }
+            found = -1;
+            return i;
+        }
+
+        inline int toPixels(const float* in, uint32_t* out, int count, float offset, float scale) {
+            const __m128 off = _mm_set1_ps(offset);
+            const __m128 scl = _mm_set1_ps(scale);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 max = _mm_set1_ps(255.0f);
+            const __m128i alpha = _mm_set1_epi32(0xFF000000);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 v = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&in[i]), off), scl);
+                __m128i g = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(v, zero), max));
+                // Gray to RGBA by copying the value to the three color bytes
+                __m128i px = _mm_or_si128(_mm_or_si128(g, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(g, 16), alpha));
+                _mm_storeu_si128((__m128i*)&out[i], px);
+            }
+            return i;
+        }
+    }
+
+    namespace avx2 {
+        DSP_TARGET("avx2")
+        inline int toPixels(const float* in, uint32_t* out, int count, float offset, float scale) {
+            const __m256 off = _mm256_set1_ps(offset);
+            const __m256 scl = _mm256_set1_ps(scale);
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 max = _mm256_set1_ps(255.0f);
+            const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 v = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&in[i]), off), scl);
+                __m256i g = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(v, zero), max));
+                __m256i px = _mm256_or_si256(_mm256_or_si256(g, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(g, 16), alpha));
+                _mm256_storeu_si256((__m256i*)&out[i], px);
+            }
+            return i;
+        }
+    }
+#endif
+
+#if defined(DSP_SIMD_NEON)
+    namespace neon {
+        inline int findLevel(const float* in, int start, int count, float level, bool below, int& found) {
+            const float32x4_t lvl = vdupq_n_f32(level);
+            int i = start;
+            for (; i + 4 <= count; i += 4) {
+                uint32x4_t lt = vcltq_f32(vld1q_f32(&in[i]), lvl);
+                bool hit = below ? (vmaxvq_u32(lt) != 0) : (vminvq_u32(lt) == 0);
+                if (hit) {
+                    found = generic::findLevel(in, i, i + 4, level, below);
+                    return i;
+                }
+            }
+            found = -1;
+            return i;
+        }
+
+        inline int toPixels(const float* in, uint32_t* out, int count, float offset, float scale) {
+            const float32x4_t off = vdupq_n_f32(offset);
+            const float32x4_t zero = vdupq_n_f32(0.0f);
+            const float32x4_t max = vdupq_n_f32(255.0f);
+            const uint32x4_t alpha = vdupq_n_u32(0xFF000000);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                float32x4_t v = vmulq_n_f32(vsubq_f32(vld1q_f32(&in[i]), off), scale);
+                uint32x4_t g = vcvtq_u32_f32(vminq_f32(vmaxq_f32(v, zero), max));
+                uint32x4_t px = vorrq_u32(vorrq_u32(g, vshlq_n_u32(g, 8)), vorrq_u32(vshlq_n_u32(g, 16), alpha));
+                vst1q_u32(&out[i], px);
+            }
+            return i;
+        }
+    }
+#endif
+
+    /**
+     * Find the next sample crossing the sync level.
+     * @param in Input samples.
+     * @param start Index to start searching from.
+     * @param count Number of samples.
+     * @param level Sync level.
+     * @param below True to find the next sample below the level, false for the next one at or above it.
+     * @return Index of the sample, count if there is none.
+     */
+    inline int findLevel(const float* in, int start, int count, float level, bool below) {
+#if defined(DSP_SIMD_X86) || defined(DSP_SIMD_NEON)
+        int found;
+#if defined(DSP_SIMD_X86)
+        start = sse::findLevel(in, start, count, level, below, found);
+#else
+        start = neon::findLevel(in, start, count, level, below, found);
+#endif
+        if (found >= 0) { return found; }
+#endif
+        return generic::findLevel(in, start, count, level, below);
+    }
+
+    /**
+     * Convert video levels to gray RGBA pixels.
+     * @param in Video samples.
+     * @param out RGBA pixels.
+     * @param count Number of pixels.
+     * @param offset Level of black.
+     * @param scale Gain from video level to pixel value (255 / span).
+     */
+    inline void toPixels(const float* in, uint32_t* out, int count, float offset, float scale) {
+        int done = 0;
+#if defined(DSP_SIMD_X86)
+        done = dsp::simd::hasAVX2() ? avx2::toPixels(in, out, count, offset, scale) : sse::toPixels(in, out, count, offset, scale);
+#elif defined(DSP_SIMD_NEON)
+        done = neon::toPixels(in, out, count, offset, scale);
+#endif
+        generic::toPixels(&in[done], &out[done], count - done, offset, scale);
+    }
+
+    class LineDecoder {
+    public:
+        /**
+         * Create a decoder.
+         * @param img Image the frames are drawn to, swapped every frame.
+         * @param width Width of the image in pixels.
+         * @param height Height of the image in lines.
+         * @param samplesPerLine Number of samples in a line, including the blanking.
+         */
+        LineDecoder(ImGui::ImageDisplay* img, int width, int height, int samplesPerLine) {
+            _img = img;
+            _width = width;
+            _height = height;
+            _samplesPerLine = samplesPerLine;
+
+            // Pulse lengths, relative to the 64us line: broad pulses are over 27us, line sync over 2.9us and equalizing pulses over 1.3us
+            broadLen = (samplesPerLine * 300) / 720;
+            hsyncLen = (samplesPerLine * 33) / 720;
+            eqLen = (samplesPerLine * 15) / 720;
+
+            // Without a line sync (eg. in the vertical blanking), lines are cut at a fixed length
+            maxLineLen = samplesPerLine + samplesPerLine / 8;
+            lineBuf = new float[maxLineLen];
+            pixelBuf = new float[_width];
+        }
+
+        ~LineDecoder() {
+            delete[] lineBuf;
+            delete[] pixelBuf;
+        }
+
+        void process(const float* in, int count) {
+            int i = 0;
+            while (i < count) {
+                if (inSync) {
+                    // Measure the length of the sync pulse
+                    int end = findLevel(in, i, count, syncLevel, false);
+                    syncCount += end - i;
+                    i = end;
+                    if (i < count) {
+                        inSync = false;
+                        syncPulse();
+                    }
+                }
+                else {
+                    // Everything up to the next sync pulse is video
+                    int start = findLevel(in, i, count, syncLevel, true);
+                    appendVideo(&in[i], start - i);
+                    i = start;
+                    if (i < count) {
+                        inSync = true;
+                        syncCount = 0;
+                    }
+                }
+            }
+        }
+
+        float syncLevel = -0.3f;
+        float minLvl = 0.0f;
+        float spanLvl = 1.0f;
+
+    private:
+        void syncPulse() {
+            // The sync samples are part of the line, like the rest of the blanking
+            appendSync(syncCount);
+
+            if (syncCount >= broadLen) {
+                shortSync = 0;
+            }
+            else if (syncCount >= hsyncLen) {
+                if (shortSync == 5) {
+                    evenField = false;
+                    ypos = 0;
+                    _img->swap();
+                }
+                else if (shortSync == 4) {
+                    evenField = true;
+                    ypos = 0;
+                }
+                shortSync = 0;
+
+                // The line starts after the sync, a line cut short by it is only kept if most of it is there
+                if (lineLen >= _samplesPerLine / 2) { emitLine(lineLen); }
+                lineLen = 0;
+            }
+            else if (syncCount >= eqLen) {
+                shortSync++;
+            }
+        }
+
+        void appendVideo(const float* in, int count) {
+            while (count > 0) {
+                int n = std::min<int>(count, maxLineLen - lineLen);
+                memcpy(&lineBuf[lineLen], in, n * sizeof(float));
+                lineLen += n;
+                in += n;
+                count -= n;
+                if (lineLen == maxLineLen) { freeRun(); }
+            }
+        }
+
+        void appendSync(int count) {
+            while (count > 0) {
+                int n = std::min<int>(count, maxLineLen - lineLen);
+                std::fill_n(&lineBuf[lineLen], n, syncLevel);
+                lineLen += n;
+                count -= n;
+                if (lineLen == maxLineLen) { freeRun(); }
+            }
+        }
+
+        // No line sync came in time, output a nominal line and keep the rest for the next one
+        void freeRun() {
+            emitLine(_samplesPerLine);
+            lineLen -= _samplesPerLine;
+            memmove(lineBuf, &lineBuf[_samplesPerLine], lineLen * sizeof(float));
+        }
+
+        void emitLine(int len) {
+            int row = evenField ? (ypos * 2) : (ypos * 2 + 1);
+            if (row < _height) {
+                // Resample the line to the width of the image
+                const float* src = lineBuf;
+                if (len != _width) {
+                    float step = (float)(len - 1) / (float)(_width - 1);
+                    for (int x = 0; x < _width; x++) {
+                        float pos = x * step;
+                        int id = (int)pos;
+                        int next = std::min<int>(id + 1, len - 1);
+                        float frac = pos - (float)id;
+                        pixelBuf[x] = lineBuf[id] + (lineBuf[next] - lineBuf[id]) * frac;
+                    }
+                    src = pixelBuf;
+                }
+                uint32_t* pixels = &((uint32_t*)_img->buffer)[row * _width];
+                toPixels(src, pixels, _width, minLvl, 255.0f / spanLvl);
+            }
+
+            ypos++;
+            if (ypos >= _height / 2) {
+                ypos = 0;
+                evenField = !evenField;
+                if (evenField) { _img->swap(); }
+            }
+        }
+
+        ImGui::ImageDisplay* _img;
+        int _width;
+        int _height;
+        int _samplesPerLine;
+
+        int broadLen;
+        int hsyncLen;
+        int eqLen;
+        int maxLineLen;
+
+        bool inSync = false;
+        int syncCount = 0;
+        int shortSync = 0;
+
+        float* lineBuf;
+        float* pixelBuf;
+        int lineLen = 0;
+        int ypos = 0;
+        bool evenField = false;
+    };
+}
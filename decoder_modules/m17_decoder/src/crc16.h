@@ -30,7 +30,14 @@ namespace mobilinkd {
         }
 
         void operator()(uint8_t byte) {
-            reg_ = crc(byte, reg_);
+            // All the feedback of a byte only depends on the top byte of the register
+            reg_ = (((reg_ << 8) | byte) & MASK) ^ table()[reg_ >> 8];
+        }
+
+        void operator()(const uint8_t* data, size_t len) {
+            for (size_t i = 0; i != len; ++i) {
+                (*this)(data[i]);
+            }
         }
 
         uint16_t crc(uint8_t byte, uint16_t reg) {
@@ -52,6 +59,18 @@ namespace mobilinkd {
             return reg;
         }
 
+        static const std::array<uint16_t, 256>& table() {
+            static const std::array<uint16_t, 256> tab = [] {
+                std::array<uint16_t, 256> t{};
+                CRC16 c;
+                for (size_t i = 0; i != 256; ++i) {
+                    t[i] = c.crc(0, uint16_t(i << 8));
+                }
+                return t;
+            }();
+            return tab;
+        }
+
         std::array<uint8_t, 2> get_bytes() {
             auto crc = get();
             std::array<uint8_t, 2> result{ uint8_t((crc >> 8) & 0xFF), uint8_t(crc & 0xFF) };
@@ -17,78 +17,15 @@ namespace mobilinkd {
 
         int popcount(uint32_t n) {
             int count = 0;
-            for (int i = 0; i < 32; i++) {
-                count += ((n >> i) & 1);
+            for (; n; count++) {
+                n &= n - 1;
             }
             return count;
         }
 
-        namespace detail {
-
-            // Need a constexpr sort.
-            // https://stackoverflow.com/a/40030044/854133
-            template <class T>
-            void swap(T& l, T& r) {
-                T tmp = std::move(l);
-                l = std::move(r);
-                r = std::move(tmp);
-            }
-
-            template <typename T, size_t N>
-            struct array {
-                constexpr T& operator[](size_t i) {
-                    return arr[i];
-                }
-
-                constexpr const T& operator[](size_t i) const {
-                    return arr[i];
-                }
-
-                constexpr const T* begin() const {
-                    return arr;
-                }
-                constexpr const T* end() const {
-                    return arr + N;
-                }
-
-                T arr[N];
-            };
-
-            template <typename T, size_t N>
-            void sort_impl(array<T, N>& array, size_t left, size_t right) {
-                if (left < right) {
-                    size_t m = left;
-
-                    for (size_t i = left + 1; i < right; i++)
-                        if (array[i] < array[left])
-                            swap(array[++m], array[i]);
-
-                    swap(array[left], array[m]);
-
-                    sort_impl(array, left, m);
-                    sort_impl(array, m + 1, right);
-                }
-            }
-
-            template <typename T, size_t N>
-            array<T, N> sort(array<T, N> array) {
-                auto sorted = array;
-                sort_impl(sorted, 0, N);
-                return sorted;
-            }
-
-        } // detail
-
         // static constexpr uint16_t POLY = 0xAE3;
         constexpr uint16_t POLY = 0xC75;
 
-#pragma pack(push, 1)
-        struct SyndromeMapEntry {
-            uint32_t a{ 0 };
-            uint16_t b{ 0 };
-        };
-#pragma pack(pop)
-
         /**
  * Calculate the syndrome of a [23,12] Golay codeword.
  *
@@ -108,55 +45,51 @@ namespace mobilinkd {
             return popcount(codeword) & 1;
         }
 
-        SyndromeMapEntry makeSyndromeMapEntry(uint64_t val) {
-            return SyndromeMapEntry{ uint32_t(val >> 16), uint16_t(val & 0xFFFF) };
-        }
-
-        uint64_t makeSME(uint64_t syndrome, uint32_t bits) {
-            return (syndrome << 24) | (bits & 0xFFFFFF);
-        }
-
         constexpr size_t LUT_SIZE = 2048;
 
-        std::array<SyndromeMapEntry, LUT_SIZE> make_lut() {
+        struct DecodeTables {
+            // Syndrome of the low and high 12 bits of a codeword, the syndrome is linear so they can be XORed together
+            uint16_t syndromeLow[4096];
+            uint16_t syndromeHigh[4096];
+            // Error pattern of each syndrome, the code is perfect so every syndrome maps to at most 3 errors
+            uint32_t correction[LUT_SIZE];
+        };
+
+        DecodeTables make_tables() {
             constexpr size_t VECLEN = 23;
-            detail::array<uint64_t, LUT_SIZE> result{};
+            DecodeTables tables;
 
-            size_t index = 0;
-            result[index++] = makeSME(syndrome(0), 0);
+            for (uint32_t i = 0; i != 4096; ++i) {
+                tables.syndromeLow[i] = syndrome(i) >> 12;
+                tables.syndromeHigh[i] = syndrome(i << 12) >> 12;
+            }
 
+            tables.correction[0] = 0;
             for (size_t i = 0; i != VECLEN; ++i) {
-                auto v = (1 << i);
-                result[index++] = makeSME(syndrome(v), v);
+                uint32_t v = (1 << i);
+                tables.correction[syndrome(v) >> 12] = v;
             }
 
             for (size_t i = 0; i != VECLEN - 1; ++i) {
                 for (size_t j = i + 1; j != VECLEN; ++j) {
-                    auto v = (1 << i) | (1 << j);
-                    result[index++] = makeSME(syndrome(v), v);
+                    uint32_t v = (1 << i) | (1 << j);
+                    tables.correction[syndrome(v) >> 12] = v;
                 }
             }
 
             for (size_t i = 0; i != VECLEN - 2; ++i) {
                 for (size_t j = i + 1; j != VECLEN - 1; ++j) {
                     for (size_t k = j + 1; k != VECLEN; ++k) {
-                        auto v = (1 << i) | (1 << j) | (1 << k);
-                        result[index++] = makeSME(syndrome(v), v);
+                        uint32_t v = (1 << i) | (1 << j) | (1 << k);
+                        tables.correction[syndrome(v) >> 12] = v;
                     }
                 }
             }
 
-            result = detail::sort(result);
-
-            std::array<SyndromeMapEntry, LUT_SIZE> tmp;
-            for (size_t i = 0; i != LUT_SIZE; ++i) {
-                tmp[i] = makeSyndromeMapEntry(result[i]);
-            }
-
-            return tmp;
+            return tables;
         }
 
-        inline auto LUT = make_lut();
+        inline const DecodeTables TABLES = make_tables();
 
         /**
  * Calculate [23,12] Golay codeword.
@@ -180,22 +113,13 @@ namespace mobilinkd {
         }
 
         bool decode(uint32_t input, uint32_t& output) {
-            auto syndrm = syndrome(input >> 1);
-            auto it = std::lower_bound(LUT.begin(), LUT.end(), syndrm,
-                                       [](const SyndromeMapEntry& sme, uint32_t val) {
-                                           return (sme.a >> 8) < val;
-                                       });
-
-            if ((it->a >> 8) == syndrm) {
-                // Build the correction from the compressed entry.
-                auto correction = ((((it->a & 0xFF) << 16) | it->b) << 1);
-                // Apply the correction to the input.
-                output = input ^ correction;
-                // Only test parity for 3-bit errors.
-                return popcount(syndrm) < 3 || !parity(output);
-            }
+            uint32_t codeword = (input >> 1) & 0xffffff;
+            uint32_t syndrm = TABLES.syndromeLow[codeword & 0xfff] ^ TABLES.syndromeHigh[codeword >> 12];
 
-            return false;
+            // Apply the correction to the input.
+            output = input ^ (TABLES.correction[syndrm] << 1);
+            // Only test parity for 3-bit errors.
+            return popcount(syndrm) < 3 || !parity(output);
         }
 
     } // Golay24
@@ -37,9 +37,7 @@ M17LSF M17DecodeLSF(uint8_t* _lsf) {
     // Check CRC
     mobilinkd::CRC16 crc16;
     crc16.reset();
-    for (int i = 0; i < 28; i++) {
-        crc16(_lsf[i]);
-    }
+    crc16(_lsf, 28);
     if (crc16.get() != lsf.rawCRC) {
         lsf.valid = false;
         return lsf;
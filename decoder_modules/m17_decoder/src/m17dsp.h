@@ -4,15 +4,12 @@
 #include <dsp/sink/null_sink.h>
 #include <dsp/demod/gfsk.h>
 #include <dsp/routing/doubler.h>
+#include <dsp/fec/viterbi.h>
 #include <volk/volk.h>
 #include <codec2.h>
 #include <golay24.h>
 #include <lsf_decode.h>
 
-extern "C" {
-#include <correct.h>
-}
-
 #define M17_DEVIATION     2400.0f
 #define M17_BAUDRATE      4800.0f
 #define M17_RRC_ALPHA     0.5f
@@ -26,6 +23,7 @@ extern "C" {
 #define M17_ENCODED_LSF_SIZE     488
 #define M17_RAW_FRAME_SIZE       384
 #define M17_CUT_FRAME_SIZE       368
+#define M17_CONV_TAIL_SIZE       4
 
 #define M17_MAX_FN          0x7FFF
 #define M17_END_FN          0x8000
@@ -90,7 +88,28 @@ const uint8_t M17_PUNCTURING_P1[61] = { 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1
 
 const uint8_t M17_PUNCTURING_P2[12] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0 };
 
-static const correct_convolutional_polynomial_t correct_conv_m17_polynomial[] = { 0b11001, 0b10111 };
+// Generators of the K=5 convolutional code, bit n is the input delayed by n bits
+#define M17_CONV_POLY_1     0b11001
+#define M17_CONV_POLY_2     0b10111
+
+// Convert the hard bits of a punctured frame to soft bits, punctured bits are erasures
+inline void M17Depuncture(const uint8_t* in, int8_t* soft, int count, const uint8_t* pattern, int patternLen) {
+    int inOffset = 0;
+    for (int i = 0; i < count; i++) {
+        if (!pattern[i % patternLen]) {
+            soft[i] = 0;
+            continue;
+        }
+        soft[i] = in[inOffset++] ? 127 : -127;
+    }
+}
+
+inline void M17PackBits(const uint8_t* bits, uint8_t* out, int count) {
+    for (int i = 0; i < count / 8; i++) {
+        const uint8_t* b = &bits[i * 8];
+        out[i] = (b[0] << 7) | (b[1] << 6) | (b[2] << 5) | (b[3] << 4) | (b[4] << 3) | (b[5] << 2) | (b[6] << 1) | b[7];
+    }
+}
 
 namespace dsp {
     class M17Slice4FSK : public block {
@@ -284,7 +303,6 @@ namespace dsp {
         ~M17LSFDecoder() {
             if (!block::_block_init) { return; }
             block::stop();
-            correct_convolutional_destroy(conv);
         }
 
         void init(stream<uint8_t>* in, void (*handler)(M17LSF& lsf, void* ctx), void* ctx) {
@@ -292,7 +310,7 @@ namespace dsp {
             _handler = handler;
             _ctx = ctx;
 
-            conv = correct_convolutional_create(2, 5, correct_conv_m17_polynomial);
+            viterbi.init(M17_CONV_POLY_1, M17_CONV_POLY_2);
 
             block::registerInput(_in);
             block::_block_init = true;
@@ -313,25 +331,13 @@ namespace dsp {
             if (count < 0) { return -1; }
 
             // Depuncture the data
-            int inOffset = 0;
-            for (int i = 0; i < M17_ENCODED_LSF_SIZE; i++) {
-                if (!M17_PUNCTURING_P1[i % 61]) {
-                    depunctured[i] = 0;
-                    continue;
-                }
-                depunctured[i] = _in->readBuf[inOffset++];
-            }
+            M17Depuncture(_in->readBuf, depunctured, M17_ENCODED_LSF_SIZE, M17_PUNCTURING_P1, 61);
 
             _in->flush();
 
-            // Pack into bytes
-            memset(packed, 0, 61);
-            for (int i = 0; i < M17_ENCODED_LSF_SIZE; i++) {
-                packed[i / 8] |= depunctured[i] << (7 - (i % 8));
-            }
-
-            // Run through convolutional decoder
-            correct_convolutional_decode(conv, packed, M17_ENCODED_LSF_SIZE, lsf);
+            // Run through convolutional decoder, the encoder is flushed back to state 0 by the tail bits
+            viterbi.decode(depunctured, M17_ENCODED_LSF_SIZE, decoded);
+            M17PackBits(decoded, lsf, M17_LSF_SIZE);
 
             // Decode it and call the handler
             M17LSF decLsf = M17DecodeLSF(lsf);
@@ -346,11 +352,11 @@ namespace dsp {
         void (*_handler)(M17LSF& lsf, void* ctx);
         void* _ctx;
 
-        uint8_t depunctured[488];
-        uint8_t packed[61];
+        int8_t depunctured[M17_ENCODED_LSF_SIZE];
+        uint8_t decoded[M17_LSF_SIZE + M17_CONV_TAIL_SIZE];
         uint8_t lsf[30];
 
-        correct_convolutional* conv;
+        fec::Viterbi<5> viterbi;
     };
 
     class M17PayloadFEC : public block {
@@ -362,13 +368,12 @@ namespace dsp {
         ~M17PayloadFEC() {
             if (!block::_block_init) { return; }
             block::stop();
-            correct_convolutional_destroy(conv);
         }
 
         void init(stream<uint8_t>* in) {
             _in = in;
 
-            conv = correct_convolutional_create(2, 5, correct_conv_m17_polynomial);
+            viterbi.init(M17_CONV_POLY_1, M17_CONV_POLY_2);
 
             block::registerInput(_in);
             block::registerOutput(&out);
@@ -390,24 +395,11 @@ namespace dsp {
             if (count < 0) { return -1; }
 
             // Depuncture the data
-            int inOffset = 0;
-            for (int i = 0; i < M17_ENCODED_PAYLOAD_SIZE; i++) {
-                if (!M17_PUNCTURING_P2[i % 12]) {
-                    depunctured[i] = 0;
-                    continue;
-                }
-                depunctured[i] = _in->readBuf[inOffset++];
-            }
-
-            // Pack into bytes
-            memset(packed, 0, 37);
-            for (int i = 0; i < M17_ENCODED_PAYLOAD_SIZE; i++) {
-                if (!(i % 8)) { packed[i / 8] = 0; }
-                packed[i / 8] |= depunctured[i] << (7 - (i % 8));
-            }
+            M17Depuncture(_in->readBuf, depunctured, M17_ENCODED_PAYLOAD_SIZE, M17_PUNCTURING_P2, 12);
 
-            // Run through convolutional decoder
-            correct_convolutional_decode(conv, packed, M17_ENCODED_PAYLOAD_SIZE, out.writeBuf);
+            // Run through convolutional decoder, the encoder is flushed back to state 0 by the tail bits
+            viterbi.decode(depunctured, M17_ENCODED_PAYLOAD_SIZE, decoded);
+            M17PackBits(decoded, out.writeBuf, M17_PAYLOAD_SIZE);
 
             _in->flush();
 
@@ -420,10 +412,10 @@ namespace dsp {
     private:
         stream<uint8_t>* _in;
 
-        uint8_t depunctured[296];
-        uint8_t packed[37];
+        int8_t depunctured[M17_ENCODED_PAYLOAD_SIZE];
+        uint8_t decoded[M17_PAYLOAD_SIZE + M17_CONV_TAIL_SIZE];
 
-        correct_convolutional* conv;
+        fec::Viterbi<5> viterbi;
     };
 
     class M17Codec2Decode : public block {
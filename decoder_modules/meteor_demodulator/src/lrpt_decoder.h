@@ -0,0 +1,284 @@
+#pragma once
+#include <dsp/processor.h>
+#include <dsp/fec/viterbi.h>
+#include <atomic>
+#include <algorithm>
+
+extern "C" {
+#include <correct.h>
+}
+
+#define LRPT_CADU_SIZE          1024
+#define LRPT_ASM                0x1ACFFC1D
+#define LRPT_ASM_SIZE           4
+#define LRPT_RS_INTERLEAVE      4
+#define LRPT_RS_BLOCK_SIZE      255
+#define LRPT_RS_DATA_SIZE       223
+#define LRPT_SOFT_SCALE         84.0f
+
+namespace dsp::meteor {
+    /**
+     * Decodes the soft symbols of the Meteor demodulator into Reed-Solomon corrected CADUs.
+     * The chain is a k=7 r=1/2 Viterbi decoder, an ASM correlator resolving the QPSK phase ambiguity,
+     * the CCSDS derandomizer and a (255,223) Reed-Solomon decoder with an interleaving of 4.
+     * Only the CADUs that could be corrected are output, including their ASM.
+     */
+    class LRPTDecoder : public Processor<complex_t, uint8_t> {
+        using base_type = Processor<complex_t, uint8_t>;
+    public:
+        LRPTDecoder() {}
+
+        LRPTDecoder(stream<complex_t>* in) { init(in); }
+
+        ~LRPTDecoder() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            correct_reed_solomon_destroy(rs);
+            buffer::free(softBuf);
+            buffer::free(bitBuf);
+        }
+
+        void init(stream<complex_t>* in) {
+            viterbi[0].init(0x4F, 0x6D);
+            viterbi[1].init(0x4F, 0x6D);
+            rs = correct_reed_solomon_create(correct_rs_primitive_polynomial_ccsds, 112, 11, LRPT_RS_BLOCK_SIZE - LRPT_RS_DATA_SIZE);
+            softBuf = buffer::alloc<int8_t>(STREAM_BUFFER_SIZE * 2);
+            bitBuf = buffer::alloc<uint8_t>(STREAM_BUFFER_SIZE + 1024);
+            genTables();
+            base_type::init(in);
+        }
+
+        void reset() {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            viterbi[0].reset();
+            viterbi[1].reset();
+            rotation = 0;
+            berErrors = 0.0f;
+            berBits = 0;
+            shift[0] = 0;
+            shift[1] = 0;
+            locked = false;
+            frameBits = 0;
+            misses = 0;
+            base_type::tempStart();
+        }
+
+        void resetStats() {
+            ber = 0.0f;
+            goodFrames = 0;
+            badFrames = 0;
+            correctedBytes = 0;
+        }
+
+        /**
+         * Get the channel bit error rate estimated by the Viterbi decoder.
+         * @return Bit error rate averaged over about one CADU.
+         */
+        float getBER() { return ber; }
+
+        bool isLocked() { return locked; }
+
+        int getGoodFrames() { return goodFrames; }
+        int getBadFrames() { return badFrames; }
+        int getCorrectedBytes() { return correctedBytes; }
+
+        int process(int count, const complex_t* in, uint8_t* out) {
+            // The code is transparent, so 180 degree rotations only invert the decoded bits. Until the ASM is found,
+            // the symbols are decoded both as received and rotated by 90 degrees.
+            int outCount = 0;
+            for (int r = 0; r < 2; r++) {
+                if (locked && r != rotation) { continue; }
+
+                // Convert to soft bits, undoing the rotation
+                for (int i = 0; i < count; i++) {
+                    float re = r ? -in[i].im : in[i].re;
+                    float im = r ? in[i].re : in[i].im;
+                    softBuf[2*i] = std::clamp<int>(re * LRPT_SOFT_SCALE, -127, 127);
+                    softBuf[2*i + 1] = std::clamp<int>(im * LRPT_SOFT_SCALE, -127, 127);
+                }
+
+                int bits = viterbi[r].process(softBuf, count * 2, bitBuf);
+                if (!bits) { continue; }
+
+                bool wasLocked = locked;
+                outCount += deframe(r, bitBuf, bits, &out[outCount]);
+
+                // The other decoder wasn't fed while synchronized, restart it
+                if (wasLocked && !locked) { viterbi[rotation ^ 1].reset(); }
+
+                // Average the error rate of the decoder in use over about a CADU
+                if (r != rotation) { continue; }
+                berErrors += viterbi[r].getBER() * (float)bits;
+                berBits += bits;
+                if (berBits >= LRPT_CADU_SIZE * 8) {
+                    ber = berErrors / (float)berBits;
+                    berErrors = 0.0f;
+                    berBits = 0;
+                }
+            }
+            return outCount;
+        }
+
+        int run() {
+            int count = base_type::_in->read();
+            if (count < 0) { return -1; }
+
+            int outCount = process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+
+            base_type::_in->flush();
+            if (outCount) {
+                if (!base_type::out.swap(outCount)) { return -1; }
+            }
+            return outCount;
+        }
+
+    private:
+        // Find the ASM in the bits of a decoder, then follow the frames and check their ASM
+        int deframe(int r, const uint8_t* bits, int count, uint8_t* out) {
+            int outCount = 0;
+            for (int i = 0; i < count; i++) {
+                if (!locked) {
+                    shift[r] = (shift[r] << 1) | bits[i];
+                    int errors = popcount(shift[r] ^ LRPT_ASM);
+                    int invErrors = popcount(~shift[r] ^ LRPT_ASM);
+                    if (errors > MAX_SEARCH_ERRORS && invErrors > MAX_SEARCH_ERRORS) { continue; }
+
+                    inverted = (invErrors < errors);
+                    rotation = r;
+                    locked = true;
+                    misses = 0;
+                    frameBits = LRPT_ASM_SIZE * 8;
+                    continue;
+                }
+
+                int bit = bits[i] ^ (inverted ? 1 : 0);
+                frame[frameBits >> 3] = (frame[frameBits >> 3] << 1) | bit;
+                frameBits++;
+
+                if (frameBits == LRPT_ASM_SIZE * 8) {
+                    // Check the ASM of the next frame, flywheel through a few bad ones
+                    uint32_t sync = ((uint32_t)frame[0] << 24) | ((uint32_t)frame[1] << 16) | ((uint32_t)frame[2] << 8) | frame[3];
+                    if (popcount(sync ^ LRPT_ASM) <= MAX_LOCKED_ERRORS) {
+                        misses = 0;
+                    }
+                    else if (++misses > MAX_MISSES) {
+                        locked = false;
+                        shift[r] = sync ^ (inverted ? 0xFFFFFFFF : 0);
+                    }
+                }
+                else if (frameBits == LRPT_CADU_SIZE * 8) {
+                    if (decodeFrame()) {
+                        memcpy(&out[outCount], frame, LRPT_CADU_SIZE);
+                        outCount += LRPT_CADU_SIZE;
+                    }
+                    frameBits = 0;
+                }
+            }
+            return outCount;
+        }
+
+        bool decodeFrame() {
+            // Derandomize
+            uint8_t* data = &frame[LRPT_ASM_SIZE];
+            for (int i = 0; i < LRPT_CADU_SIZE - LRPT_ASM_SIZE; i++) {
+                data[i] ^= pn[i % LRPT_RS_BLOCK_SIZE];
+            }
+
+            // Correct each interleaved codeword, they are in the dual basis representation
+            int corrected = 0;
+            for (int i = 0; i < LRPT_RS_INTERLEAVE; i++) {
+                for (int j = 0; j < LRPT_RS_BLOCK_SIZE; j++) {
+                    rsIn[j] = fromDualBasis[data[j * LRPT_RS_INTERLEAVE + i]];
+                }
+                if (correct_reed_solomon_decode(rs, rsIn, LRPT_RS_BLOCK_SIZE, rsOut) < 0) {
+                    badFrames++;
+                    return false;
+                }
+                // Re-encode so the parity bytes are corrected as well
+                correct_reed_solomon_encode(rs, rsOut, LRPT_RS_DATA_SIZE, rsIn);
+                for (int j = 0; j < LRPT_RS_BLOCK_SIZE; j++) {
+                    uint8_t val = toDualBasis[rsIn[j]];
+                    uint8_t& dst = data[j * LRPT_RS_INTERLEAVE + i];
+                    if (dst != val) { corrected++; }
+                    dst = val;
+                }
+            }
+            goodFrames++;
+            correctedBytes += corrected;
+
+            // Output a clean ASM
+            frame[0] = (LRPT_ASM >> 24) & 0xFF;
+            frame[1] = (LRPT_ASM >> 16) & 0xFF;
+            frame[2] = (LRPT_ASM >> 8) & 0xFF;
+            frame[3] = LRPT_ASM & 0xFF;
+            return true;
+        }
+
+        void genTables() {
+            // CCSDS pseudo-random sequence, x^8 + x^7 + x^5 + x^3 + 1 starting from all ones
+            uint8_t sr = 0xFF;
+            for (int i = 0; i < LRPT_RS_BLOCK_SIZE; i++) {
+                uint8_t byte = 0;
+                for (int j = 0; j < 8; j++) {
+                    byte = (byte << 1) | (sr & 1);
+                    uint8_t fb = (sr ^ (sr >> 3) ^ (sr >> 5) ^ (sr >> 7)) & 1;
+                    sr = (sr >> 1) | (fb << 7);
+                }
+                pn[i] = byte;
+            }
+
+            // Conventional to dual basis conversion from the CCSDS transformation matrix
+            const uint8_t tal[8] = { 0x8D, 0xEF, 0xEC, 0x86, 0xFA, 0x99, 0xAF, 0x7B };
+            for (int i = 0; i < 256; i++) {
+                uint8_t val = 0;
+                for (int k = 0; k < 8; k++) {
+                    if (i & (1 << k)) { val ^= tal[7 - k]; }
+                }
+                toDualBasis[i] = val;
+                fromDualBasis[val] = i;
+            }
+        }
+
+        static inline int popcount(uint32_t x) {
+            int count = 0;
+            for (; x; count++) { x &= x - 1; }
+            return count;
+        }
+
+        const int MAX_SEARCH_ERRORS = 2;
+        const int MAX_LOCKED_ERRORS = 6;
+        const int MAX_MISSES = 4;
+
+        fec::Viterbi<7> viterbi[2];
+        correct_reed_solomon* rs;
+
+        int8_t* softBuf;
+        uint8_t* bitBuf;
+        uint8_t pn[LRPT_RS_BLOCK_SIZE];
+        uint8_t toDualBasis[256];
+        uint8_t fromDualBasis[256];
+
+        // Phase ambiguity
+        int rotation = 0;
+        float berErrors = 0.0f;
+        int berBits = 0;
+
+        // Deframer
+        uint32_t shift[2] = { 0, 0 };
+        std::atomic<bool> locked = false;
+        bool inverted = false;
+        int frameBits = 0;
+        int misses = 0;
+        uint8_t frame[LRPT_CADU_SIZE];
+        uint8_t rsIn[LRPT_RS_BLOCK_SIZE];
+        uint8_t rsOut[LRPT_RS_BLOCK_SIZE];
+
+        // Stats
+        std::atomic<float> ber = 0.0f;
+        std::atomic<int> goodFrames = 0;
+        std::atomic<int> badFrames = 0;
+        std::atomic<int> correctedBytes = 0;
+    };
+}
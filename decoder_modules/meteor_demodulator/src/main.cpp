@@ -7,14 +7,15 @@
 #include <module.h>
 #include <filesystem>
 #include "meteor_demod.h"
+#include "lrpt_decoder.h"
 #include <dsp/routing/splitter.h>
 #include <dsp/buffer/reshaper.h>
 #include <dsp/sink/handler_sink.h>
 #include <meteor_demodulator_interface.h>
 #include <gui/widgets/folder_select.h>
 #include <gui/widgets/constellation_diagram.h>
-
-#include <fstream>
+#include <utils/disk_writer.h>
+#include <chrono>
 
 #define CONCAT(a, b) ((std::string(a) + b).c_str())
 
@@ -60,6 +61,12 @@ public:
         if (config.conf[name].contains("oqpsk")) {
             oqpsk = config.conf[name]["oqpsk"];
         }
+        if (config.conf[name].contains("saveSoft")) {
+            saveSoft = config.conf[name]["saveSoft"];
+        }
+        if (config.conf[name].contains("saveCadu")) {
+            saveCadu = config.conf[name]["saveCadu"];
+        }
         config.release();
 
         vfo = sigpath::vfoManager.createVFO(name, ImGui::WaterfallVFO::REF_CENTER, 0, INPUT_SAMPLE_RATE, INPUT_SAMPLE_RATE, INPUT_SAMPLE_RATE, INPUT_SAMPLE_RATE, true);
@@ -67,15 +74,24 @@ public:
         split.init(&demod.out);
         split.bindStream(&symSinkStream);
         split.bindStream(&sinkStream);
+        split.bindStream(&decodeStream);
         reshape.init(&symSinkStream, 1024, (72000 / 30) - 1024);
         symSink.init(&reshape.out, symSinkHandler, this);
         sink.init(&sinkStream, sinkHandler, this);
+        lrpt.init(&decodeStream);
+        caduSink.init(&lrpt.out, caduSinkHandler, this);
+
+        // The files are side-taps of the decoder, better lose data than stall the DSP when the disk is slow
+        softWriter.setOverflowPolicy(diskio::OVERFLOW_DROP);
+        caduWriter.setOverflowPolicy(diskio::OVERFLOW_DROP);
 
         demod.start();
         split.start();
         reshape.start();
         symSink.start();
         sink.start();
+        lrpt.start();
+        caduSink.start();
 
         gui::menu.registerEntry(name, menuHandler, this, this);
         core::modComManager.registerInterface("meteor_demodulator", name, moduleInterfaceHandler, this);
@@ -85,13 +101,16 @@ public:
         if (recording) {
             std::lock_guard<std::mutex> lck(recMtx);
             recording = false;
-            recFile.close();
+            softWriter.close();
+            caduWriter.close();
         }
         demod.stop();
         split.stop();
         reshape.stop();
         symSink.stop();
         sink.stop();
+        lrpt.stop();
+        caduSink.stop();
         sigpath::vfoManager.deleteVFO(vfo);
         gui::menu.removeEntry(name);
     }
@@ -104,12 +123,16 @@ public:
 
         demod.setBrokenModulation(brokenModulation);
         demod.setInput(vfo->output);
+        lrpt.reset();
+        lrpt.resetStats();
 
         demod.start();
         split.start();
         reshape.start();
         symSink.start();
         sink.start();
+        lrpt.start();
+        caduSink.start();
 
         enabled = true;
     }
@@ -120,6 +143,8 @@ public:
         reshape.stop();
         symSink.stop();
         sink.stop();
+        lrpt.stop();
+        caduSink.stop();
 
         sigpath::vfoManager.deleteVFO(vfo);
         enabled = false;
@@ -162,13 +187,56 @@ private:
             config.release(true);
         }
 
+        if (_this->recording) { style::beginDisabled(); }
+        if (ImGui::Checkbox(CONCAT("Save soft symbols##meteor_save_soft", _this->name), &_this->saveSoft)) {
+            config.acquire();
+            config.conf[_this->name]["saveSoft"] = _this->saveSoft;
+            config.release(true);
+        }
+        if (ImGui::Checkbox(CONCAT("Save CADUs##meteor_save_cadu", _this->name), &_this->saveCadu)) {
+            config.acquire();
+            config.conf[_this->name]["saveCadu"] = _this->saveCadu;
+            config.release(true);
+        }
+        if (_this->recording) { style::endDisabled(); }
+
+        // Decoder status, the throughput is updated once a second
+        auto now = std::chrono::steady_clock::now();
+        int goodFrames = _this->lrpt.getGoodFrames();
+        if (now - _this->lastStatsTime >= std::chrono::seconds(1)) {
+            double elapsed = std::chrono::duration<double>(now - _this->lastStatsTime).count();
+            _this->throughput = (double)std::max<int>(goodFrames - _this->lastGoodFrames, 0) * LRPT_CADU_SIZE * 8.0 / elapsed;
+            _this->lastGoodFrames = goodFrames;
+            _this->lastStatsTime = now;
+        }
+        if (_this->lrpt.isLocked()) {
+            ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Locked");
+        }
+        else {
+            ImGui::TextUnformatted("Searching");
+        }
+        ImGui::SameLine();
+        ImGui::Text("BER %.2f%%", _this->lrpt.getBER() * 100.0f);
+        ImGui::Text("Frames %d good / %d bad (%d bytes corrected)", goodFrames, _this->lrpt.getBadFrames(), _this->lrpt.getCorrectedBytes());
+        ImGui::Text("Throughput %.1fkbit/s", _this->throughput / 1000.0);
+        if (ImGui::Button(CONCAT("Reset stats##meteor_reset_stats", _this->name), ImVec2(menuWidth, 0))) {
+            _this->lrpt.resetStats();
+            _this->lastGoodFrames = 0;
+        }
+
         if (!_this->folderSelect.pathIsValid() && _this->enabled) { style::beginDisabled(); }
 
         if (_this->recording) {
             if (ImGui::Button(CONCAT("Stop##meteor_rec_", _this->name), ImVec2(menuWidth, 0))) {
                 _this->stopRecording();
             }
-            ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Recording %.2fMB", (float)_this->dataWritten / 1000000.0f);
+            uint64_t written = _this->softWriter.tell() + _this->caduWriter.tell();
+            uint64_t dropped = _this->softWriter.getDroppedBytes() + _this->caduWriter.getDroppedBytes();
+            ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Recording %.2fMB", (float)written / 1000000.0f);
+            if (dropped) {
+                ImGui::SameLine();
+                ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f), "(%.2fMB dropped)", (float)dropped / 1000000.0f);
+            }
         }
         else {
             if (ImGui::Button(CONCAT("Record##meteor_rec_", _this->name), ImVec2(menuWidth, 0))) {
@@ -193,34 +261,46 @@ private:
     static void sinkHandler(dsp::complex_t* data, int count, void* ctx) {
         MeteorDemodulatorModule* _this = (MeteorDemodulatorModule*)ctx;
         std::lock_guard<std::mutex> lck(_this->recMtx);
-        if (!_this->recording) { return; }
+        if (!_this->recording || !_this->softWriter.isOpen()) { return; }
         for (int i = 0; i < count; i++) {
-            _this->writeBuffer[(2 * i)] = std::clamp<int>(data[i].re * 84.0f, -127, 127);
-            _this->writeBuffer[(2 * i) + 1] = std::clamp<int>(data[i].im * 84.0f, -127, 127);
+            _this->writeBuffer[(2 * i)] = std::clamp<int>(data[i].re * LRPT_SOFT_SCALE, -127, 127);
+            _this->writeBuffer[(2 * i) + 1] = std::clamp<int>(data[i].im * LRPT_SOFT_SCALE, -127, 127);
         }
-        _this->recFile.write((char*)_this->writeBuffer, count * 2);
-        _this->dataWritten += count * 2;
+        _this->softWriter.write((uint8_t*)_this->writeBuffer, count * 2);
+    }
+
+    static void caduSinkHandler(uint8_t* data, int count, void* ctx) {
+        MeteorDemodulatorModule* _this = (MeteorDemodulatorModule*)ctx;
+        std::lock_guard<std::mutex> lck(_this->recMtx);
+        if (!_this->recording || !_this->caduWriter.isOpen()) { return; }
+        _this->caduWriter.write(data, count);
     }
 
     void startRecording() {
         std::lock_guard<std::mutex> lck(recMtx);
-        dataWritten = 0;
-        std::string filename = genFileName(folderSelect.expandString(folderSelect.path) + "/meteor", ".s");
-        recFile = std::ofstream(filename, std::ios::binary);
-        if (recFile.is_open()) {
-            flog::info("Recording to '{0}'", filename);
-            recording = true;
+        if (!saveSoft && !saveCadu) {
+            flog::error("Nothing selected to record");
+            return;
         }
-        else {
+        std::string filename = genFileName(folderSelect.expandString(folderSelect.path) + "/meteor", "");
+        if (saveSoft && !softWriter.open(filename + ".s")) {
             flog::error("Could not open file for recording!");
+            return;
         }
+        if (saveCadu && !caduWriter.open(filename + ".cadu")) {
+            flog::error("Could not open file for recording!");
+            softWriter.close();
+            return;
+        }
+        flog::info("Recording to '{0}'", filename);
+        recording = true;
     }
 
     void stopRecording() {
         std::lock_guard<std::mutex> lck(recMtx);
         recording = false;
-        recFile.close();
-        dataWritten = 0;
+        softWriter.close();
+        caduWriter.close();
     }
 
     static void moduleInterfaceHandler(int code, void* in, void* out, void* ctx) {
@@ -246,6 +326,9 @@ private:
     dsp::buffer::Reshaper<dsp::complex_t> reshape;
     dsp::sink::Handler<dsp::complex_t> symSink;
     dsp::sink::Handler<dsp::complex_t> sink;
+    dsp::stream<dsp::complex_t> decodeStream;
+    dsp::meteor::LRPTDecoder lrpt;
+    dsp::sink::Handler<uint8_t> caduSink;
 
     ImGui::ConstellationDiagram constDiagram;
 
@@ -253,11 +336,18 @@ private:
 
     std::mutex recMtx;
     bool recording = false;
-    uint64_t dataWritten = 0;
-    std::ofstream recFile;
+    diskio::Writer softWriter;
+    diskio::Writer caduWriter;
+    bool saveSoft = true;
+    bool saveCadu = true;
     bool brokenModulation = false;
     bool oqpsk = false;
     int8_t* writeBuffer;
+
+    // Decoder stats
+    std::chrono::steady_clock::time_point lastStatsTime = std::chrono::steady_clock::now();
+    int lastGoodFrames = 0;
+    double throughput = 0.0;
 };
 
 MOD_EXPORT void _INIT_() {
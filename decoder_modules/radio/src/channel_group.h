@@ -0,0 +1,345 @@
+#pragma once
+#include <imgui.h>
+#include <gui/gui.h>
+#include <gui/style.h>
+#include <signal_path/signal_path.h>
+#include <config.h>
+#include <dsp/demod/channel_group.h>
+#include <utils/flog.h>
+#include <utils/freq_formatting.h>
+
+// Demodulates a list of NFM or AM channels inside one radio instance. The channels share the VFO of the instance,
+// which is placed over all of them, and a single DSP block. Each channel gets its own sink stream.
+class ChannelGroup {
+public:
+    ChannelGroup() {}
+
+    ~ChannelGroup() {
+        stop();
+        gui::waterfall.onFFTRedraw.unbindHandler(&fftRedrawHandler);
+        for (auto& ch : channels) { delete ch; }
+    }
+
+    void init(std::string name, ConfigManager* config) {
+        this->name = name;
+        _config = config;
+
+        fftRedrawHandler.handler = fftRedraw;
+        fftRedrawHandler.ctx = this;
+        gui::waterfall.onFFTRedraw.bindHandler(&fftRedrawHandler);
+
+        // Load config
+        _config->acquire();
+        json& conf = _config->conf[name]["channelGroup"];
+        if (conf.contains("mode")) { modeId = (conf["mode"] == "AM") ? 1 : 0; }
+        if (conf.contains("bandwidth")) { bandwidth = conf["bandwidth"]; }
+        if (conf.contains("channels")) {
+            for (auto& c : conf["channels"]) {
+                Channel* ch = new Channel;
+                ch->group = this;
+                ch->frequency = c["frequency"];
+                ch->squelchEnabled = c["squelchEnabled"];
+                ch->squelchLevel = c["squelchLevel"];
+                channels.push_back(ch);
+            }
+        }
+        _config->release();
+
+        demod.init(NULL, (dsp::demod::ChannelGroup::Mode)modeId, audioSampleRate, audioSampleRate, bandwidth);
+    }
+
+    /**
+     * Start demodulating the channels.
+     * @param vfo VFO to use, it is moved and resized to cover all channels.
+     */
+    void start(VFOManager::VFO* vfo) {
+        if (active) { return; }
+        _vfo = vfo;
+        active = true;
+        startDSP();
+    }
+
+    void stop() {
+        if (!active) { return; }
+        stopDSP();
+        active = false;
+    }
+
+    bool isActive() { return active; }
+
+    void showMenu(float menuWidth) {
+        ImGui::Columns(2, ("ChannelGroupModeColumns##_radio_grp_" + name).c_str(), false);
+        if (ImGui::RadioButton(("NFM##_radio_grp_mode_" + name).c_str(), modeId == 0) && modeId != 0) {
+            setMode(0);
+        }
+        ImGui::NextColumn();
+        if (ImGui::RadioButton(("AM##_radio_grp_mode_" + name).c_str(), modeId == 1) && modeId != 1) {
+            setMode(1);
+        }
+        ImGui::Columns(1, ("EndChannelGroupModeColumns##_radio_grp_" + name).c_str(), false);
+
+        ImGui::LeftLabel("Bandwidth");
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
+        if (ImGui::InputFloat(("##_radio_grp_bw_" + name).c_str(), &bandwidth, 100, 1000, "%.0f")) {
+            bandwidth = std::clamp<float>(bandwidth, MIN_BANDWIDTH, MAX_BANDWIDTH);
+            restart();
+            saveConfig();
+        }
+
+        // Add a channel
+        ImGui::LeftLabel("Frequency");
+        ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX() - ImGui::CalcTextSize("Add").x - ImGui::GetStyle().FramePadding.x * 2.0f - ImGui::GetStyle().ItemSpacing.x);
+        ImGui::InputDouble(("##_radio_grp_freq_" + name).c_str(), &newFrequency, 1000.0, 100000.0, "%.0f");
+        ImGui::SameLine();
+        if (ImGui::Button(("Add##_radio_grp_add_" + name).c_str())) {
+            addChannel(newFrequency);
+        }
+        if (ImGui::Button(("Add VFO frequency##_radio_grp_add_vfo_" + name).c_str(), ImVec2(menuWidth, 0))) {
+            double freq = gui::waterfall.getCenterFrequency();
+            if (gui::waterfall.selectedVFO != "" && gui::waterfall.vfos.find(gui::waterfall.selectedVFO) != gui::waterfall.vfos.end()) {
+                freq += gui::waterfall.vfos[gui::waterfall.selectedVFO]->generalOffset;
+            }
+            addChannel(freq);
+        }
+
+        // Channel list
+        int removeId = -1;
+        if (ImGui::BeginTable(("radio_grp_chan_table_" + name).c_str(), 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY, ImVec2(0, 200))) {
+            ImGui::TableSetupColumn("Frequency");
+            ImGui::TableSetupColumn("Level");
+            ImGui::TableSetupColumn("Squelch", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupScrollFreeze(4, 1);
+            ImGui::TableHeadersRow();
+            for (int i = 0; i < channels.size(); i++) {
+                Channel* ch = channels[i];
+                std::string id = std::to_string(i) + name;
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(utils::formatFreq(ch->frequency).c_str());
+                ImGui::TableSetColumnIndex(1);
+                if (running) { ImGui::Text("%.1fdB", demod.getLevel(i)); }
+                ImGui::TableSetColumnIndex(2);
+                if (ImGui::Checkbox(("##_radio_grp_sql_ena_" + id).c_str(), &ch->squelchEnabled)) {
+                    applySquelch(i);
+                    saveConfig();
+                }
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                if (ImGui::SliderFloat(("##_radio_grp_sql_lvl_" + id).c_str(), &ch->squelchLevel, MIN_SQUELCH, MAX_SQUELCH, "%.1fdB")) {
+                    applySquelch(i);
+                    saveConfig();
+                }
+                ImGui::TableSetColumnIndex(3);
+                if (ImGui::Button(("X##_radio_grp_rem_" + id).c_str())) {
+                    removeId = i;
+                }
+            }
+            ImGui::EndTable();
+        }
+        if (removeId >= 0) { removeChannel(removeId); }
+
+        if (ImGui::Button(("Recenter VFO##_radio_grp_recenter_" + name).c_str(), ImVec2(menuWidth, 0))) {
+            restart();
+        }
+
+        if (!error.empty()) {
+            ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%s", error.c_str());
+        }
+    }
+
+private:
+    struct Channel {
+        ChannelGroup* group;
+        double frequency;
+        bool squelchEnabled = false;
+        float squelchLevel = -50.0f;
+        std::string streamName;
+        SinkManager::Stream* stream = NULL;
+        EventHandler<float> srChangeHandler;
+    };
+
+    // Place the VFO over all channels and configure the demodulator for it, returns false if the channels can't all fit
+    bool configure(bool recenter) {
+        error = "";
+        double minFreq = INFINITY;
+        double maxFreq = -INFINITY;
+        for (auto& ch : channels) {
+            minFreq = std::min<double>(minFreq, ch->frequency);
+            maxFreq = std::max<double>(maxFreq, ch->frequency);
+        }
+        double span = channels.empty() ? bandwidth : (maxFreq - minFreq) + bandwidth;
+
+        // Smallest power of two multiple of the audio samplerate that covers the span with some margin for the filters
+        int ratio = 1;
+        while (audioSampleRate * ratio < span * 1.25) { ratio *= 2; }
+        if (ratio > (1 << dsp::multirate::decim::plans_len)) {
+            error = "Channels are too far apart";
+            flog::error("Channel group '{0}' spans {1} Hz, which is too wide", name, span);
+            return false;
+        }
+        samplerate = audioSampleRate * ratio;
+
+        if (recenter && !channels.empty()) {
+            _vfo->setOffset(((minFreq + maxFreq) / 2.0) - gui::waterfall.getCenterFrequency());
+        }
+        _vfo->setReference(ImGui::WaterfallVFO::REF_CENTER);
+        _vfo->setBandwidthLimits(span, span, true);
+        _vfo->setSampleRate(samplerate, span);
+
+        demod.setSamplerates(samplerate, audioSampleRate);
+        demod.setBandwidth(bandwidth);
+        demod.setMode((dsp::demod::ChannelGroup::Mode)modeId);
+        updateOffsets();
+        return true;
+    }
+
+    void startDSP() {
+        if (running || !configure(true)) { return; }
+        demod.setInput(_vfo->output);
+        for (auto& ch : channels) { addStream(ch); }
+        demod.start();
+        for (auto& ch : channels) { ch->stream->start(); }
+        running = true;
+    }
+
+    void stopDSP() {
+        if (!running) { return; }
+        for (auto& ch : channels) { removeStream(ch); }
+        demod.stop();
+        running = false;
+    }
+
+    void restart() {
+        if (!active) { return; }
+        stopDSP();
+        startDSP();
+    }
+
+    // Keep the channels on their frequency when the VFO or the tuner moves
+    void updateOffsets() {
+        vfoFrequency = gui::waterfall.getCenterFrequency() + _vfo->getOffset();
+        for (int i = 0; i < demod.getChannelCount(); i++) {
+            demod.setOffset(i, channels[i]->frequency - vfoFrequency);
+        }
+    }
+
+    void applySquelch(int id) {
+        if (!running) { return; }
+        Channel* ch = channels[id];
+        demod.setSquelchLevel(id, ch->squelchEnabled ? ch->squelchLevel : -INFINITY);
+    }
+
+    void addStream(Channel* ch) {
+        int id = demod.addChannel(ch->frequency - vfoFrequency, ch->squelchEnabled ? ch->squelchLevel : -INFINITY);
+        ch->streamName = name + " " + utils::formatFreq(ch->frequency);
+        ch->srChangeHandler.handler = sampleRateChangeHandler;
+        ch->srChangeHandler.ctx = ch;
+        ch->stream = new SinkManager::Stream(demod.getOutput(id), &ch->srChangeHandler, audioSampleRate);
+        sigpath::sinkManager.registerStream(ch->streamName, ch->stream);
+    }
+
+    void removeStream(Channel* ch) {
+        sigpath::sinkManager.unregisterStream(ch->streamName);
+        delete ch->stream;
+        ch->stream = NULL;
+        demod.removeChannel(0);
+    }
+
+    void addChannel(double frequency) {
+        for (auto& ch : channels) {
+            if (ch->frequency == frequency) { return; }
+        }
+        stopDSP();
+        Channel* ch = new Channel;
+        ch->group = this;
+        ch->frequency = frequency;
+        channels.push_back(ch);
+        if (active) { startDSP(); }
+        saveConfig();
+    }
+
+    void removeChannel(int id) {
+        stopDSP();
+        delete channels[id];
+        channels.erase(channels.begin() + id);
+        if (active) { startDSP(); }
+        saveConfig();
+    }
+
+    void setMode(int id) {
+        modeId = id;
+        demod.setMode((dsp::demod::ChannelGroup::Mode)modeId);
+        saveConfig();
+    }
+
+    void setAudioSampleRate(double sr) {
+        if (sr == audioSampleRate) { return; }
+        audioSampleRate = sr;
+        if (!running) { return; }
+        if (!configure(false)) { stopDSP(); }
+    }
+
+    void saveConfig() {
+        _config->acquire();
+        json& conf = _config->conf[name]["channelGroup"];
+        conf["mode"] = modeId ? "AM" : "NFM";
+        conf["bandwidth"] = bandwidth;
+        conf["channels"] = json::array();
+        for (auto& ch : channels) {
+            json c;
+            c["frequency"] = ch->frequency;
+            c["squelchEnabled"] = ch->squelchEnabled;
+            c["squelchLevel"] = ch->squelchLevel;
+            conf["channels"].push_back(c);
+        }
+        _config->release(true);
+    }
+
+    static void sampleRateChangeHandler(float sampleRate, void* ctx) {
+        Channel* ch = (Channel*)ctx;
+        ch->group->setAudioSampleRate(sampleRate);
+    }
+
+    static void fftRedraw(ImGui::WaterFall::FFTRedrawArgs args, void* ctx) {
+        ChannelGroup* _this = (ChannelGroup*)ctx;
+        if (!_this->running) { return; }
+
+        // Follow the VFO and tuner
+        if (gui::waterfall.getCenterFrequency() + _this->_vfo->getOffset() != _this->vfoFrequency) {
+            _this->updateOffsets();
+        }
+
+        // Mark the channels, brighter when their squelch is open
+        for (int i = 0; i < _this->channels.size(); i++) {
+            Channel* ch = _this->channels[i];
+            if (ch->frequency < args.lowFreq || ch->frequency > args.highFreq) { continue; }
+            float x = args.min.x + (ch->frequency - args.lowFreq) * args.freqToPixelRatio;
+            bool open = !ch->squelchEnabled || _this->demod.getLevel(i) >= ch->squelchLevel;
+            args.window->DrawList->AddLine(ImVec2(x, args.min.y), ImVec2(x, args.max.y), open ? IM_COL32(255, 255, 0, 200) : IM_COL32(255, 255, 0, 60));
+        }
+    }
+
+    std::string name;
+    ConfigManager* _config = NULL;
+    VFOManager::VFO* _vfo = NULL;
+    EventHandler<ImGui::WaterFall::FFTRedrawArgs> fftRedrawHandler;
+
+    dsp::demod::ChannelGroup demod;
+    std::vector<Channel*> channels;
+
+    int modeId = 0;
+    float bandwidth = 12500.0f;
+    double newFrequency = 0.0;
+    double audioSampleRate = 48000.0;
+    double samplerate = 48000.0;
+    double vfoFrequency = 0.0;
+    bool active = false;
+    bool running = false;
+    std::string error = "";
+
+    const float MIN_BANDWIDTH = 1000.0f;
+    const float MAX_BANDWIDTH = 40000.0f;
+    const float MIN_SQUELCH = -100.0f;
+    const float MAX_SQUELCH = 0.0f;
+};
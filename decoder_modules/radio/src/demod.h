@@ -46,6 +46,9 @@ namespace demod {
         virtual bool getFMIFNRAllowed() = 0;
         virtual bool getNBAllowed() = 0;
         virtual dsp::stream<dsp::stereo_t>* getOutput() = 0;
+
+        // Emitted by demodulators whose AF samplerate depends on their options when it changes
+        Event<double> onAFSampleRateChanged;
     };
 }
 
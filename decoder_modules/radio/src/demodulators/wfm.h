@@ -45,10 +45,13 @@ namespace demod {
             if (config->conf[name][getName()].contains("rds")) {
                 _rds = config->conf[name][getName()]["rds"];
             }
+            if (config->conf[name][getName()].contains("economy")) {
+                _economy = config->conf[name][getName()]["economy"];
+            }
             _config->release(modified);
 
             // Define structure
-            demod.init(input, bandwidth / 2.0f, getIFSampleRate(), _stereo, _lowPass, _rds);
+            demod.init(input, bandwidth / 2.0f, getIFSampleRate(), _stereo, _lowPass, _rds, _economy);
             recov.init(&demod.rdsOut, 5000.0 / 2375, omegaGain, muGain, 0.01);
             slice.init(&recov.out);
             manch.init(&slice.out);
@@ -81,18 +84,29 @@ namespace demod {
                 _config->conf[name][getName()]["stereo"] = _stereo;
                 _config->release(true);
             }
+            // The economy mode always low-passes the audio
+            if (_economy) { style::beginDisabled(); }
             if (ImGui::Checkbox(("Low Pass##_radio_wfm_lowpass_" + name).c_str(), &_lowPass)) {
                 demod.setLowPass(_lowPass);
                 _config->acquire();
                 _config->conf[name][getName()]["lowPass"] = _lowPass;
                 _config->release(true);
             }
+            if (_economy) { style::endDisabled(); }
             if (ImGui::Checkbox(("Decode RDS##_radio_wfm_rds_" + name).c_str(), &_rds)) {
                 demod.setRDSOut(_rds);
                 _config->acquire();
                 _config->conf[name][getName()]["rds"] = _rds;
                 _config->release(true);
             }
+            if (ImGui::Checkbox(("Economy##_radio_wfm_economy_" + name).c_str(), &_economy)) {
+                demod.setEconomy(_economy);
+                onAFSampleRateChanged.emit(getAFSampleRate());
+                _config->acquire();
+                _config->conf[name][getName()]["economy"] = _economy;
+                _config->release(true);
+            }
+            ImGui::Text("DSP Load: %.1f%%", demod.getLoad() * 100.0f);
 
             // if (_rds) {
             //     if (rdsDecode.countryCodeValid()) { ImGui::Text("Country code: %d", rdsDecode.getCountryCode()); }
@@ -118,7 +132,7 @@ namespace demod {
 
         const char* getName() { return "WFM"; }
         double getIFSampleRate() { return 250000.0; }
-        double getAFSampleRate() { return getIFSampleRate(); }
+        double getAFSampleRate() { return demod.getOutSamplerate(); }
         double getDefaultBandwidth() { return 150000.0; }
         double getMinBandwidth() { return 50000.0; }
         double getMaxBandwidth() { return getIFSampleRate(); }
@@ -200,6 +214,7 @@ namespace demod {
         bool _stereo = false;
         bool _lowPass = true;
         bool _rds = false;
+        bool _economy = false;
         float muGain = 0.01;
         float omegaGain = (0.01*0.01)/4.0;
 
@@ -16,6 +16,7 @@
 #include <utils/optionlist.h>
 #include "radio_interface.h"
 #include "demod.h"
+#include "channel_group.h"
 
 ConfigManager config;
 
@@ -57,6 +58,9 @@ public:
             created = true;
         }
         selectedDemodID = config.conf[name]["selectedDemodId"];
+        if (config.conf[name]["channelGroup"].contains("enabled")) {
+            groupMode = config.conf[name]["channelGroup"]["enabled"];
+        }
         config.release(created);
 
         // Initialize the VFO
@@ -105,6 +109,10 @@ public:
         // Start stream, the rest was started when selecting the demodulator
         stream.start();
 
+        // Take over the VFO if the channel group was in use
+        group.init(name, &config);
+        if (groupMode) { enterGroupMode(); }
+
         // Register the menu
         gui::menu.registerEntry(name, menuHandler, this, this);
 
@@ -134,10 +142,12 @@ public:
         ifChain.start();
         selectDemodByID((DemodID)selectedDemodID);
         afChain.start();
+        if (groupMode) { enterGroupMode(); }
     }
 
     void disable() {
         enabled = false;
+        group.stop();
         ifChain.stop();
         if (selectedDemod) { selectedDemod->stop(); }
         afChain.stop();
@@ -170,6 +180,20 @@ private:
         if (!_this->enabled) { style::beginDisabled(); }
 
         float menuWidth = ImGui::GetContentRegionAvail().x;
+
+        if (ImGui::Checkbox(CONCAT("Channel Group##_radio_grp_ena_", _this->name), &_this->groupMode)) {
+            if (_this->groupMode) { _this->enterGroupMode(); }
+            else { _this->leaveGroupMode(); }
+            config.acquire();
+            config.conf[_this->name]["channelGroup"]["enabled"] = _this->groupMode;
+            config.release(true);
+        }
+        if (_this->groupMode) {
+            _this->group.showMenu(menuWidth);
+            if (!_this->enabled) { style::endDisabled(); }
+            return;
+        }
+
         ImGui::BeginGroup();
 
         ImGui::Columns(4, CONCAT("RadioModeColumns##_", _this->name), false);
@@ -282,6 +306,23 @@ private:
         if (!_this->enabled) { style::endDisabled(); }
     }
 
+    // The channel group demodulates the VFO output directly, so the single channel DSP is idle while it runs
+    void enterGroupMode() {
+        if (!enabled) { return; }
+        ifChain.stop();
+        if (selectedDemod) { selectedDemod->stop(); }
+        afChain.stop();
+        group.start(vfo);
+    }
+
+    void leaveGroupMode() {
+        if (!enabled) { return; }
+        group.stop();
+        ifChain.start();
+        selectDemodByID((DemodID)selectedDemodID);
+        afChain.start();
+    }
+
     demod::Demodulator* instantiateDemod(DemodID id) {
         demod::Demodulator* demod = NULL;
         switch (id) {
@@ -345,6 +386,11 @@ private:
         }
         selectedDemod = demod;
 
+        // Some demodulators change their output samplerate depending on their options
+        afSampleRateChangedHandler.handler = demodAFSampleRateChangeHandler;
+        afSampleRateChangedHandler.ctx = this;
+        selectedDemod->onAFSampleRateChanged.bindHandler(&afSampleRateChangedHandler);
+
         // Give the demodulator the most recent audio SR
         selectedDemod->AFSampRateChanged(audioSampleRate);
 
@@ -441,7 +487,8 @@ private:
         if (postProcEnabled) {
             // Configure resampler
             afChain.stop();
-            resamp.setInSamplerate(selectedDemod->getAFSampleRate());
+            afSampleRate = selectedDemod->getAFSampleRate();
+            resamp.setInSamplerate(afSampleRate);
             setAudioSampleRate(audioSampleRate);
             afChain.enableBlock(&resamp, [=](dsp::stream<dsp::stereo_t>* out){ stream.setInput(out); });
 
@@ -472,7 +519,7 @@ private:
 
     void setAudioSampleRate(double sr) {
         audioSampleRate = sr;
-        if (!selectedDemod) { return; }
+        if (!selectedDemod || groupMode) { return; }
         selectedDemod->AFSampRateChanged(audioSampleRate);
         if (!postProcEnabled && vfo) {
             // If postproc is disabled, IF SR = AF SR
@@ -584,6 +631,13 @@ private:
         _this->setBandwidth(newBw);
     }
 
+    static void demodAFSampleRateChangeHandler(double afSampleRate, void* ctx) {
+        RadioModule* _this = (RadioModule*)ctx;
+        if (!_this->postProcEnabled || afSampleRate == _this->afSampleRate) { return; }
+        _this->afSampleRate = afSampleRate;
+        _this->resamp.setInSamplerate(afSampleRate);
+    }
+
     static void sampleRateChangeHandler(float sampleRate, void* ctx) {
         RadioModule* _this = (RadioModule*)ctx;
         _this->setAudioSampleRate(sampleRate);
@@ -597,7 +651,7 @@ private:
 
     static void moduleInterfaceHandler(int code, void* in, void* out, void* ctx) {
         RadioModule* _this = (RadioModule*)ctx;
-        if (!_this->enabled || !_this->selectedDemod) { return; }
+        if (!_this->enabled || !_this->selectedDemod || _this->groupMode) { return; }
 
         // Execute commands
         if (code == RADIO_IFACE_CMD_GET_MODE && out) {
@@ -643,6 +697,7 @@ private:
 
     // Handlers
     EventHandler<double> onUserChangedBandwidthHandler;
+    EventHandler<double> afSampleRateChangedHandler;
     EventHandler<float> srChangeHandler;
     EventHandler<dsp::stream<dsp::complex_t>*> ifChainOutputChanged;
     EventHandler<dsp::stream<dsp::stereo_t>*> afChainOutputChanged;
@@ -665,10 +720,14 @@ private:
 
     demod::Demodulator* selectedDemod = NULL;
 
+    ChannelGroup group;
+    bool groupMode = false;
+
     OptionList<std::string, DeemphasisMode> deempModes;
     OptionList<std::string, IFNRPreset> ifnrPresets;
 
     double audioSampleRate = 48000.0;
+    double afSampleRate = 0.0;
     float minBandwidth;
     float maxBandwidth;
     float bandwidth;
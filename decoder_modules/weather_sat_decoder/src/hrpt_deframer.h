@@ -0,0 +1,160 @@
+#pragma once
+#include <dsp/processor.h>
+#include <atomic>
+
+#define HRPT_FRAME_WORDS        11090
+#define HRPT_FRAME_BITS         (HRPT_FRAME_WORDS * 10)
+#define HRPT_SYNC_BITS          60
+#define HRPT_SYNC               0xA116FD719D83C95ull
+#define HRPT_SYNC_MASK          ((1ull << HRPT_SYNC_BITS) - 1)
+
+namespace dsp::noaa {
+    /**
+     * Decodes the Manchester chips of NOAA HRPT and outputs the minor frames as 10-bit words, sync included.
+     * The frame sync is searched for in both chip alignments and polarities at once by correlating
+     * the last 64 bits with a popcount, then followed from frame to frame.
+     */
+    class HRPTDeframer : public Processor<float, uint16_t> {
+        using base_type = Processor<float, uint16_t>;
+    public:
+        HRPTDeframer() {}
+
+        HRPTDeframer(stream<float>* in) { init(in); }
+
+        void reset() {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            lastChip = 0.0f;
+            chipPhase = 0;
+            shift[0] = 0;
+            shift[1] = 0;
+            locked = false;
+            frameBits = 0;
+            misses = 0;
+            base_type::tempStart();
+        }
+
+        bool isLocked() { return locked; }
+
+        int getFrameCount() { return frameCount; }
+
+        int process(int count, const float* in, uint16_t* out) {
+            int outCount = 0;
+            for (int i = 0; i < count; i++) {
+                // Every chip ends a bit in one of the two possible alignments
+                int align = chipPhase;
+                chipPhase ^= 1;
+                int bit = (lastChip > in[i]);
+                lastChip = in[i];
+
+                if (!locked) {
+                    shift[align] = (shift[align] << 1) | bit;
+                    int errors = popcount((shift[align] ^ HRPT_SYNC) & HRPT_SYNC_MASK);
+                    int invErrors = popcount((~shift[align] ^ HRPT_SYNC) & HRPT_SYNC_MASK);
+                    if (errors > MAX_SEARCH_ERRORS && invErrors > MAX_SEARCH_ERRORS) { continue; }
+
+                    // The carrier loop can lock 180 degrees off, which inverts all the bits
+                    inverted = (invErrors < errors);
+                    alignment = align;
+                    locked = true;
+                    misses = 0;
+                    writeSync();
+                    continue;
+                }
+                if (align != alignment) { continue; }
+
+                // Bits are accumulated 8 at a time to fill the frame a byte at a time
+                acc = (acc << 1) | (bit ^ inverted);
+                frameBits++;
+                if (!(frameBits & 7)) { frame[(frameBits >> 3) - 1] = acc; }
+
+                if (frameBits == HRPT_SYNC_BITS) {
+                    // Check the sync of the frame, flywheel through a few bad ones
+                    uint64_t sync = 0;
+                    for (int j = 0; j < 7; j++) { sync = (sync << 8) | frame[j]; }
+                    sync = (sync << 4) | (acc & 0xF);
+                    if (popcount(sync ^ HRPT_SYNC) <= MAX_LOCKED_ERRORS) {
+                        misses = 0;
+                    }
+                    else if (++misses > MAX_MISSES) {
+                        locked = false;
+                        shift[alignment] = inverted ? ~sync : sync;
+                    }
+                }
+                else if (frameBits == HRPT_FRAME_BITS) {
+                    // The frame is a multiple of 4 bits, flush the last half byte
+                    frame[HRPT_FRAME_BITS >> 3] = acc << 4;
+                    unpack(&out[outCount]);
+                    outCount += HRPT_FRAME_WORDS;
+                    frameCount++;
+                    frameBits = 0;
+                }
+            }
+            return outCount;
+        }
+
+        int run() {
+            int count = base_type::_in->read();
+            if (count < 0) { return -1; }
+
+            int outCount = process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+
+            base_type::_in->flush();
+            if (outCount) {
+                if (!base_type::out.swap(outCount)) { return -1; }
+            }
+            return outCount;
+        }
+
+    private:
+        // Start a frame with the sync that was just found
+        void writeSync() {
+            uint64_t sync = HRPT_SYNC;
+            for (int j = 0; j < 7; j++) { frame[j] = sync >> (HRPT_SYNC_BITS - 8 * (j + 1)); }
+            acc = sync;
+            frameBits = HRPT_SYNC_BITS;
+        }
+
+        // Unpack 4 words at a time from 5 bytes
+        void unpack(uint16_t* out) {
+            const uint8_t* in = frame;
+            for (int i = 0; i < HRPT_FRAME_WORDS - 2; i += 4) {
+                uint64_t v = ((uint64_t)in[0] << 32) | ((uint64_t)in[1] << 24) | ((uint64_t)in[2] << 16) | ((uint64_t)in[3] << 8) | in[4];
+                out[i] = (v >> 30) & 0x3FF;
+                out[i + 1] = (v >> 20) & 0x3FF;
+                out[i + 2] = (v >> 10) & 0x3FF;
+                out[i + 3] = v & 0x3FF;
+                in += 5;
+            }
+            // 11090 isn't a multiple of 4, the last two words are in the last 20 bits
+            uint32_t v = ((uint32_t)in[0] << 16) | ((uint32_t)in[1] << 8) | in[2];
+            out[HRPT_FRAME_WORDS - 2] = (v >> 14) & 0x3FF;
+            out[HRPT_FRAME_WORDS - 1] = (v >> 4) & 0x3FF;
+        }
+
+        static inline int popcount(uint64_t x) {
+            x = x - ((x >> 1) & 0x5555555555555555ull);
+            x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+            x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+            return (int)((x * 0x0101010101010101ull) >> 56);
+        }
+
+        const int MAX_SEARCH_ERRORS = 4;
+        const int MAX_LOCKED_ERRORS = 12;
+        const int MAX_MISSES = 4;
+
+        float lastChip = 0.0f;
+        int chipPhase = 0;
+        uint64_t shift[2] = { 0, 0 };
+
+        std::atomic<bool> locked = false;
+        bool inverted = false;
+        int alignment = 0;
+        int misses = 0;
+        int frameBits = 0;
+        uint8_t acc = 0;
+        uint8_t frame[(HRPT_FRAME_BITS >> 3) + 1];
+        std::atomic<int> frameCount = 0;
+    };
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <dsp/processor.h>
+#include <dsp/loop/fast_agc.h>
+#include <dsp/loop/carrier_tracking_pll.h>
+#include <dsp/taps/root_raised_cosine.h>
+#include <dsp/filter/fir.h>
+#include <dsp/clock_recovery/mm.h>
+
+namespace dsp::demod {
+    /**
+     * Demodulates the residual carrier PM signal of NOAA HRPT into Manchester chips.
+     * The carrier is tracked by a PLL and the quadrature component relative to it is matched filtered and sampled once per chip.
+     * It's the coherent detector of the data, it does noticeably better than the phase itself at low SNR.
+     */
+    class HRPT : public Processor<complex_t, float> {
+        using base_type = Processor<complex_t, float>;
+    public:
+        HRPT() {}
+
+        HRPT(stream<complex_t>* in, double chiprate, double samplerate, double agcRate, double pllBandwidth, int rrcTapCount, double rrcBeta, double omegaGain, double muGain, double omegaRelLimit = 0.01) {
+            init(in, chiprate, samplerate, agcRate, pllBandwidth, rrcTapCount, rrcBeta, omegaGain, muGain, omegaRelLimit);
+        }
+
+        ~HRPT() {
+            if (!base_type::_block_init) { return; }
+            base_type::stop();
+            taps::free(rrcTaps);
+            buffer::free(pllBuf);
+        }
+
+        void init(stream<complex_t>* in, double chiprate, double samplerate, double agcRate, double pllBandwidth, int rrcTapCount, double rrcBeta, double omegaGain, double muGain, double omegaRelLimit = 0.01) {
+            _chiprate = chiprate;
+            _samplerate = samplerate;
+            _rrcTapCount = rrcTapCount;
+            _rrcBeta = rrcBeta;
+
+            rrcTaps = taps::rootRaisedCosine<float>(_rrcTapCount, _rrcBeta, _chiprate, _samplerate);
+            agc.init(NULL, 1.0, 10e6, agcRate);
+            pll.init(NULL, pllBandwidth);
+            rrc.init(NULL, rrcTaps);
+            recov.init(NULL, _samplerate / _chiprate, omegaGain, muGain, omegaRelLimit);
+            pllBuf = buffer::alloc<complex_t>(STREAM_BUFFER_SIZE);
+
+            agc.out.free();
+            pll.out.free();
+            rrc.out.free();
+            recov.out.free();
+
+            base_type::init(in);
+        }
+
+        void setPLLBandwidth(double bandwidth) {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            pll.setBandwidth(bandwidth);
+        }
+
+        void reset() {
+            assert(base_type::_block_init);
+            std::lock_guard<std::recursive_mutex> lck(base_type::ctrlMtx);
+            base_type::tempStop();
+            agc.reset();
+            pll.reset();
+            rrc.reset();
+            recov.reset();
+            base_type::tempStart();
+        }
+
+        inline int process(int count, complex_t* in, float* out) {
+            pll.process(count, in, pllBuf);
+            for (int i = 0; i < count; i++) {
+                out[i] = pllBuf[i].im;
+            }
+            agc.process(count, out, out);
+            rrc.process(count, out, out);
+            return recov.process(count, out, out);
+        }
+
+        int run() {
+            int count = base_type::_in->read();
+            if (count < 0) { return -1; }
+
+            int outCount = process(count, base_type::_in->readBuf, base_type::out.writeBuf);
+
+            // Swap if some data was generated
+            base_type::_in->flush();
+            if (outCount) {
+                if (!base_type::out.swap(outCount)) { return -1; }
+            }
+            return outCount;
+        }
+
+    protected:
+        double _chiprate;
+        double _samplerate;
+        int _rrcTapCount;
+        double _rrcBeta;
+
+        complex_t* pllBuf;
+        tap<float> rrcTaps;
+        loop::FastAGC<float> agc;
+        loop::CarrierTrackingPLL pll;
+        filter::FIR<float, float> rrc;
+        clock_recovery::MM<float> recov;
+    };
+}
@@ -0,0 +1,659 @@
+#include <imgui.h>
+#include <module.h>
+#include <dsp/types.h>
+#include <dsp/stream.h>
+#include <dsp/sink/handler_sink.h>
+#include <dsp/audio/activity_detector.h>
+#include <gui/gui.h>
+#include <gui/style.h>
+#include <gui/widgets/folder_select.h>
+#include <signal_path/signal_path.h>
+#include <config.h>
+#include <core.h>
+#include <utils/wav.h>
+#include <utils/freq_formatting.h>
+#include <radio_interface.h>
+#include <filesystem>
+#include <regex>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <set>
+#include <algorithm>
+#include <inttypes.h>
+#include "writer_pool.h"
+
+#define CONCAT(a, b) ((std::string(a) + b).c_str())
+
+#define SILENCE_LVL 10e-6
+
+#define STAGING_SIZE            (64 * 1024)
+#define WAV_HEADER_SIZE         44
+#define WAV_MAX_DATA_SIZE       0xFFFF0000ULL
+#define MAX_HANG_TIME           10000
+#define INDEX_FILE_NAME         "index.csv"
+
+SDRPP_MOD_INFO{
+    /* Name:            */ "multi_recorder",
+    /* Description:     */ "Squelch gated multi-channel recorder for SDR++",
+    /* Author:          */ "Ryzerth",
+    /* Version:         */ 0, 1, 0,
+    /* Max instances    */ -1
+};
+
+ConfigManager config;
+
+class MultiRecorderModule : public ModuleManager::Instance {
+public:
+    MultiRecorderModule(std::string name) : folderSelect("%ROOT%/recordings") {
+        this->name = name;
+        root = (std::string)core::args["root"];
+        strcpy(nameTemplate, "$n/$y-$M-$d/$h$m$s_$f");
+
+        // Load config
+        config.acquire();
+        if (config.conf[name].contains("recPath")) {
+            folderSelect.setPath(config.conf[name]["recPath"]);
+        }
+        if (config.conf[name].contains("nameTemplate")) {
+            std::string _nameTemplate = config.conf[name]["nameTemplate"];
+            if (_nameTemplate.length() > sizeof(nameTemplate)-1) {
+                _nameTemplate = _nameTemplate.substr(0, sizeof(nameTemplate)-1);
+            }
+            strcpy(nameTemplate, _nameTemplate.c_str());
+        }
+        if (config.conf[name].contains("streams")) {
+            for (const auto& s : config.conf[name]["streams"]) {
+                selectedStreams.insert((std::string)s);
+            }
+        }
+        if (config.conf[name].contains("threads")) {
+            threads = std::clamp<int>(config.conf[name]["threads"], 1, WRITER_POOL_MAX_THREADS);
+        }
+        if (config.conf[name].contains("hangTime")) {
+            hangTime = std::clamp<int>(config.conf[name]["hangTime"], 0, MAX_HANG_TIME);
+        }
+        if (config.conf[name].contains("stereo")) {
+            stereo = config.conf[name]["stereo"];
+        }
+        config.release();
+
+        fftRedrawHandler.ctx = this;
+        fftRedrawHandler.handler = fftRedraw;
+        gui::waterfall.onFFTRedraw.bindHandler(&fftRedrawHandler);
+
+        gui::menu.registerEntry(name, menuHandler, this);
+    }
+
+    ~MultiRecorderModule() {
+        gui::menu.removeEntry(name);
+        gui::waterfall.onFFTRedraw.unbindHandler(&fftRedrawHandler);
+        stop();
+        sigpath::sinkManager.onStreamRegistered.unbindHandler(&onStreamRegisteredHandler);
+        sigpath::sinkManager.onStreamUnregister.unbindHandler(&onStreamUnregisterHandler);
+    }
+
+    void postInit() {
+        // Enumerate streams
+        streamNames = sigpath::sinkManager.getStreamNames();
+
+        // Bind stream register/unregister handlers
+        onStreamRegisteredHandler.ctx = this;
+        onStreamRegisteredHandler.handler = streamRegisteredHandler;
+        sigpath::sinkManager.onStreamRegistered.bindHandler(&onStreamRegisteredHandler);
+        onStreamUnregisterHandler.ctx = this;
+        onStreamUnregisterHandler.handler = streamUnregisterHandler;
+        sigpath::sinkManager.onStreamUnregister.bindHandler(&onStreamUnregisterHandler);
+    }
+
+    void enable() {
+        enabled = true;
+    }
+
+    void disable() {
+        enabled = false;
+    }
+
+    bool isEnabled() {
+        return enabled;
+    }
+
+    void start() {
+        std::lock_guard<std::recursive_mutex> lck(chanMtx);
+        if (running) { return; }
+
+        // Settings can't change while running, the sink threads use these copies
+        activeFolder = expandString(folderSelect.path);
+        activeTemplate = nameTemplate;
+        activeChannels = stereo ? 2 : 1;
+
+        pool.start(threads);
+
+        // All channels append their recordings to the same index
+        std::string indexPath = activeFolder + "/" + INDEX_FILE_NAME;
+        bool newIndex = !std::filesystem::exists(indexPath) || !std::filesystem::file_size(indexPath);
+        indexFile = pool.open(indexPath, true);
+        if (newIndex) {
+            writeIndex("start,stop,duration,stream,frequency,mode,peak_db,file\n");
+        }
+
+        running = true;
+        for (const auto& s : streamNames) {
+            if (selectedStreams.find(s) != selectedStreams.end()) { startChannel(s); }
+        }
+    }
+
+    void stop() {
+        std::lock_guard<std::recursive_mutex> lck(chanMtx);
+        if (!running) { return; }
+        while (!channels.empty()) {
+            stopChannel(channels.begin()->first);
+        }
+        // The pool closes the index once the rows queued by the last recordings are written
+        pool.stop();
+        indexFile = 0;
+        running = false;
+    }
+
+private:
+    struct Channel {
+        MultiRecorderModule* module;
+        std::string name;
+        dsp::stream<dsp::stereo_t>* stream = NULL;
+        dsp::sink::Handler<dsp::stereo_t> sink;
+        uint64_t samplerate = 48000;
+
+        // Updated by the UI thread
+        std::atomic<double> frequency = 0.0;
+        std::atomic<int> mode = -1;
+
+        // Current recording, only accessed by the sink thread while it runs
+        std::atomic<bool> recording = false;
+        WriterPool::FileId file = 0;
+        std::string path;
+        std::string lastPath;
+        int pathCount = 0;
+        std::vector<uint8_t> staging;
+        uint64_t dataBytes = 0;
+        uint64_t samples = 0;
+        dsp::audio::ActivityDetector detector;
+        float peak = 0.0f;
+        double recFrequency = 0.0;
+        int recMode = -1;
+        std::chrono::system_clock::time_point startTime;
+        std::atomic<uint64_t> recordings = 0;
+    };
+
+    static void menuHandler(void* ctx) {
+        MultiRecorderModule* _this = (MultiRecorderModule*)ctx;
+        float menuWidth = ImGui::GetContentRegionAvail().x;
+        bool running = _this->running;
+
+        // Recording path
+        if (running) { style::beginDisabled(); }
+        if (_this->folderSelect.render("##_multi_recorder_fold_" + _this->name)) {
+            if (_this->folderSelect.pathIsValid()) {
+                config.acquire();
+                config.conf[_this->name]["recPath"] = _this->folderSelect.path;
+                config.release(true);
+            }
+        }
+
+        ImGui::LeftLabel("Name template");
+        ImGui::FillWidth();
+        if (ImGui::InputText(CONCAT("##_multi_recorder_name_template_", _this->name), _this->nameTemplate, 1023)) {
+            config.acquire();
+            config.conf[_this->name]["nameTemplate"] = _this->nameTemplate;
+            config.release(true);
+        }
+
+        ImGui::LeftLabel("I/O threads");
+        ImGui::FillWidth();
+        if (ImGui::InputInt(CONCAT("##_multi_recorder_threads_", _this->name), &_this->threads)) {
+            _this->threads = std::clamp<int>(_this->threads, 1, WRITER_POOL_MAX_THREADS);
+            config.acquire();
+            config.conf[_this->name]["threads"] = _this->threads;
+            config.release(true);
+        }
+
+        if (ImGui::Checkbox(CONCAT("Stereo##_multi_recorder_stereo_", _this->name), &_this->stereo)) {
+            config.acquire();
+            config.conf[_this->name]["stereo"] = _this->stereo;
+            config.release(true);
+        }
+        if (running) { style::endDisabled(); }
+
+        ImGui::LeftLabel("Hang time (ms)");
+        ImGui::FillWidth();
+        int hangTime = _this->hangTime;
+        if (ImGui::InputInt(CONCAT("##_multi_recorder_hang_", _this->name), &hangTime, 100, 1000)) {
+            _this->hangTime = std::clamp<int>(hangTime, 0, MAX_HANG_TIME);
+            config.acquire();
+            config.conf[_this->name]["hangTime"] = (int)_this->hangTime;
+            config.release(true);
+        }
+
+        // Channel list
+        std::lock_guard<std::recursive_mutex> lck(_this->chanMtx);
+        if (ImGui::BeginTable(CONCAT("multi_recorder_chan_table_", _this->name), 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY, ImVec2(0, 200))) {
+            ImGui::TableSetupColumn("Stream");
+            ImGui::TableSetupColumn("Frequency");
+            ImGui::TableSetupColumn("Files");
+            ImGui::TableSetupScrollFreeze(3, 1);
+            ImGui::TableHeadersRow();
+            for (const auto& s : _this->streamNames) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                bool selected = (_this->selectedStreams.find(s) != _this->selectedStreams.end());
+                if (ImGui::Checkbox(CONCAT(s, "##_multi_recorder_chan_" + _this->name), &selected)) {
+                    _this->selectStream(s, selected);
+                }
+
+                auto it = _this->channels.find(s);
+                if (it == _this->channels.end()) { continue; }
+                Channel* ch = it->second;
+                ImGui::TableSetColumnIndex(1);
+                ImGui::TextUnformatted(utils::formatFreq(ch->frequency).c_str());
+                ImGui::TableSetColumnIndex(2);
+                if (ch->recording) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%" PRIu64 " (REC)", (uint64_t)ch->recordings);
+                }
+                else {
+                    ImGui::Text("%" PRIu64, (uint64_t)ch->recordings);
+                }
+            }
+            ImGui::EndTable();
+        }
+
+        if (ImGui::BeginTable(CONCAT("multi_recorder_sel_btn_table_", _this->name), 2)) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            if (ImGui::Button(CONCAT("Select all##_multi_recorder_sel_all_", _this->name), ImVec2(ImGui::GetContentRegionAvail().x, 0))) {
+                for (const auto& s : _this->streamNames) { _this->selectStream(s, true); }
+            }
+            ImGui::TableSetColumnIndex(1);
+            if (ImGui::Button(CONCAT("Clear##_multi_recorder_sel_none_", _this->name), ImVec2(ImGui::GetContentRegionAvail().x, 0))) {
+                for (const auto& s : _this->streamNames) { _this->selectStream(s, false); }
+            }
+            ImGui::EndTable();
+        }
+
+        // Record button
+        if (!running) {
+            bool canRecord = _this->folderSelect.pathIsValid();
+            if (!canRecord) { style::beginDisabled(); }
+            if (ImGui::Button(CONCAT("Record##_multi_recorder_rec_", _this->name), ImVec2(menuWidth, 0))) {
+                _this->start();
+            }
+            if (!canRecord) { style::endDisabled(); }
+            ImGui::TextColored(ImGui::GetStyleColorVec4(ImGuiCol_Text), "Idle");
+            return;
+        }
+
+        if (ImGui::Button(CONCAT("Stop##_multi_recorder_rec_", _this->name), ImVec2(menuWidth, 0))) {
+            _this->stop();
+            return;
+        }
+        int active = 0;
+        for (auto& [n, ch] : _this->channels) {
+            if (ch->recording) { active++; }
+        }
+        ImGui::TextColored(active ? ImVec4(1.0f, 0.0f, 0.0f, 1.0f) : ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Recording %d/%d channels", active, (int)_this->channels.size());
+
+        // Writer pool statistics
+        char buf[128];
+        float queueFill = _this->pool.getQueueFill();
+        sprintf(buf, "Buffer %d%%", (int)round(queueFill * 100.0f));
+        ImGui::ProgressBar(queueFill, ImVec2(menuWidth, 0), buf);
+        ImGui::Text("Disk: %.1lfMB/s, Open files: %d", _this->pool.getThroughput() / 1e6, _this->pool.getOpenFiles());
+        uint64_t dropped = _this->pool.getDroppedBytes();
+        if (dropped) {
+            ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Dropped: %.1lfMB", (double)dropped / 1e6);
+        }
+    }
+
+    void selectStream(std::string name, bool selected) {
+        std::lock_guard<std::recursive_mutex> lck(chanMtx);
+        if (selected) {
+            selectedStreams.insert(name);
+            if (running && channels.find(name) == channels.end()) { startChannel(name); }
+        }
+        else {
+            selectedStreams.erase(name);
+            if (running && channels.find(name) != channels.end()) { stopChannel(name); }
+        }
+
+        config.acquire();
+        config.conf[this->name]["streams"] = json::array();
+        for (const auto& s : selectedStreams) {
+            config.conf[this->name]["streams"].push_back(s);
+        }
+        config.release(true);
+    }
+
+    void startChannel(std::string name) {
+        dsp::stream<dsp::stereo_t>* stream = sigpath::sinkManager.bindStream(name);
+        if (!stream) { return; }
+        Channel* ch = new Channel;
+        ch->module = this;
+        ch->name = name;
+        ch->stream = stream;
+        ch->samplerate = sigpath::sinkManager.getStreamSampleRate(name);
+        ch->detector.init(SILENCE_LVL, SILENCE_LVL, 0);
+        updateChannelInfo(ch);
+        ch->sink.init(stream, handler, ch);
+        channels[name] = ch;
+        ch->sink.start();
+    }
+
+    void stopChannel(std::string name) {
+        auto it = channels.find(name);
+        if (it == channels.end()) { return; }
+        Channel* ch = it->second;
+
+        // Once the sink is stopped, the recording can be finished from this thread
+        ch->sink.stop();
+        if (ch->recording) { endRecording(ch); }
+        sigpath::sinkManager.unbindStream(name, ch->stream);
+        channels.erase(it);
+        delete ch;
+    }
+
+    void updateChannelInfo(Channel* ch) {
+        double freq = gui::waterfall.getCenterFrequency();
+        if (gui::waterfall.vfos.find(ch->name) != gui::waterfall.vfos.end()) {
+            freq += gui::waterfall.vfos[ch->name]->generalOffset;
+        }
+        ch->frequency = freq;
+
+        if (core::modComManager.getModuleName(ch->name) == "radio") {
+            int mode;
+            core::modComManager.callInterface(ch->name, RADIO_IFACE_CMD_GET_MODE, NULL, &mode);
+            ch->mode = mode;
+        }
+    }
+
+    static void fftRedraw(ImGui::WaterFall::FFTRedrawArgs args, void* ctx) {
+        MultiRecorderModule* _this = (MultiRecorderModule*)ctx;
+        std::lock_guard<std::recursive_mutex> lck(_this->chanMtx);
+        for (auto& [n, ch] : _this->channels) {
+            _this->updateChannelInfo(ch);
+        }
+    }
+
+    static void handler(dsp::stereo_t* data, int count, void* ctx) {
+        Channel* ch = (Channel*)ctx;
+        MultiRecorderModule* _this = ch->module;
+
+        float* _data = (float*)data;
+        int _count = count * 2;
+
+        // Open a file when the squelch opens, close it once it stayed closed for the hang time
+        ch->detector.setHang(((uint64_t)_this->hangTime * ch->samplerate) / 1000);
+        dsp::audio::ActivityDetector::Event event = ch->detector.process(_data, _count, 2);
+        if (event == dsp::audio::ActivityDetector::EVENT_START) {
+            _this->beginRecording(ch);
+        }
+        else if (event == dsp::audio::ActivityDetector::EVENT_END && ch->recording) {
+            _this->endRecording(ch);
+        }
+        if (!ch->recording) { return; }
+        float level = ch->detector.getLevel();
+        if (level > ch->peak) { ch->peak = level; }
+
+        // Start a new file before reaching the WAV size limit
+        size_t bytes = (size_t)count * _this->activeChannels * sizeof(int16_t);
+        if (ch->dataBytes + ch->staging.size() + bytes > WAV_MAX_DATA_SIZE) {
+            _this->endRecording(ch);
+            _this->beginRecording(ch);
+            if (!ch->recording) { return; }
+        }
+
+        // Convert to 16bit PCM into the staging buffer
+        size_t offset = ch->staging.size();
+        ch->staging.resize(offset + bytes);
+        int16_t* out = (int16_t*)&ch->staging[offset];
+        if (_this->activeChannels == 2) {
+            for (int i = 0; i < _count; i++) {
+                out[i] = std::clamp<float>(_data[i], -1.0f, 1.0f) * 32767.0f;
+            }
+        }
+        else {
+            for (int i = 0; i < count; i++) {
+                out[i] = std::clamp<float>((data[i].l + data[i].r) * 0.5f, -1.0f, 1.0f) * 32767.0f;
+            }
+        }
+        ch->samples += count;
+        if (ch->staging.size() >= STAGING_SIZE) { _this->flushStaging(ch); }
+    }
+
+    void beginRecording(Channel* ch) {
+        ch->startTime = std::chrono::system_clock::now();
+        ch->recFrequency = ch->frequency;
+        ch->recMode = ch->mode;
+        ch->dataBytes = 0;
+        ch->samples = 0;
+        ch->peak = 0.0f;
+
+        // Don't overwrite a file started in the same second
+        std::string path = activeFolder + "/" + genFileName(ch);
+        if (path == ch->lastPath) {
+            ch->path = path + "_" + std::to_string(++ch->pathCount) + ".wav";
+        }
+        else {
+            ch->lastPath = path;
+            ch->pathCount = 0;
+            ch->path = path + ".wav";
+        }
+
+        ch->file = pool.open(ch->path);
+        if (!ch->file) { return; }
+        std::vector<uint8_t> hdr = pool.getBuffer();
+        genWavHeader(hdr, ch, 0);
+        pool.write(ch->file, std::move(hdr), false);
+        ch->staging = pool.getBuffer();
+        ch->staging.reserve(STAGING_SIZE + STREAM_BUFFER_SIZE * sizeof(dsp::stereo_t));
+        ch->recording = true;
+    }
+
+    void endRecording(Channel* ch) {
+        flushStaging(ch);
+
+        // Update the sizes in the header then close
+        std::vector<uint8_t> hdr = pool.getBuffer();
+        genWavHeader(hdr, ch, ch->dataBytes);
+        pool.writeAt(ch->file, std::move(hdr), 0);
+        ch->recording = false;
+        ch->recordings++;
+
+        // The recording is added to the index once closed, unless its file couldn't be created
+        auto stopTime = std::chrono::system_clock::now();
+        double duration = (double)ch->samples / (double)ch->samplerate;
+        float peakDb = (ch->peak > 0.0f) ? 20.0f * log10f(ch->peak) : -INFINITY;
+        std::string relPath = ch->path.substr(std::min<size_t>(activeFolder.size() + 1, ch->path.size()));
+        char buf[128];
+        sprintf(buf, ",%.3lf,", duration);
+        std::string line = formatTime(ch->startTime) + "," + formatTime(stopTime) + buf + csvQuote(ch->name) + ",";
+        sprintf(buf, "%.0lf,%s,%.1f,", ch->recFrequency, modeToString(ch->recMode).c_str(), peakDb);
+        line += buf + csvQuote(relPath) + "\n";
+        std::vector<uint8_t> row = pool.getBuffer();
+        row.assign(line.begin(), line.end());
+        pool.close(ch->file, indexFile, std::move(row));
+        ch->file = 0;
+    }
+
+    void flushStaging(Channel* ch) {
+        if (ch->staging.empty()) { return; }
+        size_t len = ch->staging.size();
+        if (pool.write(ch->file, std::move(ch->staging))) { ch->dataBytes += len; }
+        ch->staging = pool.getBuffer();
+        ch->staging.reserve(STAGING_SIZE + STREAM_BUFFER_SIZE * sizeof(dsp::stereo_t));
+    }
+
+    void writeIndex(const std::string& line) {
+        std::vector<uint8_t> buf = pool.getBuffer();
+        buf.assign(line.begin(), line.end());
+        pool.write(indexFile, std::move(buf), false);
+    }
+
+    void genWavHeader(std::vector<uint8_t>& out, Channel* ch, uint32_t dataBytes) {
+        wav::FormatHeader fmt;
+        fmt.codec = wav::CODEC_PCM;
+        fmt.channelCount = activeChannels;
+        fmt.sampleRate = ch->samplerate;
+        fmt.bitDepth = 16;
+        fmt.bytesPerSample = activeChannels * sizeof(int16_t);
+        fmt.bytesPerSecond = fmt.sampleRate * fmt.bytesPerSample;
+
+        uint32_t riffSize = WAV_HEADER_SIZE - 8 + dataBytes;
+        uint32_t fmtSize = sizeof(wav::FormatHeader);
+        out.resize(WAV_HEADER_SIZE);
+        uint8_t* p = out.data();
+        memcpy(p, "RIFF", 4);
+        memcpy(p + 4, &riffSize, 4);
+        memcpy(p + 8, "WAVEfmt ", 8);
+        memcpy(p + 16, &fmtSize, 4);
+        memcpy(p + 20, &fmt, sizeof(wav::FormatHeader));
+        memcpy(p + 36, "data", 4);
+        memcpy(p + 40, &dataBytes, 4);
+    }
+
+    std::string genFileName(Channel* ch) {
+        tm utc = toUTC(std::chrono::system_clock::to_time_t(ch->startTime));
+        char year[8], month[8], day[8], hour[8], minute[8], second[8], frequency[32];
+        sprintf(year,   "%04d", utc.tm_year + 1900);
+        sprintf(month,  "%02d", utc.tm_mon + 1);
+        sprintf(day,    "%02d", utc.tm_mday);
+        sprintf(hour,   "%02d", utc.tm_hour);
+        sprintf(minute, "%02d", utc.tm_min);
+        sprintf(second, "%02d", utc.tm_sec);
+        sprintf(frequency, "%011.0lf", ch->recFrequency);
+
+        std::string templ = activeTemplate;
+        templ = std::regex_replace(templ, std::regex("\\$n"), ch->name);
+        templ = std::regex_replace(templ, std::regex("\\$f"), frequency);
+        templ = std::regex_replace(templ, std::regex("\\$h"), hour);
+        templ = std::regex_replace(templ, std::regex("\\$m"), minute);
+        templ = std::regex_replace(templ, std::regex("\\$s"), second);
+        templ = std::regex_replace(templ, std::regex("\\$d"), day);
+        templ = std::regex_replace(templ, std::regex("\\$M"), month);
+        templ = std::regex_replace(templ, std::regex("\\$y"), year);
+        templ = std::regex_replace(templ, std::regex("\\$r"), modeToString(ch->recMode));
+        return templ;
+    }
+
+    static std::string modeToString(int mode) {
+        static std::map<int, const char*> radioModeToString = {
+            { RADIO_IFACE_MODE_NFM, "NFM" },
+            { RADIO_IFACE_MODE_WFM, "WFM" },
+            { RADIO_IFACE_MODE_AM,  "AM"  },
+            { RADIO_IFACE_MODE_DSB, "DSB" },
+            { RADIO_IFACE_MODE_USB, "USB" },
+            { RADIO_IFACE_MODE_CW,  "CW"  },
+            { RADIO_IFACE_MODE_LSB, "LSB" },
+            { RADIO_IFACE_MODE_RAW, "RAW" }
+        };
+        auto it = radioModeToString.find(mode);
+        return (it != radioModeToString.end()) ? it->second : "unknown";
+    }
+
+    static std::string formatTime(std::chrono::system_clock::time_point t) {
+        int ms = std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count() % 1000;
+        tm utc = toUTC(std::chrono::system_clock::to_time_t(t));
+        char buf[64];
+        sprintf(buf, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, ms);
+        return buf;
+    }
+
+    // Every channel names its files from its own sink thread, gmtime() isn't reentrant
+    static tm toUTC(time_t t) {
+        tm utc;
+#ifdef _WIN32
+        gmtime_s(&utc, &t);
+#else
+        gmtime_r(&t, &utc);
+#endif
+        return utc;
+    }
+
+    static std::string csvQuote(std::string str) {
+        return "\"" + std::regex_replace(str, std::regex("\""), "\"\"") + "\"";
+    }
+
+    std::string expandString(std::string input) {
+        input = std::regex_replace(input, std::regex("%ROOT%"), root);
+        return std::regex_replace(input, std::regex("//"), "/");
+    }
+
+    static void streamRegisteredHandler(std::string name, void* ctx) {
+        MultiRecorderModule* _this = (MultiRecorderModule*)ctx;
+        std::lock_guard<std::recursive_mutex> lck(_this->chanMtx);
+        _this->streamNames.push_back(name);
+        if (_this->running && _this->selectedStreams.find(name) != _this->selectedStreams.end()) {
+            _this->startChannel(name);
+        }
+    }
+
+    static void streamUnregisterHandler(std::string name, void* ctx) {
+        MultiRecorderModule* _this = (MultiRecorderModule*)ctx;
+        std::lock_guard<std::recursive_mutex> lck(_this->chanMtx);
+        _this->stopChannel(name);
+        _this->streamNames.erase(std::remove(_this->streamNames.begin(), _this->streamNames.end(), name), _this->streamNames.end());
+    }
+
+    std::string name;
+    bool enabled = true;
+    std::string root;
+
+    FolderSelect folderSelect;
+    char nameTemplate[1024];
+    int threads = 2;
+    std::atomic<int> hangTime = 1000;
+    bool stereo = false;
+
+    std::vector<std::string> streamNames;
+    std::set<std::string> selectedStreams;
+
+    // Recording state
+    std::recursive_mutex chanMtx;
+    std::atomic<bool> running = false;
+    std::map<std::string, Channel*> channels;
+    WriterPool pool;
+    WriterPool::FileId indexFile = 0;
+    std::string activeFolder;
+    std::string activeTemplate;
+    int activeChannels = 1;
+
+    EventHandler<std::string> onStreamRegisteredHandler;
+    EventHandler<std::string> onStreamUnregisterHandler;
+    EventHandler<ImGui::WaterFall::FFTRedrawArgs> fftRedrawHandler;
+};
+
+MOD_EXPORT void _INIT_() {
+    // Create default recording directory
+    std::string root = (std::string)core::args["root"];
+    if (!std::filesystem::exists(root + "/recordings")) {
+        flog::warn("Recordings directory does not exist, creating it");
+        if (!std::filesystem::create_directory(root + "/recordings")) {
+            flog::error("Could not create recordings directory");
+        }
+    }
+    json def = json({});
+    config.setPath(root + "/multi_recorder_config.json");
+    config.load(def);
+    config.enableAutoSave();
+}
+
+MOD_EXPORT ModuleManager::Instance* _CREATE_INSTANCE_(std::string name) {
+    return new MultiRecorderModule(name);
+}
+
+MOD_EXPORT void _DELETE_INSTANCE_(ModuleManager::Instance* inst) {
+    delete (MultiRecorderModule*)inst;
+}
+
+MOD_EXPORT void _END_() {
+    config.disableAutoSave();
+    config.save();
+}
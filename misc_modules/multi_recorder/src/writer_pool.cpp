@@ -0,0 +1,294 @@
+#include "writer_pool.h"
+#include <algorithm>
+#include <filesystem>
+#include <utils/flog.h>
+
+#ifdef _WIN32
+#define pool_fseek  _fseeki64
+#else
+#define pool_fseek  fseeko
+#endif
+
+WriterPool::WriterPool() {}
+
+WriterPool::~WriterPool() {
+    stop();
+}
+
+void WriterPool::start(int threads) {
+    std::lock_guard<std::mutex> lck(ctrlMtx);
+    if (running) { return; }
+    threads = std::clamp<int>(threads, 1, WRITER_POOL_MAX_THREADS);
+
+    queuedBytes = 0;
+    droppedBytes = 0;
+    errors = 0;
+    openFiles = 0;
+    {
+        std::lock_guard<std::mutex> lck2(statMtx);
+        throughput = 0.0;
+        windowBytes = 0;
+        windowStart = std::chrono::steady_clock::now();
+    }
+
+    for (int i = 0; i < threads; i++) {
+        Worker* w = new Worker;
+        workers.push_back(std::unique_ptr<Worker>(w));
+        w->thread = std::thread(&WriterPool::worker, this, w);
+    }
+    running = true;
+}
+
+void WriterPool::stop() {
+    std::lock_guard<std::mutex> lck(ctrlMtx);
+    if (!running) { return; }
+    running = false;
+
+    // Wait for all jobs to be done, close jobs can queue writes to other workers
+    {
+        std::unique_lock<std::mutex> lck2(idleMtx);
+        idleCnd.wait(lck2, [this]() { return !pendingJobs; });
+    }
+
+    // Workers finish their queue before exiting
+    for (auto& w : workers) {
+        {
+            std::lock_guard<std::mutex> lck2(w->mtx);
+            w->stop = true;
+        }
+        w->cnd.notify_all();
+    }
+    for (auto& w : workers) {
+        if (w->thread.joinable()) { w->thread.join(); }
+    }
+    workers.clear();
+
+    std::lock_guard<std::mutex> lck2(bufMtx);
+    freeBuffers.clear();
+}
+
+bool WriterPool::isRunning() {
+    return running;
+}
+
+void WriterPool::setMaxQueued(size_t bytes) {
+    maxQueued = bytes;
+}
+
+WriterPool::FileId WriterPool::open(std::string path, bool append) {
+    if (!running) { return 0; }
+    Job job;
+    job.type = JOB_OPEN;
+    job.file = nextId++;
+    job.path = path;
+    job.append = append;
+    FileId id = job.file;
+    queue(std::move(job));
+    return id;
+}
+
+std::vector<uint8_t> WriterPool::getBuffer() {
+    std::lock_guard<std::mutex> lck(bufMtx);
+    if (freeBuffers.empty()) { return std::vector<uint8_t>(); }
+    std::vector<uint8_t> buf = std::move(freeBuffers.back());
+    freeBuffers.pop_back();
+    buf.clear();
+    return buf;
+}
+
+bool WriterPool::write(FileId file, std::vector<uint8_t>&& data, bool droppable) {
+    size_t len = data.size();
+    if (!running || !file || (droppable && queuedBytes + len > maxQueued)) {
+        droppedBytes += len;
+        recycle(std::move(data));
+        return false;
+    }
+    Job job;
+    job.type = JOB_WRITE;
+    job.file = file;
+    job.data = std::move(data);
+    queuedBytes += len;
+    queue(std::move(job));
+    return true;
+}
+
+void WriterPool::writeAt(FileId file, std::vector<uint8_t>&& data, uint64_t offset) {
+    if (!running || !file) {
+        recycle(std::move(data));
+        return;
+    }
+    Job job;
+    job.type = JOB_WRITE_AT;
+    job.file = file;
+    job.data = std::move(data);
+    job.offset = offset;
+    queuedBytes += job.data.size();
+    queue(std::move(job));
+}
+
+void WriterPool::close(FileId file) {
+    if (!running || !file) { return; }
+    Job job;
+    job.type = JOB_CLOSE;
+    job.file = file;
+    queue(std::move(job));
+}
+
+void WriterPool::close(FileId file, FileId logFile, std::vector<uint8_t>&& logData) {
+    if (!running || !file) {
+        recycle(std::move(logData));
+        return;
+    }
+    Job job;
+    job.type = JOB_CLOSE;
+    job.file = file;
+    job.logFile = logFile;
+    job.data = std::move(logData);
+    queue(std::move(job));
+}
+
+float WriterPool::getQueueFill() {
+    if (!maxQueued) { return 0.0f; }
+    return std::min<float>((float)queuedBytes / (float)maxQueued, 1.0f);
+}
+
+double WriterPool::getThroughput() {
+    std::lock_guard<std::mutex> lck(statMtx);
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - windowStart).count();
+    if (elapsed >= 1.0) {
+        throughput = (double)windowBytes / elapsed;
+        windowBytes = 0;
+        windowStart = now;
+    }
+    return throughput;
+}
+
+void WriterPool::queue(Job&& job) {
+    std::lock_guard<std::mutex> lck(ctrlMtx);
+    if (workers.empty()) {
+        if (job.type == JOB_WRITE || job.type == JOB_WRITE_AT) { queuedBytes -= job.data.size(); }
+        return;
+    }
+    push(std::move(job));
+}
+
+// The worker list only changes once all workers have stopped, so workers may call this directly
+void WriterPool::push(Job&& job) {
+    {
+        std::lock_guard<std::mutex> lck(idleMtx);
+        pendingJobs++;
+    }
+
+    // A file always goes to the same worker so its jobs stay in order
+    Worker* w = workers[job.file % workers.size()].get();
+    {
+        std::lock_guard<std::mutex> lck(w->mtx);
+        w->jobs.push_back(std::move(job));
+    }
+    w->cnd.notify_one();
+}
+
+void WriterPool::recycle(std::vector<uint8_t>&& buf) {
+    if (!buf.capacity()) { return; }
+    std::lock_guard<std::mutex> lck(bufMtx);
+    if (freeBuffers.size() >= WRITER_POOL_MAX_FREE_BUFFERS) { return; }
+    freeBuffers.push_back(std::move(buf));
+}
+
+void WriterPool::worker(Worker* w) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lck(w->mtx);
+            w->cnd.wait(lck, [w]() { return !w->jobs.empty() || w->stop; });
+            if (w->jobs.empty()) { break; }
+            job = std::move(w->jobs.front());
+            w->jobs.pop_front();
+        }
+        runJob(w, job);
+
+        {
+            std::lock_guard<std::mutex> lck(idleMtx);
+            pendingJobs--;
+        }
+        idleCnd.notify_all();
+    }
+
+    // Close the files whose close job never came
+    for (auto& [id, of] : w->files) {
+        fclose(of.f);
+        openFiles--;
+    }
+    w->files.clear();
+}
+
+void WriterPool::runJob(Worker* w, Job& job) {
+    if (job.type == JOB_OPEN) {
+        std::error_code ec;
+        std::filesystem::path parent = std::filesystem::path(job.path).parent_path();
+        if (!parent.empty()) { std::filesystem::create_directories(parent, ec); }
+        FILE* f = fopen(job.path.c_str(), job.append ? "ab" : "wb");
+        if (!f) {
+            flog::error("Could not open '{}'", job.path);
+            errors++;
+            return;
+        }
+        w->files[job.file] = { f, job.append };
+        openFiles++;
+        return;
+    }
+
+    auto it = w->files.find(job.file);
+    if (job.type == JOB_CLOSE) {
+        // Nothing is logged about a file that couldn't be opened
+        if (it == w->files.end()) {
+            recycle(std::move(job.data));
+            return;
+        }
+        fclose(it->second.f);
+        w->files.erase(it);
+        openFiles--;
+
+        // Append the log data through the worker of the log file to keep its writes in order
+        if (job.logFile && !job.data.empty()) {
+            Job log;
+            log.type = JOB_WRITE;
+            log.file = job.logFile;
+            log.data = std::move(job.data);
+            queuedBytes += log.data.size();
+            push(std::move(log));
+        }
+        return;
+    }
+
+    // Write jobs, data for a file that failed to open is lost
+    size_t len = job.data.size();
+    bool ok = false;
+    if (it != w->files.end()) {
+        FILE* f = it->second.f;
+        if (job.type == JOB_WRITE_AT) {
+            // Writes to a file opened for appending always go to its end, whatever the position
+            if (it->second.append) {
+                flog::error("Cannot overwrite data of a file opened for appending");
+            }
+            else {
+                ok = !pool_fseek(f, job.offset, SEEK_SET) && fwrite(job.data.data(), 1, len, f) == len;
+                pool_fseek(f, 0, SEEK_END);
+            }
+        }
+        else {
+            ok = (fwrite(job.data.data(), 1, len, f) == len);
+        }
+    }
+    if (!ok) {
+        errors++;
+        if (job.type == JOB_WRITE) { droppedBytes += len; }
+    }
+    else {
+        std::lock_guard<std::mutex> lck(statMtx);
+        windowBytes += len;
+    }
+    queuedBytes -= len;
+    recycle(std::move(job.data));
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdint.h>
+
+#define WRITER_POOL_MAX_THREADS         16
+#define WRITER_POOL_DEFAULT_MAX_QUEUED  (256 * 1024 * 1024)
+#define WRITER_POOL_MAX_FREE_BUFFERS    256
+
+/**
+ * Small pool of threads doing the disk I/O of many files.
+ * Each file is assigned to one thread so that its operations are performed in order, files are only opened
+ * by the pool thread once their open job runs. Callers never wait for the disk, data that doesn't fit in the
+ * queue is dropped.
+ */
+class WriterPool {
+public:
+    typedef uint64_t FileId;
+
+    WriterPool();
+    ~WriterPool();
+
+    /**
+     * Start the I/O threads.
+     * @param threads Number of threads.
+     */
+    void start(int threads);
+
+    /**
+     * Perform all queued jobs, including the ones queued by close(), close the files that are still open and stop the threads.
+     */
+    void stop();
+    bool isRunning();
+
+    /**
+     * Set the maximum amount of data waiting to be written.
+     * @param bytes Maximum number of queued bytes.
+     */
+    void setMaxQueued(size_t bytes);
+
+    /**
+     * Queue the creation of a file, missing parent directories are created.
+     * @param path Path of the file.
+     * @param append Append to the file instead of truncating it.
+     * @return Identifier of the file, 0 if the pool isn't running.
+     */
+    FileId open(std::string path, bool append = false);
+
+    /**
+     * Get an empty buffer to fill with data for write() or writeAt().
+     * @return Empty buffer, reused from previous writes when possible.
+     */
+    std::vector<uint8_t> getBuffer();
+
+    /**
+     * Queue data to be appended to a file.
+     * @param file Identifier of the file.
+     * @param data Data to write, the buffer is taken over by the pool.
+     * @param droppable False to queue the data even if the queue is full, meant for small writes like headers.
+     * @return True if the data was queued, false if it was dropped.
+     */
+    bool write(FileId file, std::vector<uint8_t>&& data, bool droppable = true);
+
+    /**
+     * Queue data to overwrite part of a file. Never dropped, meant for small writes like headers.
+     * Not supported on files opened in append mode, the job fails.
+     * @param file Identifier of the file.
+     * @param data Data to write, the buffer is taken over by the pool.
+     * @param offset Offset in the file.
+     */
+    void writeAt(FileId file, std::vector<uint8_t>&& data, uint64_t offset);
+
+    /**
+     * Queue closing a file once its queued data has been written.
+     * @param file Identifier of the file.
+     */
+    void close(FileId file);
+
+    /**
+     * Queue closing a file, then append data to another file only if the first one could be opened.
+     * Meant for index rows describing the closed file.
+     * @param file Identifier of the file to close.
+     * @param logFile Identifier of the file to append to.
+     * @param logData Data to append, the buffer is taken over by the pool.
+     */
+    void close(FileId file, FileId logFile, std::vector<uint8_t>&& logData);
+
+    size_t getQueuedBytes() { return queuedBytes; }
+    uint64_t getDroppedBytes() { return droppedBytes; }
+    int getOpenFiles() { return openFiles; }
+    float getQueueFill();
+
+    /**
+     * Get the combined write speed of all threads.
+     * @return Write speed in bytes per second, updated about once a second.
+     */
+    double getThroughput();
+
+    /**
+     * Get the number of write errors since the pool was started.
+     * @return Number of failed operations.
+     */
+    uint64_t getErrors() { return errors; }
+
+private:
+    enum JobType {
+        JOB_OPEN,
+        JOB_WRITE,
+        JOB_WRITE_AT,
+        JOB_CLOSE
+    };
+
+    struct Job {
+        JobType type;
+        FileId file;
+        std::vector<uint8_t> data;
+        uint64_t offset = 0;
+        std::string path;
+        bool append = false;
+        FileId logFile = 0;
+    };
+
+    struct OpenFile {
+        FILE* f;
+        bool append;
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::deque<Job> jobs;
+        std::mutex mtx;
+        std::condition_variable cnd;
+        bool stop = false;
+
+        // Only accessed by the worker thread
+        std::map<FileId, OpenFile> files;
+    };
+
+    void queue(Job&& job);
+    void push(Job&& job);
+    void recycle(std::vector<uint8_t>&& buf);
+    void worker(Worker* w);
+    void runJob(Worker* w, Job& job);
+
+    std::mutex ctrlMtx;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> running = false;
+    std::atomic<FileId> nextId = 1;
+
+    // Jobs queued or running, stop() waits for none to be left before stopping the threads
+    std::mutex idleMtx;
+    std::condition_variable idleCnd;
+    size_t pendingJobs = 0;
+
+    std::mutex bufMtx;
+    std::vector<std::vector<uint8_t>> freeBuffers;
+
+    size_t maxQueued = WRITER_POOL_DEFAULT_MAX_QUEUED;
+    std::atomic<size_t> queuedBytes = 0;
+    std::atomic<uint64_t> droppedBytes = 0;
+    std::atomic<uint64_t> errors = 0;
+    std::atomic<int> openFiles = 0;
+
+    // Metrics
+    std::mutex statMtx;
+    double throughput = 0.0;
+    uint64_t windowBytes = 0;
+    std::chrono::steady_clock::time_point windowStart;
+};
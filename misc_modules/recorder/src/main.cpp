@@ -7,7 +7,14 @@
 #include <dsp/routing/splitter.h>
 #include <dsp/audio/volume.h>
 #include <dsp/convert/stereo_to_mono.h>
+#include <dsp/buffer/history_ring.h>
+#include <dsp/audio/activity_detector.h>
+#include <dsp/math/abs_max.h>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
 #include <ctime>
 #include <gui/gui.h>
 #include <filesystem>
@@ -21,15 +28,32 @@
 #include <core.h>
 #include <utils/optionlist.h>
 #include <utils/wav.h>
+#include <utils/sigmf.h>
+#include <utils/flac.h>
+#include <utils/ziq.h>
 #include <radio_interface.h>
 #include <version.h>
 
 #include <stdarg.h>
+#include <inttypes.h>
 
 #define CONCAT(a, b) ((std::string(a) + b).c_str())
 
 #define SILENCE_LVL 10e-6
 
+#define SEGMENT_MAX_HANG_TIME   10000
+#define SEGMENT_HYSTERESIS_DB   6.0f
+#define SEGMENT_PENDING_TIME    2
+
+#define DISK_BUFFER_SIZE        (4 * 1024 * 1024)
+#define DISK_BUFFER_COUNT       16
+#define DISK_PREALLOC_STEP      (256 * 1024 * 1024)
+
+#define TM_MAX_HISTORY          3600
+#define TM_SLACK_SECONDS        2
+#define TM_MAX_MEMORY           (4ULL * 1024 * 1024 * 1024)
+#define TM_POLL_INTERVAL        10
+
 SDRPP_MOD_INFO{
     /* Name:            */ "recorder",
     /* Description:     */ "Recorder module for SDR++",
@@ -40,6 +64,20 @@ SDRPP_MOD_INFO{
 
 ConfigManager config;
 
+enum Container {
+    CONTAINER_WAV,
+    CONTAINER_RF64,
+    CONTAINER_SIGMF,
+    CONTAINER_FLAC,
+    CONTAINER_ZIQ
+};
+
+enum SegmentMode {
+    SEGMENT_NONE,
+    SEGMENT_SPLIT,
+    SEGMENT_MARKERS
+};
+
 class RecorderModule : public ModuleManager::Instance {
 public:
     RecorderModule(std::string name) : folderSelect("%ROOT%/recordings") {
@@ -48,16 +86,26 @@ public:
         strcpy(nameTemplate, "$t/$y-$M-$d/$h$m$s_$f");
 
         // Define option lists
-        containers.define("WAV", wav::FORMAT_WAV);
-        // containers.define("RF64", wav::FORMAT_RF64); // Disabled for now
+        containers.define("WAV", CONTAINER_WAV);
+        containers.define("RF64", CONTAINER_RF64);
+        containers.define("SigMF", CONTAINER_SIGMF);
+        containers.define("FLAC", CONTAINER_FLAC);
+        containers.define("ZIQ", "ZIQ (compressed)", CONTAINER_ZIQ);
         sampleTypes.define(wav::SAMP_TYPE_UINT8, "Uint8", wav::SAMP_TYPE_UINT8);
         sampleTypes.define(wav::SAMP_TYPE_INT16, "Int16", wav::SAMP_TYPE_INT16);
         sampleTypes.define(wav::SAMP_TYPE_INT32, "Int32", wav::SAMP_TYPE_INT32);
         sampleTypes.define(wav::SAMP_TYPE_FLOAT32, "Float32", wav::SAMP_TYPE_FLOAT32);
+        overflowPolicies.define("block", "Wait for disk", diskio::OVERFLOW_BLOCK);
+        overflowPolicies.define("drop", "Drop samples", diskio::OVERFLOW_DROP);
+        segmentModes.define("none", "None", SEGMENT_NONE);
+        segmentModes.define("split", "Split files", SEGMENT_SPLIT);
+        segmentModes.define("markers", "Markers", SEGMENT_MARKERS);
 
         // Load default config for option lists
-        containerId = containers.valueId(wav::FORMAT_WAV);
+        containerId = containers.valueId(CONTAINER_WAV);
         sampleTypeId = sampleTypes.valueId(wav::SAMP_TYPE_INT16);
+        overflowPolicyId = overflowPolicies.valueId(diskio::OVERFLOW_BLOCK);
+        segmentModeId = segmentModes.valueId(SEGMENT_NONE);
 
         // Load config
         config.acquire();
@@ -73,6 +121,15 @@ public:
         if (config.conf[name].contains("sampleType") && sampleTypes.keyExists(config.conf[name]["sampleType"])) {
             sampleTypeId = sampleTypes.keyId(config.conf[name]["sampleType"]);
         }
+        if (config.conf[name].contains("overflowPolicy") && overflowPolicies.keyExists(config.conf[name]["overflowPolicy"])) {
+            overflowPolicyId = overflowPolicies.keyId(config.conf[name]["overflowPolicy"]);
+        }
+        if (config.conf[name].contains("directIO")) {
+            directIO = config.conf[name]["directIO"];
+        }
+        if (config.conf[name].contains("preallocate")) {
+            preallocate = config.conf[name]["preallocate"];
+        }
         if (config.conf[name].contains("audioStream")) {
             selectedStreamName = config.conf[name]["audioStream"];
         }
@@ -85,6 +142,24 @@ public:
         if (config.conf[name].contains("ignoreSilence")) {
             ignoreSilence = config.conf[name]["ignoreSilence"];
         }
+        if (config.conf[name].contains("segments") && segmentModes.keyExists(config.conf[name]["segments"])) {
+            segmentModeId = segmentModes.keyId(config.conf[name]["segments"]);
+        }
+        if (config.conf[name].contains("silenceLevel")) {
+            silenceLevel = std::clamp<float>(config.conf[name]["silenceLevel"], -150.0f, 0.0f);
+        }
+        if (config.conf[name].contains("hangTime")) {
+            hangTime = std::clamp<int>(config.conf[name]["hangTime"], 0, SEGMENT_MAX_HANG_TIME);
+        }
+        if (config.conf[name].contains("tmHistory")) {
+            tmHistory = std::clamp<int>(config.conf[name]["tmHistory"], 1, TM_MAX_HISTORY);
+        }
+        if (config.conf[name].contains("tmPostTrigger")) {
+            tmPostTrigger = std::clamp<int>(config.conf[name]["tmPostTrigger"], 0, TM_MAX_HISTORY);
+        }
+        if (config.conf[name].contains("tmSquelchTrigger")) {
+            tmSquelchTrigger = config.conf[name]["tmSquelchTrigger"];
+        }
         if (config.conf[name].contains("nameTemplate")) {
             std::string _nameTemplate = config.conf[name]["nameTemplate"];
             if (_nameTemplate.length() > sizeof(nameTemplate)-1) {
@@ -105,15 +180,24 @@ public:
         basebandSink.init(NULL, complexHandler, this);
         stereoSink.init(&stereoStream, stereoHandler, this);
         monoSink.init(&s2m.out, monoHandler, this);
+        tmSink.init(NULL, tmHandler, this);
+        squelchSink.init(&squelchStream, squelchHandler, this);
+
+        // Track retunes to start new SigMF capture segments
+        retuneHandler.ctx = this;
+        retuneHandler.handler = retuneEventHandler;
+        sigpath::sourceManager.onRetune.bindHandler(&retuneHandler);
 
         gui::menu.registerEntry(name, menuHandler, this);
         core::modComManager.registerInterface("recorder", name, moduleInterfaceHandler, this);
     }
 
     ~RecorderModule() {
+        disarm();
         std::lock_guard<std::recursive_mutex> lck(recMtx);
         core::modComManager.unregisterInterface(name);
         gui::menu.removeEntry(name);
+        sigpath::sourceManager.onRetune.unbindHandler(&retuneHandler);
         stop();
         deselectStream();
         sigpath::sinkManager.onStreamRegistered.unbindHandler(&onStreamRegisteredHandler);
@@ -156,8 +240,16 @@ public:
     void start() {
         std::lock_guard<std::recursive_mutex> lck(recMtx);
         if (recording) { return; }
+        segmentMode = (recMode == RECORDER_MODE_AUDIO) ? segmentModes[segmentModeId] : SEGMENT_NONE;
 
-        // Configure the wav writer
+        // In time machine mode, recordings are started by triggers
+        if (recMode == RECORDER_MODE_TIME_MACHINE) {
+            if (!armed) { arm(); }
+            trigger();
+            return;
+        }
+
+        // Configure and open the file
         if (recMode == RECORDER_MODE_AUDIO) {
             if (selectedStreamName.empty()) { return; }
             samplerate = sigpath::sinkManager.getStreamSampleRate(selectedStreamName);
@@ -165,43 +257,22 @@ public:
         else {
             samplerate = sigpath::iqFrontEnd.getSampleRate();
         }
-        writer.setFormat(containers[containerId]);
-        writer.setChannels((recMode == RECORDER_MODE_AUDIO && !stereo) ? 1 : 2);
-        writer.setSampleType(sampleTypes[sampleTypeId]);
-        writer.setSamplerate(samplerate);
-
-        // Open file
-        std::string stream_type = (recMode == RECORDER_MODE_AUDIO) ? "audio" : "baseband";
-        std::string stream_name = (recMode == RECORDER_MODE_AUDIO) ? selectedStreamName : "";
-        std::string extension = ".wav";
-
-        Metadata metadata(stream_type, stream_name);
-
-        std::string expandedPath = expandString(folderSelect.path + "/" + metadata.genFileName(nameTemplate) + extension);
 
-        {
-            size_t endOfPath = expandedPath.rfind('/');
-
-            if(endOfPath != std::string::npos) {
-                std::string path(expandedPath, 0, endOfPath);
-
-                try {
-                    std::filesystem::create_directories(path);
-                } catch(const std::exception &e) {
-                    flog::error("Failed to create path: {0}", e.what());
-                    return;
-                }
-            }
+        // When splitting, files are only opened once a transmission starts, by the segment thread
+        if (segmentMode == SEGMENT_SPLIT) {
+            if (!folderSelect.pathIsValid()) { return; }
+            container = containers[containerId];
+            useSigmf = (container == CONTAINER_SIGMF);
+            startSegmentWorker();
         }
+        else if (!openFile()) { return; }
+        ignoringSilence = true;
+        segmentCount = 0;
 
-        auto list_info = [&](riff::Writer &rw) {
-            metadata.genListInfo(rw);
-        };
-
-        if (!writer.open(expandedPath, list_info)) {
-            flog::error("Failed to open file for recording: {0}", expandedPath);
-            return;
-        }
+        // The close level is lower than the open level so that fading signals don't cut segments
+        float openLevel = powf(10.0f, silenceLevel / 20.0f);
+        float closeLevel = powf(10.0f, (silenceLevel - SEGMENT_HYSTERESIS_DB) / 20.0f);
+        detector.init(openLevel, closeLevel, ((uint64_t)hangTime * samplerate) / 1000);
 
         // Open audio stream or baseband
         if (recMode == RECORDER_MODE_AUDIO) {
@@ -230,13 +301,22 @@ public:
         std::lock_guard<std::recursive_mutex> lck(recMtx);
         if (!recording) { return; }
 
+        // The dump thread closes the file itself
+        if (recMode == RECORDER_MODE_TIME_MACHINE) {
+            std::lock_guard<std::mutex> tmLck(tmMtx);
+            tmStopDump = true;
+            tmCnd.notify_all();
+            return;
+        }
+
         // Close audio stream or baseband
         if (recMode == RECORDER_MODE_AUDIO) {
             splitter.unbindStream(&stereoStream);
             monoSink.stop();
             stereoSink.stop();
             s2m.stop();
-            
+            if (detector.isActive()) { endSegment(); }
+            if (segmentMode == SEGMENT_SPLIT) { stopSegmentWorker(); }
         }
         else {
             // Unbind and destroy IQ stream
@@ -245,21 +325,100 @@ public:
             delete basebandStream;
         }
 
-        // Close file
-        writer.close();
-        
+        closeFile();
         recording = false;
     }
 
+    /**
+     * Start keeping the baseband history in memory, the ring is sized from the current samplerate.
+     */
+    void arm() {
+        std::lock_guard<std::recursive_mutex> lck(recMtx);
+        if (armed || recMode != RECORDER_MODE_TIME_MACHINE) { return; }
+
+        // Allocate the history, with some slack so that the dump can fall behind the live stream
+        samplerate = sigpath::iqFrontEnd.getSampleRate();
+        history.init(tmCapacity(samplerate));
+        if (!history.getCapacity()) {
+            flog::error("Could not allocate the time machine history");
+            return;
+        }
+        historySamples = std::min<uint64_t>((uint64_t)tmHistory * samplerate, history.getCapacity());
+        tmTriggerPos = 0;
+        tmLost = 0;
+        tmRetunes.clear();
+        tmRetunes.push_back({ 0, gui::waterfall.getCenterFrequency() });
+
+        // Start the dump thread
+        tmTriggered = false;
+        tmStopDump = false;
+        tmExit = false;
+        dumpThread = std::thread(&RecorderModule::dumpWorker, this);
+
+        // Create and bind IQ stream
+        tmStream = new dsp::stream<dsp::complex_t>();
+        tmSink.setInput(tmStream);
+        tmSink.start();
+        sigpath::iqFrontEnd.bindIQStream(tmStream);
+
+        // Watch the squelch of the selected audio stream
+        if (tmSquelchTrigger) {
+            squelchOpen = false;
+            squelchSink.start();
+            splitter.bindStream(&squelchStream);
+        }
+
+        armed = true;
+    }
+
+    /**
+     * Stop keeping the history and free it. Must not be called with recMtx held since it waits for the dump thread.
+     */
+    void disarm() {
+        if (!armed) { return; }
+
+        // Stop the dump thread, any recording in progress is closed
+        {
+            std::lock_guard<std::mutex> lck(tmMtx);
+            tmExit = true;
+            tmCnd.notify_all();
+        }
+        if (dumpThread.joinable()) { dumpThread.join(); }
+
+        std::lock_guard<std::recursive_mutex> lck(recMtx);
+        if (tmSquelchTrigger) {
+            splitter.unbindStream(&squelchStream);
+            squelchSink.stop();
+        }
+        sigpath::iqFrontEnd.unbindIQStream(tmStream);
+        tmSink.stop();
+        delete tmStream;
+        history.init(0);
+        armed = false;
+    }
+
+    /**
+     * Start dumping the history to disk, or extend the current dump.
+     * Only flags the dump thread so it's safe to call from DSP threads.
+     */
+    void trigger() {
+        if (!armed) { return; }
+        tmTriggerPos = history.getWritePos();
+        std::lock_guard<std::mutex> lck(tmMtx);
+        tmTriggered = true;
+        tmCnd.notify_all();
+    }
+
 private:
     static void menuHandler(void* ctx) {
         RecorderModule* _this = (RecorderModule*)ctx;
         float menuWidth = ImGui::GetContentRegionAvail().x;
 
         // Recording mode
-        if (_this->recording) { style::beginDisabled(); }
+        bool locked = _this->recording || _this->armed;
+        if (locked) { style::beginDisabled(); }
         ImGui::BeginGroup();
-        ImGui::Columns(2, CONCAT("RecorderModeColumns##_", _this->name), false);
+        ImGui::Columns(3, CONCAT("RecorderModeColumns##_", _this->name), false);
         if (ImGui::RadioButton(CONCAT("Baseband##_recorder_mode_", _this->name), _this->recMode == RECORDER_MODE_BASEBAND)) {
             _this->recMode = RECORDER_MODE_BASEBAND;
             config.acquire();
@@ -273,9 +432,16 @@ private:
             config.conf[_this->name]["mode"] = _this->recMode;
             config.release(true);
         }
+        ImGui::NextColumn();
+        if (ImGui::RadioButton(CONCAT("History##_recorder_mode_", _this->name), _this->recMode == RECORDER_MODE_TIME_MACHINE)) {
+            _this->recMode = RECORDER_MODE_TIME_MACHINE;
+            config.acquire();
+            config.conf[_this->name]["mode"] = _this->recMode;
+            config.release(true);
+        }
         ImGui::Columns(1, CONCAT("EndRecorderModeColumns##_", _this->name), false);
         ImGui::EndGroup();
-        if (_this->recording) { style::endDisabled(); }
+        if (locked) { style::endDisabled(); }
 
         // Recording path
         if (_this->folderSelect.render("##_recorder_fold_" + _this->name)) {
@@ -310,7 +476,83 @@ private:
             config.release(true);
         }
 
+        ImGui::LeftLabel("On overflow");
+        ImGui::FillWidth();
+        if (ImGui::Combo(CONCAT("##_recorder_overflow_", _this->name), &_this->overflowPolicyId, _this->overflowPolicies.txt)) {
+            _this->writer.setOverflowPolicy(_this->overflowPolicies[_this->overflowPolicyId]);
+            _this->sigmfWriter.setOverflowPolicy(_this->overflowPolicies[_this->overflowPolicyId]);
+            config.acquire();
+            config.conf[_this->name]["overflowPolicy"] = _this->overflowPolicies.key(_this->overflowPolicyId);
+            config.release(true);
+        }
+
+#ifdef __linux__
+        if (locked) { style::beginDisabled(); }
+        if (ImGui::Checkbox(CONCAT("Direct I/O##_recorder_direct_io_", _this->name), &_this->directIO)) {
+            config.acquire();
+            config.conf[_this->name]["directIO"] = _this->directIO;
+            config.release(true);
+        }
+        if (ImGui::Checkbox(CONCAT("Preallocate##_recorder_prealloc_", _this->name), &_this->preallocate)) {
+            config.acquire();
+            config.conf[_this->name]["preallocate"] = _this->preallocate;
+            config.release(true);
+        }
+        if (locked) { style::endDisabled(); }
+#endif
+
+        // Show time machine options
+        if (_this->recMode == RECORDER_MODE_TIME_MACHINE) {
+            if (_this->armed) { style::beginDisabled(); }
+            ImGui::LeftLabel("History (s)");
+            ImGui::FillWidth();
+            if (ImGui::InputInt(CONCAT("##_recorder_tm_history_", _this->name), &_this->tmHistory)) {
+                _this->tmHistory = std::clamp<int>(_this->tmHistory, 1, TM_MAX_HISTORY);
+                config.acquire();
+                config.conf[_this->name]["tmHistory"] = _this->tmHistory;
+                config.release(true);
+            }
+            if (ImGui::Checkbox(CONCAT("Trigger on squelch##_recorder_tm_squelch_", _this->name), &_this->tmSquelchTrigger)) {
+                config.acquire();
+                config.conf[_this->name]["tmSquelchTrigger"] = _this->tmSquelchTrigger;
+                config.release(true);
+            }
+            if (_this->armed) { style::endDisabled(); }
+
+            ImGui::LeftLabel("Post-trigger (s)");
+            ImGui::FillWidth();
+            if (ImGui::InputInt(CONCAT("##_recorder_tm_post_", _this->name), &_this->tmPostTrigger)) {
+                _this->tmPostTrigger = std::clamp<int>(_this->tmPostTrigger, 0, TM_MAX_HISTORY);
+                config.acquire();
+                config.conf[_this->name]["tmPostTrigger"] = _this->tmPostTrigger;
+                config.release(true);
+            }
+
+            // Memory used by the history, or that would be used once armed
+            if (_this->armed) {
+                double fill = (double)_this->history.getFill() / (double)_this->samplerate;
+                ImGui::Text("Memory: %.1lfMB, %.1lfs buffered", (double)_this->history.getMemoryUsage() / 1e6, fill);
+                if (sigpath::iqFrontEnd.getSampleRate() != _this->samplerate) {
+                    ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Samplerate changed, re-arm");
+                }
+            }
+            else {
+                size_t capacity = _this->tmCapacity(sigpath::iqFrontEnd.getSampleRate());
+                ImGui::Text("Memory: %.1lfMB", (double)(capacity * sizeof(dsp::complex_t)) / 1e6);
+            }
+        }
+
         // Show additional audio options
+        if (_this->recMode == RECORDER_MODE_TIME_MACHINE && _this->tmSquelchTrigger) {
+            ImGui::LeftLabel("Squelch stream");
+            ImGui::FillWidth();
+            if (ImGui::Combo(CONCAT("##_recorder_stream_", _this->name), &_this->streamId, _this->audioStreams.txt)) {
+                _this->selectStream(_this->audioStreams.value(_this->streamId));
+                config.acquire();
+                config.conf[_this->name]["audioStream"] = _this->audioStreams.key(_this->streamId);
+                config.release(true);
+            }
+        }
         if (_this->recMode == RECORDER_MODE_AUDIO) {
             ImGui::LeftLabel("Stream");
             ImGui::FillWidth();
@@ -348,12 +590,64 @@ private:
                 config.conf[_this->name]["ignoreSilence"] = _this->ignoreSilence;
                 config.release(true);
             }
+
+            // Transmission detection
+            if (_this->recording) { style::beginDisabled(); }
+            ImGui::LeftLabel("Segments");
+            ImGui::FillWidth();
+            if (ImGui::Combo(CONCAT("##_recorder_segments_", _this->name), &_this->segmentModeId, _this->segmentModes.txt)) {
+                config.acquire();
+                config.conf[_this->name]["segments"] = _this->segmentModes.key(_this->segmentModeId);
+                config.release(true);
+            }
+            SegmentMode segMode = _this->segmentModes[_this->segmentModeId];
+            if (segMode != SEGMENT_NONE || _this->ignoreSilence) {
+                ImGui::LeftLabel("Level (dB)");
+                ImGui::FillWidth();
+                if (ImGui::SliderFloat(CONCAT("##_recorder_silence_lvl_", _this->name), &_this->silenceLevel, -150.0f, 0.0f, "%.0fdB")) {
+                    config.acquire();
+                    config.conf[_this->name]["silenceLevel"] = _this->silenceLevel;
+                    config.release(true);
+                }
+                ImGui::LeftLabel("Hang time (ms)");
+                ImGui::FillWidth();
+                if (ImGui::InputInt(CONCAT("##_recorder_hang_", _this->name), &_this->hangTime, 100, 1000)) {
+                    _this->hangTime = std::clamp<int>(_this->hangTime, 0, SEGMENT_MAX_HANG_TIME);
+                    config.acquire();
+                    config.conf[_this->name]["hangTime"] = _this->hangTime;
+                    config.release(true);
+                }
+            }
+            if (_this->recording) { style::endDisabled(); }
+            Container selContainer = _this->containers[_this->containerId];
+            if (segMode == SEGMENT_MARKERS && (selContainer == CONTAINER_FLAC || selContainer == CONTAINER_ZIQ)) {
+                ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Markers need WAV, RF64 or SigMF");
+            }
         }
 
         // Record button
         bool canRecord = _this->folderSelect.pathIsValid();
         if (_this->recMode == RECORDER_MODE_AUDIO) { canRecord &= !_this->selectedStreamName.empty(); }
-        if (!_this->recording) {
+        if (_this->recMode == RECORDER_MODE_TIME_MACHINE && !_this->recording) {
+            if (!_this->armed) {
+                if (ImGui::Button(CONCAT("Arm##_recorder_rec_", _this->name), ImVec2(menuWidth, 0))) {
+                    _this->arm();
+                }
+                ImGui::TextColored(ImGui::GetStyleColorVec4(ImGuiCol_Text), "Idle --:--:--");
+            }
+            else {
+                float buttonWidth = (menuWidth - ImGui::GetStyle().ItemSpacing.x) / 2.0f;
+                if (ImGui::Button(CONCAT("Trigger##_recorder_rec_", _this->name), ImVec2(buttonWidth, 0))) {
+                    _this->trigger();
+                }
+                ImGui::SameLine();
+                if (ImGui::Button(CONCAT("Disarm##_recorder_rec_", _this->name), ImVec2(buttonWidth, 0))) {
+                    _this->disarm();
+                }
+                ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Armed --:--:--");
+            }
+        }
+        else if (!_this->recording) {
             if (ImGui::Button(CONCAT("Record##_recorder_rec_", _this->name), ImVec2(menuWidth, 0))) {
                 _this->start();
             }
@@ -363,16 +657,42 @@ private:
             if (ImGui::Button(CONCAT("Stop##_recorder_rec_", _this->name), ImVec2(menuWidth, 0))) {
                 _this->stop();
             }
-            uint64_t seconds = _this->writer.getSamplesWritten() / _this->samplerate;
+            uint64_t seconds = _this->getSamplesWritten() / _this->samplerate;
             time_t diff = seconds;
             tm* dtm = gmtime(&diff);
 
-            if (_this->ignoreSilence && _this->ignoringSilence) {
+            bool paused = (_this->ignoreSilence || _this->segmentMode == SEGMENT_SPLIT) && _this->ignoringSilence;
+            if (paused) {
                 ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Paused %02d:%02d:%02d", dtm->tm_hour, dtm->tm_min, dtm->tm_sec);
             }
             else {
                 ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Recording %02d:%02d:%02d", dtm->tm_hour, dtm->tm_min, dtm->tm_sec);
             }
+            if (_this->segmentMode != SEGMENT_NONE) {
+                ImGui::SameLine();
+                ImGui::Text("Segments: %d", (int)_this->segmentCount);
+            }
+
+            // Disk writer statistics
+            char buf[128];
+            float queueFill = _this->getQueueFill();
+            sprintf(buf, "Buffer %d%%", (int)round(queueFill * 100.0f));
+            ImGui::ProgressBar(queueFill, ImVec2(menuWidth, 0), buf);
+            ImGui::Text("Disk: %.1lfMB/s", _this->getThroughput() / 1e6);
+            uint64_t dropped = _this->getSamplesDropped();
+            if (_this->recMode == RECORDER_MODE_TIME_MACHINE) { dropped += _this->tmLost; }
+            if (dropped) {
+                ImGui::SameLine();
+                ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Dropped: %" PRIu64, dropped);
+            }
+
+            // Encoder statistics, the load is relative to one core
+            if (_this->container == CONTAINER_FLAC) {
+                ImGui::Text("Ratio: %.2lfx, Encoder: %.1lf%% CPU", _this->flacWriter.getCompressionRatio(), _this->flacWriter.getEncoderLoad() * 100.0);
+            }
+            else if (_this->container == CONTAINER_ZIQ) {
+                ImGui::Text("Ratio: %.2lfx, Encoder: %.1lf%% CPU", _this->ziqWriter.getCompressionRatio(), _this->ziqWriter.getEncoderLoad() * 100.0);
+            }
         }
     }
 
@@ -631,8 +951,250 @@ private:
             genChunks(rw);
             rw.endChunk();
         }
+
+        std::string
+        genDescription() const
+        {
+            char desc[512];
+            snprintf(desc, sizeof(desc), "Frequency: %sHz Mode: %s Bandwidth: %sHz", frequency, mode, bandwidth);
+            return desc;
+        }
     };
 
+    bool openFile() {
+        // Configure the writer
+        int channels = (recMode == RECORDER_MODE_AUDIO && !stereo) ? 1 : 2;
+        container = containers[containerId];
+        useSigmf = (container == CONTAINER_SIGMF);
+        if (container == CONTAINER_FLAC) {
+            if (samplerate > FLAC_MAX_SAMPLERATE) {
+                flog::error("FLAC does not support samplerates above {0}Hz, use ZIQ to compress baseband", FLAC_MAX_SAMPLERATE);
+                return false;
+            }
+            flacWriter.setChannels(channels);
+            flacWriter.setSampleType(sampleTypes[sampleTypeId]);
+            flacWriter.setSamplerate(samplerate);
+            flacWriter.setBuffers(DISK_BUFFER_SIZE, DISK_BUFFER_COUNT);
+            flacWriter.setOverflowPolicy(overflowPolicies[overflowPolicyId]);
+            flacWriter.setDirectIO(directIO);
+            flacWriter.setPreallocation(preallocate ? DISK_PREALLOC_STEP : 0);
+        }
+        else if (container == CONTAINER_ZIQ) {
+            ziqWriter.setComplex(recMode != RECORDER_MODE_AUDIO);
+            ziqWriter.setChannels(channels);
+            ziqWriter.setSampleType(sampleTypes[sampleTypeId]);
+            ziqWriter.setSamplerate(samplerate);
+            ziqWriter.setBuffers(DISK_BUFFER_SIZE, DISK_BUFFER_COUNT);
+            ziqWriter.setOverflowPolicy(overflowPolicies[overflowPolicyId]);
+            ziqWriter.setDirectIO(directIO);
+            ziqWriter.setPreallocation(preallocate ? DISK_PREALLOC_STEP : 0);
+        }
+        else if (useSigmf) {
+            sigmfWriter.setComplex(recMode != RECORDER_MODE_AUDIO);
+            sigmfWriter.setChannels(channels);
+            sigmfWriter.setSampleType(sampleTypes[sampleTypeId]);
+            sigmfWriter.setSamplerate(samplerate);
+            sigmfWriter.setBuffers(DISK_BUFFER_SIZE, DISK_BUFFER_COUNT);
+            sigmfWriter.setOverflowPolicy(overflowPolicies[overflowPolicyId]);
+            sigmfWriter.setDirectIO(directIO);
+            sigmfWriter.setPreallocation(preallocate ? DISK_PREALLOC_STEP : 0);
+        }
+        else {
+            writer.setFormat((containers[containerId] == CONTAINER_RF64) ? wav::FORMAT_RF64 : wav::FORMAT_WAV);
+            writer.setChannels(channels);
+            writer.setSampleType(sampleTypes[sampleTypeId]);
+            writer.setSamplerate(samplerate);
+            writer.setBuffers(DISK_BUFFER_SIZE, DISK_BUFFER_COUNT);
+            writer.setOverflowPolicy(overflowPolicies[overflowPolicyId]);
+            writer.setDirectIO(directIO);
+            writer.setPreallocation(preallocate ? DISK_PREALLOC_STEP : 0);
+        }
+
+        // Open file
+        std::string stream_type = (recMode == RECORDER_MODE_AUDIO) ? "audio" : "baseband";
+        std::string stream_name = (recMode == RECORDER_MODE_AUDIO) ? selectedStreamName : "";
+        std::string extension = ".wav";
+        if (useSigmf) { extension = ""; }
+        else if (container == CONTAINER_FLAC) { extension = ".flac"; }
+        else if (container == CONTAINER_ZIQ) { extension = ".ziq"; }
+
+        Metadata metadata(stream_type, stream_name);
+
+        std::string expandedPath = expandString(folderSelect.path + "/" + metadata.genFileName(nameTemplate) + extension);
+
+        // Transmissions can start within the same second, don't overwrite the previous one
+        if (segmentMode == SEGMENT_SPLIT) {
+            std::string base = expandedPath.substr(0, expandedPath.size() - extension.size());
+            std::string check = useSigmf ? ".sigmf-meta" : "";
+            for (int i = 1; std::filesystem::exists(expandedPath + check); i++) {
+                expandedPath = base + "_" + std::to_string(i) + extension;
+            }
+        }
+
+        {
+            size_t endOfPath = expandedPath.rfind('/');
+
+            if(endOfPath != std::string::npos) {
+                std::string path(expandedPath, 0, endOfPath);
+
+                try {
+                    std::filesystem::create_directories(path);
+                } catch(const std::exception &e) {
+                    flog::error("Failed to create path: {0}", e.what());
+                    return false;
+                }
+            }
+        }
+
+        auto list_info = [&](riff::Writer &rw) {
+            metadata.genListInfo(rw);
+        };
+
+        if (container == CONTAINER_FLAC || container == CONTAINER_ZIQ) {
+            bool opened;
+            if (container == CONTAINER_FLAC) {
+                flacWriter.setDescription(metadata.genDescription());
+                opened = flacWriter.open(expandedPath);
+            }
+            else {
+                opened = ziqWriter.open(expandedPath);
+            }
+            if (!opened) {
+                flog::error("Failed to open file for recording: {0}", expandedPath);
+                return false;
+            }
+        }
+        else if (useSigmf) {
+            sigmfWriter.setDescription(metadata.genDescription());
+            if (!sigmfWriter.open(expandedPath)) {
+                flog::error("Failed to open file for recording: {0}", expandedPath);
+                return false;
+            }
+
+            // First capture segment, annotations cover the signal passed by the VFO
+            captureFreq = getCaptureFrequency(gui::waterfall.getCenterFrequency());
+            annotationLabel = metadata.mode;
+            annotationBandwidth = 0.0;
+            if (recMode == RECORDER_MODE_AUDIO && gui::waterfall.vfos.find(selectedStreamName) != gui::waterfall.vfos.end()) {
+                annotationBandwidth = gui::waterfall.vfos[selectedStreamName]->bandwidth;
+            }
+            sigmfWriter.addCapture(captureFreq);
+        }
+        else if (!writer.open(expandedPath, list_info)) {
+            flog::error("Failed to open file for recording: {0}", expandedPath);
+            return false;
+        }
+        return true;
+    }
+
+    void closeFile() {
+        switch (container) {
+        case CONTAINER_SIGMF:   sigmfWriter.close(); break;
+        case CONTAINER_FLAC:    flacWriter.close(); break;
+        case CONTAINER_ZIQ:     ziqWriter.close(); break;
+        default:                writer.close(); break;
+        }
+    }
+
+    size_t tmCapacity(uint64_t sampleRate) {
+        uint64_t maxSamples = TM_MAX_MEMORY / sizeof(dsp::complex_t);
+        return std::min<uint64_t>((uint64_t)(tmHistory + TM_SLACK_SECONDS) * sampleRate, maxSamples);
+    }
+
+    void dumpWorker() {
+        dsp::complex_t* buf = dsp::buffer::alloc<dsp::complex_t>(STREAM_BUFFER_SIZE);
+        while (true) {
+            // Wait for a trigger
+            {
+                std::unique_lock<std::mutex> lck(tmMtx);
+                tmCnd.wait(lck, [=]() { return tmTriggered || tmExit; });
+                if (tmExit) { break; }
+                tmTriggered = false;
+                tmStopDump = false;
+            }
+
+            // Open the file, it starts with the history
+            uint64_t pos = history.getWritePos();
+            uint64_t backlog = std::min<uint64_t>(pos, historySamples);
+            pos -= backlog;
+            {
+                std::lock_guard<std::recursive_mutex> lck(recMtx);
+                if (!openFile()) { continue; }
+                tmLost = 0;
+                ignoringSilence = false;
+                recording = true;
+            }
+            addHistoryCapture(pos);
+
+            // Write the history then follow the live stream until stopped or the post-trigger time has elapsed
+            while (true) {
+                {
+                    std::lock_guard<std::mutex> lck(tmMtx);
+                    if (tmStopDump || tmExit) { break; }
+                }
+                uint64_t count = STREAM_BUFFER_SIZE;
+                if (tmPostTrigger) {
+                    uint64_t end = tmTriggerPos + (uint64_t)tmPostTrigger * samplerate;
+                    if (pos >= end) { break; }
+                    count = std::min<uint64_t>(count, end - pos);
+                }
+
+                // Stop at the next retune so that it starts a new capture segment
+                uint64_t nextRetune = nextRetunePos(pos);
+                if (nextRetune) { count = std::min<uint64_t>(count, nextRetune - pos); }
+
+                // Samples lost to a slow disk break the timeline, a new capture segment keeps the timestamps correct
+                uint64_t lost;
+                int read = history.read(pos, buf, count, lost);
+                tmLost += lost;
+                if (lost) { addHistoryCapture(pos - read); }
+                if (read) { writeSamples((float*)buf, read); }
+                if (nextRetune && pos == nextRetune) { addHistoryCapture(pos); }
+                if (read) { continue; }
+
+                // Caught up with the live stream
+                std::unique_lock<std::mutex> lck(tmMtx);
+                tmCnd.wait_for(lck, std::chrono::milliseconds(TM_POLL_INTERVAL), [=]() { return tmStopDump || tmExit; });
+            }
+
+            // Close the file, triggers received during the dump only extended it
+            {
+                std::lock_guard<std::recursive_mutex> lck(recMtx);
+                closeFile();
+                recording = false;
+            }
+            {
+                std::lock_guard<std::mutex> lck(tmMtx);
+                tmTriggered = false;
+            }
+        }
+        dsp::buffer::free(buf);
+    }
+
+    uint64_t nextRetunePos(uint64_t pos) {
+        std::lock_guard<std::mutex> lck(tmMtx);
+        for (const auto& [retunePos, freq] : tmRetunes) {
+            if (retunePos > pos) { return retunePos; }
+        }
+        return 0;
+    }
+
+    void addHistoryCapture(uint64_t pos) {
+        if (!useSigmf) { return; }
+
+        // Use the frequency the samples were received at, not the current one
+        double freq;
+        {
+            std::lock_guard<std::mutex> lck(tmMtx);
+            auto it = std::upper_bound(tmRetunes.begin(), tmRetunes.end(), pos, [](uint64_t p, const std::pair<uint64_t, double>& r) { return p < r.first; });
+            freq = (it != tmRetunes.begin()) ? std::prev(it)->second : tmRetunes.front().second;
+        }
+        double age = (double)(history.getWritePos() - pos) / (double)samplerate;
+        std::lock_guard<std::recursive_mutex> lck(recMtx);
+        captureFreq = freq;
+        sigmfWriter.addCapture(freq, age);
+    }
+
     std::string expandString(std::string input) {
         input = std::regex_replace(input, std::regex("%ROOT%"), root);
         return std::regex_replace(input, std::regex("//"), "/");
@@ -640,37 +1202,250 @@ private:
 
     static void complexHandler(dsp::complex_t* data, int count, void* ctx) {
         RecorderModule* _this = (RecorderModule*)ctx;
-        _this->writer.write((float*)data, count);
+        _this->writeSamples((float*)data, count);
+    }
+
+    static void tmHandler(dsp::complex_t* data, int count, void* ctx) {
+        RecorderModule* _this = (RecorderModule*)ctx;
+        _this->history.write(data, count);
+    }
+
+    static void squelchHandler(dsp::stereo_t* data, int count, void* ctx) {
+        RecorderModule* _this = (RecorderModule*)ctx;
+        float absMax = dsp::math::absMax((float*)data, count * 2);
+
+        // Trigger when the squelch opens and keep extending the dump while it stays open
+        bool open = (absMax >= SILENCE_LVL);
+        if (open && !_this->squelchOpen) {
+            _this->trigger();
+        }
+        else if (open) {
+            _this->tmTriggerPos = _this->history.getWritePos();
+        }
+        _this->squelchOpen = open;
     }
 
     static void stereoHandler(dsp::stereo_t* data, int count, void* ctx) {
         RecorderModule* _this = (RecorderModule*)ctx;
-        if (_this->ignoreSilence) {
-            float absMax = 0.0f;
-            float* _data = (float*)data;
-            int _count = count * 2;
-            for (int i = 0; i < _count; i++) {
-                float val = fabsf(_data[i]);
-                if (val > absMax) { absMax = val; }
+        _this->processAudio((float*)data, count, 2);
+    }
+
+    static void monoHandler(float* data, int count, void* ctx) {
+        RecorderModule* _this = (RecorderModule*)ctx;
+        _this->processAudio(data, count, 1);
+    }
+
+    void processAudio(float* data, int count, int channels) {
+        if (ignoreSilence || useSigmf || segmentMode != SEGMENT_NONE) {
+            dsp::audio::ActivityDetector::Event event = detector.process(data, count * channels, channels);
+            if (event == dsp::audio::ActivityDetector::EVENT_START) { beginSegment(); }
+            updateSilence(!detector.isActive());
+            if (event == dsp::audio::ActivityDetector::EVENT_END) { endSegment(); }
+            if ((ignoreSilence || segmentMode == SEGMENT_SPLIT) && ignoringSilence) { return; }
+        }
+        if (segmentMode == SEGMENT_SPLIT && holdSamples(data, count, channels)) { return; }
+        writeSamples(data, count);
+    }
+
+    bool holdSamples(float* data, int count, int channels) {
+        std::lock_guard<std::mutex> lck(segMtx);
+        if (segReady) { return false; }
+
+        // Samples of a segment that ended before the previous one was opened are dropped
+        if (pendingLocked) { return true; }
+        size_t len = std::min<size_t>(count * channels, pending.size() - pendingLen);
+        memcpy(&pending[pendingLen], data, len * sizeof(float));
+        pendingLen += len;
+        return true;
+    }
+
+    void startSegmentWorker() {
+        pendingChannels = stereo ? 2 : 1;
+        pending.resize(SEGMENT_PENDING_TIME * samplerate * pendingChannels);
+        pendingLen = 0;
+        pendingLocked = false;
+        segReady = false;
+        segJobs.clear();
+        segExit = false;
+        segmentThread = std::thread(&RecorderModule::segmentWorker, this);
+    }
+
+    void stopSegmentWorker() {
+        {
+            std::lock_guard<std::mutex> lck(segMtx);
+            segExit = true;
+            segCnd.notify_all();
+        }
+        if (segmentThread.joinable()) { segmentThread.join(); }
+        pending.clear();
+        pending.shrink_to_fit();
+    }
+
+    // Opens and closes the split files so that the sink thread only ever writes samples
+    void segmentWorker() {
+        while (true) {
+            // Jobs left when exiting are still done so that the last file is closed
+            bool open;
+            {
+                std::unique_lock<std::mutex> lck(segMtx);
+                segCnd.wait(lck, [=]() { return !segJobs.empty() || segExit; });
+                if (segJobs.empty()) { break; }
+                open = segJobs.front();
+                segJobs.pop_front();
+            }
+
+            if (!open) {
+                closeFile();
+                continue;
+            }
+
+            // A file that couldn't be opened just drops the samples of this transmission
+            bool opened = openFile();
+            if (opened && useSigmf) {
+                sigmfWriter.beginAnnotation(annotationLabel, captureFreq - (annotationBandwidth / 2.0), captureFreq + (annotationBandwidth / 2.0));
+            }
+
+            std::lock_guard<std::mutex> lck(segMtx);
+            if (opened && pendingLen) { writeSamples(pending.data(), pendingLen / pendingChannels); }
+            pendingLen = 0;
+            if (pendingLocked) {
+                // The segment is already over, its close job is next
+                pendingLocked = false;
+            }
+            else {
+                segReady = true;
             }
-            _this->ignoringSilence = (absMax < SILENCE_LVL);
-            if (_this->ignoringSilence) { return; }
         }
-        _this->writer.write((float*)data, count);
     }
 
-    static void monoHandler(float* data, int count, void* ctx) {
+    // Called from the sink thread, which recMtx holders wait for when stopping, so these must not lock it
+
+    void beginSegment() {
+        segmentTime = std::chrono::system_clock::now();
+        if (segmentMode == SEGMENT_SPLIT) {
+            // Samples are held back until the segment thread has opened the file
+            std::lock_guard<std::mutex> lck(segMtx);
+            if (!pendingLocked) { pendingLen = 0; }
+            segJobs.push_back(true);
+            segCnd.notify_all();
+        }
+        else {
+            segmentStart = getSamplesWritten();
+        }
+        segmentCount++;
+    }
+
+    void endSegment() {
+        if (segmentMode == SEGMENT_SPLIT) {
+            // If the file isn't open yet, the held back samples still belong to this segment until it is
+            std::lock_guard<std::mutex> lck(segMtx);
+            if (!segReady) { pendingLocked = true; }
+            segReady = false;
+            segJobs.push_back(false);
+            segCnd.notify_all();
+        }
+        else if (segmentMode == SEGMENT_MARKERS && (container == CONTAINER_WAV || container == CONTAINER_RF64)) {
+            // The label gives the time reference lost when silence is skipped
+            writer.addMarker(segmentStart, getSamplesWritten() - segmentStart, formatTime(segmentTime));
+        }
+    }
+
+    static std::string formatTime(std::chrono::system_clock::time_point t) {
+        time_t secs = std::chrono::system_clock::to_time_t(t);
+        int ms = std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count() % 1000;
+        tm* utc = gmtime(&secs);
+        char buf[64];
+        sprintf(buf, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", utc->tm_year + 1900, utc->tm_mon + 1, utc->tm_mday, utc->tm_hour, utc->tm_min, utc->tm_sec, ms);
+        return buf;
+    }
+
+    void updateSilence(bool silent) {
+        // Each squelch opening is annotated in SigMF recordings, split files are annotated by the segment thread
+        if (useSigmf && segmentMode != SEGMENT_SPLIT && silent != ignoringSilence) {
+            if (silent) {
+                sigmfWriter.endAnnotation();
+            }
+            else {
+                // Skipping silence breaks the timeline, a new capture segment keeps the timestamps correct
+                if (ignoreSilence) { sigmfWriter.addCapture(captureFreq); }
+                sigmfWriter.beginAnnotation(annotationLabel, captureFreq - (annotationBandwidth / 2.0), captureFreq + (annotationBandwidth / 2.0));
+            }
+        }
+        ignoringSilence = silent;
+    }
+
+    void writeSamples(float* data, int count) {
+        switch (container) {
+        case CONTAINER_SIGMF:   sigmfWriter.write(data, count); break;
+        case CONTAINER_FLAC:    flacWriter.write(data, count); break;
+        case CONTAINER_ZIQ:     ziqWriter.write(data, count); break;
+        default:                writer.write(data, count); break;
+        }
+    }
+
+    size_t getSamplesWritten() {
+        switch (container) {
+        case CONTAINER_SIGMF:   return sigmfWriter.getSamplesWritten();
+        case CONTAINER_FLAC:    return flacWriter.getSamplesWritten();
+        case CONTAINER_ZIQ:     return ziqWriter.getSamplesWritten();
+        default:                return writer.getSamplesWritten();
+        }
+    }
+
+    uint64_t getSamplesDropped() {
+        switch (container) {
+        case CONTAINER_SIGMF:   return sigmfWriter.getSamplesDropped();
+        case CONTAINER_FLAC:    return flacWriter.getSamplesDropped();
+        case CONTAINER_ZIQ:     return ziqWriter.getSamplesDropped();
+        default:                return writer.getSamplesDropped();
+        }
+    }
+
+    float getQueueFill() {
+        switch (container) {
+        case CONTAINER_SIGMF:   return sigmfWriter.getQueueFill();
+        case CONTAINER_FLAC:    return flacWriter.getQueueFill();
+        case CONTAINER_ZIQ:     return ziqWriter.getQueueFill();
+        default:                return writer.getQueueFill();
+        }
+    }
+
+    double getThroughput() {
+        switch (container) {
+        case CONTAINER_SIGMF:   return sigmfWriter.getThroughput();
+        case CONTAINER_FLAC:    return flacWriter.getThroughput();
+        case CONTAINER_ZIQ:     return ziqWriter.getThroughput();
+        default:                return writer.getThroughput();
+        }
+    }
+
+    double getCaptureFrequency(double centerFreq) {
+        // Audio recordings are at the frequency of the VFO
+        if (recMode == RECORDER_MODE_AUDIO && gui::waterfall.vfos.find(selectedStreamName) != gui::waterfall.vfos.end()) {
+            return centerFreq + gui::waterfall.vfos[selectedStreamName]->generalOffset;
+        }
+        return centerFreq;
+    }
+
+    static void retuneEventHandler(double freq, void* ctx) {
         RecorderModule* _this = (RecorderModule*)ctx;
-        if (_this->ignoreSilence) {
-            float absMax = 0.0f;
-            for (int i = 0; i < count; i++) {
-                float val = fabsf(data[i]);
-                if (val > absMax) { absMax = val; }
+        std::lock_guard<std::recursive_mutex> lck(_this->recMtx);
+
+        // Retunes are remembered with the position in the history, older ones are no longer needed
+        if (_this->armed) {
+            uint64_t pos = _this->history.getWritePos();
+            uint64_t oldest = pos - std::min<uint64_t>(pos, _this->history.getCapacity());
+            std::lock_guard<std::mutex> tmLck(_this->tmMtx);
+            while (_this->tmRetunes.size() > 1 && _this->tmRetunes[1].first <= oldest) {
+                _this->tmRetunes.erase(_this->tmRetunes.begin());
             }
-            _this->ignoringSilence = (absMax < SILENCE_LVL);
-            if (_this->ignoringSilence) { return; }
+            if (_this->tmRetunes.back().first == pos) { _this->tmRetunes.pop_back(); }
+            _this->tmRetunes.push_back({ pos, freq });
+            return;
         }
-        _this->writer.write(data, count);
+        if (!_this->recording || !_this->useSigmf) { return; }
+        _this->captureFreq = _this->getCaptureFrequency(freq);
+        _this->sigmfWriter.addCapture(_this->captureFreq);
     }
 
     static void moduleInterfaceHandler(int code, void* in, void* out, void* ctx) {
@@ -681,9 +1456,9 @@ private:
             *_out = _this->recMode;
         }
         else if (code == RECORDER_IFACE_CMD_SET_MODE) {
-            if (_this->recording) { return; }
+            if (_this->recording || _this->armed) { return; }
             int* _in = (int*)in;
-            _this->recMode = std::clamp<int>(*_in, 0, 1);
+            _this->recMode = std::clamp<int>(*_in, 0, 2);
         }
         else if (code == RECORDER_IFACE_CMD_START) {
             if (!_this->recording) { _this->start(); }
@@ -691,6 +1466,11 @@ private:
         else if (code == RECORDER_IFACE_CMD_STOP) {
             if (_this->recording) { _this->stop(); }
         }
+        else if (code == RECORDER_IFACE_CMD_TRIGGER) {
+            // Only an armed recorder has a history to save, arming it here would allocate it on the caller's thread and dump nothing
+            if (_this->recMode != RECORDER_MODE_TIME_MACHINE || !_this->armed) { return; }
+            _this->trigger();
+        }
     }
 
     std::string name;
@@ -698,22 +1478,53 @@ private:
     std::string root;
     char nameTemplate[1024];
 
-    OptionList<std::string, wav::Format> containers;
+    OptionList<std::string, Container> containers;
     OptionList<int, wav::SampleType> sampleTypes;
+    OptionList<std::string, diskio::OverflowPolicy> overflowPolicies;
+    OptionList<std::string, SegmentMode> segmentModes;
     FolderSelect folderSelect;
 
     int recMode = RECORDER_MODE_AUDIO;
     int containerId;
     int sampleTypeId;
+    int overflowPolicyId;
+    bool directIO = false;
+    bool preallocate = false;
     bool stereo = true;
     std::string selectedStreamName = "";
     float audioVolume = 1.0f;
     bool ignoreSilence = false;
+    int segmentModeId;
+    float silenceLevel = -100.0f;
+    int hangTime = 500;
     dsp::stereo_t audioLvl = { -100.0f, -100.0f };
 
     bool recording = false;
     bool ignoringSilence = false;
+    SegmentMode segmentMode = SEGMENT_NONE;
+    dsp::audio::ActivityDetector detector;
+    uint64_t segmentStart = 0;
+    std::atomic<int> segmentCount = 0;
+    std::chrono::system_clock::time_point segmentTime;
+    std::thread segmentThread;
+    std::mutex segMtx;
+    std::condition_variable segCnd;
+    std::deque<bool> segJobs;
+    bool segExit = false;
+    bool segReady = false;
+    bool pendingLocked = false;
+    std::vector<float> pending;
+    size_t pendingLen = 0;
+    int pendingChannels = 2;
     wav::Writer writer;
+    sigmf::Writer sigmfWriter;
+    flac::Writer flacWriter;
+    ziq::Writer ziqWriter;
+    Container container = CONTAINER_WAV;
+    bool useSigmf = false;
+    double captureFreq = 0.0;
+    double annotationBandwidth = 0.0;
+    std::string annotationLabel;
     std::recursive_mutex recMtx;
     dsp::stream<dsp::complex_t>* basebandStream;
     dsp::stream<dsp::stereo_t> stereoStream;
@@ -732,8 +1543,31 @@ private:
 
     uint64_t samplerate = 48000;
 
+    // Time machine
+    int tmHistory = 10;
+    int tmPostTrigger = 10;
+    bool tmSquelchTrigger = false;
+    std::atomic<bool> armed = false;
+    bool squelchOpen = false;
+    dsp::buffer::HistoryRing<dsp::complex_t> history;
+    uint64_t historySamples = 0;
+    std::atomic<uint64_t> tmTriggerPos = 0;
+    std::atomic<uint64_t> tmLost = 0;
+    std::vector<std::pair<uint64_t, double>> tmRetunes;
+    std::thread dumpThread;
+    std::mutex tmMtx;
+    std::condition_variable tmCnd;
+    bool tmTriggered = false;
+    bool tmStopDump = false;
+    bool tmExit = false;
+    dsp::stream<dsp::complex_t>* tmStream;
+    dsp::sink::Handler<dsp::complex_t> tmSink;
+    dsp::stream<dsp::stereo_t> squelchStream;
+    dsp::sink::Handler<dsp::stereo_t> squelchSink;
+
     EventHandler<std::string> onStreamRegisteredHandler;
     EventHandler<std::string> onStreamUnregisterHandler;
+    EventHandler<double> retuneHandler;
 
 };
 
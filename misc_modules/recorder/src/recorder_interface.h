@@ -4,10 +4,12 @@ enum {
     RECORDER_IFACE_CMD_GET_MODE,
     RECORDER_IFACE_CMD_SET_MODE,
     RECORDER_IFACE_CMD_START,
-    RECORDER_IFACE_CMD_STOP
+    RECORDER_IFACE_CMD_STOP,
+    RECORDER_IFACE_CMD_TRIGGER
 };
 
 enum {
     RECORDER_MODE_BASEBAND,
-    RECORDER_MODE_AUDIO
+    RECORDER_MODE_AUDIO,
+    RECORDER_MODE_TIME_MACHINE
 };
\ No newline at end of file
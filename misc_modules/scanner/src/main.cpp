@@ -3,6 +3,8 @@
 #include <gui/gui.h>
 #include <gui/style.h>
 #include <signal_path/signal_path.h>
+#include <core.h>
+#include <recorder_interface.h>
 
 SDRPP_MOD_INFO{
     /* Name:            */ "scanner",
@@ -17,14 +19,23 @@ public:
     ScannerModule(std::string name) {
         this->name = name;
         gui::menu.registerEntry(name, menuHandler, this, NULL);
+
+        modChangedHandler.handler = _modChangeHandler;
+        modChangedHandler.ctx = this;
+        core::moduleManager.onInstanceCreated.bindHandler(&modChangedHandler);
+        core::moduleManager.onInstanceDeleted.bindHandler(&modChangedHandler);
     }
 
     ~ScannerModule() {
+        core::moduleManager.onInstanceCreated.unbindHandler(&modChangedHandler);
+        core::moduleManager.onInstanceDeleted.unbindHandler(&modChangedHandler);
         gui::menu.removeEntry(name);
         stop();
     }
 
-    void postInit() {}
+    void postInit() {
+        refreshRecorders();
+    }
 
     void enable() {
         enabled = true;
@@ -79,6 +90,7 @@ private:
         ImGui::LeftLabel("Level");
         ImGui::SetNextItemWidth(menuWidth - ImGui::GetCursorPosX());
         ImGui::SliderFloat("##scanner_level", &_this->level, -150.0, 0.0);
+        ImGui::Checkbox("Trigger recorders##scanner_trigger_rec", &_this->triggerRecorders);
 
         ImGui::BeginTable(("scanner_bottom_btn_table" + _this->name).c_str(), 2);
         ImGui::TableNextRow();
@@ -248,12 +260,41 @@ private:
                 found = true;
                 receiving = true;
                 current = freq;
+                if (triggerRecorders) { triggerRecorder(); }
                 break;
             }
         }
         return found;
     }
 
+    void triggerRecorder() {
+        // Armed time machine recorders save what was received before the signal was found, others ignore it.
+        // Only called when a signal is found, a recorder keeps following the live stream while it lasts.
+        std::vector<std::string> names;
+        {
+            std::lock_guard<std::mutex> lck(recorderMtx);
+            names = recorderNames;
+        }
+        for (auto const& _name : names) {
+            core::modComManager.callInterface(_name, RECORDER_IFACE_CMD_TRIGGER, NULL, NULL);
+        }
+    }
+
+    // The instance list is only modified from the UI thread, the worker uses this copy of the recorder names
+    void refreshRecorders() {
+        std::lock_guard<std::mutex> lck(recorderMtx);
+        recorderNames.clear();
+        for (auto const& [_name, inst] : core::moduleManager.instances) {
+            if (core::moduleManager.getInstanceModuleName(_name) != "recorder") { continue; }
+            recorderNames.push_back(_name);
+        }
+    }
+
+    static void _modChangeHandler(std::string _name, void* ctx) {
+        ScannerModule* _this = (ScannerModule*)ctx;
+        _this->refreshRecorders();
+    }
+
     float getMaxLevel(float* data, double freq, double width, int dataWidth, double wfStart, double wfWidth) {
         double low = freq - (width/2.0);
         double high = freq + (width/2.0);
@@ -283,10 +324,15 @@ private:
     bool tuning = false;
     bool scanUp = true;
     bool reverseLock = false;
+    bool triggerRecorders = false;
     std::chrono::time_point<std::chrono::high_resolution_clock> lastSignalTime;
     std::chrono::time_point<std::chrono::high_resolution_clock> lastTuneTime;
     std::thread workerThread;
     std::mutex scanMtx;
+
+    EventHandler<std::string> modChangedHandler;
+    std::vector<std::string> recorderNames;
+    std::mutex recorderMtx;
 };
 
 MOD_EXPORT void _INIT_() {
@@ -0,0 +1,231 @@
+#include "iqreader.h"
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define WAV_CODEC_PCM           1
+#define WAV_CODEC_FLOAT         3
+#define WAV_CODEC_EXTENSIBLE    0xFFFE
+
+namespace {
+#pragma pack(push, 1)
+    struct ChunkHeader {
+        char id[4];
+        uint32_t size;
+    };
+
+    struct FormatHeader {
+        uint16_t codec;
+        uint16_t channelCount;
+        uint32_t sampleRate;
+        uint32_t bytesPerSecond;
+        uint16_t bytesPerSample;
+        uint16_t bitDepth;
+    };
+#pragma pack(pop)
+}
+
+IQReader::IQReader(std::string path, dsp::convert::SampleFormat rawFormat, uint32_t rawSamplerate) {
+    // Map the whole file, sequential access is hinted to the OS
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        fileHandle = NULL;
+        throw std::runtime_error("Could not open file");
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || !fileSize.QuadPart) {
+        close();
+        throw std::runtime_error("Could not get file size or file is empty");
+    }
+    size = fileSize.QuadPart;
+    mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapHandle) {
+        close();
+        throw std::runtime_error("Could not map file");
+    }
+    data = (uint8_t*)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        close();
+        throw std::runtime_error("Could not map file");
+    }
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) { throw std::runtime_error("Could not open file"); }
+    struct stat st;
+    if (fstat(fd, &st) || !st.st_size) {
+        close();
+        throw std::runtime_error("Could not get file size or file is empty");
+    }
+    size = st.st_size;
+    void* ptr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        close();
+        throw std::runtime_error("Could not map file");
+    }
+    data = (uint8_t*)ptr;
+    pageSize = sysconf(_SC_PAGESIZE);
+    madvise(data, size, MADV_SEQUENTIAL);
+#endif
+
+    // Compressed files have their own reader
+    if (size >= 4 && !memcmp(data, "ZIQF", 4)) {
+        close();
+        openZiq(path);
+        return;
+    }
+
+    // Parse the header if it's a WAV file, otherwise use the whole file as raw samples
+    wav = (size >= 12 && (!memcmp(data, "RIFF", 4) || !memcmp(data, "RF64", 4)) && !memcmp(&data[8], "WAVE", 4));
+    if (wav) {
+        try {
+            parseWav();
+        }
+        catch (...) {
+            close();
+            throw;
+        }
+    }
+    else {
+        format = rawFormat;
+        samplerate = rawSamplerate;
+        sampleSize = dsp::convert::sampleFormatSize(format);
+        dataOffset = 0;
+        sampleCount = size / sampleSize;
+    }
+    if (!samplerate) {
+        close();
+        throw std::runtime_error("Sample rate may not be zero");
+    }
+
+    readahead(dataOffset);
+}
+
+IQReader::~IQReader() {
+    close();
+    if (ziqReader) { delete ziqReader; }
+}
+
+void IQReader::seek(uint64_t sample) {
+    position = std::min<uint64_t>(sample, sampleCount);
+    prefetched = 0;
+    if (ziqReader) { ziqReader->seek(position); }
+}
+
+int IQReader::read(dsp::complex_t* out, int count) {
+    if (ziqReader) {
+        count = ziqReader->read((float*)out, count);
+        position = ziqReader->getPosition();
+        return count;
+    }
+    if (!data) { return 0; }
+    count = std::min<uint64_t>(count, sampleCount - position);
+    if (count <= 0) { return 0; }
+
+    // Convert directly from the mapped file
+    uint64_t offset = dataOffset + position * sampleSize;
+    readahead(offset);
+    dsp::convert::toComplex(format, &data[offset], out, count);
+    position += count;
+    return count;
+}
+
+void IQReader::close() {
+#ifdef _WIN32
+    if (data) { UnmapViewOfFile(data); }
+    if (mapHandle) { CloseHandle(mapHandle); }
+    if (fileHandle) { CloseHandle(fileHandle); }
+    mapHandle = NULL;
+    fileHandle = NULL;
+#else
+    if (data) { munmap(data, size); }
+    if (fd >= 0) { ::close(fd); }
+    fd = -1;
+#endif
+    data = NULL;
+}
+
+void IQReader::openZiq(std::string path) {
+    ziqReader = new ziq::Reader(path);
+    if (ziqReader->getChannels() != 2 || !ziqReader->isComplex()) {
+        delete ziqReader;
+        ziqReader = NULL;
+        throw std::runtime_error("ZIQ file doesn't contain IQ samples");
+    }
+    format = dsp::convert::SAMPLE_FORMAT_F32;
+    samplerate = ziqReader->getSampleRate();
+    sampleCount = ziqReader->getSampleCount();
+}
+
+void IQReader::parseWav() {
+    // Walk the chunks to find the format and the data
+    uint64_t ds64DataSize = 0;
+    uint64_t dataSize = 0;
+    bool gotFormat = false;
+    bool gotData = false;
+    FormatHeader fmt;
+    uint16_t codec;
+    uint64_t pos = 12;
+    while (pos + sizeof(ChunkHeader) <= size && !gotData) {
+        ChunkHeader hdr;
+        memcpy(&hdr, &data[pos], sizeof(ChunkHeader));
+        pos += sizeof(ChunkHeader);
+        uint64_t chunkSize = hdr.size;
+
+        if (!memcmp(hdr.id, "ds64", 4) && chunkSize >= 16 && pos + 16 <= size) {
+            // RF64 files store the 64bit data size here, the size in the data chunk header is invalid
+            memcpy(&ds64DataSize, &data[pos + 8], sizeof(uint64_t));
+        }
+        else if (!memcmp(hdr.id, "fmt ", 4) && chunkSize >= sizeof(FormatHeader) && pos + chunkSize <= size) {
+            memcpy(&fmt, &data[pos], sizeof(FormatHeader));
+            codec = fmt.codec;
+            if (codec == WAV_CODEC_EXTENSIBLE && chunkSize >= 26) { memcpy(&codec, &data[pos + 24], sizeof(uint16_t)); }
+            gotFormat = true;
+        }
+        else if (!memcmp(hdr.id, "data", 4)) {
+            if (hdr.size == 0xFFFFFFFF && ds64DataSize) { chunkSize = ds64DataSize; }
+            dataOffset = pos;
+            dataSize = chunkSize;
+            gotData = true;
+        }
+
+        pos += chunkSize + (chunkSize & 1);
+    }
+    if (!gotFormat || !gotData) { throw std::runtime_error("Invalid WAV file"); }
+
+    // Select the sample format
+    if (fmt.channelCount != 2) { throw std::runtime_error("WAV file must have two channels"); }
+    if (codec == WAV_CODEC_PCM && fmt.bitDepth == 8) { format = dsp::convert::SAMPLE_FORMAT_U8; }
+    else if (codec == WAV_CODEC_PCM && fmt.bitDepth == 16) { format = dsp::convert::SAMPLE_FORMAT_S16; }
+    else if (codec == WAV_CODEC_PCM && fmt.bitDepth == 24) { format = dsp::convert::SAMPLE_FORMAT_S24_LE; }
+    else if (codec == WAV_CODEC_PCM && fmt.bitDepth == 32) { format = dsp::convert::SAMPLE_FORMAT_S32; }
+    else if (codec == WAV_CODEC_FLOAT && fmt.bitDepth == 32) { format = dsp::convert::SAMPLE_FORMAT_F32; }
+    else { throw std::runtime_error("Unsupported WAV sample format"); }
+    samplerate = fmt.sampleRate;
+    sampleSize = dsp::convert::sampleFormatSize(format);
+
+    // Files that weren't closed properly can have an empty data chunk or one extending past the end of the file
+    if (!dataSize || dataSize > size - dataOffset) { dataSize = size - dataOffset; }
+    sampleCount = dataSize / sampleSize;
+}
+
+void IQReader::readahead(uint64_t offset) {
+#ifndef _WIN32
+    // Ask the OS to load the next part of the file before it's needed
+    if (offset + IQ_READER_READAHEAD_SIZE / 2 < prefetched) { return; }
+    uint64_t start = std::max<uint64_t>(offset, prefetched) & ~(pageSize - 1);
+    uint64_t end = std::min<uint64_t>(offset + IQ_READER_READAHEAD_SIZE, size);
+    if (end <= start) { return; }
+    madvise(&data[start], end - start, MADV_WILLNEED);
+    prefetched = end;
+#endif
+}
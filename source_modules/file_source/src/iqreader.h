@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <stdint.h>
+#include <dsp/types.h>
+#include <dsp/convert/sample_format.h>
+#include <utils/ziq.h>
+
+#define IQ_READER_READAHEAD_SIZE    (32 * 1024 * 1024)
+
+/**
+ * IQ file reader based on a memory mapping of the whole file.
+ * WAV and RF64 files are parsed, any other file is read as raw interleaved IQ samples.
+ * Compressed ZIQ files aren't mapped, they're decompressed a chunk at a time by a ziq::Reader.
+ */
+class IQReader {
+public:
+    /**
+     * Open and map a file. Throws on error.
+     * @param path Path of the file.
+     * @param rawFormat Sample format used if the file isn't a WAV file.
+     * @param rawSamplerate Samplerate used if the file isn't a WAV file.
+     */
+    IQReader(std::string path, dsp::convert::SampleFormat rawFormat, uint32_t rawSamplerate);
+    ~IQReader();
+
+    bool isWav() { return wav; }
+    bool isCompressed() { return ziqReader != NULL; }
+    dsp::convert::SampleFormat getFormat() { return format; }
+    uint32_t getSampleRate() { return samplerate; }
+    uint64_t getSampleCount() { return sampleCount; }
+    uint64_t getPosition() { return position; }
+
+    /**
+     * Move the read position.
+     * @param sample Index of the next sample to read, clamped to the number of samples.
+     */
+    void seek(uint64_t sample);
+
+    /**
+     * Convert samples at the read position and advance it.
+     * @param out Output buffer.
+     * @param count Maximum number of samples to read.
+     * @return Number of samples read, 0 at the end of the file, -1 if the file is corrupt.
+     */
+    int read(dsp::complex_t* out, int count);
+
+    void close();
+
+private:
+    void openZiq(std::string path);
+    void parseWav();
+    void readahead(uint64_t offset);
+
+    uint8_t* data = NULL;
+    uint64_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = NULL;
+    void* mapHandle = NULL;
+#else
+    int fd = -1;
+    uint64_t pageSize = 4096;
+#endif
+    ziq::Reader* ziqReader = NULL;
+
+    bool wav = false;
+    dsp::convert::SampleFormat format;
+    uint32_t samplerate;
+    int sampleSize;
+    uint64_t dataOffset = 0;
+    uint64_t sampleCount = 0;
+    uint64_t position = 0;
+    uint64_t prefetched = 0;
+};
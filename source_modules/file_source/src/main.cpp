@@ -4,14 +4,21 @@
 #include <module.h>
 #include <gui/gui.h>
 #include <signal_path/signal_path.h>
-#include <wavreader.h>
+#include <iqreader.h>
+#include <dsp/convert/sample_format.h>
 #include <core.h>
 #include <gui/widgets/file_select.h>
+#include <gui/style.h>
+#include <utils/optionlist.h>
+#include <utils/sigmf.h>
 #include <filesystem>
 #include <regex>
 #include <gui/tuner.h>
 #include <algorithm>
 #include <stdexcept>
+#include <chrono>
+#include <mutex>
+#include <ctype.h>
 
 #define CONCAT(a, b) ((std::string(a) + b).c_str())
 
@@ -27,12 +34,31 @@ ConfigManager config;
 
 class FileSourceModule : public ModuleManager::Instance {
 public:
-    FileSourceModule(std::string name) : fileSelect("", { "Wav IQ Files (*.wav)", "*.wav", "All Files", "*" }) {
+    FileSourceModule(std::string name) : fileSelect("", { "Wav IQ Files (*.wav)", "*.wav", "Compressed IQ Files (*.ziq)", "*.ziq", "SigMF Recordings (*.sigmf-meta)", "*.sigmf-meta", "Raw IQ Files (*.cu8 *.cs8 *.cs16 *.cf32 *.cfile)", "*.cu8 *.cs8 *.cs16 *.cf32 *.cfile", "All Files", "*" }) {
         this->name = name;
 
         if (core::args["server"].b()) { return; }
 
+        // Define raw sample formats
+        rawFormats.define("u8", "Unsigned 8bit", dsp::convert::SAMPLE_FORMAT_U8);
+        rawFormats.define("s8", "Signed 8bit", dsp::convert::SAMPLE_FORMAT_S8);
+        rawFormats.define("s16", "Signed 16bit", dsp::convert::SAMPLE_FORMAT_S16);
+        rawFormats.define("f32", "Float32", dsp::convert::SAMPLE_FORMAT_F32);
+        rawFormatId = rawFormats.valueId(dsp::convert::SAMPLE_FORMAT_S16);
+
         config.acquire();
+        if (config.conf.contains("rawFormat") && rawFormats.keyExists(config.conf["rawFormat"])) {
+            rawFormatId = rawFormats.keyId(config.conf["rawFormat"]);
+        }
+        if (config.conf.contains("rawSampleRate")) {
+            rawSampleRate = config.conf["rawSampleRate"];
+        }
+        if (config.conf.contains("loop")) {
+            loop = config.conf["loop"];
+        }
+        if (config.conf.contains("fastMode")) {
+            fastMode = config.conf["fastMode"];
+        }
         fileSelect.setPath(config.conf["path"], true);
         config.release();
 
@@ -50,6 +76,7 @@ public:
     ~FileSourceModule() {
         stop(this);
         sigpath::sourceManager.unregisterSource("File");
+        if (reader != NULL) { delete reader; }
     }
 
     void postInit() {}
@@ -91,8 +118,9 @@ private:
         FileSourceModule* _this = (FileSourceModule*)ctx;
         if (_this->running) { return; }
         if (_this->reader == NULL) { return; }
+        _this->stopWorker = false;
         _this->running = true;
-        _this->workerThread = _this->float32Mode ? std::thread(floatWorker, _this) : std::thread(worker, _this);
+        _this->workerThread = std::thread(worker, _this);
         flog::info("FileSourceModule '{0}': Start!", _this->name);
     }
 
@@ -100,11 +128,13 @@ private:
         FileSourceModule* _this = (FileSourceModule*)ctx;
         if (!_this->running) { return; }
         if (_this->reader == NULL) { return; }
+        _this->stopWorker = true;
         _this->stream.stopWriter();
         _this->workerThread.join();
         _this->stream.clearWriteStop();
         _this->running = false;
-        _this->reader->rewind();
+        _this->seekTarget = -1;
+        _this->reader->seek(0);
         flog::info("FileSourceModule '{0}': Stop!", _this->name);
     }
 
@@ -116,68 +146,258 @@ private:
     static void menuHandler(void* ctx) {
         FileSourceModule* _this = (FileSourceModule*)ctx;
 
+        if (_this->running) { style::beginDisabled(); }
         if (_this->fileSelect.render("##file_source_" + _this->name)) {
             if (_this->fileSelect.pathIsValid()) {
-                if (_this->reader != NULL) {
-                    _this->reader->close();
-                    delete _this->reader;
-                }
-                try {
-                    _this->reader = new WavReader(_this->fileSelect.path);
-                    if (_this->reader->getSampleRate() == 0) {
-                        _this->reader->close();
-                        delete _this->reader;
-                        _this->reader = NULL;
-                        throw std::runtime_error("Sample rate may not be zero");
-                    }
-                    _this->sampleRate = _this->reader->getSampleRate();
-                    core::setInputSampleRate(_this->sampleRate);
-                    std::string filename = std::filesystem::path(_this->fileSelect.path).filename().string();
-                    _this->centerFreq = _this->getFrequency(filename);
-                    tuner::tune(tuner::TUNER_MODE_IQ_ONLY, "", _this->centerFreq);
-                    //gui::freqSelect.minFreq = _this->centerFreq - (_this->sampleRate/2);
-                    //gui::freqSelect.maxFreq = _this->centerFreq + (_this->sampleRate/2);
-                    //gui::freqSelect.limitFreq = true;
-                }
-                catch (std::exception& e) {
-                    flog::error("Error: {0}", e.what());
-                }
+                _this->openFile(true);
                 config.acquire();
                 config.conf["path"] = _this->fileSelect.path;
                 config.release(true);
             }
         }
 
-        ImGui::Checkbox("Float32 Mode##_file_source", &_this->float32Mode);
+        // Raw files don't have a header, the format and samplerate must be given
+        if (_this->reader != NULL && !_this->reader->isWav() && !_this->reader->isCompressed() && !_this->isSigmf) {
+            ImGui::LeftLabel("Format");
+            ImGui::FillWidth();
+            if (ImGui::Combo(CONCAT("##_file_source_format_", _this->name), &_this->rawFormatId, _this->rawFormats.txt)) {
+                _this->openFile(false);
+                config.acquire();
+                config.conf["rawFormat"] = _this->rawFormats.key(_this->rawFormatId);
+                config.release(true);
+            }
+            ImGui::LeftLabel("Samplerate");
+            ImGui::FillWidth();
+            if (ImGui::InputInt(CONCAT("##_file_source_sr_", _this->name), &_this->rawSampleRate, 0, 0)) {
+                _this->rawSampleRate = std::max<int>(_this->rawSampleRate, 1);
+                _this->openFile(false);
+                config.acquire();
+                config.conf["rawSampleRate"] = _this->rawSampleRate;
+                config.release(true);
+            }
+        }
+        if (_this->running) { style::endDisabled(); }
+
+        // Seek bar showing the position and duration of the file
+        if (_this->reader != NULL) {
+            double sampleRate = _this->reader->getSampleRate();
+            float pos = (double)_this->reader->getPosition() / sampleRate;
+            float duration = (double)_this->reader->getSampleCount() / sampleRate;
+            char buf[64];
+            int posSec = pos;
+            int durSec = duration;
+            sprintf(buf, "%02d:%02d:%02d / %02d:%02d:%02d", posSec / 3600, (posSec / 60) % 60, posSec % 60, durSec / 3600, (durSec / 60) % 60, durSec % 60);
+            ImGui::FillWidth();
+            if (ImGui::SliderFloat(CONCAT("##_file_source_seek_", _this->name), &pos, 0.0f, duration, buf)) {
+                _this->seek(pos * sampleRate);
+            }
+        }
+
+        // SigMF navigation using the capture segments and annotations
+        if (_this->reader != NULL && _this->isSigmf) {
+            _this->sigmfMenu();
+        }
+
+        if (ImGui::Checkbox(CONCAT("Loop##_file_source_loop_", _this->name), &_this->loop)) {
+            config.acquire();
+            config.conf["loop"] = _this->loop;
+            config.release(true);
+        }
+        if (ImGui::Checkbox(CONCAT("As fast as possible##_file_source_fast_", _this->name), &_this->fastMode)) {
+            config.acquire();
+            config.conf["fastMode"] = _this->fastMode;
+            config.release(true);
+        }
     }
 
-    static void worker(void* ctx) {
-        FileSourceModule* _this = (FileSourceModule*)ctx;
-        double sampleRate = std::max(_this->reader->getSampleRate(), (uint32_t)1);
-        int blockSize = std::min((int)(sampleRate / 200.0f), (int)STREAM_BUFFER_SIZE);
-        int16_t* inBuf = new int16_t[blockSize * 2];
+    void sigmfMenu() {
+        // Follow the frequency of the capture segment being played
+        uint64_t pos = reader->getPosition();
+        int capId = sigmfMeta.captureAt(pos);
+        if (capId >= 0 && capId != captureId) {
+            captureId = capId;
+            if (sigmfMeta.captures[capId].frequency != centerFreq) {
+                centerFreq = sigmfMeta.captures[capId].frequency;
+                tuner::tune(tuner::TUNER_MODE_IQ_ONLY, "", centerFreq);
+            }
+        }
 
-        while (true) {
-            _this->reader->readSamples(inBuf, blockSize * 2 * sizeof(int16_t));
-            volk_16i_s32f_convert_32f((float*)_this->stream.writeBuf, inBuf, 32768.0f, blockSize * 2);
-            if (!_this->stream.swap(blockSize)) { break; };
+        // Recording time, with a field to jump to any time
+        double time;
+        if (sigmfMeta.timeAtSample(pos, time)) {
+            ImGui::Text("Time: %s", sigmf::Metadata::formatTime(time).c_str());
+        }
+        ImGui::LeftLabel("Go to");
+        ImGui::FillWidth();
+        if (ImGui::InputText(CONCAT("##_file_source_goto_", name), gotoTime, sizeof(gotoTime) - 1, ImGuiInputTextFlags_EnterReturnsTrue)) {
+            uint64_t sample;
+            if (sigmf::Metadata::parseTime(gotoTime, time) && sigmfMeta.sampleAtTime(time, sample)) {
+                seek(sample);
+            }
+            else {
+                flog::warn("FileSourceModule '{0}': '{1}' is not a time in the recording", name, gotoTime);
+            }
         }
 
-        delete[] inBuf;
+        // Annotations
+        if (!sigmfMeta.annotations.empty()) {
+            ImGui::LeftLabel("Annotation");
+            ImGui::FillWidth();
+            if (ImGui::Combo(CONCAT("##_file_source_annotation_", name), &annotationId, annotationsTxt.c_str())) {
+                seek(sigmfMeta.annotations[annotationId].sampleStart);
+            }
+        }
     }
 
-    static void floatWorker(void* ctx) {
-        FileSourceModule* _this = (FileSourceModule*)ctx;
-        double sampleRate = std::max(_this->reader->getSampleRate(), (uint32_t)1);
-        int blockSize = std::min((int)(sampleRate / 200.0f), (int)STREAM_BUFFER_SIZE);
-        dsp::complex_t* inBuf = new dsp::complex_t[blockSize];
+    void loadSigmf(std::string base) {
+        if (!sigmfMeta.load(base + ".sigmf-meta")) { throw std::runtime_error("Could not load SigMF metadata"); }
+
+        // Only complex little endian types can be played back
+        dsp::convert::SampleFormat format;
+        if (sigmfMeta.datatype == "cu8") { format = dsp::convert::SAMPLE_FORMAT_U8; }
+        else if (sigmfMeta.datatype == "ci8") { format = dsp::convert::SAMPLE_FORMAT_S8; }
+        else if (sigmfMeta.datatype == "ci16_le") { format = dsp::convert::SAMPLE_FORMAT_S16; }
+        else if (sigmfMeta.datatype == "ci32_le") { format = dsp::convert::SAMPLE_FORMAT_S32; }
+        else if (sigmfMeta.datatype == "cf32_le") { format = dsp::convert::SAMPLE_FORMAT_F32; }
+        else { throw std::runtime_error("Unsupported SigMF datatype: " + sigmfMeta.datatype); }
+        if (sigmfMeta.channels != 1) { throw std::runtime_error("Multi-channel SigMF recordings are not supported"); }
+
+        reader = new IQReader(base + ".sigmf-data", format, sigmfMeta.samplerate);
+
+        // Build the annotation list
+        annotationsTxt.clear();
+        for (auto& ann : sigmfMeta.annotations) {
+            double time;
+            std::string when = sigmfMeta.timeAtSample(ann.sampleStart, time) ? sigmf::Metadata::formatTime(time) : std::to_string(ann.sampleStart);
+            annotationsTxt += when + " " + ann.label;
+            annotationsTxt += '\0';
+        }
+        annotationId = 0;
+        captureId = -1;
+        gotoTime[0] = 0;
+        double startTime;
+        if (sigmfMeta.timeAtSample(0, startTime)) { strcpy(gotoTime, sigmf::Metadata::formatTime(startTime).c_str()); }
+    }
+
+    void openFile(bool newFile) {
+        // Close the previous file
+        if (reader != NULL) {
+            delete reader;
+            reader = NULL;
+        }
 
-        while (true) {
-            _this->reader->readSamples(_this->stream.writeBuf, blockSize * sizeof(dsp::complex_t));
-            if (!_this->stream.swap(blockSize)) { break; };
+        try {
+            std::string ext = std::filesystem::path(fileSelect.path).extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            isSigmf = (ext == ".sigmf-meta" || ext == ".sigmf-data");
+
+            // Select the raw format from the extension if it's a known one
+            if (newFile) {
+                if (ext == ".cu8") { rawFormatId = rawFormats.valueId(dsp::convert::SAMPLE_FORMAT_U8); }
+                else if (ext == ".cs8") { rawFormatId = rawFormats.valueId(dsp::convert::SAMPLE_FORMAT_S8); }
+                else if (ext == ".cs16") { rawFormatId = rawFormats.valueId(dsp::convert::SAMPLE_FORMAT_S16); }
+                else if (ext == ".cf32" || ext == ".cfile") { rawFormatId = rawFormats.valueId(dsp::convert::SAMPLE_FORMAT_F32); }
+            }
+
+            // SigMF recordings have their format and frequency in the metadata, others in the header or the name
+            if (isSigmf) {
+                loadSigmf(fileSelect.path.substr(0, fileSelect.path.size() - ext.size()));
+                centerFreq = sigmfMeta.captures.empty() ? 0.0 : sigmfMeta.captures[0].frequency;
+            }
+            else {
+                reader = new IQReader(fileSelect.path, rawFormats[rawFormatId], rawSampleRate);
+                std::string filename = std::filesystem::path(fileSelect.path).filename().string();
+                centerFreq = getFrequency(filename);
+            }
+            sampleRate = reader->getSampleRate();
+            core::setInputSampleRate(sampleRate);
+            tuner::tune(tuner::TUNER_MODE_IQ_ONLY, "", centerFreq);
+            //gui::freqSelect.minFreq = centerFreq - (sampleRate/2);
+            //gui::freqSelect.maxFreq = centerFreq + (sampleRate/2);
+            //gui::freqSelect.limitFreq = true;
         }
+        catch (std::exception& e) {
+            flog::error("Error: {0}", e.what());
+        }
+    }
 
-        delete[] inBuf;
+    void seek(uint64_t sample) {
+        // The worker applies the seek between two blocks
+        std::lock_guard<std::mutex> lck(seekMtx);
+        if (running) {
+            seekTarget = sample;
+            return;
+        }
+        reader->seek(sample);
+    }
+
+    static void worker(void* ctx) {
+        FileSourceModule* _this = (FileSourceModule*)ctx;
+        double sampleRate = _this->reader->getSampleRate();
+        int blockSize = std::clamp<int>(sampleRate / 200.0, 1, STREAM_BUFFER_SIZE);
+
+        // Real-time pacing reference
+        auto refTime = std::chrono::steady_clock::now();
+        uint64_t refSamples = 0;
+
+        while (!_this->stopWorker) {
+            // Apply a pending seek
+            {
+                std::lock_guard<std::mutex> lck(_this->seekMtx);
+                if (_this->seekTarget >= 0) {
+                    _this->reader->seek(_this->seekTarget);
+                    _this->seekTarget = -1;
+                    refTime = std::chrono::steady_clock::now();
+                    refSamples = 0;
+                }
+            }
+
+            // Convert samples directly from the mapped file into the stream, a corrupt file ends the playback
+            int count;
+            try {
+                count = _this->reader->read(_this->stream.writeBuf, blockSize);
+            }
+            catch (const std::exception& e) {
+                flog::error("Error reading file, stopping playback: {0}", e.what());
+                break;
+            }
+            if (count < 0) {
+                flog::error("Corrupt file, stopping playback");
+                break;
+            }
+            if (!count) {
+                // Loop back to the start or wait for a seek or stop at the end of the file, a file without samples can't loop
+                if (_this->loop && _this->reader->getSampleCount()) {
+                    _this->reader->seek(0);
+                }
+                else {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    refTime = std::chrono::steady_clock::now();
+                    refSamples = 0;
+                }
+                continue;
+            }
+            if (!_this->stream.swap(count)) { break; }
+
+            // Without pacing, the DSP chain runs as fast as the slowest block allows
+            if (_this->fastMode) {
+                refTime = std::chrono::steady_clock::now();
+                refSamples = 0;
+                continue;
+            }
+
+            // Wait until the samples are due, restart the pacing if too far behind instead of trying to catch up
+            refSamples += count;
+            auto due = refTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>((double)refSamples / sampleRate));
+            auto now = std::chrono::steady_clock::now();
+            if (now - due > std::chrono::seconds(1)) {
+                refTime = now;
+                refSamples = 0;
+            }
+            else {
+                std::this_thread::sleep_until(due);
+            }
+        }
     }
 
     double getFrequency(std::string filename) {
@@ -193,15 +413,30 @@ private:
     std::string name;
     dsp::stream<dsp::complex_t> stream;
     SourceManager::SourceHandler handler;
-    WavReader* reader = NULL;
+    IQReader* reader = NULL;
     bool running = false;
     bool enabled = true;
     float sampleRate = 1000000;
     std::thread workerThread;
+    bool stopWorker = false;
+
+    std::mutex seekMtx;
+    int64_t seekTarget = -1;
 
     double centerFreq = 100000000;
 
-    bool float32Mode = false;
+    OptionList<std::string, dsp::convert::SampleFormat> rawFormats;
+    int rawFormatId;
+    int rawSampleRate = 1000000;
+    bool loop = true;
+    bool fastMode = false;
+
+    bool isSigmf = false;
+    sigmf::Metadata sigmfMeta;
+    int captureId = -1;
+    int annotationId = 0;
+    std::string annotationsTxt;
+    char gotoTime[64];
 };
 
 MOD_EXPORT void _INIT_() {
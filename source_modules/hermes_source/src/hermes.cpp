@@ -1,5 +1,7 @@
 #include "hermes.h"
 #include <utils/flog.h>
+#include <algorithm>
+#include <dsp/convert/sample_format.h>
 
 namespace hermes {
     Client::Client(std::shared_ptr<net::Socket> sock) {
@@ -32,6 +34,7 @@ namespace hermes {
     }
 
     void Client::setSamplerate(HermesLiteSamplerate samplerate) {
+        this->samplerate = 48000.0 * (double)(1 << samplerate);
         writeReg(0, (uint32_t)samplerate << 24);
     }
 
@@ -45,6 +48,18 @@ namespace hermes {
         writeReg(HL_REG_RX_LNA, gain | (1 << 6));
     }
 
+    void Client::setBufferTime(double seconds) {
+        bufferTime = std::max<double>(seconds, HERMES_MIN_BUFFER_TIME);
+    }
+
+    uint64_t Client::getLostPackets() {
+        return lostPackets;
+    }
+
+    uint64_t Client::getReceivedPackets() {
+        return receivedPackets;
+    }
+
     void Client::autoFilters(double freq) {
         uint8_t filt = (freq >= 3000000.0) ? (1 << 6) : 0;
         
@@ -155,53 +170,66 @@ namespace hermes {
     }
 
     void Client::worker() {
-        uint8_t rbuf[2048];
-        MetisUSBPacket* pkt = (MetisUSBPacket*)rbuf;
+        uint8_t* rbuf = new uint8_t[HERMES_RECV_BATCH * HERMES_MAX_PACKET_SIZE];
+        int lens[HERMES_RECV_BATCH];
+        int count = 0;
         while (true) {
-            // Wait for a packet or exit if connection closed
-            int len = sock->recv(rbuf, 2048);
-            if (len <= 0) { break; }
+            // Wait for a batch of packets or exit if connection closed
+            int pktCount = sock->recvmulti(rbuf, HERMES_MAX_PACKET_SIZE, lens, HERMES_RECV_BATCH);
+            if (pktCount <= 0) { break; }
 
-            // Ignore anything that's not a USB packet
-            if (htons(pkt->hdr.signature) != HERMES_METIS_SIGNATURE || pkt->hdr.type != METIS_PKT_USB) {
-                continue;
-            }
+            // Compute the number of samples to accumulate before swapping
+            int blockSize = std::clamp<int>(samplerate * bufferTime, HERMES_FRAME_SAMPLES, STREAM_BUFFER_SIZE - HERMES_FRAME_SAMPLES);
 
-            // Parse frames
-            for (int frn = 0; frn < 2; frn++) {
-                uint8_t* frame = pkt->frame[frn];
-                HPSDRUSBHeader* hdr = (HPSDRUSBHeader*)frame;
+            for (int p = 0; p < pktCount; p++) {
+                MetisUSBPacket* pkt = (MetisUSBPacket*)&rbuf[p * HERMES_MAX_PACKET_SIZE];
 
-                // Make sure this is a valid frame by checking the sync
-                if (hdr->sync[0] != 0x7F || hdr->sync[1] != 0x7F || hdr->sync[2] != 0x7F) {
+                // Ignore anything that's not a USB packet
+                if (lens[p] < (int)sizeof(MetisUSBPacket) || htons(pkt->hdr.signature) != HERMES_METIS_SIGNATURE || pkt->hdr.type != METIS_PKT_USB) {
                     continue;
                 }
 
-                // Check if this is a response
-                if (hdr->c0 & (1 << 7)) {
-                    uint8_t reg = (hdr->c0 >> 1) & 0x3F;
-                    flog::warn("Got response! Reg={0}, Seq={1}", reg, (uint32_t)htonl(pkt->seq));
+                // Count the packets that were skipped in the sequence. Packets slightly older than the last one were
+                // reordered and arrived too late, they are dropped. A large jump back means the stream was restarted.
+                uint32_t seq = htonl(pkt->seq);
+                int32_t gap = seq - lastSeq - 1;
+                if (seqValid && gap < 0 && gap >= -HERMES_MAX_REORDER) { continue; }
+                if (seqValid && gap > 0) { lostPackets += gap; }
+                lastSeq = seq;
+                seqValid = true;
+                receivedPackets++;
+
+                // Parse frames
+                for (int frn = 0; frn < 2; frn++) {
+                    uint8_t* frame = pkt->frame[frn];
+                    HPSDRUSBHeader* hdr = (HPSDRUSBHeader*)frame;
+
+                    // Make sure this is a valid frame by checking the sync
+                    if (hdr->sync[0] != 0x7F || hdr->sync[1] != 0x7F || hdr->sync[2] != 0x7F) {
+                        continue;
+                    }
+
+                    // Check if this is a response
+                    if (hdr->c0 & (1 << 7)) {
+                        uint8_t reg = (hdr->c0 >> 1) & 0x3F;
+                        flog::warn("Got response! Reg={0}, Seq={1}", reg, seq);
+                    }
+
+                    // Decode IQ and send to stream once enough was accumulated
+                    // Each sample is 24bit I, 24bit Q (swapped for some reason) and 16bit microphone data
+                    dsp::convert::s24ToComplex(&frame[8], &out.writeBuf[count], HERMES_FRAME_SAMPLES, true, 1.0f / (float)0x1000000, 0.0f, 8, true);
+                    count += HERMES_FRAME_SAMPLES;
+                    if (count >= blockSize) {
+                        if (!out.swap(count)) {
+                            delete[] rbuf;
+                            return;
+                        }
+                        count = 0;
+                    }
                 }
-
-                // Decode and send IQ to stream
-                uint8_t* iq = &frame[8];
-                for (int i = 0; i < 63; i++) {
-                    // Convert to 32bit
-                    int32_t si = ((uint32_t)iq[(i*8) + 0] << 16) | ((uint32_t)iq[(i*8) + 1] << 8) | (uint32_t)iq[(i*8) + 2];
-                    int32_t sq = ((uint32_t)iq[(i*8) + 3] << 16) | ((uint32_t)iq[(i*8) + 4] << 8) | (uint32_t)iq[(i*8) + 5];
-                    
-                    // Sign extend
-                    si = (si << 8) >> 8;
-                    sq = (sq << 8) >> 8;
-
-                    // Convert to float (IQ swapped for some reason)
-                    out.writeBuf[i].im = (float)si / (float)0x1000000;
-                    out.writeBuf[i].re = (float)sq / (float)0x1000000;
-                }
-                out.swap(63);
-                // TODO: Buffer the data to avoid having a very high DSP frame rate
-            }            
+            }
         }
+        delete[] rbuf;
     }
 
     std::vector<Info> discover() {
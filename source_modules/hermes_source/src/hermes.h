@@ -6,12 +6,18 @@
 #include <vector>
 #include <string>
 #include <thread>
+#include <atomic>
 
 #define HERMES_METIS_REPEAT     5
 #define HERMES_METIS_TIMEOUT    1000
 #define HERMES_METIS_SIGNATURE  0xEFFE
 #define HERMES_HPSDR_USB_SYNC   0x7F
 #define HERMES_I2C_DELAY        50
+#define HERMES_RECV_BATCH       32
+#define HERMES_MAX_REORDER      256
+#define HERMES_MAX_PACKET_SIZE  2048
+#define HERMES_FRAME_SAMPLES    63
+#define HERMES_MIN_BUFFER_TIME  0.001
 
 namespace hermes {
     enum MetisPacketType {
@@ -138,6 +144,24 @@ namespace hermes {
         void setGain(int gain);
         void autoFilters(double freq);
 
+        /**
+         * Set the duration of the buffers sent to the output stream.
+         * @param seconds Buffer duration in seconds.
+         */
+        void setBufferTime(double seconds);
+
+        /**
+         * Get the number of packets that were lost since the client was opened.
+         * @return Number of missing sequence numbers.
+         */
+        uint64_t getLostPackets();
+
+        /**
+         * Get the number of packets that were received since the client was opened.
+         * @return Number of received IQ packets.
+         */
+        uint64_t getReceivedPackets();
+
         dsp::stream<dsp::complex_t> out;
 
     //private:
@@ -154,6 +178,13 @@ namespace hermes {
         void worker();
 
         double freq = 0;
+        double samplerate = 384000.0;
+        double bufferTime = 0.01;
+
+        uint32_t lastSeq = 0;
+        bool seqValid = false;
+        std::atomic<uint64_t> lostPackets = 0;
+        std::atomic<uint64_t> receivedPackets = 0;
 
         std::thread workerThread;
         std::shared_ptr<net::Socket> sock;
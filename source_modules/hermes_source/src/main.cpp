@@ -10,6 +10,7 @@
 #include <gui/widgets/stepped_slider.h>
 #include <dsp/routing/stream_link.h>
 #include <utils/optionlist.h>
+#include <inttypes.h>
 
 #define CONCAT(a, b) ((std::string(a) + b).c_str())
 
@@ -36,6 +37,15 @@ public:
 
         srId = samplerates.keyId(384000);
 
+        // Define buffer durations
+        bufferTimes.define(1, "1ms", 0.001);
+        bufferTimes.define(5, "5ms", 0.005);
+        bufferTimes.define(10, "10ms", 0.010);
+        bufferTimes.define(20, "20ms", 0.020);
+        bufferTimes.define(50, "50ms", 0.050);
+
+        btId = bufferTimes.keyId(10);
+
         lnk.init(NULL, &stream);
 
         sampleRate = 384000.0;
@@ -101,6 +111,7 @@ private:
 
         // Default config
         srId = samplerates.valueId(hermes::HL_SAMP_RATE_384KHZ);
+        btId = bufferTimes.keyId(10);
         gain = 0;
 
         // Load config
@@ -111,6 +122,10 @@ private:
             int sr = config.conf["devices"][selectedMac]["samplerate"];
             if (samplerates.keyExists(sr)) { srId = samplerates.keyId(sr); }
         }
+        if (config.conf["devices"][selectedMac].contains("bufferTime")) {
+            int bt = config.conf["devices"][selectedMac]["bufferTime"];
+            if (bufferTimes.keyExists(bt)) { btId = bufferTimes.keyId(bt); }
+        }
         if (config.conf["devices"][selectedMac].contains("gain")) {
             gain = config.conf["devices"][selectedMac]["gain"];
         }
@@ -152,6 +167,7 @@ private:
         
         // TODO: Implement start
         _this->dev = hermes::open(_this->devices[_this->devId].addr);
+        _this->dev->setBufferTime(_this->bufferTimes[_this->btId]);
 
         // TODO: STOP USING A LINK, FIND A BETTER WAY
         _this->lnk.setInput(&_this->dev->out);
@@ -227,6 +243,16 @@ private:
             _this->selectMac(mac);
         }
 
+        SmGui::LeftLabel("Buffer");
+        SmGui::FillWidth();
+        if (SmGui::Combo(CONCAT("##_hermes_bt_sel_", _this->name), &_this->btId, _this->bufferTimes.txt)) {
+            if (!_this->selectedMac.empty()) {
+                config.acquire();
+                config.conf["devices"][_this->selectedMac]["bufferTime"] = _this->bufferTimes.key(_this->btId);
+                config.release(true);
+            }
+        }
+
         if (_this->running) { SmGui::EndDisabled(); }
 
         // TODO: Device parameters
@@ -243,6 +269,12 @@ private:
                 config.release(true);
             }
         }
+
+        if (_this->running) {
+            char buf[128];
+            sprintf(buf, "Lost packets: %" PRIu64 " / %" PRIu64, _this->dev->getLostPackets(), _this->dev->getReceivedPackets());
+            SmGui::Text(buf);
+        }
     }
 
     std::string name;
@@ -256,10 +288,12 @@ private:
 
     OptionList<std::string, hermes::Info> devices;
     OptionList<int, hermes::HermesLiteSamplerate> samplerates;
+    OptionList<int, double> bufferTimes;
 
     double freq;
     int devId = 0;
     int srId = 0;
+    int btId = 0;
     int gain = 0;
 
     bool firstSelect = true;
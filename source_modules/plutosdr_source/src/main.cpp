@@ -5,6 +5,7 @@
 #include <core.h>
 #include <gui/style.h>
 #include <gui/smgui.h>
+#include <dsp/convert/sample_format.h>
 #include <iio.h>
 #include <ad9361.h>
 
@@ -256,13 +257,7 @@ private:
             iio_buffer_refill(rxbuf);
 
             int16_t* buf = (int16_t*)iio_buffer_first(rxbuf, rx0_i);
-
-            for (int i = 0; i < blockSize; i++) {
-                _this->stream.writeBuf[i].re = (float)buf[i * 2] / 32768.0f;
-                _this->stream.writeBuf[i].im = (float)buf[(i * 2) + 1] / 32768.0f;
-            }
-
-            volk_16i_s32f_convert_32f((float*)_this->stream.writeBuf, buf, 32768.0f, blockSize * 2);
+            dsp::convert::s16ToComplex(buf, _this->stream.writeBuf, blockSize);
 
             if (!_this->stream.swap(blockSize)) { break; };
         }
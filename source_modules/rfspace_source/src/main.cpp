@@ -28,6 +28,14 @@ public:
     RFSpaceSourceModule(std::string name) {
         this->name = name;
 
+        // Define block durations
+        blockTimes.define(5, "5ms", 0.005);
+        blockTimes.define(10, "10ms", 0.010);
+        blockTimes.define(20, "20ms", 0.020);
+        blockTimes.define(50, "50ms", 0.050);
+        blockTimes.define(100, "100ms", 0.100);
+        btId = blockTimes.keyId(10);
+
         handler.ctx = this;
         handler.selectHandler = menuSelected;
         handler.deselectHandler = menuDeselected;
@@ -99,6 +107,7 @@ private:
         if (_this->running) { return; }
 
         // TODO: Set configuration here
+        if (_this->client) { _this->client->setBlockTime(_this->blockTimes[_this->btId]); }
         if (_this->client) { _this->client->start(rfspace::RFSPACE_SAMP_FORMAT_COMPLEX, rfspace::RFSPACE_SAMP_FORMAT_16BIT); }
 
         _this->running = true;
@@ -179,6 +188,14 @@ private:
                 config.release(true);
             }
 
+            SmGui::LeftLabel("Block size");
+            SmGui::FillWidth();
+            if (SmGui::Combo("##rfspace_source_block_time", &_this->btId, _this->blockTimes.txt)) {
+                config.acquire();
+                config.conf["devices"][_this->devConfName]["blockTime"] = _this->blockTimes.key(_this->btId);
+                config.release(true);
+            }
+
             if (_this->running) { SmGui::EndDisabled(); }
 
             if (_this->client->deviceId == rfspace::RFSPACE_DEV_ID_CLOUD_IQ) {
@@ -206,6 +223,12 @@ private:
             SmGui::Text("Status:");
             SmGui::SameLine();
             SmGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), _this->connectedStr.c_str());
+
+            if (_this->running) {
+                char buf[128];
+                sprintf(buf, "Throughput: %.3lfMS/s (%d%%)", _this->client->getThroughput() / 1e6, (int)round(_this->client->getThroughputRatio() * 100.0));
+                SmGui::Text(buf);
+            }
         }
         else {
             SmGui::Text("Status:");
@@ -247,6 +270,7 @@ private:
         // Load config
         srId = 0;
         rfPortId = 0;
+        btId = blockTimes.keyId(10);
         bool changed = false;
         config.acquire();
         if (!config.conf["devices"].contains(devConfName)) {
@@ -263,6 +287,12 @@ private:
                 srId = sampleRates.keyId(sr);
             }
         }
+        if (config.conf["devices"][devConfName].contains("blockTime")) {
+            int bt = config.conf["devices"][devConfName]["blockTime"];
+            if (blockTimes.keyExists(bt)) {
+                btId = blockTimes.keyId(bt);
+            }
+        }
         if (config.conf["devices"][devConfName].contains("gain")) {
             gain = config.conf["devices"][devConfName]["gain"];
         }
@@ -299,6 +329,9 @@ private:
     OptionList<std::string, rfspace::RFPort> rfPorts;
     int rfPortId = 0;
 
+    OptionList<int, double> blockTimes;
+    int btId = 0;
+
     float gain = 0;
 
     char hostname[1024];
@@ -1,5 +1,5 @@
 #include <rfspace_client.h>
-#include <volk/volk.h>
+#include <dsp/convert/sample_format.h>
 #include <cstring>
 #include <utils/flog.h>
 
@@ -16,8 +16,10 @@ namespace rfspace {
         sbuffer = new uint8_t[RFSPACE_MAX_SIZE];
         ubuffer = new uint8_t[RFSPACE_MAX_SIZE];
 
-        // Clear write stop of stream just in case
+        // Clear write stop of stream just in case and start aggregating the received samples
         output->clearWriteStop();
+        aggregator.init(output);
+        aggregator.start();
 
         // Send UDP packet so that a router opens the port
         sendDummyUDP();
@@ -134,6 +136,19 @@ namespace rfspace {
 
     void RFspaceClientClass::setSampleRate(uint32_t sampleRate) {
         setControlItemWithChanID(RFSPACE_CTRL_ITEM_IQ_SAMP_RATE, 0, &sampleRate, sizeof(sampleRate));
+        aggregator.setSamplerate(sampleRate);
+    }
+
+    void RFspaceClientClass::setBlockTime(double seconds) {
+        aggregator.setBlockTime(seconds);
+    }
+
+    double RFspaceClientClass::getThroughput() {
+        return aggregator.getThroughput();
+    }
+
+    double RFspaceClientClass::getThroughputRatio() {
+        return aggregator.getThroughputRatio();
     }
 
     void RFspaceClientClass::start(SampleFormat sampleFormat, SampleDepth sampleDepth) {
@@ -147,13 +162,12 @@ namespace rfspace {
     }
 
     void RFspaceClientClass::close() {
-        output->stopWriter();
+        aggregator.stop();
         stopHeartBeat = true;
         heartBeatCnd.notify_all();
         if (heartBeatThread.joinable()) { heartBeatThread.join(); }
         client->close();
         udpClient->close();
-        output->clearWriteStop();
     }
 
     bool RFspaceClientClass::isOpen() {
@@ -196,8 +210,11 @@ namespace rfspace {
         if (type == RFSPACE_MSG_TYPE_T2H_DATA_ITEM_0) {
             int16_t* samples = (int16_t*)&buf[4];
             int sampCount = (size - 4) / (2 * sizeof(int16_t));
-            volk_16i_s32f_convert_32f((float*)_this->output->writeBuf, samples, 32768.0f, sampCount * 2);
-            _this->output->swap(sampCount);
+            dsp::complex_t* out = _this->aggregator.reserve(sampCount);
+            if (out) {
+                dsp::convert::s16ToComplex(samples, out, sampCount);
+                _this->aggregator.commit(sampCount);
+            }
         }
 
         // Restart an async read
@@ -2,6 +2,7 @@
 #include <utils/networking.h>
 #include <dsp/stream.h>
 #include <dsp/types.h>
+#include <dsp/buffer/block_aggregator.h>
 #include <atomic>
 #include <queue>
 
@@ -113,6 +114,24 @@ namespace rfspace {
         void setPort(RFPort port);
         void setGain(int8_t gain);
         void setSampleRate(uint32_t sampleRate);
+
+        /**
+         * Set the duration of the blocks sent to the DSP.
+         * @param seconds Block duration in seconds.
+         */
+        void setBlockTime(double seconds);
+
+        /**
+         * Get the measured network throughput.
+         * @return Throughput in samples per second.
+         */
+        double getThroughput();
+
+        /**
+         * Get the measured network throughput relative to the samplerate.
+         * @return Ratio between the throughput and samplerate.
+         */
+        double getThroughputRatio();
         
         void start(SampleFormat sampleFormat, SampleDepth sampleDepth);
         void stop();
@@ -131,6 +150,7 @@ namespace rfspace {
         net::Conn udpClient;
 
         dsp::stream<dsp::complex_t>* output;
+        dsp::buffer::BlockAggregator<dsp::complex_t> aggregator;
 
         uint16_t tcpHeader;
         uint16_t udpHeader;
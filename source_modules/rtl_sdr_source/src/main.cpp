@@ -6,6 +6,7 @@
 #include <gui/style.h>
 #include <config.h>
 #include <gui/smgui.h>
+#include <dsp/convert/sample_format.h>
 #include <rtl-sdr.h>
 
 #ifdef __ANDROID__
@@ -522,10 +523,7 @@ private:
     static void asyncHandler(unsigned char* buf, uint32_t len, void* ctx) {
         RTLSDRSourceModule* _this = (RTLSDRSourceModule*)ctx;
         int sampCount = len / 2;
-        for (int i = 0; i < sampCount; i++) {
-            _this->stream.writeBuf[i].re = (float)(buf[i * 2] - 127) / 128.0f;
-            _this->stream.writeBuf[i].im = (float)(buf[(i * 2) + 1] - 127) / 128.0f;
-        }
+        dsp::convert::u8ToComplex(buf, _this->stream.writeBuf, sampCount, 1.0f / 128.0f, 127.0f);
         if (!_this->stream.swap(sampCount)) { return; }
     }
 
@@ -44,8 +44,16 @@ public:
         directSamplingModes.define(1, "I branch", 1);
         directSamplingModes.define(2, "Q branch", 2);
 
-        // Select the default samplerate instead of id 0
+        // Define block durations
+        blockTimes.define(5, "5ms", 0.005);
+        blockTimes.define(10, "10ms", 0.010);
+        blockTimes.define(20, "20ms", 0.020);
+        blockTimes.define(50, "50ms", 0.050);
+        blockTimes.define(100, "100ms", 0.100);
+
+        // Select the default samplerate and block duration instead of id 0
         srId = samplerates.valueId(2.4e6);
+        btId = blockTimes.keyId(10);
 
         // Load config
         config.acquire();
@@ -60,6 +68,10 @@ public:
             double sr = config.conf["sampleRate"];
             if (samplerates.keyExists(sr)) { srId = samplerates.keyId(sr); }
         }
+        if (config.conf.contains("blockTime")) {
+            int bt = config.conf["blockTime"];
+            if (blockTimes.keyExists(bt)) { btId = blockTimes.keyId(bt); }
+        }
         if (config.conf.contains("directSamplingMode")) {
             int mode = config.conf["directSamplingMode"];
             if (directSamplingModes.keyExists(mode)) { directSamplingId = directSamplingModes.keyId(mode); }
@@ -138,6 +150,7 @@ private:
         }
         
         // Sync settings
+        _this->client->setBlockTime(_this->blockTimes[_this->btId]);
         _this->client->setFrequency(_this->freq);
         _this->client->setSampleRate(_this->sampleRate);
         _this->client->setPPM(_this->ppm);
@@ -201,6 +214,14 @@ private:
             config.release(true);
         }
 
+        SmGui::LeftLabel("Block size");
+        SmGui::FillWidth();
+        if (SmGui::Combo(CONCAT("##_rtltcp_bt_", _this->name), &_this->btId, _this->blockTimes.txt)) {
+            config.acquire();
+            config.conf["blockTime"] = _this->blockTimes.key(_this->btId);
+            config.release(true);
+        }
+
         if (_this->running) { SmGui::EndDisabled(); }
 
         SmGui::LeftLabel("Direct Sampling");
@@ -281,6 +302,12 @@ private:
             config.conf["tunerAGC"] = _this->tunerAGC;
             config.release(true);
         }
+
+        if (_this->running) {
+            char buf[128];
+            sprintf(buf, "Throughput: %.3lfMS/s (%d%%)", _this->client->getThroughput() / 1e6, (int)round(_this->client->getThroughputRatio() * 100.0));
+            SmGui::Text(buf);
+        }
     }
 
     std::string name;
@@ -296,6 +323,7 @@ private:
     char ip[1024] = "localhost";
     int port = 1234;
     int srId = 0;
+    int btId = 0;
     int directSamplingId = 0;
     int ppm = 0;
     int gain = 0;
@@ -306,6 +334,7 @@ private:
 
     OptionList<double, double> samplerates;
     OptionList<int, int> directSamplingModes;
+    OptionList<int, double> blockTimes;
 };
 
 MOD_EXPORT void _INIT_() {
@@ -1,4 +1,5 @@
 #include "rtl_tcp_client.h"
+#include <dsp/convert/sample_format.h>
 
 namespace rtltcp {
     Client::Client(std::shared_ptr<net::Socket> sock, dsp::stream<dsp::complex_t>* stream) {
@@ -6,6 +7,8 @@ namespace rtltcp {
         this->stream = stream;
 
         // Start worker
+        aggregator.init(stream);
+        aggregator.start();
         workerThread = std::thread(&Client::worker, this);
     }
 
@@ -19,11 +22,10 @@ namespace rtltcp {
 
     void Client::close() {
         sock->close();
-        stream->stopWriter();
+        aggregator.stop();
         if (workerThread.joinable()) {
             workerThread.join();
         }
-        stream->clearWriteStop();
     }
 
     void Client::setFrequency(double freq) {
@@ -32,7 +34,7 @@ namespace rtltcp {
 
     void Client::setSampleRate(double sr) {
         sendCommand(2, sr);
-        bufferSize = sr / 200.0;
+        aggregator.setSamplerate(sr);
     }
 
     void Client::setGainMode(int mode) {
@@ -67,28 +69,43 @@ namespace rtltcp {
         sendCommand(14, enabled);
     }
 
+    void Client::setBlockTime(double seconds) {
+        aggregator.setBlockTime(seconds);
+    }
+
+    double Client::getThroughput() {
+        return aggregator.getThroughput();
+    }
+
+    double Client::getThroughputRatio() {
+        return aggregator.getThroughputRatio();
+    }
+
     void Client::sendCommand(uint8_t command, uint32_t param) {
         Command cmd = { command, htonl(param) };
         sock->send((uint8_t*)&cmd, sizeof(Command));
     }
 
     void Client::worker() {
-        uint8_t* buffer = dsp::buffer::alloc<uint8_t>(STREAM_BUFFER_SIZE*2);
+        uint8_t* buffer = dsp::buffer::alloc<uint8_t>(RTL_TCP_RECV_SIZE);
+        int leftover = 0;
 
         while (true) {
-            // Read data
-            int count = sock->recv(buffer, bufferSize * 2, true);
+            // Read whatever data is available
+            int count = sock->recv(&buffer[leftover], RTL_TCP_RECV_SIZE - leftover);
             if (count <= 0) { break; }
-
-            // Convert to complex float
-            int scount = count/2;
-            for (int i = 0; i < scount; i++) {
-                stream->writeBuf[i].re = ((double)buffer[i * 2] - 128.0) / 128.0;
-                stream->writeBuf[i].im = ((double)buffer[(i * 2) + 1] - 128.0) / 128.0;
-            }
-
-            // Swap buffer
-            if (!stream->swap(scount)) { break; }
+            count += leftover;
+
+            // Convert to complex float directly into the aggregator
+            int scount = count / 2;
+            dsp::complex_t* out = aggregator.reserve(scount);
+            if (!out) { break; }
+            dsp::convert::u8ToComplex(buffer, out, scount);
+            aggregator.commit(scount);
+
+            // Keep the incomplete sample for the next read
+            leftover = count & 1;
+            if (leftover) { buffer[0] = buffer[count - 1]; }
         }
 
         dsp::buffer::free(buffer);
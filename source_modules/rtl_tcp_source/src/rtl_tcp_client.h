@@ -2,8 +2,11 @@
 #include <utils/net.h>
 #include <dsp/stream.h>
 #include <dsp/types.h>
+#include <dsp/buffer/block_aggregator.h>
 #include <thread>
 
+#define RTL_TCP_RECV_SIZE   (256 * 1024)
+
 namespace rtltcp {
 #pragma pack(push, 1)
         struct Command {
@@ -31,6 +34,24 @@ namespace rtltcp {
         void setGainIndex(int index);
         void setBiasTee(bool enabled);
 
+        /**
+         * Set the duration of the blocks sent to the DSP.
+         * @param seconds Block duration in seconds.
+         */
+        void setBlockTime(double seconds);
+
+        /**
+         * Get the measured network throughput.
+         * @return Throughput in samples per second.
+         */
+        double getThroughput();
+
+        /**
+         * Get the measured network throughput relative to the samplerate.
+         * @return Ratio between the throughput and samplerate.
+         */
+        double getThroughputRatio();
+
     private:
         void sendCommand(uint8_t command, uint32_t param);
         void worker();
@@ -38,7 +59,7 @@ namespace rtltcp {
         std::shared_ptr<net::Socket> sock;
         std::thread workerThread;
         dsp::stream<dsp::complex_t>* stream;
-        int bufferSize = 2400000 / 200;
+        dsp::buffer::BlockAggregator<dsp::complex_t> aggregator;
     };
 
     std::shared_ptr<Client> connect(dsp::stream<dsp::complex_t>* stream, std::string host, int port = 1234);
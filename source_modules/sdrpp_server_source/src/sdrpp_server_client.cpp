@@ -69,8 +69,9 @@ namespace server {
             elemId.str = diffId;
 
             // Encore packet
+            bool diff = uiDiffSupported;
             int size = 0;
-            s_cmd_data[size++] = syncRequired;
+            s_cmd_data[size++] = (syncRequired ? UI_FLAG_SENDBACK : 0) | (diff ? UI_FLAG_DIFF : 0);
             size += SmGui::DrawList::storeItem(elemId, &s_cmd_data[size], SERVER_MAX_PACKET_SIZE - size);
             size += SmGui::DrawList::storeItem(diffValue, &s_cmd_data[size], SERVER_MAX_PACKET_SIZE - size);
 
@@ -79,14 +80,17 @@ namespace server {
                 flog::warn("Action requires resync");
                 auto waiter = awaitCommandAck(COMMAND_UI_ACTION);
                 sendCommand(COMMAND_UI_ACTION, size);
+                bool valid = true;
                 if (waiter->await(PROTOCOL_TIMEOUT_MS)) {
-                    std::lock_guard lck(dlMtx);
-                    dl.load(r_cmd_data, r_pkt_hdr->size - sizeof(PacketHeader) - sizeof(CommandHeader));
+                    valid = loadUI(diff);
                 }
                 else {
                     flog::error("Timeout out after asking for UI");
                 }
                 waiter->handled();
+
+                // Ask for the full UI if the diff could not be applied
+                if (!valid && diff) { getUI(); }
                 flog::warn("Resync done");
             }
             else {
@@ -122,13 +126,13 @@ namespace server {
     void ClientClass::start() {
         if (!client || !client->isOpen()) { return; }
         sendCommand(COMMAND_START, 0);
-        getUI();
+        getUI(uiDiffSupported);
     }
 
     void ClientClass::stop() {
         if (!client || !client->isOpen()) { return; }
         sendCommand(COMMAND_STOP, 0);
-        getUI();
+        getUI(uiDiffSupported);
     }
 
     void ClientClass::close() {
@@ -165,6 +169,9 @@ namespace server {
                 _this->currentSampleRate = *(double*)_this->r_cmd_data;
                 core::setInputSampleRate(_this->currentSampleRate);
             }
+            else if (_this->r_cmd_hdr->cmd == COMMAND_UI_DIFF_SUPPORTED) {
+                _this->uiDiffSupported = true;
+            }
             else if (_this->r_cmd_hdr->cmd == COMMAND_DISCONNECT) {
                 flog::error("Asked to disconnect by the server");
                 _this->serverBusy = true;
@@ -217,12 +224,13 @@ namespace server {
         _this->client->readAsync(sizeof(PacketHeader), _this->rbuffer, tcpHandler, _this);
     }
 
-    int ClientClass::getUI() {
+    int ClientClass::getUI(bool diff) {
         auto waiter = awaitCommandAck(COMMAND_GET_UI);
-        sendCommand(COMMAND_GET_UI, 0);
+        s_cmd_data[0] = UI_FLAG_DIFF;
+        sendCommand(COMMAND_GET_UI, diff ? 1 : 0);
+        bool valid = true;
         if (waiter->await(PROTOCOL_TIMEOUT_MS)) {
-            std::lock_guard lck(dlMtx);
-            dl.load(r_cmd_data, r_pkt_hdr->size - sizeof(PacketHeader) - sizeof(CommandHeader));
+            valid = loadUI(diff);
         }
         else {
             if (!serverBusy) { flog::error("Timeout out after asking for UI"); };
@@ -230,9 +238,26 @@ namespace server {
             return serverBusy ? -2 : -1;
         }
         waiter->handled();
+
+        // Ask for the full UI if the diff could not be applied
+        if (!valid && diff) { return getUI(); }
         return 0;
     }
 
+    bool ClientClass::loadUI(bool diff) {
+        uint8_t* data = r_cmd_data;
+        int len = r_pkt_hdr->size - sizeof(PacketHeader) - sizeof(CommandHeader);
+        std::lock_guard lck(dlMtx);
+
+        // Without diffs, the whole UI is sent as is
+        if (!diff) { return dl.load(data, len) >= 0; }
+
+        // Otherwise, the first byte tells if the rest is a full UI or changes to apply to the current one
+        if (len < 1) { return false; }
+        if (data[0] == UI_FORMAT_DIFF) { return dl.loadDiff(&data[1], len - 1) >= 0; }
+        return dl.load(&data[1], len - 1) >= 0;
+    }
+
     void ClientClass::sendPacket(PacketType type, int len) {
         s_pkt_hdr->type = type;
         s_pkt_hdr->size = sizeof(PacketHeader) + len;
@@ -100,7 +100,8 @@ namespace server {
     private:
         static void tcpHandler(int count, uint8_t* buf, void* ctx);
 
-        int getUI();
+        int getUI(bool diff = false);
+        bool loadUI(bool diff);
 
         void sendPacket(PacketType type, int len);
         void sendCommand(Command cmd, int len);
@@ -134,6 +135,7 @@ namespace server {
 
         SmGui::DrawList dl;
         std::mutex dlMtx;
+        bool uiDiffSupported = false;
 
         ZSTD_DCtx* dctx;
 
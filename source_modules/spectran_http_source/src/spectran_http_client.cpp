@@ -1,5 +1,8 @@
 #include "spectran_http_client.h"
 #include <utils/flog.h>
+#include <dsp/convert/sample_format.h>
+#include <string.h>
+#include <stdlib.h>
 
 SpectranHTTPClient::SpectranHTTPClient(std::string host, int port, dsp::stream<dsp::complex_t>* stream) {
     this->stream = stream;
@@ -9,12 +12,13 @@ SpectranHTTPClient::SpectranHTTPClient(std::string host, int port, dsp::stream<d
     this->port = port;
     sock = net::connect(host, port);
     http = net::http::Client(sock);
+    reader = net::http::StreamReader(sock);
 
     // Make request
     net::http::RequestHeader rqhdr(net::http::METHOD_GET, "/stream?format=float32", host);
     http.sendRequestHeader(rqhdr);
     net::http::ResponseHeader rshdr;
-    http.recvResponseHeader(rshdr, 5000);
+    reader.recvResponseHeader(rshdr, 5000);
 
     if (rshdr.getStatusCode() != net::http::STATUS_CODE_OK) {
         flog::error("HTTP request did not return ok: {}", rshdr.getStatusString());
@@ -63,45 +67,44 @@ void SpectranHTTPClient::setCenterFrequency(uint64_t freq) {
     flog::debug("Response: {}", rshdr.getStatusString());
 }
 
+static bool findJSONInt(std::string_view json, std::string_view key, int64_t& value) {
+    // Parse the number right after the key (yes, this is hacky, but it must be extremely fast)
+    auto begin = json.find(key);
+    if (begin == std::string_view::npos) { return false; }
+    begin += key.size();
+    char buf[32];
+    size_t len = std::min<size_t>(json.size() - begin, sizeof(buf) - 1);
+    memcpy(buf, &json[begin], len);
+    buf[len] = 0;
+    char* end;
+    value = strtoll(buf, &end, 10);
+    return end != buf;
+}
+
 void SpectranHTTPClient::worker() {
     while (sock->isOpen()) {
-        // Get chunk header
-        net::http::ChunkHeader chdr;
-        int err = http.recvChunkHeader(chdr, 5000);
-        if (err < 0) { return; }
-
-        // If null length, finish
-        size_t clen = chdr.getLength();
-        if (!clen) { return; }
-
-        // Read JSON
-        std::string jsonData;
-        int jlen = sock->recvline(jsonData, clen, 5000);
-        if (jlen <= 0) {
+        // Get a whole chunk from the reader, if null length, finish
+        uint8_t* chunk;
+        int clen = reader.recvChunk(&chunk, 5000);
+        if (clen <= 0) { return; }
+
+        // Find the end of the JSON metadata line
+        uint8_t* jsonEnd = (uint8_t*)memchr(chunk, '\n', clen);
+        if (!jsonEnd) {
             flog::error("Couldn't read JSON metadata");
             return;
         }
+        int jlen = (jsonEnd - chunk) + 1;
+        std::string_view jsonData((char*)chunk, jlen - 1);
 
-        // Decode JSON (yes, this is hacky, but it must be extremely fast)
-        auto startFreqBegin = jsonData.find("\"startFrequency\":");
-        auto startFreqEnd = jsonData.find(',', startFreqBegin);
-        std::string startFreqStr = jsonData.substr(startFreqBegin + 17, startFreqEnd - startFreqBegin - 17);
-        int64_t startFreq = std::stoll(startFreqStr);
-
-        auto endFreqBegin = jsonData.find("\"endFrequency\":");
-        auto endFreqEnd = jsonData.find(',', endFreqBegin);
-        std::string endFreqStr = jsonData.substr(endFreqBegin + 15, endFreqEnd - endFreqBegin - 15);
-        int64_t endFreq = std::stoll(endFreqStr);
-
-        auto sampleFreqBegin = jsonData.find("\"sampleFrequency\":");
-        bool sampleFreqReceived = (sampleFreqBegin != -1);
-        int64_t sampleFreq;
-        if (sampleFreqReceived) {
-            auto sampleFreqEnd = jsonData.find(',', sampleFreqBegin);
-            std::string sampleFreqStr = jsonData.substr(sampleFreqBegin + 18, sampleFreqEnd - sampleFreqBegin - 18);
-            sampleFreq = std::stoll(sampleFreqStr);
-            //flog::debug("{}", jsonData);
+        // Decode JSON
+        int64_t startFreq, endFreq;
+        if (!findJSONInt(jsonData, "\"startFrequency\":", startFreq) || !findJSONInt(jsonData, "\"endFrequency\":", endFreq)) {
+            flog::error("Invalid JSON metadata");
+            return;
         }
+        int64_t sampleFreq;
+        bool sampleFreqReceived = findJSONInt(jsonData, "\"sampleFrequency\":", sampleFreq);
         
         // Calculate and update center freq
         int64_t samplerate = /* sampleFreqReceived ? sampleFreq :  */(endFreq - startFreq);
@@ -117,39 +120,21 @@ void SpectranHTTPClient::worker() {
             onSamplerateChanged(samplerate);
         }
 
-        // Read (and check for) record separator
-        uint8_t rs;
-        int rslen = sock->recv(&rs, 1, true, 5000);
-        if (rslen != 1 || rs != 0x1E) {
+        // Check for record separator
+        if (jlen >= clen || chunk[jlen] != 0x1E) {
             flog::error("Missing record separator");
             return;
         }
 
-        // Read data
-        uint8_t* buf = (uint8_t*)stream->writeBuf;
-        int sampLen = 0;
-        for (int i = jlen + 1; i < clen;) {
-            int read = sock->recv(&buf[sampLen], clen - i, true);
-            if (read <= 0) {
-                flog::error("Recv failed while reading data");
+        // Convert the samples straight from the receive buffer and swap to stream
+        if (streamingEnabled) {
+            int sampCount = (clen - jlen - 1) / sizeof(dsp::complex_t);
+            if (sampCount > STREAM_BUFFER_SIZE) {
+                flog::error("Chunk of {0} samples is larger than the stream buffer", sampCount);
                 return;
             }
-            i += read;
-            sampLen += read;
-        }
-        int sampCount = sampLen / 8;
-
-        // Swap to stream
-        if (streamingEnabled) {
+            dsp::convert::f32ToComplex((const float*)&chunk[jlen + 1], stream->writeBuf, sampCount);
             if (!stream->swap(sampCount)) { return; }
         }
-        
-        // Read trailing CRLF
-        std::string dummy;
-        sock->recvline(dummy, 2);
-        if (dummy != "\r") {
-            flog::error("Missing trailing CRLF");
-            return;
-        }
     }
 }
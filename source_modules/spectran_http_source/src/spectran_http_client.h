@@ -29,6 +29,7 @@ private:
 
     std::shared_ptr<net::Socket> sock;
     net::http::Client http;
+    net::http::StreamReader reader;
     dsp::stream<dsp::complex_t>* stream;
     std::thread workerThread;
 
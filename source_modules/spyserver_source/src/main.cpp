@@ -9,6 +9,7 @@
 #include <config.h>
 #include <gui/widgets/stepped_slider.h>
 #include <gui/smgui.h>
+#include <utils/optionlist.h>
 
 
 #define CONCAT(a, b) ((std::string(a) + b).c_str())
@@ -51,9 +52,21 @@ public:
     SpyServerSourceModule(std::string name) {
         this->name = name;
 
+        // Define block durations
+        blockTimes.define(5, "5ms", 0.005);
+        blockTimes.define(10, "10ms", 0.010);
+        blockTimes.define(20, "20ms", 0.020);
+        blockTimes.define(50, "50ms", 0.050);
+        blockTimes.define(100, "100ms", 0.100);
+        btId = blockTimes.keyId(10);
+
         config.acquire();
         std::string host = config.conf["hostname"];
         port = config.conf["port"];
+        if (config.conf.contains("blockTime")) {
+            int bt = config.conf["blockTime"];
+            if (blockTimes.keyExists(bt)) { btId = blockTimes.keyId(bt); }
+        }
         config.release();
 
         handler.ctx = this;
@@ -134,6 +147,8 @@ private:
         _this->client->setSetting(SPYSERVER_SETTING_STREAMING_MODE, SPYSERVER_STREAM_MODE_IQ_ONLY);
         _this->client->setSetting(SPYSERVER_SETTING_GAIN, _this->gain);
         _this->client->setSetting(SPYSERVER_SETTING_IQ_DIGITAL_GAIN, _this->client->computeDigitalGain(srvBits, _this->gain, _this->srId + _this->client->devInfo.MinimumIQDecimation));
+        _this->client->setSamplerate(_this->sampleRate);
+        _this->client->setBlockTime(_this->blockTimes[_this->btId]);
         _this->client->startStream();
 
         _this->running = true;
@@ -203,6 +218,14 @@ private:
                 config.conf["devices"][_this->devRef]["sampleRateId"] = _this->srId;
                 config.release(true);
             }
+
+            SmGui::LeftLabel("Block size");
+            SmGui::FillWidth();
+            if (SmGui::Combo(CONCAT("##_spyserver_bt_", _this->name), &_this->btId, _this->blockTimes.txt)) {
+                config.acquire();
+                config.conf["blockTime"] = _this->blockTimes.key(_this->btId);
+                config.release(true);
+            }
             if (_this->running) { style::endDisabled(); }
 
             SmGui::LeftLabel("Sample bit depth");
@@ -232,6 +255,12 @@ private:
             SmGui::Text("Status:");
             SmGui::SameLine();
             ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Connected (%s)", deviceTypesStr[_this->client->devInfo.DeviceType]);
+
+            if (_this->running) {
+                char buf[128];
+                sprintf(buf, "Throughput: %.3lfMS/s (%d%%)", _this->client->getThroughput() / 1e6, (int)round(_this->client->getThroughputRatio() * 100.0));
+                SmGui::Text(buf);
+            }
         }
         else {
             SmGui::Text("Status:");
@@ -304,6 +333,9 @@ private:
 
     uint32_t gain = 0;
 
+    int btId = 0;
+    OptionList<int, double> blockTimes;
+
     std::string devRef = "";
 
     dsp::stream<dsp::complex_t> stream;
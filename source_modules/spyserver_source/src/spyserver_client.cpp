@@ -1,5 +1,5 @@
 #include <spyserver_client.h>
-#include <volk/volk.h>
+#include <dsp/convert/sample_format.h>
 #include <cstring>
 
 using namespace std::chrono_literals;
@@ -12,6 +12,7 @@ namespace spyserver {
         output = out;
 
         output->clearWriteStop();
+        aggregator.init(output);
 
         sendHandshake("SDR++");
 
@@ -25,17 +26,17 @@ namespace spyserver {
     }
 
     void SpyServerClientClass::startStream() {
-        output->clearWriteStop();
+        aggregator.start();
         setSetting(SPYSERVER_SETTING_STREAMING_ENABLED, true);
     }
 
     void SpyServerClientClass::stopStream() {
-        output->stopWriter();
+        aggregator.stop();
         setSetting(SPYSERVER_SETTING_STREAMING_ENABLED, false);
     }
 
     void SpyServerClientClass::close() {
-        output->stopWriter();
+        aggregator.stop();
         client->close();
     }
 
@@ -59,6 +60,22 @@ namespace spyserver {
         }
     }
 
+    void SpyServerClientClass::setSamplerate(double samplerate) {
+        aggregator.setSamplerate(samplerate);
+    }
+
+    void SpyServerClientClass::setBlockTime(double seconds) {
+        aggregator.setBlockTime(seconds);
+    }
+
+    double SpyServerClientClass::getThroughput() {
+        return aggregator.getThroughput();
+    }
+
+    double SpyServerClientClass::getThroughputRatio() {
+        return aggregator.getThroughputRatio();
+    }
+
     bool SpyServerClientClass::waitForDevInfo(int timeoutMS) {
         std::unique_lock lck(deviceInfoMtx);
         auto now = std::chrono::system_clock::now();
@@ -105,6 +122,44 @@ namespace spyserver {
         return read;
     }
 
+    void SpyServerClientClass::writeIQ(int mtype, int mflags) {
+        int sampSize;
+        switch (mtype) {
+            case SPYSERVER_MSG_TYPE_UINT8_IQ:   sampSize = sizeof(uint8_t) * 2; break;
+            case SPYSERVER_MSG_TYPE_INT16_IQ:   sampSize = sizeof(int16_t) * 2; break;
+            case SPYSERVER_MSG_TYPE_INT24_IQ:   sampSize = 6; break;
+            default:                            sampSize = sizeof(dsp::complex_t); break;
+        }
+        int sampCount = receivedHeader.BodySize / sampSize;
+        float gain = pow(10, (double)mflags / 20.0);
+
+        // Convert directly into the aggregator, in pieces if the message is larger than what it accepts at once
+        for (int i = 0; i < sampCount;) {
+            int count = std::min<int>(sampCount - i, BLOCK_AGGREGATOR_MAX_WRITE);
+            dsp::complex_t* out = aggregator.reserve(count);
+            if (!out) { return; }
+
+            uint8_t* in = &readBuf[i * sampSize];
+            switch (mtype) {
+                case SPYSERVER_MSG_TYPE_UINT8_IQ:
+                    dsp::convert::u8ToComplex(in, out, count, 1.0f / (gain * 128.0f));
+                    break;
+                case SPYSERVER_MSG_TYPE_INT16_IQ:
+                    dsp::convert::s16ToComplex((int16_t*)in, out, count, 1.0f / (32768.0f * gain));
+                    break;
+                case SPYSERVER_MSG_TYPE_INT24_IQ:
+                    dsp::convert::s24ToComplex(in, out, count, false, 1.0f / (8388608.0f * gain));
+                    break;
+                default:
+                    dsp::convert::f32ToComplex((float*)in, out, count, gain);
+                    break;
+            }
+
+            aggregator.commit(count);
+            i += count;
+        }
+    }
+
     void SpyServerClientClass::dataHandler(int count, uint8_t* buf, void* ctx) {
         SpyServerClientClass* _this = (SpyServerClientClass*)ctx;
 
@@ -132,31 +187,8 @@ namespace spyserver {
             }
             _this->deviceInfoCnd.notify_all();
         }
-        else if (mtype == SPYSERVER_MSG_TYPE_UINT8_IQ) {
-            int sampCount = _this->receivedHeader.BodySize / (sizeof(uint8_t) * 2);
-            float gain = pow(10, (double)mflags / 20.0);
-            float scale = 1.0f / (gain * 128.0f);
-            for (int i = 0; i < sampCount; i++) {
-                _this->output->writeBuf[i].re = ((float)_this->readBuf[(2 * i)] - 128.0f) * scale;
-                _this->output->writeBuf[i].im = ((float)_this->readBuf[(2 * i) + 1] - 128.0f) * scale;
-            }
-            _this->output->swap(sampCount);
-        }
-        else if (mtype == SPYSERVER_MSG_TYPE_INT16_IQ) {
-            int sampCount = _this->receivedHeader.BodySize / (sizeof(int16_t) * 2);
-            float gain = pow(10, (double)mflags / 20.0);
-            volk_16i_s32f_convert_32f((float*)_this->output->writeBuf, (int16_t*)_this->readBuf, 32768.0 * gain, sampCount * 2);
-            _this->output->swap(sampCount);
-        }
-        else if (mtype == SPYSERVER_MSG_TYPE_INT24_IQ) {
-            printf("ERROR: IQ format not supported\n");
-            return;
-        }
-        else if (mtype == SPYSERVER_MSG_TYPE_FLOAT_IQ) {
-            int sampCount = _this->receivedHeader.BodySize / sizeof(dsp::complex_t);
-            float gain = pow(10, (double)mflags / 20.0);
-            volk_32f_s32f_multiply_32f((float*)_this->output->writeBuf, (float*)_this->readBuf, gain, sampCount * 2);
-            _this->output->swap(sampCount);
+        else if (mtype == SPYSERVER_MSG_TYPE_UINT8_IQ || mtype == SPYSERVER_MSG_TYPE_INT16_IQ || mtype == SPYSERVER_MSG_TYPE_INT24_IQ || mtype == SPYSERVER_MSG_TYPE_FLOAT_IQ) {
+            _this->writeIQ(mtype, mflags);
         }
 
         _this->client->readAsync(sizeof(SpyServerMessageHeader), (uint8_t*)&_this->receivedHeader, dataHandler, _this);
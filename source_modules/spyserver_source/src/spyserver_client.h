@@ -3,6 +3,7 @@
 #include <spyserver_protocol.h>
 #include <dsp/stream.h>
 #include <dsp/types.h>
+#include <dsp/buffer/block_aggregator.h>
 
 namespace spyserver {
     class SpyServerClientClass {
@@ -22,6 +23,30 @@ namespace spyserver {
 
         int computeDigitalGain(int serverBits, int deviceGain, int decimationId);
 
+        /**
+         * Set the samplerate of the IQ stream, used to compute block sizes and throughput.
+         * @param samplerate Samplerate in samples per second.
+         */
+        void setSamplerate(double samplerate);
+
+        /**
+         * Set the duration of the blocks sent to the DSP.
+         * @param seconds Block duration in seconds.
+         */
+        void setBlockTime(double seconds);
+
+        /**
+         * Get the measured network throughput.
+         * @return Throughput in samples per second.
+         */
+        double getThroughput();
+
+        /**
+         * Get the measured network throughput relative to the samplerate.
+         * @return Ratio between the throughput and samplerate.
+         */
+        double getThroughputRatio();
+
         SpyServerDeviceInfo devInfo;
 
     private:
@@ -30,6 +55,8 @@ namespace spyserver {
 
         int readSize(int count, uint8_t* buffer);
 
+        void writeIQ(int mtype, int mflags);
+
         static void dataHandler(int count, uint8_t* buf, void* ctx);
 
         net::Conn client;
@@ -44,6 +71,7 @@ namespace spyserver {
         SpyServerMessageHeader receivedHeader;
 
         dsp::stream<dsp::complex_t>* output;
+        dsp::buffer::BlockAggregator<dsp::complex_t> aggregator;
     };
 
     typedef std::unique_ptr<SpyServerClientClass> SpyServerClient;